@@ -3,9 +3,17 @@
 
 #include "hlgl/hlgl-base.h"
 #include "hlgl/hlgl-buffer.h"
+#include "hlgl/hlgl-gltf.h"
+#include "hlgl/hlgl-mesh.h"
+#include "hlgl/hlgl-meshlet.h"
 #include "hlgl/hlgl-pipeline.h"
+#include "hlgl/hlgl-profiler.h"
+#include "hlgl/hlgl-query.h"
 #include "hlgl/hlgl-shader.h"
 #include "hlgl/hlgl-texture.h"
+#include "hlgl/hlgl-texture-atlas.h"
+#include "hlgl/hlgl-image.h"
+#include "hlgl/hlgl-virtual-texture.h"
 
 namespace hlgl {
 
@@ -13,7 +21,7 @@ namespace hlgl {
 // Functions
 
 struct                InitContextParams {
-  WindowHandle window;                                                  // Handle/pointer to the window which the renderer should draw to.  Required!
+  WindowHandle window;                                                  // Handle/pointer to the window which the renderer should draw to.  Required, unless 'headless' is set.
   const char* appName {nullptr};                                        // Name of the application.  Optional.
   struct {uint32_t major {0}, minor {0}, patch {0};} appVer {};         // Version of the application.  Defaults to {0,0,0}.
   const char* engineName {nullptr};                                     // Name of the engine that the application is running on.  Optional.
@@ -24,6 +32,8 @@ struct                InitContextParams {
   Features requiredFeatures {Feature::None};                            // The set of features which must be enabled, causing initialization to fail in their absence.
   VsyncMode vsync {VsyncMode::Fifo};                                    // The Vsync mode which should be used initally.  This can be changed after context initialization.
   bool hdr {false};                                                     // Whether HDR should be enabled initially.  This can be changed after context intitialization.
+  bool headless {false};                                                // Run without a window or swapchain, for render farms, CI, and server-side compute.  See 'isHeadless'.
+  struct {uint32_t width {1920}, height {1080};} headlessSize {};      // Initial size of the offscreen display when headless.  This can be changed later with 'setDisplaySize'.
   };
 bool                  initContext(InitContextParams params);                                    // Initialize the HLGL context.  Returns false if initialization fails, in which case the application should close.
 void                  shutdownContext();                                                        // Shuts down the HLGL context, cleaning up any remaining objects and GPU resources.
@@ -49,6 +59,28 @@ void                  blitImage(
                         Texture* dst, Texture* src,
                         BlitRegion dstRegion, BlitRegion srcRegion,
                         bool filterLinear = false);
+struct                DynamicResolutionParams {
+  bool enabled {false};           // When disabled, the render scale is always 1.
+  float targetFrameTime {16.6f};  // The GPU time per frame to aim for, in milliseconds.
+  float minScale {0.5f};          // The lowest render scale, relative to the display size.  No lower than 0.25.
+  float maxScale {1.0f};          // The highest render scale.  No higher than 1.
+  float decreaseRate {0.5f};      // How far the scale moves toward its ideal value each frame when over budget, from 0 to 1.
+  float increaseRate {0.05f};     // How far the scale moves toward its ideal value each frame when under budget.  Lower than 'decreaseRate', so it doesn't oscillate.
+  };
+enum class            UpscaleFilter {
+  Bilinear, // A linearly filtered blit.  'src' needs the TransferSrc usage.
+  Sharpen,  // Bilinear filtering followed by contrast adaptive sharpening, in a compute pass.  Both textures need the Storage usage.
+  };
+void                  upscale(                                                                  // Scales 'src' up to the size of 'dst', such as a render-sized texture to the swapchain image (bilinear only).
+                        Texture* dst, Texture* src,
+                        UpscaleFilter filter = UpscaleFilter::Bilinear,
+                        float sharpness = 0.5f);
+// 'depth' needs a sampler so it can be read, and 'pyramid' needs the Storage usage, a sampler, and a single-channel float format such as R32f.
+// Each texel reduces every texel it overlaps in the level above (or in 'depth'), including the extra row or column of odd-sized levels, so the pyramid stays conservative at any size.
+// Use FilterMode::Max for 'cullDraws', or FilterMode::Min with reversed depth.  Giving 'pyramid' a sampler with the same filtering makes its samples conservative too.
+void                  buildDepthPyramid(                                                        // Reduces 'depth' into every mip level of 'pyramid' with a min or max reduction sampler, for occlusion culling.
+                        Texture* depth, Texture* pyramid,
+                        FilterMode reduction = FilterMode::Max);
 void                  dispatch(                                                                 // Executes the currently bound compute pipeline using the given group counts.
                         uint32_t groupCountX,
                         uint32_t groupCountY,
@@ -91,7 +123,41 @@ void                  drawIndexedIndirectCount(
                         DeviceSize countOffset,
                         uint32_t maxDraws,
                         uint32_t stride);
+void                  drawMeshTasks(                                                            // Launches task shader workgroups (or mesh shader workgroups, without a task shader) according to the currently bound graphics pipeline.  Needs Feature::MeshShading.
+                        uint32_t groupCountX,
+                        uint32_t groupCountY = 1,
+                        uint32_t groupCountZ = 1);
+void                  drawMeshTasksIndirect(                                                    // Executes 'drawCount' mesh task draw calls using commands contained in 'drawBuffer'.
+                        Buffer* drawBuffer,
+                        DeviceSize drawOffset,
+                        uint32_t drawCount,
+                        uint32_t stride);
+void                  drawMeshTasksIndirectCount(                                               // Uses 'countBuffer' to determine how many mesh task draw calls to execute using commands in 'drawBuffer'.
+                        Buffer* drawBuffer,
+                        DeviceSize drawOffset,
+                        Buffer* countBuffer,
+                        DeviceSize countOffset,
+                        uint32_t maxDraws,
+                        uint32_t stride);
+struct                CullParams {
+  Buffer* instances {nullptr};      // An array of 'instanceCount' CullInstance structures.  Needs the DeviceAddressable usage.
+  uint32_t instanceCount {0};
+  Buffer* drawBuffer {nullptr};     // Receives a tightly packed DrawIndexedIndirectEntry for each visible instance.  Needs the Indirect and DeviceAddressable usages, and room for 'instanceCount' entries.
+  DeviceSize drawOffset {0};
+  Buffer* countBuffer {nullptr};    // Receives the number of visible instances as a uint32.  Needs the Indirect, DeviceAddressable and TransferDst usages.
+  DeviceSize countOffset {0};
+  const float* viewProj {nullptr};  // The column-major view-projection matrix the instances are culled against, such as from glm::value_ptr.  Required.
+  Texture* hiZ {nullptr};           // A depth pyramid from the previous frame (see 'buildDepthPyramid'), for occlusion culling.  Optional.
+  bool reverseZ {false};            // Set if greater depth is nearer, in which case 'hiZ' should be built with FilterMode::Min.
+  Buffer* lods {nullptr};           // An array of MeshLod structures, which instances with levels of detail refer to.  Needs the DeviceAddressable usage.  Optional.
+  float lodScale {0.0f};            // Pixels per unit at a distance of one unit (see 'getLodScale').  0 disables level of detail selection.
+  float lodThreshold {1.0f};        // The most error, in pixels, a level of detail may show.  Each instance draws the coarsest level within it.
+  };
+void                  cullDraws(CullParams params);                                             // Culls instances against the view frustum (and 'hiZ') and picks their levels of detail, writing the draws of visible instances to 'drawBuffer' for 'drawIndexedIndirectCount', with a stride of sizeof(DrawIndexedIndirectEntry).
 void                  endDrawing();                                                             // Ends the current drawing pass.
+void                  beginAsyncCompute();                                                      // Following compute work (pipelines, push constants, dispatches and barriers) is recorded for the async compute queue, overlapping the graphics work.
+void                  endAsyncCompute();                                                        // Returns to recording graphics work.  The bound pipeline is reset, so it has to be bound again.
+void                  waitAsyncCompute();                                                       // Graphics work recorded after this waits for all async compute work recorded so far.  Call it just before the results are needed, to keep the overlap.
 void                  endFrame();                                                               // Ends the frame, executing command buffers and displaying the swapchain image to the screen.
 int64_t               getFrameCounter();                                                        // Gets the counter for the current frame (increments by one for each drawn frame).
 Texture*              getFrameSwapchainImage();                                                 // Gets the current swapchain image which this frame will draw to.
@@ -101,13 +167,21 @@ float                 getDisplayAspectRatio();
 ImageFormat           getDisplayFormat();                                                       // Gets the image format of the display's surface.
 void                  getDisplaySize(uint32_t& w, uint32_t& h);                                 // Gets the of the display.  Width is stored in 'w' and height is stored in 'h'.
 const GpuProperties&  getGpuProperties();                                                       // Gets the properties of the GPU being used by HLGL.
+MemoryBudget          getMemoryBudget();                                                        // Gets the current budget and usage of each GPU memory heap.
+float                 getGpuFrameTime();                                                        // Gets the GPU time of the most recently finished frame, in milliseconds.  0 if the GPU doesn't support timestamps.
+float                 getRenderScale();                                                         // Gets the current render scale, which is only below 1 when dynamic resolution is enabled.
+void                  getRenderSize(uint32_t& w, uint32_t& h);                                  // Gets the render size, which is the display size multiplied by the render scale.  RenderSize textures are this size.
 VsyncMode             getVsync();                                                               // Gets the current vsync mode.
+bool                  isAsyncComputeAvailable();                                                // Returns true if the GPU has a compute queue separate from graphics.  Otherwise async compute sections are recorded along with the graphics work.
 bool                  isDepthFormatSupported(ImageFormat format);                               // Returns true if the provided format is supported as a depth-stencil format by the GPU being used by HLGL.
+bool                  isTextureFormatSupported(ImageFormat format);                             // Returns true if the provided format can be sampled with linear filtering by the GPU being used by HLGL.
 bool                  isHdrEnabled();                                                           // Returns true if HDR rendering is currently enabled.
+bool                  isHeadless();                                                             // Returns true if running without a window.  The "swapchain image" is then an offscreen RGBA8i_srgb target (one per frame in flight) which is never presented.
 inline bool           isValidationEnabled()                                                     // Returns true if validation is enabled.  Equivalent to (getGpuProperties().enabledFeatures & Feature::Validation).
                         { return (getGpuProperties().enabledFeatures & Feature::Validation); }
 
-void                  setDisplaySize(uint32_t w, uint32_t h);                                   // After the display resizes, use this to provide a hint for what size the new swapchain should be.
+void                  setDisplaySize(uint32_t w, uint32_t h);                                   // After the display resizes, use this to provide a hint for what size the new swapchain should be.  When headless, this sets the size of the offscreen targets.
+void                  setDynamicResolution(DynamicResolutionParams params);                     // Sets how the render scale follows GPU frame time.  The new scale takes effect at the next 'beginFrame'.
 void                  setHdr(bool mode);                                                        // Sets whether to request an HDR surface.  If HDR support isn't available, it will be disabled.
 void                  setVsync(VsyncMode mode);                                                 // Sets the requested vsync mode.  If the requested mode isn't available, the swapchain may default to "Fifo".
 
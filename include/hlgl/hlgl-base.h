@@ -3,12 +3,14 @@
 
 #include <array>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <type_traits>
 #include <variant>
+#include <vector>
 
 namespace hlgl {
 
@@ -409,6 +411,9 @@ constexpr inline const char* enumToStr(DebugSeverity val) {
 // Function pointer used to print debug messages.
 using DebugCallbackFunc = void(*)(DebugSeverity, std::string_view);
 
+// Called with data read back from the GPU.  'data' is only valid for the duration of the call.
+using ReadbackFunc = std::function<void(const void* data, size_t size)>;
+
 // A {float, int} pair used for a clear value for a depth-stencil attachment.
 struct DepthStencilClearVal { float depth {0.0f}; uint32_t stencil {0}; };
 
@@ -443,6 +448,33 @@ struct DrawIndirectEntry {
   uint32_t firstInstance;
 };
 
+// A drawBuffer used for indirect mesh task draw calls should be an array of this structure.
+// You may use a larger struct with additional per-object data, and adjust "stride" accordingly, but this struct should come before that data.
+struct DrawMeshTasksIndirectEntry {
+  uint32_t groupCountX;
+  uint32_t groupCountY;
+  uint32_t groupCountZ;
+};
+
+// A level of detail of a mesh, as a range of an index buffer.  See 'buildLodChain'.
+struct MeshLod {
+  uint32_t firstIndex;
+  uint32_t indexCount;
+  float error;        // How far the level may be from the full mesh, in the mesh's units.
+  uint32_t padding;
+};
+
+// The instance buffer read by 'cullDraws' should be an array of this structure.
+// 'draw' is copied to the draw buffer when the bounding sphere is visible, so use 'firstInstance' to find each object's data from the shaders.
+struct CullInstance {
+  float center[3];                // The world-space center of the object's bounding sphere.
+  float radius;                   // The radius of the bounding sphere.
+  DrawIndexedIndirectEntry draw;  // The draw command for the object.  With levels of detail, its 'firstIndex' and 'indexCount' are replaced by the chosen level's.
+  uint32_t firstLod {0};          // Where the object's levels of detail start in 'CullParams::lods', finest first.
+  uint32_t lodCount {0};          // 0 or 1 always draws 'draw' as it is.
+  float lodErrorScale {1.0f};     // Multiplies the levels' errors, such as by the object's world-space scale.
+};
+
 // Features which don't need to be supported by a GPU to use HLGL, but may be requested and used by the user.
 enum class Feature {
   None                = 0,
@@ -565,6 +597,23 @@ constexpr inline const char* enumToStr(ImageLayout val) {
   }
 }
 
+// The budget and usage of each GPU memory heap.
+// Budgets come from the driver when VK_EXT_memory_budget is available, otherwise they're estimated from the heap sizes.
+struct MemoryBudget {
+  struct Heap {
+    uint64_t size {0};                // Total size of the heap, in bytes.
+    uint64_t budget {0};              // How many bytes this process can use from the heap before allocations start failing or getting paged out.
+    uint64_t usage {0};               // How many bytes this process is currently using from the heap.
+    uint64_t allocated {0};           // How many of those bytes are occupied by HLGL's own allocations.
+    bool deviceLocal {false};         // Whether this heap is device-local VRAM.
+  };
+  std::array<Heap, 16> heaps {};      // One entry for each memory heap.  Only the first 'heapCount' entries are valid.
+  uint32_t heapCount {0};             // The number of memory heaps on the GPU.
+  uint64_t textureBytes {0};          // Bytes of memory used by all live textures.
+  uint64_t evictableTextureBytes {0}; // Bytes of memory used by textures created with 'TextureUsage::Evictable'.
+  bool fromDriver {false};            // True if budgets are reported by the driver rather than estimated.
+};
+
 // The type of a pipeline.
 enum class PipelineType {
   Compute,
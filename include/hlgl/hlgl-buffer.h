@@ -50,6 +50,12 @@ class Buffer {
 
   void updateData(void* data, size_t size, DeviceSize offset);
 
+  // Copies 'size' bytes starting at 'offset' back to the CPU, without stalling.  The buffer needs the TransferSrc usage.
+  // The copy is recorded into the current frame, and 'callback' is called from 'beginFrame' once that frame has finished on the GPU.
+  // 'size' may be 0 to read up to the end of the buffer.  Updateable buffers are read from the copy used by the current frame.
+  // Returns false if the copy couldn't be recorded, in which case 'callback' is never called.
+  bool readbackAsync(DeviceSize offset, DeviceSize size, ReadbackFunc callback);
+
   void barrier(bool read);
   void readBarrier() { barrier(true); }
   void writeBarrier() { barrier(false); }
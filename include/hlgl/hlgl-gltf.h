@@ -0,0 +1,110 @@
+#ifndef HLGL_GLTF_H
+#define HLGL_GLTF_H
+
+#include "hlgl-base.h"
+#include "hlgl-buffer.h"
+#include "hlgl-texture.h"
+
+#include <string>
+
+namespace hlgl {
+
+// glTF 2.0 scene loading.
+// Every mesh in a file is packed into one vertex buffer and one index buffer, and every material into one material buffer,
+// so a whole scene can be drawn through buffer device addresses (or 'drawIndexedIndirect') without rebinding anything.
+
+// The vertex format of a loaded scene.  Texture coordinates are stored in the padding after position and normal, keeping it at 48 bytes.
+struct GltfVertex {
+  float position[3];
+  float u;
+  float normal[3];
+  float v;
+  float tangent[4];   // xyz = tangent, w = bitangent sign.  Zero if the file doesn't provide tangents.
+};
+
+enum class GltfAlphaMode : uint32_t {
+  Opaque = 0,
+  Mask   = 1, // Fragments with alpha below 'alphaCutoff' are discarded.
+  Blend  = 2,
+};
+
+// A material, laid out so the material buffer can be read by shaders as-is.
+// Textures are bindless sampler indices (see 'Texture::getSamplerIndex'), where 0 means the material has no such texture.
+struct GltfMaterial {
+  float baseColorFactor[4] {1.0f, 1.0f, 1.0f, 1.0f};
+  float emissiveFactor[3] {0.0f, 0.0f, 0.0f};
+  float alphaCutoff {0.5f};
+  float metallicFactor {1.0f};
+  float roughnessFactor {1.0f};
+  float normalScale {1.0f};
+  float occlusionStrength {1.0f};
+  uint32_t baseColorTexture {0};          // sRGB.
+  uint32_t metallicRoughnessTexture {0};  // Roughness in green, metalness in blue.
+  uint32_t normalTexture {0};
+  uint32_t occlusionTexture {0};          // Occlusion in red.
+  uint32_t emissiveTexture {0};           // sRGB.
+  GltfAlphaMode alphaMode {GltfAlphaMode::Opaque};
+  uint32_t doubleSided {0};
+  uint32_t padding {0};
+};
+
+// A range of the packed index buffer, drawn with one material.
+// Indices are relative to 'vertexOffset', so a primitive can be drawn with 'drawIndexed(indexCount, ..., firstIndex, vertexOffset)'.
+struct GltfPrimitive {
+  uint32_t firstIndex;    // The full detail mesh.  Its simpler levels of detail follow it in the index buffer.
+  uint32_t indexCount;
+  uint32_t vertexOffset;
+  uint32_t vertexCount;
+  uint32_t material;      // Index into 'GltfScene::materials'.  Primitives without a material use a default one appended to the end.
+  float center[3];        // The bounding sphere of the primitive's vertices, in the mesh's space.
+  float radius;
+  uint32_t firstLod;      // Index into 'GltfScene::lods', where the first is the full detail mesh.
+  uint32_t lodCount;
+};
+
+struct GltfMesh {
+  std::string name {};
+  uint32_t firstPrimitive {0};  // Index into 'GltfScene::primitives'.
+  uint32_t primitiveCount {0};
+};
+
+// A node of the scene which has a mesh.
+struct GltfInstance {
+  float transform[16];  // Column-major, from the mesh's space to the scene's.
+  uint32_t mesh;        // Index into 'GltfScene::meshes'.
+};
+
+struct GltfScene {
+  std::optional<Buffer> vertexBuffer {};    // Every mesh's vertices, as 'GltfVertex'.
+  std::optional<Buffer> indexBuffer {};     // Every mesh's indices, as uint32.
+  std::optional<Buffer> materialBuffer {};  // Every material, as 'GltfMaterial'.
+  std::optional<Buffer> lodBuffer {};       // Every primitive's levels of detail, as 'MeshLod', for 'CullParams::lods'.
+  std::vector<Texture> textures {};         // Every texture which loaded.  Materials refer to them by sampler index.
+  std::vector<GltfMaterial> materials {};
+  std::vector<GltfPrimitive> primitives {};
+  std::vector<MeshLod> lods {};             // Ranges of the index buffer, with errors in the mesh's space.  See 'selectLod'.
+  std::vector<GltfMesh> meshes {};
+  std::vector<GltfInstance> instances {};   // The nodes of the file's default scene (or its first scene) which have a mesh.
+
+  bool isValid() const { return vertexBuffer && indexBuffer && materialBuffer; }
+  operator bool() const { return isValid(); }
+};
+
+struct LoadGltfParams {
+  const char* filename {nullptr};                 // A .glb or .gltf file.  Required.
+  BufferUsages bufferUsage {BufferUsage::None};   // Usages to add to the scene's buffers, which are always Storage and DeviceAddressable (plus Vertex or Index).
+  bool loadTextures {true};                       // Whether to load the file's textures.  If false, materials have no textures.
+  bool generateMips {true};                       // Whether to build mip chains for PNG and JPEG textures.  KTX2 textures keep their own.
+  uint32_t maxLods {1};                           // The most levels of detail to build for each primitive with 'buildLodChain', including the full mesh.  1 builds none.
+  TextureUsages textureUsage {TextureUsage::None};// Additional usage flags for textures, such as 'Evictable'.
+  const char* debugName {nullptr};
+};
+
+// Loads a glTF 2.0 file.  Binary files are memory-mapped rather than read.
+// Each primitive is read and run through 'optimizeMesh' (and 'buildLodChain') on worker threads, then every one is packed into the scene's buffers.
+// PNG and JPEG textures are decoded and mipmapped on worker threads, and KTX2 (KHR_texture_basisu) textures are loaded with 'Texture::loadKtx',
+// so loading is bound by I/O rather than by creating resources.  Returns an invalid scene if the file couldn't be loaded.
+GltfScene loadGltf(const LoadGltfParams& params);
+
+} // namespace hlgl
+#endif // HLGL_GLTF_H
@@ -0,0 +1,60 @@
+#ifndef HLGL_IMAGE_H
+#define HLGL_IMAGE_H
+
+#include "hlgl-base.h"
+#include "hlgl-texture.h"
+
+namespace hlgl {
+
+// CPU-side image processing, for preparing pixel data (from an image decoder, procedural generation, etc) to be uploaded to a Texture.
+// These functions use SIMD instructions (AVX2 or NEON) when available, and split large images across HLGL's worker threads.
+
+// The filter used to downsample each mip level from the one before it.
+enum class MipFilter {
+  Box,    // Averages each 2x2 block of pixels.  Fast, but slightly blurry and prone to aliasing.
+  Kaiser, // A wider Kaiser-windowed sinc filter, which keeps mips sharper at the cost of some ringing.
+};
+
+// Expands tightly packed 3-channel 8-bit pixels (RGB8 or BGR8) to 4 channels, setting each alpha to 'alpha'.
+// 'dst' must have room for 'pixelCount' * 4 bytes, and must not overlap 'src'.
+void expandRGB8ToRGBA8(const uint8_t* src, uint8_t* dst, size_t pixelCount, uint8_t alpha = 255);
+
+// Multiplies the color channels of 4-channel 8-bit pixels by their alpha, in place.
+// If 'srgb' is true, color is converted to linear before being multiplied, then back to sRGB.
+void premultiplyAlpha(uint8_t* rgba, size_t pixelCount, bool srgb);
+
+// Converts 32-bit floats to 16-bit half floats, rounding to nearest even.  Suitable for RGBA16f and similar formats.
+void packHalfFloats(const float* src, uint16_t* dst, size_t count);
+
+// A chain of mip levels stored contiguously, largest first, along with offsets which can be passed straight to Texture::CreateParams.
+struct MipChain {
+  ImageFormat format {ImageFormat::Undefined};
+  std::vector<uint8_t> data {};
+  std::vector<Texture::Offset> offsets {};
+  uint32_t width {0};
+  uint32_t height {0};
+  uint32_t mipCount {0};
+};
+
+// Builds a chain of 'mipCount' mip levels from a 4-channel 8-bit image (level 0 is copied as-is).  If 'mipCount' is 0, a full chain is built.
+// If 'srgb' is true, filtering is done in linear space so the mips don't darken.  Alpha is always treated as linear.
+MipChain buildMipChainRGBA8(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t mipCount, bool srgb, MipFilter filter = MipFilter::Box);
+
+// How hard the block compressor works to find the best endpoints for each block.
+enum class CompressionQuality {
+  Fast,   // Uses each block's bounding box.  Good enough for data which is regenerated often.
+  Normal, // Fits endpoints along each block's principal axis.
+  High,   // Additionally refines the endpoints with a few rounds of least squares fitting.
+};
+
+// Compresses every level and layer of a 4-channel 8-bit chain (as built by 'buildMipChainRGBA8') to a block compressed format.
+// Supported formats are BC1RGB, BC1RGBA, BC3, BC4u, BC5u, and BC7, plus their sRGB variants.  BC4 uses the red channel, BC5 uses red and green.
+// The data is compressed as-is, so an _srgb format should be used for sRGB data.  Blocks are spread across HLGL's worker threads.
+// Returns an empty chain if 'format' isn't supported.
+MipChain compressTexture(const MipChain& src, ImageFormat format, CompressionQuality quality = CompressionQuality::Normal);
+
+// Compresses a single 4-channel 8-bit image, as above.
+MipChain compressTexture(const uint8_t* rgba, uint32_t width, uint32_t height, ImageFormat format, CompressionQuality quality = CompressionQuality::Normal);
+
+} // namespace hlgl
+#endif // HLGL_IMAGE_H
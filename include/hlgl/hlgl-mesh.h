@@ -0,0 +1,170 @@
+#ifndef HLGL_MESH_H
+#define HLGL_MESH_H
+
+#include "hlgl-base.h"
+
+namespace hlgl {
+
+// CPU-side mesh processing, for preparing imported meshes to be uploaded to a Buffer.
+// Vertices are treated as opaque blocks of bytes, so any interleaved vertex format can be processed as long as it starts with (or contains) a float3 position.
+
+// The size of the post-transform vertex cache that meshes are optimized for, and that 'analyzeVertexCache' simulates by default.
+// Modern GPUs don't have a true FIFO cache, but their batching behaves similarly to one of about this size.
+constexpr uint32_t vertexCacheSize_c {16};
+
+// How well an index buffer reuses transformed vertices, as measured against a simulated FIFO cache.
+struct VertexCacheStats {
+  uint32_t vertexInvocations {0}; // How many times the vertex shader runs, which is the number of cache misses.
+  float acmr {0.0f};              // Average cache miss ratio: invocations per triangle.  3 is the worst possible, around 0.6 is excellent.
+  float atvr {0.0f};              // Average transformed vertex ratio: invocations per vertex.  1 is the best possible.
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = vertexCacheSize_c);
+
+struct OptimizeMeshParams {
+  const void* vertices {nullptr};     // Interleaved vertices.  Required.
+  size_t vertexCount {0};
+  size_t vertexSize {0};              // The size in bytes of each vertex.  Required.
+  size_t positionOffset {0};          // Where each vertex's position (as 3 floats) is, in bytes from the start of the vertex.
+  const uint32_t* indices {nullptr};  // A triangle list.  If null, every 3 vertices are a triangle, as with non-indexed drawing.
+  size_t indexCount {0};
+  bool weld {true};                   // Whether to merge vertices whose bytes are identical, which non-indexed or OBJ-style meshes are full of.
+  uint32_t cacheSize {vertexCacheSize_c};
+  float overdrawThreshold {1.05f};    // How much worse than optimal the cache hit rate may get in exchange for less overdraw.  0 skips overdraw optimization.
+};
+
+// The result of 'optimizeMesh'.
+struct OptimizedMesh {
+  std::vector<uint8_t> vertices {};   // Vertices in the same format as the input.
+  size_t vertexCount {0};
+  std::vector<uint32_t> indices {};
+  std::vector<uint8_t> packedIndices {}; // 'indices' packed into the smallest index size which can address every vertex.
+  uint8_t indexSize {4};                 // The size of each index in 'packedIndices': 2 if there are no more than 65536 vertices, otherwise 4.
+  VertexCacheStats before {};            // Cache statistics of the mesh as it was passed in.
+  VertexCacheStats after {};             // Cache statistics of the optimized mesh.
+};
+
+// Prepares a mesh for efficient rendering:
+// - Identical vertices are welded (by hashing their bytes), so shared vertices are only shaded once.
+// - Triangles are reordered for the vertex cache with Tipsify, which walks the mesh in fans and rarely misses the cache.
+// - The resulting clusters of triangles are reordered so the outward facing ones are drawn first, reducing overdraw from the mesh occluding itself.
+// - Vertices are reordered by first use, so vertex fetch moves through memory mostly forwards.  Unused vertices are dropped.
+// Returns an empty mesh if the parameters are invalid.
+OptimizedMesh optimizeMesh(const OptimizeMeshParams& params);
+
+// Optimizes several meshes at once, spread across HLGL's worker threads.
+std::vector<OptimizedMesh> optimizeMesh(const std::vector<OptimizeMeshParams>& params);
+
+// Reorders a triangle list's triangles for the vertex cache with Tipsify, without touching the vertices.
+// For index ranges which share a vertex buffer with others, such as levels of detail.
+std::vector<uint32_t> optimizeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = vertexCacheSize_c);
+
+// Compressed vertices.
+// A QuantizedVertex is 20 bytes, against 48 for a typical float vertex with position, normal, tangent, and texture coordinates.
+// Shaders decode them with the 'hlgl_vertex' Slang module, which any HLGL shader can use with 'import hlgl_vertex;'.
+
+// How quantized positions are stored.
+enum class PositionEncoding {
+  Unorm16,  // 16 bits per axis, spread evenly across the mesh's bounds.  Precision is the size of the bounds / 65535.
+  Half,     // Half floats, ignoring the bounds.  More precise near the origin and less precise far from it, so best for small meshes centered on it.
+};
+
+struct QuantizedVertex {
+  uint16_t position[3]; // See 'PositionEncoding'.
+  uint16_t padding;
+  uint32_t normal;      // Octahedral encoding, as two snorm16 values.
+  uint32_t tangent;     // Octahedral encoding like 'normal'.  The lowest bit of the second value is set if the bitangent sign is negative.
+  uint16_t uv[2];       // unorm16, spread evenly across the mesh's texture coordinate bounds.
+};
+
+// Where a mesh's quantized positions and texture coordinates lie, laid out so it can be passed to shaders as-is.
+struct QuantizationBounds {
+  float positionMin[3] {0.0f, 0.0f, 0.0f};
+  float padding0 {0.0f};
+  float positionExtent[3] {1.0f, 1.0f, 1.0f};
+  float padding1 {0.0f};
+  float uvMin[2] {0.0f, 0.0f};
+  float uvExtent[2] {1.0f, 1.0f};
+};
+
+// Marks a vertex attribute as absent in 'QuantizeVerticesParams'.
+constexpr size_t noAttribute_c {SIZE_MAX};
+
+struct QuantizeVerticesParams {
+  const void* vertices {nullptr};                     // Interleaved vertices.  Required.
+  size_t vertexCount {0};
+  size_t vertexSize {0};                              // The size in bytes of each vertex.  Required.
+  size_t positionOffset {0};                          // Where each attribute is, in bytes from the start of the vertex, or 'noAttribute_c'.
+  size_t normalOffset {noAttribute_c};                // Positions, normals, and texture coordinates are read as 3, 3, and 2 floats.
+  size_t tangentOffset {noAttribute_c};               // Tangents are read as 4 floats, with the bitangent sign in the last.
+  size_t uvOffset {noAttribute_c};
+  PositionEncoding positionEncoding {PositionEncoding::Unorm16};
+  const QuantizationBounds* bounds {nullptr};         // Bounds to quantize within, so several meshes can share them.  If null, the vertices' own bounds are used.
+};
+
+struct QuantizedMesh {
+  std::vector<QuantizedVertex> vertices {};
+  QuantizationBounds bounds {};
+};
+
+// Compresses vertices, using SIMD instructions (AVX2 or NEON) when available and splitting large meshes across HLGL's worker threads.
+// Absent attributes are left as zero.  Returns an empty mesh if the parameters are invalid.
+QuantizedMesh quantizeVertices(const QuantizeVerticesParams& params);
+
+// Compresses several meshes at once, spread across HLGL's worker threads.
+std::vector<QuantizedMesh> quantizeVertices(const std::vector<QuantizeVerticesParams>& params);
+
+// Levels of detail.
+// A mesh's levels of detail all index into its own vertex buffer, so they're simply more ranges of its index buffer.
+
+// The most attributes 'buildLodChain' takes into account.
+constexpr size_t maxLodAttributes_c {8};
+
+// A float of each vertex which 'buildLodChain' tries to preserve, such as one component of a normal or texture coordinate.
+struct LodAttribute {
+  size_t offset {0};    // Where the float is, in bytes from the start of the vertex.
+  float weight {1.0f};  // How much a change in the attribute counts as error, relative to moving the vertex by the size of the mesh's bounds.
+};
+
+struct BuildLodChainParams {
+  const void* vertices {nullptr};     // Interleaved vertices.  Required.
+  size_t vertexCount {0};
+  size_t vertexSize {0};              // The size in bytes of each vertex.  Required.
+  size_t positionOffset {0};          // Where each vertex's position (as 3 floats) is, in bytes from the start of the vertex.
+  const uint32_t* indices {nullptr};  // A welded triangle list, such as from 'optimizeMesh'.  Required.
+  size_t indexCount {0};
+  std::vector<LodAttribute> attributes {}; // Up to 'maxLodAttributes_c'.  Around 0.5 for each component of a normal and 1 for texture coordinates works well.
+  uint32_t maxLods {8};               // The most levels to build, including the full mesh.
+  float reduction {0.5f};             // How many of the previous level's triangles each level aims to keep.
+  size_t minTriangles {64};           // Levels aren't simplified below this many triangles.
+  float maxError {0.1f};              // The most a level may deviate from the full mesh, relative to the size of its bounds.
+};
+
+struct MeshLodChain {
+  std::vector<uint32_t> indices {};       // Every level's indices, finest first.
+  std::vector<uint8_t> packedIndices {};  // 'indices' packed like 'OptimizedMesh::packedIndices'.
+  uint8_t indexSize {4};
+  std::vector<MeshLod> lods {};           // Each level's range of 'indices'.  The first is the mesh as it was passed in, with an error of 0.
+};
+
+// Builds a chain of progressively simpler levels of detail, by collapsing edges in order of their quadric error (Garland & Heckbert 1997).
+// Each collapse moves one vertex onto a neighbour, so levels reuse the mesh's vertices.  It's attribute aware:
+// - Attributes are measured against what the original triangles would interpolate, so collapses that distort them cost more (see 'attributes').
+// - UV seams and hard edges (vertices sharing a position with different attributes) only collapse along the seam, with both sides together.
+// - Open borders only collapse along the border, and vertices where several seams or borders meet never move.
+// Each level is reordered with 'optimizeVertexCache'.  The chain stops early if a level can't be simplified within 'maxError'.
+// Returns an empty chain if the parameters are invalid.
+MeshLodChain buildLodChain(const BuildLodChainParams& params);
+
+// Builds several chains at once, spread across HLGL's worker threads.
+std::vector<MeshLodChain> buildLodChain(const std::vector<BuildLodChainParams>& params);
+
+// The size in pixels of one unit at a distance of one unit from the camera, for selecting levels of detail.
+float getLodScale(float fovY, float viewportHeight);
+
+// Picks the coarsest level whose error, projected onto the screen, is no more than 'threshold' pixels.  This is the choice 'cullDraws' makes on the GPU.
+// 'depth' is the view-space depth of the bounding sphere's center, and errors are multiplied by 'errorScale' (such as the object's scale) first.
+uint32_t selectLod(const MeshLod* lods, uint32_t lodCount, float depth, float radius, float lodScale, float threshold = 1.0f, float errorScale = 1.0f);
+
+} // namespace hlgl
+#endif // HLGL_MESH_H
@@ -0,0 +1,53 @@
+#ifndef HLGL_MESHLET_H
+#define HLGL_MESHLET_H
+
+#include "hlgl-base.h"
+
+namespace hlgl {
+
+// CPU-side meshlet building, for drawing with task and mesh shaders (see 'drawMeshTasks').
+// A meshlet is a small cluster of triangles with its own list of vertices, which a mesh shader workgroup can transform and output in one go.
+// Each meshlet has bounds, so whole clusters can be culled on the GPU before any of their vertices are processed.
+
+// The limits the meshlet builder defaults to.  64 vertices and 124 triangles fit the output limits of mesh shaders on every vendor.
+constexpr uint32_t meshletMaxVertices_c {64};
+constexpr uint32_t meshletMaxTriangles_c {124};
+
+// A meshlet, laid out so an array of them can be uploaded and read by shaders as-is.
+struct Meshlet {
+  uint32_t vertexOffset;    // The first entry of this meshlet in 'MeshletMesh::vertices'.
+  uint32_t triangleOffset;  // The first byte of this meshlet in 'MeshletMesh::triangles'.  Always a multiple of 4.
+  uint32_t vertexCount;
+  uint32_t triangleCount;
+  float center[3];          // The bounding sphere of the meshlet's vertices.
+  float radius;
+  float coneAxis[3];        // The normal cone of the meshlet's triangles.  Every triangle faces away from a camera at 'cameraPos' when
+  float coneCutoff;         // dot(center - cameraPos, coneAxis) >= coneCutoff * length(center - cameraPos) + radius.  1 if the cone is too wide to cull.
+};
+
+// The meshlets of one mesh.
+struct MeshletMesh {
+  std::vector<Meshlet> meshlets {};
+  std::vector<uint32_t> vertices {};  // For each meshlet, the indices of its vertices in the original vertex buffer.
+  std::vector<uint8_t> triangles {};  // For each meshlet, three bytes per triangle indexing into its own vertices, padded to a multiple of 4 bytes.
+};
+
+struct BuildMeshletsParams {
+  const uint32_t* indices {nullptr};             // The mesh's triangle list.  Required.
+  size_t indexCount {0};
+  const float* positions {nullptr};              // The position of each vertex, as 3 floats.  Required.
+  size_t vertexCount {0};
+  size_t positionStride {3 * sizeof(float)};     // The distance in bytes between each position, for positions interleaved with other attributes.
+  uint32_t maxVertices {meshletMaxVertices_c};   // No more than 256, since triangles index vertices with a byte.
+  uint32_t maxTriangles {meshletMaxTriangles_c}; // No more than 512.
+};
+
+// Splits a mesh into meshlets.  Triangles are gathered greedily, preferring those which share the most vertices with the meshlet being built,
+// so the meshlets are compact and little of each vertex's work is repeated.  Triangle order within the mesh isn't preserved.
+MeshletMesh buildMeshlets(const BuildMeshletsParams& params);
+
+// Builds the meshlets of several meshes at once, spread across HLGL's worker threads.
+std::vector<MeshletMesh> buildMeshlets(const std::vector<BuildMeshletsParams>& params);
+
+} // namespace hlgl
+#endif // HLGL_MESHLET_H
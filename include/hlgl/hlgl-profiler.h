@@ -0,0 +1,77 @@
+#ifndef HLGL_PROFILER_H
+#define HLGL_PROFILER_H
+
+#include "hlgl-base.h"
+
+#include <string>
+#include <vector>
+
+namespace hlgl {
+
+// ProfileScope measures how long the GPU spends on the commands recorded during its lifetime, using timestamp queries.
+// Scopes can be nested, and each frame's scopes form a tree under a root scope covering the whole frame.
+// Results are read back when the frame's fence is next waited on, so they're available from 'getProfileStats' a couple of frames later,
+// without stalling.  Scopes created outside of a frame, or on GPUs without timestamp support, do nothing.
+class ProfileScope {
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+  ProfileScope(ProfileScope&&) = delete;
+  ProfileScope& operator=(ProfileScope&&) = delete;
+  public:
+  ProfileScope(const char* name);
+  ~ProfileScope();
+
+  private:
+  int32_t scope_ {-1};
+  int64_t frame_ {-1};
+};
+
+struct ProfileNode {
+  std::string name;
+  float gpuTime {0.0f};         // Milliseconds, in the most recently resolved frame.
+  float avgGpuTime {0.0f};      // Milliseconds, smoothed over recent frames with the same scope structure.
+  uint32_t depth {0};           // 0 for the root scope covering the whole frame.
+  int32_t parent {-1};          // Index of the enclosing scope in 'ProfileStats::nodes', or -1 for the root.
+};
+
+struct ProfileStats {
+  int64_t frame {-1};                 // The frame counter of the frame these results are from.
+  std::vector<ProfileNode> nodes {};  // Every scope in the order they were opened, so each node's children follow it.
+};
+
+// Gets the timings of the most recently resolved frame.
+const ProfileStats& getProfileStats();
+
+// Draws the profile stats into an ImGui window, with a button to capture a CPU trace into 'hlgl-trace.json'.
+// Must be called between 'imguiNewFrame' and 'ImGui::Render'.
+void drawProfilerWindow(bool* open = nullptr);
+
+// TraceScope records how long the CPU spends in the enclosing scope on the calling thread, while a trace capture is running.
+// 'name' isn't copied, so it must outlive the capture; string literals are ideal.  When no capture is running a scope costs a single atomic load.
+// HLGL traces its own frame waits, swapchain acquires, submissions, presents, transfers, and shader and pipeline creation the same way.
+class TraceScope {
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+  TraceScope(TraceScope&&) = delete;
+  TraceScope& operator=(TraceScope&&) = delete;
+  public:
+  TraceScope(const char* name);
+  ~TraceScope();
+
+  private:
+  const char* name_ {nullptr};
+  uint64_t start_ {0};
+};
+
+// Starts recording trace scopes, discarding anything recorded by an earlier capture.
+// Each thread keeps its most recent events in a fixed-size ring buffer, so long captures only keep their end.
+void beginTraceCapture();
+// Stops recording trace scopes.  What was recorded is kept until the next capture begins.
+void endTraceCapture();
+bool isTraceCapturing();
+// Writes the recorded scopes to a Chrome trace event JSON file, which can be opened in Perfetto or chrome://tracing.
+// Should be called after 'endTraceCapture', since events recorded while saving may be lost.  Returns false if the file couldn't be written.
+bool saveTraceCapture(const char* path);
+
+} // namespace hlgl
+#endif // HLGL_PROFILER_H
@@ -0,0 +1,64 @@
+#ifndef HLGL_QUERY_H
+#define HLGL_QUERY_H
+
+#include "hlgl-base.h"
+
+namespace hlgl {
+
+enum class QueryType {
+  Occlusion,            // Counts the samples which pass the depth and stencil tests.  Exact on GPUs that support precise occlusion queries.
+  OcclusionBinary,      // Only tells whether any sample passed, which can be cheaper than counting them.
+  PipelineStatistics,   // Counts the work done by each stage of the pipeline, see PipelineStatistics.
+};
+
+// The counters collected by a PipelineStatistics query.
+struct PipelineStatistics {
+  uint64_t inputVertices {0};         // Vertices read by the input assembler.
+  uint64_t inputPrimitives {0};       // Primitives assembled from those vertices.
+  uint64_t vertexInvocations {0};     // Vertex shader invocations.  Can be lower than 'inputVertices' thanks to the post-transform cache.
+  uint64_t clippingInvocations {0};   // Primitives which reached the clipping stage.
+  uint64_t clippingPrimitives {0};    // Primitives output by clipping, which go on to be rasterized.
+  uint64_t fragmentInvocations {0};   // Fragment shader invocations.
+  uint64_t computeInvocations {0};    // Compute shader invocations.
+};
+
+struct QueryPoolImpl;
+
+// QueryPool holds a set of GPU queries which measure the commands recorded between 'begin' and 'end'.
+// Each frame in flight has its own set of queries, and their results are read back without stalling when the frame's fence is next waited on,
+// so a query's result becomes available a couple of frames after it was recorded.  Each query may only be used once per frame.
+class QueryPool {
+  QueryPool(const QueryPool&) = delete;
+  QueryPool& operator=(const QueryPool&) = delete;
+  public:
+  QueryPool(QueryPool&&) noexcept = default;
+  QueryPool& operator=(QueryPool&&) noexcept = default;
+  ~QueryPool();
+
+  struct CreateParams {
+    QueryType     type {QueryType::Occlusion};
+    uint32_t      count {1};                          // Number of queries in the pool.
+    const char*   debugName {nullptr};
+    };
+  QueryPool(CreateParams params);
+
+  bool isValid() const { return (bool)_pimpl; }
+  operator bool() const { return (bool)_pimpl; }
+
+  // Starts and ends query 'index' in the current frame.  A query started inside a drawing pass must end in the same drawing pass.
+  void begin(uint32_t index);
+  void end(uint32_t index);
+
+  // Gets the latest result of an occlusion query.  For binary queries 'samples' is non-zero if any sample passed.
+  // Returns false if the query hasn't produced a result yet.
+  bool getResult(uint32_t index, uint64_t& samples) const;
+  // Gets the latest result of a pipeline statistics query.  Returns false if the query hasn't produced a result yet.
+  bool getResult(uint32_t index, PipelineStatistics& stats) const;
+  // The frame counter of the frame which produced the latest result of query 'index', or -1 if it hasn't produced one yet.
+  int64_t getResultFrame(uint32_t index) const;
+
+  std::unique_ptr<QueryPoolImpl> _pimpl;
+};
+
+} // namespace hlgl
+#endif // HLGL_QUERY_H
@@ -0,0 +1,105 @@
+#ifndef HLGL_TEXTURE_ATLAS_H
+#define HLGL_TEXTURE_ATLAS_H
+
+#include "hlgl-base.h"
+#include "hlgl-texture.h"
+
+namespace hlgl {
+
+// Where an image was placed by a TextureArrayPool or TextureAtlas.
+// Shaders sample it from texture 'samplerIndex', at array layer 'layer', with UVs remapped to 'uvOffset + uv * uvScale'.
+struct TextureRegion {
+  uint32_t handle {0};              // Identifies the region when removing it.  0 if the image couldn't be inserted.
+  uint32_t samplerIndex {0};        // Sampler index of the texture holding the region.
+  uint32_t layer {0};               // Array layer holding the region.  Always 0 in an atlas.
+  float uvOffset[2] {0.0f, 0.0f};
+  float uvScale[2] {1.0f, 1.0f};
+
+  bool isValid() const { return handle != 0; }
+};
+
+struct TextureArrayPoolImpl;
+
+// TextureArrayPool stores many images of the same size and format as layers of a few array textures,
+// so they can share one descriptor and be picked between in shaders by layer, instead of each needing a texture of their own.
+// When every layer is taken another array texture is created, so regions from a pool may have different sampler indices.
+// Shaders should declare the bindless textures as 'Sampler2DArray' to sample pool textures.
+class TextureArrayPool {
+  TextureArrayPool(const TextureArrayPool&) = delete;
+  TextureArrayPool& operator=(const TextureArrayPool&) = delete;
+  public:
+  TextureArrayPool(TextureArrayPool&&) noexcept = default;
+  TextureArrayPool& operator=(TextureArrayPool&&) noexcept = default;
+  ~TextureArrayPool();
+
+  struct CreateParams {
+    uint32_t      width {0};                          // Width of every image in the pool.  Required!
+    uint32_t      height {0};                         // Height of every image in the pool.  Required!
+    uint32_t      mipCount {1};                       // Number of mip levels stored for each image.
+    ImageFormat   format {ImageFormat::Undefined};    // Pixel format of every image in the pool.  Required!
+    uint32_t      layersPerArray {64};                // Number of layers in each array texture.
+    std::optional<Texture::CreateParams::Sampler> sampler {Texture::CreateParams::Sampler{}};
+    const char*   debugName {nullptr};
+    };
+  TextureArrayPool(CreateParams params);
+
+  bool isValid() const { return (bool)_pimpl; }
+  operator bool() const { return (bool)_pimpl; }
+
+  // Copies an image into a free layer.  'data', 'dataSize', 'offsets' and 'numOffsets' work like Texture::CreateParams, except 'layer' is ignored.
+  // Without offsets, 'data' only holds the first mip level.  A MipChain can be passed as 'data.data()', 'data.size()', 'offsets.data()', 'offsets.size()'.
+  // Fails if 'dataSize' doesn't cover every level being copied.  Recorded into the current frame if there is one, otherwise it's executed immediately.
+  TextureRegion insert(const void* data, uint64_t dataSize = 0, const Texture::Offset* offsets = nullptr, uint32_t numOffsets = 0);
+  // Copies an existing texture into a free layer.  It must have the same size and format as the pool, and the TransferSrc usage.
+  TextureRegion insert(const Texture& texture);
+  // Frees a region's layer so it can be reused.  The layer's contents are left as they are until then.
+  void remove(const TextureRegion& region);
+
+  uint32_t getArrayCount() const;
+  uint32_t getUsedLayerCount() const;
+
+  std::unique_ptr<TextureArrayPoolImpl> _pimpl;
+};
+
+struct TextureAtlasImpl;
+
+// TextureAtlas packs images of any size into a few large textures, such as glyphs, sprites, or small material textures.
+// Images are placed in rows (shelves) of similar height, and space freed by removing an image is reused by later ones of the same or smaller size.
+// When an image doesn't fit anywhere another page (texture) is created.
+// Each image is surrounded by copies of its edge pixels, so bilinear filtering doesn't blend in its neighbors.
+// Atlas textures have a single mip level, since mips would blend neighboring images together.
+class TextureAtlas {
+  TextureAtlas(const TextureAtlas&) = delete;
+  TextureAtlas& operator=(const TextureAtlas&) = delete;
+  public:
+  TextureAtlas(TextureAtlas&&) noexcept = default;
+  TextureAtlas& operator=(TextureAtlas&&) noexcept = default;
+  ~TextureAtlas();
+
+  struct CreateParams {
+    uint32_t      width {2048};                       // Width of each page.
+    uint32_t      height {2048};                      // Height of each page.
+    ImageFormat   format {ImageFormat::Undefined};    // Pixel format.  Compressed formats aren't supported.  Required!
+    uint32_t      padding {1};                        // Pixels of repeated edge around each image.
+    std::optional<Texture::CreateParams::Sampler> sampler {Texture::CreateParams::Sampler{.filtering = FilterMode::Linear}};
+    const char*   debugName {nullptr};
+    };
+  TextureAtlas(CreateParams params);
+
+  bool isValid() const { return (bool)_pimpl; }
+  operator bool() const { return (bool)_pimpl; }
+
+  // Copies a 'width' x 'height' image of tightly packed pixels into the atlas.
+  // Recorded into the current frame if there is one, otherwise it's executed immediately.
+  TextureRegion insert(uint32_t width, uint32_t height, const void* data);
+  // Frees a region's space so it can be reused.  Its contents are left as they are until then.
+  void remove(const TextureRegion& region);
+
+  uint32_t getPageCount() const;
+  uint32_t getRegionCount() const;
+
+  std::unique_ptr<TextureAtlasImpl> _pimpl;
+};
+
+} // namespace hlgl
+#endif // HLGL_TEXTURE_ATLAS_H
@@ -14,9 +14,13 @@ enum class TextureUsage {
   Storage     = 1 << 3, // A storage image can be used as arbitrary data storage by shaders.
   TransferSrc = 1 << 4, // Valid source for transfer operations.
   TransferDst = 1 << 5, // Valid destination for transfer operations.
+  Evictable   = 1 << 6, // When GPU memory is over budget, HLGL may drop this texture's highest-resolution mip levels to free memory.
+  RenderSize  = 1 << 7, // Like ScreenSize, but follows the render size (see 'getRenderSize'), which is smaller than the display with dynamic resolution.
+  ArrayView   = 1 << 8, // The texture is viewed as an array even if it has a single layer, so it can always be sampled as a 'Sampler2DArray'.
+  Bucketed    = 1 << 9, // With ScreenSize or RenderSize, the image is allocated in steps of 256 pixels so most resizes don't reallocate it.  See 'getCapacity'.
   };
 using TextureUsages = Flags<TextureUsage>;
-template <> struct FlagsTraits<TextureUsage> { static constexpr bool isFlags {true}; static constexpr int32_t numBits {5}; };
+template <> struct FlagsTraits<TextureUsage> { static constexpr bool isFlags {true}; static constexpr int32_t numBits {10}; };
 
 struct TextureImpl;
 
@@ -24,6 +28,7 @@ struct TextureImpl;
 class Texture {
   Texture(const Texture&) = delete;
   Texture& operator=(const Texture&) = delete;
+  Texture(std::unique_ptr<TextureImpl>&& pimpl) noexcept;
   public:
   Texture(Texture&&) noexcept = default;
   Texture& operator=(Texture&&) noexcept = default;
@@ -40,8 +45,9 @@ class Texture {
     uint32_t      width {1};                        // Width of the texture, in pixels.  Cannot be 0.
     uint32_t      height {1};                       // Height of the texture, in pixels.  If 0 or 1, the texture will be 1D.
     uint32_t      depth {1};                        // Depth of the texture, in pixels.  If 0 or 1, the texture will be 1D or 2D.
-    uint32_t      mipCount {1};                     // Number of mipmap levels in the texture.  Cannot be 0.  Defaults to 1 for no mipmapping.
-    uint32_t      mipBase {0};                      // Base mipmap level.  Defaults to 0.
+    uint32_t      mipCount {1};                     // Number of mipmap levels in the texture.  Defaults to 1 for no mipmapping.  Can only be 0 if 'generateMips' is true, which creates a full mip chain.
+    uint32_t      mipBase {0};                      // Base mipmap level.  Defaults to 0.  Unless wrapping an existing image, the size is that of level 0, and the levels before the base are allocated but undefined.
+    bool          generateMips {false};             // If true, every mip level after the first is generated on the GPU from the first level of 'dataPtr'.
     uint32_t      layerCount {1};                   // Number of layers in the texture.  Defaults to 1 for a non-layered texture.  Must be 6 for a cubemap.
     uint32_t      layerBase {0};                    // Base layer index.  Defaults to 0.
     ImageFormat   format {ImageFormat::Undefined};  // Pixel format.  Required!
@@ -50,6 +56,7 @@ class Texture {
     Offset*       offsets {nullptr};                // An array of offsets into the data pointed to by 'dataPtr' indicating the region of each mip level and/or layer.
     uint32_t      numOffsets {0};                   // The number of entries in 'offsets'.
     void*         extraData {nullptr};              // Currently unused except for internal purposes.
+    float         priority {0.5f};                  // Residency priority in [0,1].  Lower priority evictable textures are demoted first, and the driver may page them out first.
     const char*   debugName {};
 
     struct Sampler {
@@ -72,14 +79,35 @@ class Texture {
     const char* filename {nullptr};
     const void* dataPtr {nullptr};
     size_t dataSize {0};
+    TextureUsages usage {TextureUsage::None}; // Additional usage flags, such as 'Evictable'.
+    float priority {0.5f};                    // Residency priority, see 'CreateParams::priority'.
+    bool stream {false};                      // Only load the smallest mip levels now, and stream in larger ones as they're requested with 'requestMip'.
+                                              // Requires a filename for an uncompressed (not supercompressed) KTX2 file, otherwise the whole texture is loaded.
+                                              // Basis Universal textures are transcoded to the best compressed format the GPU supports.
     const char* debugName {nullptr}; };
   Texture(LoadKtxParams params);
+  // Loads several KTX textures at once.  Files are read, inflated, and transcoded in parallel on worker threads,
+  // and each one is uploaded as soon as it's ready.  Textures which fail to load are returned invalid.
+  static std::vector<Texture> loadKtx(const std::vector<LoadKtxParams>& params);
 
   bool isValid() const { return (bool)_pimpl; }
   operator bool() const { return (bool)_pimpl; }
 
   void getDimensions(uint32_t& w, uint32_t& h, uint32_t& d) const;
+  // The size of the underlying image, which can be larger than 'getDimensions' for bucketed textures (see TextureUsage::Bucketed),
+  // and for render-sized ones, which are allocated large enough for the display.  Their contents occupy the top left corner of the image,
+  // so shaders sampling them with normalized coordinates should scale those coordinates by (dimensions / capacity).
+  void getCapacity(uint32_t& w, uint32_t& h, uint32_t& d) const;
+  // Changes the size of the texture.  Bucketed and render-sized textures keep their image if the new size fits within it (see 'getCapacity'),
+  // so rendering at a lower resolution for a while is free.  Drawing and blits use the new size.
+  // Otherwise the image is reallocated and its contents are lost.  Screen-sized textures are resized again when the display is.
+  bool resize(uint32_t w, uint32_t h);
   ImageFormat getFormat() const;
+  uint32_t getMipCount() const;
+
+  // Regenerates every mip level after the first by downsampling the first, on the GPU.
+  // Recorded into the current frame if there is one, otherwise it's executed immediately.
+  void generateMips();
 
   void barrier(ImageLayout layout, bool read);
   void readBarrier(ImageLayout layout) { barrier(layout, true); }
@@ -88,6 +116,26 @@ class Texture {
   uint32_t getSamplerIndex() const;
   uint32_t getStorageIndex() const;
 
+  // Copies one mip level of one layer back to the CPU, without stalling.  The texture needs the TransferSrc usage and an uncompressed format.
+  // Rows are tightly packed, and depth formats only read back their depth, at 4 bytes per pixel.
+  // Works like 'Buffer::readbackAsync', and the same applies to the frame's swapchain image, for screenshots.
+  bool readbackAsync(ReadbackFunc callback, uint32_t mipLevel = 0, uint32_t layer = 0);
+
+  // Residency tracking.
+  // Evictable textures are demoted in order of priority, lowest first, regardless of when they were last used.
+  // Textures used in the last few frames are skipped, but HLGL can't see bindless sampling, so textures which are only accessed through
+  // bindless descriptors should call 'markUsed' on frames where they're sampled if they mustn't be demoted while visible.
+  void markUsed();
+  void setPriority(float priority);
+  float getPriority() const;
+
+  // Streaming, for textures loaded with 'LoadKtxParams::stream'.
+  // 'requestMip' sets the highest-resolution mip level that should be resident (0 being the full-size image).
+  // Larger levels are read and uploaded over the following frames, and levels larger than requested are released.
+  // The resident mip is also raised when an evictable texture is demoted.
+  void requestMip(uint32_t mip);
+  uint32_t getResidentMip() const;
+
   std::unique_ptr<TextureImpl> _pimpl;
 };
 
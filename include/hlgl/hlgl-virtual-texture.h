@@ -0,0 +1,75 @@
+#ifndef HLGL_VIRTUAL_TEXTURE_H
+#define HLGL_VIRTUAL_TEXTURE_H
+
+#include "hlgl-base.h"
+
+#include <functional>
+
+namespace hlgl {
+
+struct VirtualTextureImpl;
+
+// VirtualTexture is a texture which can be far larger than GPU memory, such as a terrain megatexture.
+// It's split into square pages, and only pages which shaders have recently asked for are kept in a fixed size page cache,
+// so the memory used depends on the cache size rather than the virtual size.
+// Shaders sample it through a page table using the helpers in 'getShaderSource', which also write the pages they wanted to a feedback buffer.
+// At the start of each frame, feedback from earlier frames is read back, missing pages are loaded by a user callback on worker threads,
+// and finished pages are uploaded into the cache, replacing the least recently used ones.
+class VirtualTexture {
+  VirtualTexture(const VirtualTexture&) = delete;
+  VirtualTexture& operator=(const VirtualTexture&) = delete;
+  public:
+  VirtualTexture(VirtualTexture&&) noexcept = default;
+  VirtualTexture& operator=(VirtualTexture&&) noexcept = default;
+  ~VirtualTexture();
+
+  // Fills 'dst' with one page of mip level 'mip', surrounded by 'pageBorder' pixels of its neighbors on every side.
+  // 'dst' is (pageSize + 2 * pageBorder) pixels square, with tightly packed rows, in the texture's format.
+  // Called on a worker thread.  If it returns false, the page is requested again the next time it's needed.
+  using PageLoader = std::function<bool(uint32_t mip, uint32_t pageX, uint32_t pageY, void* dst)>;
+
+  struct CreateParams {
+    uint32_t    width {0};                            // Virtual width in pixels.  Must be a power of two, and no smaller than 'pageSize'.
+    uint32_t    height {0};                           // Virtual height in pixels.  Must be a power of two, and no smaller than 'pageSize'.
+    uint32_t    pageSize {128};                       // Width and height of a page in pixels, not including the border.  Must be a power of two.
+    uint32_t    pageBorder {4};                       // Pixels of padding around each page, so filtering doesn't pick up neighboring pages in the cache.
+    uint32_t    cachePagesX {32};                     // Width of the page cache, in pages.
+    uint32_t    cachePagesY {32};                     // Height of the page cache, in pages.
+    ImageFormat format {ImageFormat::RGBA8i_srgb};    // Pixel format.  Compressed formats aren't supported.
+    PageLoader  loader {};                            // Loads pages.  Required!
+    uint32_t    maxUploadsPerFrame {16};              // Limits how many pages are copied into the cache each frame.
+    const char* debugName {nullptr};
+    };
+  VirtualTexture(CreateParams params);
+
+  bool isValid() const { return (bool)_pimpl; }
+  operator bool() const { return (bool)_pimpl; }
+
+  // Everything the shader helpers need, to be passed to shaders through push constants.  Matches 'VirtualTexture' in 'getShaderSource'.
+  // The buffers are different on each frame in flight, so this should be fetched every frame.
+  struct ShaderParams {
+    DeviceAddress pageTable;
+    DeviceAddress feedback;
+    uint32_t cacheIndex;    // Sampler index of the page cache texture.
+    uint32_t width;
+    uint32_t height;
+    uint32_t pageSize;
+    uint32_t pageBorder;
+    uint32_t cacheWidth;
+    uint32_t cacheHeight;
+    uint32_t numMips;
+  };
+  ShaderParams getShaderParams() const;
+
+  // The number of pages currently in the cache, including the lowest resolution mip level, which is always resident.
+  uint32_t getResidentPageCount() const;
+
+  // Slang source for sampling virtual textures.  Prepend it to a shader's source, then call
+  // 'vtSample(vt, textures[NonUniformResourceIndex(vt.cacheIndex)], uv)' where 'vt' is a 'VirtualTexture' push constant.
+  static const char* getShaderSource();
+
+  std::unique_ptr<VirtualTextureImpl> _pimpl;
+};
+
+} // namespace hlgl
+#endif // HLGL_VIRTUAL_TEXTURE_H
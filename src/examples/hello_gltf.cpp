@@ -0,0 +1,194 @@
+#include <hlgl.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+const char* shader_slang = R"(
+  struct Vertex {
+    float3 pos;     float u;
+    float3 normal;  float v;
+    float4 tangent;
+  };
+
+  struct Material {
+    float4 baseColorFactor;
+    float3 emissiveFactor;
+    float alphaCutoff;
+    float metallicFactor;
+    float roughnessFactor;
+    float normalScale;
+    float occlusionStrength;
+    uint baseColorTexture;
+    uint metallicRoughnessTexture;
+    uint normalTexture;
+    uint occlusionTexture;
+    uint emissiveTexture;
+    uint alphaMode;
+    uint doubleSided;
+    uint padding;
+  };
+
+  [vk::binding(0,1)]
+  Sampler2D textures[];
+
+  struct VSOutput {
+    float4 pos : SV_Position;
+    float3 normal;
+    float2 uv;
+  };
+
+  [shader("vertex")]
+  VSOutput main(uniform float4x4 model, uniform float4x4* viewProj, uniform Vertex* vertices, uniform Material* materials, uniform uint material,
+                uint vertIndex : SV_VertexID)
+  {
+    // The primitive's vertex offset is already included in SV_VertexID.
+    Vertex v = vertices[vertIndex];
+    VSOutput output;
+    output.pos = mul(*viewProj, mul(model, float4(v.pos, 1.0)));
+    output.normal = mul((float3x3)model, v.normal);
+    output.uv = float2(v.u, v.v);
+    return output;
+  }
+
+  [shader("fragment")]
+  float4 main(uniform float4x4 model, uniform float4x4* viewProj, uniform Vertex* vertices, uniform Material* materials, uniform uint material,
+              VSOutput input) : SV_Target
+  {
+    Material m = materials[material];
+    float4 color = m.baseColorFactor;
+    if (m.baseColorTexture != 0)
+      color *= textures[NonUniformResourceIndex(m.baseColorTexture)].Sample(input.uv);
+    if (m.alphaMode == 1 && color.a < m.alphaCutoff)
+      discard;
+    float3 L = normalize(float3(0.5, -1.0, 0.5));
+    float diffuse = max(dot(normalize(input.normal), -L), 0.15);
+    return float4(color.rgb * diffuse + m.emissiveFactor, 1.0);
+  }
+)";
+
+int main(int, char**) {
+
+  // Create the window.
+  glfwInit();
+  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+  GLFWwindow* window = glfwCreateWindow(1920, 1080, "Hello glTF HLGL", nullptr, nullptr);
+  if (!window) {
+    std::cerr << "Window creation failed.\n";
+    return 1;
+  }
+
+  // Create the HLGL context.
+  if (!hlgl::initContext(hlgl::InitContextParams{
+    .window = window,
+    .debugCallback = [](hlgl::DebugSeverity severity, std::string_view message){std::cout << "[HLGL] " << message << std::endl;},
+    .requiredFeatures = hlgl::Feature::Validation}))
+  {
+    std::cerr << "HLGL context creation failed.\n";
+    return 1;
+  }
+  else {
+
+    hlgl::Texture depthBuffer(hlgl::Texture::CreateParams{
+      .usage = hlgl::TextureUsage::Framebuffer | hlgl::TextureUsage::ScreenSize,
+      .format = hlgl::ImageFormat::D24S8,
+      .debugName = "depthBuffer"
+    });
+
+    // Load the whole scene into one vertex buffer, one index buffer, and one material buffer.
+    hlgl::GltfScene scene {hlgl::loadGltf(hlgl::LoadGltfParams{.filename = "../../assets/models/maxwell.glb", .maxLods = 6})};
+    if (!scene) {
+      std::cerr << "Failed to load maxwell.glb.\n";
+      glfwSetWindowShouldClose(window, GLFW_TRUE);
+    }
+    std::cout << "Loaded " << scene.meshes.size() << " meshes, " << scene.primitives.size() << " primitives, and "
+              << scene.textures.size() << " textures.\n";
+    for (const hlgl::GltfPrimitive& primitive : scene.primitives) {
+      std::cout << "Primitive levels of detail (triangles, error):";
+      for (uint32_t l {primitive.firstLod}; l < primitive.firstLod + primitive.lodCount; ++l)
+        std::cout << " (" << scene.lods[l].indexCount / 3 << ", " << scene.lods[l].error << ")";
+      std::cout << "\n";
+    }
+
+    hlgl::Shader shader(hlgl::Shader::CreateParams{.src = shader_slang, .debugName = "gltf.slang"});
+    hlgl::Pipeline pipeline(hlgl::Pipeline::GraphicsParams{
+      .vertShader = {.shader = &shader},
+      .fragShader = {.shader = &shader},
+      .cullMode = hlgl::CullMode::None,
+      .colorAttachments = {hlgl::ColorAttachmentInfo{.format = hlgl::getDisplayFormat()}},
+      .depthAttachment = hlgl::DepthAttachmentInfo{.format = hlgl::ImageFormat::D24S8}
+    });
+
+    hlgl::Buffer uniforms(hlgl::Buffer::CreateParams{
+      .usage = hlgl::BufferUsage::DeviceAddressable | hlgl::BufferUsage::Uniform | hlgl::BufferUsage::Updateable,
+      .size = sizeof(glm::mat4),
+      .debugName = "uniforms"
+    });
+
+    struct PushConstants {
+      glm::mat4 model;
+      hlgl::DeviceAddress viewProj;
+      hlgl::DeviceAddress vertices;
+      hlgl::DeviceAddress materials;
+      uint32_t material;
+    } pushConstants{};
+
+    // Loop until the window is closed.
+    double startTime {glfwGetTime()};
+    while (!glfwWindowShouldClose(window)) {
+      glfwPollEvents();
+
+      // Begin the frame.
+      hlgl::Result result = hlgl::beginFrame();
+      if (result == hlgl::Result::Shutdown)
+        break;
+      else if (result == hlgl::Result::Success)
+      {
+        hlgl::bindPipeline(&pipeline);
+
+        // Zoom in and out, so the levels of detail change as the model gets smaller on screen.
+        float time {(float)(glfwGetTime() - startTime)};
+        float angle {time * 0.5f};
+        float zoom {1.0f + 7.0f * (0.5f - 0.5f * std::cos(time * 0.3f))};
+        glm::mat4 proj {glm::perspective(glm::radians(45.0f), hlgl::getDisplayAspectRatio(), 0.1f, 100.0f)};
+        glm::mat4 view {glm::lookAt(glm::vec3(0.0f, -1.0f, -3.0f) * zoom, glm::vec3(0.0f), glm::vec3(0.0f, -1.0f, 0.0f))};
+        glm::mat4 spin {glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f))};
+        glm::mat4 viewProj {proj * view};
+        uniforms.updateData(&viewProj, sizeof(glm::mat4), 0);
+        uint32_t displayWidth {1}, displayHeight {1};
+        hlgl::getDisplaySize(displayWidth, displayHeight);
+        float lodScale {hlgl::getLodScale(glm::radians(45.0f), (float)displayHeight)};
+
+        hlgl::beginDrawing(
+          {hlgl::ColorAttachment{.texture = hlgl::getFrameSwapchainImage(), .clear = hlgl::ColorRGBAf{0.0f, 0.0f, 0.2f, 1.0f}}},
+          hlgl::DepthAttachment{.texture = &depthBuffer, .clear = hlgl::DepthStencilClearVal{1.0f, 0}});
+
+        pushConstants.viewProj = uniforms.getAddress();
+        pushConstants.vertices = scene.vertexBuffer->getAddress();
+        pushConstants.materials = scene.materialBuffer->getAddress();
+        for (const hlgl::GltfInstance& instance : scene.instances) {
+          pushConstants.model = spin * glm::make_mat4(instance.transform);
+          float scale {std::max({glm::length(glm::vec3(pushConstants.model[0])), glm::length(glm::vec3(pushConstants.model[1])), glm::length(glm::vec3(pushConstants.model[2]))})};
+          const hlgl::GltfMesh& mesh {scene.meshes[instance.mesh]};
+          for (uint32_t p {mesh.firstPrimitive}; p < mesh.firstPrimitive + mesh.primitiveCount; ++p) {
+            const hlgl::GltfPrimitive& primitive {scene.primitives[p]};
+            // Pick the coarsest level of detail that stays within a pixel of the full mesh.  Clip space w is the view-space depth.
+            glm::vec4 clip {viewProj * pushConstants.model * glm::vec4(primitive.center[0], primitive.center[1], primitive.center[2], 1.0f)};
+            const hlgl::MeshLod& lod {scene.lods[primitive.firstLod + hlgl::selectLod(&scene.lods[primitive.firstLod], primitive.lodCount, clip.w, primitive.radius * scale, lodScale, 1.0f, scale)]};
+            pushConstants.material = primitive.material;
+            hlgl::pushConstants(&pushConstants, sizeof(PushConstants));
+            hlgl::drawIndexed(lod.indexCount, &*scene.indexBuffer, 4, 0, 1, lod.firstIndex, primitive.vertexOffset);
+          }
+        }
+        hlgl::endFrame();
+      }
+    }
+  }
+  hlgl::shutdownContext();
+  return 0;
+}
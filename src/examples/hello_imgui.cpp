@@ -31,6 +31,7 @@ int main(int, char**) {
     hlgl::imguiNewFrame();
 
     ImGui::ShowDemoWindow();
+    hlgl::drawProfilerWindow();
     ImGui::Render();
 
     // Begin the frame.
@@ -41,10 +42,14 @@ int main(int, char**) {
     {
       // Begin a drawing pass.
       // Although we aren't drawing anything, it's neccessary to clear the screen.
-      hlgl::beginDrawing({hlgl::ColorAttachment{
-        .texture = hlgl::getFrameSwapchainImage(),
-        .clear = hlgl::ColorRGBAf{0.5f, 0.0f, 0.5f, 1.0f}
-        }});
+      {
+        hlgl::ProfileScope scope("Clear");
+        hlgl::beginDrawing({hlgl::ColorAttachment{
+          .texture = hlgl::getFrameSwapchainImage(),
+          .clear = hlgl::ColorRGBAf{0.5f, 0.0f, 0.5f, 1.0f}
+          }});
+        hlgl::endDrawing();
+      }
 
       hlgl::endFrame();
     }
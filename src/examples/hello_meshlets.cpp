@@ -0,0 +1,281 @@
+#include <hlgl.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <tiny_obj_loader.h>
+
+#include <iostream>
+#include <unordered_map>
+
+const char* shader_slang = R"(
+  struct Vertex {
+    float3 pos;     float pad0;
+    float3 normal;  float pad1;
+  };
+
+  struct Meshlet {
+    uint vertexOffset;
+    uint triangleOffset;
+    uint vertexCount;
+    uint triangleCount;
+    float4 sphere;  // xyz = center, w = radius.
+    float4 cone;    // xyz = axis, w = cutoff.
+  };
+
+  struct SceneData {
+    float4x4 viewProj;
+    float4x4 model;
+    float4 cameraPos; // In the model's space, for cone culling.
+  };
+
+  struct Payload {
+    uint meshlets[32];
+  };
+
+  groupshared Payload payload;
+  groupshared uint visibleCount;
+
+  bool isVisible(SceneData* scene, Meshlet meshlet) {
+    // Backface cull the whole meshlet using its normal cone.
+    float3 toCenter = meshlet.sphere.xyz - scene->cameraPos.xyz;
+    if (dot(toCenter, meshlet.cone.xyz) >= meshlet.cone.w * length(toCenter) + meshlet.sphere.w)
+      return false;
+
+    // Frustum cull its bounding sphere.  The model matrix is only a rotation, so the radius is unchanged in world space.
+    float4x4 m = mul(scene->viewProj, scene->model);
+    float4 planes[6] = {
+      m[3] + m[0], m[3] - m[0],
+      m[3] + m[1], m[3] - m[1],
+      m[2], m[3] - m[2] };
+    for (uint i = 0; i < 6; ++i) {
+      if (dot(planes[i].xyz, meshlet.sphere.xyz) + planes[i].w < -meshlet.sphere.w * length(planes[i].xyz))
+        return false;
+    }
+    return true;
+  }
+
+  [shader("amplification")]
+  [numthreads(32,1,1)]
+  void main(uniform SceneData* scene, uniform Vertex* vertices, uniform uint* meshletVertices, uniform uint* meshletTriangles,
+            uniform Meshlet* meshlets, uniform uint meshletCount, uint3 id : SV_DispatchThreadID, uint3 gtid : SV_GroupThreadID)
+  {
+    if (gtid.x == 0)
+      visibleCount = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    if (id.x < meshletCount && isVisible(scene, meshlets[id.x])) {
+      uint slot;
+      InterlockedAdd(visibleCount, 1, slot);
+      payload.meshlets[slot] = id.x;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    DispatchMesh(visibleCount, 1, 1, payload);
+  }
+
+  struct MeshOutput {
+    float4 pos : SV_Position;
+    float3 normal;
+    float3 color;
+  };
+
+  // Triangles are stored as three bytes each, so read them out of the words they're packed into.
+  uint loadByte(uint* words, uint i) {
+    return (words[i >> 2] >> ((i & 3) * 8)) & 0xFF;
+  }
+
+  float3 meshletColor(uint i) {
+    uint h = i * 747796405u + 2891336453u;
+    h = ((h >> ((h >> 28) + 4)) ^ h) * 277803737u;
+    return float3((h & 0xFF), (h >> 8) & 0xFF, (h >> 16) & 0xFF) / 255.0 * 0.75 + 0.25;
+  }
+
+  [shader("mesh")]
+  [outputtopology("triangle")]
+  [numthreads(64,1,1)]
+  void main(uniform SceneData* scene, uniform Vertex* vertices, uniform uint* meshletVertices, uniform uint* meshletTriangles,
+            uniform Meshlet* meshlets, uniform uint meshletCount, in payload Payload payload,
+            out vertices MeshOutput outVerts[64], out indices uint3 outTris[124],
+            uint3 gtid : SV_GroupThreadID, uint3 gid : SV_GroupID)
+  {
+    uint meshletIndex = payload.meshlets[gid.x];
+    Meshlet meshlet = meshlets[meshletIndex];
+    SetMeshOutputCounts(meshlet.vertexCount, meshlet.triangleCount);
+
+    float4x4 mvp = mul(scene->viewProj, scene->model);
+    float3 color = meshletColor(meshletIndex);
+    for (uint i = gtid.x; i < meshlet.vertexCount; i += 64) {
+      Vertex v = vertices[meshletVertices[meshlet.vertexOffset + i]];
+      outVerts[i].pos = mul(mvp, float4(v.pos, 1.0));
+      outVerts[i].normal = mul((float3x3)scene->model, v.normal);
+      outVerts[i].color = color;
+    }
+    for (uint i = gtid.x; i < meshlet.triangleCount; i += 64) {
+      uint base = meshlet.triangleOffset + i * 3;
+      outTris[i] = uint3(loadByte(meshletTriangles, base), loadByte(meshletTriangles, base + 1), loadByte(meshletTriangles, base + 2));
+    }
+  }
+
+  [shader("fragment")]
+  float4 main(MeshOutput input) {
+    float3 L = normalize(float3(0.5, -1.0, -0.5));
+    float diffuse = max(dot(normalize(input.normal), -L), 0.1);
+    return float4(input.color * diffuse, 1.0);
+  }
+)";
+
+int main(int, char**) {
+
+  // Create the window.
+  glfwInit();
+  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+  GLFWwindow* window = glfwCreateWindow(1920, 1080, "Hello Meshlets HLGL", nullptr, nullptr);
+  if (!window) {
+    std::cerr << "Window creation failed.\n";
+    return 1;
+  }
+
+  // Create the HLGL context.  Mesh shaders are an optional feature, so this example won't run without them.
+  if (!hlgl::initContext(hlgl::InitContextParams{
+    .window = window,
+    .debugCallback = [](hlgl::DebugSeverity severity, std::string_view message){std::cout << "[HLGL] " << message << std::endl;},
+    .requiredFeatures = hlgl::Feature::Validation | hlgl::Feature::MeshShading}))
+  {
+    std::cerr << "HLGL context creation failed.\n";
+    return 1;
+  }
+  else {
+
+    hlgl::Texture depthBuffer(hlgl::Texture::CreateParams{
+      .usage = hlgl::TextureUsage::Framebuffer | hlgl::TextureUsage::ScreenSize,
+      .format = hlgl::ImageFormat::D24S8,
+      .debugName = "depthBuffer"
+    });
+
+    struct Vertex {
+      glm::vec3 pos;    float pad0;
+      glm::vec3 normal; float pad1;
+    };
+
+    // Load the obj file, welding vertices which share a position and normal so the meshlets have something to share.
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    tinyobj::LoadObj(&attrib, &shapes, &materials, nullptr, nullptr, "../../assets/models/suzanne.obj");
+
+    std::vector<Vertex> vertices{};
+    std::vector<uint32_t> indices{};
+    std::unordered_map<uint64_t, uint32_t> welded{};
+    for (tinyobj::index_t& index : shapes[0].mesh.indices) {
+      uint64_t key {((uint64_t)(uint32_t)index.vertex_index << 32) | (uint32_t)index.normal_index};
+      auto [it, inserted] = welded.try_emplace(key, (uint32_t)vertices.size());
+      if (inserted) {
+        vertices.push_back(Vertex{
+          .pos = { attrib.vertices[index.vertex_index*3], -attrib.vertices[index.vertex_index*3 +1], attrib.vertices[index.vertex_index*3 +2] },
+          .normal = { attrib.normals[index.normal_index*3], -attrib.normals[index.normal_index*3 +1], attrib.normals[index.normal_index*3 +2] } });
+      }
+      indices.push_back(it->second);
+    }
+
+    // Split the mesh into meshlets.  The limits here must match the mesh shader's outputs.
+    hlgl::MeshletMesh meshlets {hlgl::buildMeshlets(hlgl::BuildMeshletsParams{
+      .indices = indices.data(),
+      .indexCount = indices.size(),
+      .positions = &vertices[0].pos.x,
+      .vertexCount = vertices.size(),
+      .positionStride = sizeof(Vertex),
+      .maxVertices = 64,
+      .maxTriangles = 124 })};
+    std::cout << "Built " << meshlets.meshlets.size() << " meshlets from " << indices.size() / 3 << " triangles.\n";
+
+    size_t vBufSize { sizeof(Vertex) * vertices.size() };
+    size_t mvBufSize { sizeof(uint32_t) * meshlets.vertices.size() };
+    size_t mtBufSize { meshlets.triangles.size() };
+    size_t mBufSize { sizeof(hlgl::Meshlet) * meshlets.meshlets.size() };
+    // The meshlets and vertices go first, so their float4s stay 16-byte aligned.
+    hlgl::Buffer mesh(hlgl::Buffer::CreateParams{
+      .usage = hlgl::BufferUsage::Storage | hlgl::BufferUsage::DeviceAddressable,
+      .data = {
+        {.ptr = meshlets.meshlets.data(), .size = mBufSize},
+        {.ptr = vertices.data(), .size = vBufSize},
+        {.ptr = meshlets.vertices.data(), .size = mvBufSize},
+        {.ptr = meshlets.triangles.data(), .size = mtBufSize}},
+      .debugName = "suzanne.obj meshlets"
+    });
+
+    struct SceneData {
+      glm::mat4 viewProj;
+      glm::mat4 model;
+      glm::vec4 cameraPos;
+    } sceneData{};
+
+    hlgl::Buffer uniforms(hlgl::Buffer::CreateParams{
+      .usage = hlgl::BufferUsage::DeviceAddressable | hlgl::BufferUsage::Uniform | hlgl::BufferUsage::Updateable,
+      .size = sizeof(SceneData),
+      .debugName = "uniforms"
+    });
+
+    hlgl::Shader shader(hlgl::Shader::CreateParams{.src = shader_slang, .debugName = "meshlets.slang"});
+    hlgl::Pipeline pipeline(hlgl::Pipeline::GraphicsParams{
+      .fragShader = {.shader = &shader},
+      .taskShader = {.shader = &shader},
+      .meshShader = {.shader = &shader},
+      .colorAttachments = {hlgl::ColorAttachmentInfo{.format = hlgl::getDisplayFormat()}},
+      .depthAttachment = hlgl::DepthAttachmentInfo{.format = hlgl::ImageFormat::D24S8}
+    });
+
+    struct PushConstants {
+      hlgl::DeviceAddress sceneData;
+      hlgl::DeviceAddress vertices;
+      hlgl::DeviceAddress meshletVertices;
+      hlgl::DeviceAddress meshletTriangles;
+      hlgl::DeviceAddress meshlets;
+      uint32_t meshletCount;
+    } pushConstants{};
+
+    // Loop until the window is closed.
+    double startTime {glfwGetTime()};
+    while (!glfwWindowShouldClose(window)) {
+      glfwPollEvents();
+
+      glm::vec3 camPos{0.0f,0.0f,-4.0f};
+
+      // Begin the frame.
+      hlgl::Result result = hlgl::beginFrame();
+      if (result == hlgl::Result::Shutdown)
+        break;
+      else if (result == hlgl::Result::Success)
+      {
+        hlgl::bindPipeline(&pipeline);
+
+        float angle {(float)(glfwGetTime() - startTime) * 0.5f};
+        glm::mat4 proj {glm::perspective(glm::radians(45.0f), hlgl::getDisplayAspectRatio(), 0.1f, 32.0f)};
+        glm::mat4 view {glm::translate(glm::mat4(1.0f), camPos)};
+        sceneData.viewProj = proj * view;
+        sceneData.model = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f));
+        sceneData.cameraPos = glm::inverse(sceneData.model) * glm::inverse(view) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+        uniforms.updateData(&sceneData, sizeof(SceneData), 0);
+
+        hlgl::beginDrawing(
+          {hlgl::ColorAttachment{.texture = hlgl::getFrameSwapchainImage(), .clear = hlgl::ColorRGBAf{0.0f, 0.0f, 0.2f, 1.0f}}},
+          hlgl::DepthAttachment{.texture = &depthBuffer, .clear = hlgl::DepthStencilClearVal{1.0f, 0}});
+
+        pushConstants.sceneData = uniforms.getAddress();
+        pushConstants.meshlets = mesh.getAddress();
+        pushConstants.vertices = pushConstants.meshlets + mBufSize;
+        pushConstants.meshletVertices = pushConstants.vertices + vBufSize;
+        pushConstants.meshletTriangles = pushConstants.meshletVertices + mvBufSize;
+        pushConstants.meshletCount = (uint32_t)meshlets.meshlets.size();
+        hlgl::pushConstants(&pushConstants, sizeof(PushConstants));
+
+        // Each task shader workgroup culls 32 meshlets, and launches a mesh shader workgroup for each one that survives.
+        hlgl::drawMeshTasks((pushConstants.meshletCount + 31) / 32);
+        hlgl::endFrame();
+      }
+    }
+  }
+  hlgl::shutdownContext();
+  return 0;
+}
@@ -6,6 +6,7 @@
 #include <glm/gtc/quaternion.hpp>
 #include <tiny_obj_loader.h>
 
+#include <cstddef>
 #include <iostream>
 
 const char* shader_slang = R"(
@@ -15,14 +16,10 @@ const char* shader_slang = R"(
   *
   */
 
-  struct VSInput {
-    float3 Pos;     float pad0;
-    float3 Normal;  float pad1;
-    float2 UV;
-  };
+  import hlgl_vertex;
 
   [vk::binding(0,1)]
-  Sampler2D textures[];
+  Sampler2DArray textureArrays[];
 
   struct ShaderData {
     float4x4 projection;
@@ -31,6 +28,7 @@ const char* shader_slang = R"(
     float4 lightPos;
     uint32_t material[3];
     uint32_t selected;
+    uint32_t materialArray;
   };
 
   struct VSOutput {
@@ -40,21 +38,24 @@ const char* shader_slang = R"(
     float3 Factor;
     float3 LightVec;
     float3 ViewVec;
-    uint32_t materialIndex;
+    uint32_t materialArray;
+    uint32_t materialLayer;
   };
 
   [shader("vertex")]
-  VSOutput main(uniform ShaderData* shaderData, uniform VSInput* vertices, uniform uint16_t* indices, uint vertIndex : SV_VertexID, uint instIndex : SV_InstanceID, uint drawIndex : SV_DrawIndex) {
-      VSInput input = vertices[indices[vertIndex]];
+  VSOutput main(uniform ShaderData* shaderData, uniform QuantizedVertex* vertices, uniform QuantizationBounds* bounds,
+                uint vertIndex : SV_VertexID, uint instIndex : SV_InstanceID, uint drawIndex : SV_DrawIndex) {
+      DecodedVertex input = decodeVertex(vertices[vertIndex], *bounds);
       VSOutput output;
       float4x4 modelMat = shaderData->model[instIndex];
-      output.Normal = mul((float3x3)mul(shaderData->view, modelMat), input.Normal);
-      output.UV = input.UV;
-      output.Pos = mul(shaderData->projection, mul(shaderData->view, mul(modelMat, float4(input.Pos.xyz, 1.0))));
+      output.Normal = mul((float3x3)mul(shaderData->view, modelMat), input.normal);
+      output.UV = input.uv;
+      output.Pos = mul(shaderData->projection, mul(shaderData->view, mul(modelMat, float4(input.position, 1.0))));
       output.Factor = (shaderData->selected == instIndex ? 3.0f : 1.0f);
-      output.materialIndex = shaderData->material[instIndex];
+      output.materialArray = shaderData->materialArray;
+      output.materialLayer = shaderData->material[instIndex];
       // Calculate view vectors required for lighting
-      float4 fragPos = mul(mul(shaderData->view, modelMat), float4(input.Pos.xyz, 1.0));
+      float4 fragPos = mul(mul(shaderData->view, modelMat), float4(input.position, 1.0));
       output.LightVec = shaderData->lightPos.xyz - fragPos.xyz;
       output.ViewVec = -fragPos.xyz;
       return output;
@@ -70,7 +71,7 @@ const char* shader_slang = R"(
       float3 diffuse = max(dot(N, L), 0.0025);
       float3 specular = pow(max(dot(R, V), 0.0), 16.0) * 0.75;
       // Sample from texture
-      float3 color = textures[NonUniformResourceIndex(input.materialIndex)].Sample(input.UV).rgb * input.Factor;
+      float3 color = textureArrays[NonUniformResourceIndex(input.materialArray)].Sample(float3(input.UV, input.materialLayer)).rgb * input.Factor;
       return float4(diffuse * color.rgb + specular, 1.0);
   }
 )";
@@ -115,9 +116,7 @@ int main(int, char**) {
     std::vector<tinyobj::material_t> materials;
     tinyobj::LoadObj(&attrib, &shapes, &materials, nullptr, nullptr, "../../assets/models/suzanne.obj");
 
-    size_t indexCount {shapes[0].mesh.indices.size()};
     std::vector<Vertex> vertices{};
-    std::vector<uint16_t> indices{};
     for (tinyobj::index_t& index : shapes[0].mesh.indices) {
       Vertex v{
         .pos = { attrib.vertices[index.vertex_index*3], -attrib.vertices[index.vertex_index*3 +1], attrib.vertices[index.vertex_index*3 +2] },
@@ -125,21 +124,57 @@ int main(int, char**) {
         .uv = { attrib.texcoords[index.texcoord_index*2], 1.0f - attrib.texcoords[index.texcoord_index*2 +1] }
       };
       vertices.push_back(v);
-      indices.push_back(indices.size());
     }
 
-    size_t vBufSize { sizeof(Vertex) * vertices.size() };
-    size_t iBufSize { sizeof(uint16_t) * indices.size() };
+    // OBJ faces index positions, normals, and texcoords separately, so the vertices above aren't shared between triangles.
+    // Welding them and reordering for the vertex cache lets each one be shaded once, rather than once per triangle.
+    hlgl::OptimizedMesh optimized {hlgl::optimizeMesh(hlgl::OptimizeMeshParams{
+      .vertices = vertices.data(),
+      .vertexCount = vertices.size(),
+      .vertexSize = sizeof(Vertex),
+      .positionOffset = offsetof(Vertex, pos) })};
+    std::cout << "Vertex shader invocations per instance: " << optimized.before.vertexInvocations << " -> " << optimized.after.vertexInvocations
+              << " (ACMR " << optimized.before.acmr << " -> " << optimized.after.acmr << ", ATVR " << optimized.after.atvr << ")\n";
+
+    // Compress the vertices from 40 bytes to 20.  The shader decodes them with the 'hlgl_vertex' module, using the bounds stored ahead of them.
+    hlgl::QuantizedMesh quantized {hlgl::quantizeVertices(hlgl::QuantizeVerticesParams{
+      .vertices = optimized.vertices.data(),
+      .vertexCount = optimized.vertexCount,
+      .vertexSize = sizeof(Vertex),
+      .positionOffset = offsetof(Vertex, pos),
+      .normalOffset = offsetof(Vertex, normal),
+      .uvOffset = offsetof(Vertex, uv) })};
+
+    uint32_t indexCount {(uint32_t)optimized.indices.size()};
+    size_t boundsSize { sizeof(hlgl::QuantizationBounds) };
+    size_t vBufSize { quantized.vertices.size() * sizeof(hlgl::QuantizedVertex) };
+    size_t iBufSize { optimized.packedIndices.size() };
     hlgl::Buffer mesh(hlgl::Buffer::CreateParams{
       .usage = hlgl::BufferUsage::Vertex | hlgl::BufferUsage::Index | hlgl::BufferUsage::DeviceAddressable,
-      .data = {{.ptr = vertices.data(), .size = vBufSize}, {.ptr = indices.data(), .size = iBufSize}},
+      .data = {{.ptr = &quantized.bounds, .size = boundsSize}, {.ptr = quantized.vertices.data(), .size = vBufSize}, {.ptr = optimized.packedIndices.data(), .size = iBufSize}},
       .debugName = "suzanne.obj"
     });
 
-    // Load the ktx textures.
-    hlgl::Texture tex0(hlgl::Texture::LoadKtxParams{.filename = "../../assets/textures/suzanne0.ktx"});
-    hlgl::Texture tex1(hlgl::Texture::LoadKtxParams{.filename = "../../assets/textures/suzanne1.ktx"});
-    hlgl::Texture tex2(hlgl::Texture::LoadKtxParams{.filename = "../../assets/textures/suzanne2.ktx"});
+    // Load the ktx textures, then copy them into layers of one array texture so every instance samples through the same descriptor.
+    std::vector<hlgl::Texture> textures {hlgl::Texture::loadKtx({
+      {.filename = "../../assets/textures/suzanne0.ktx", .usage = hlgl::TextureUsage::TransferSrc},
+      {.filename = "../../assets/textures/suzanne1.ktx", .usage = hlgl::TextureUsage::TransferSrc},
+      {.filename = "../../assets/textures/suzanne2.ktx", .usage = hlgl::TextureUsage::TransferSrc} })};
+    uint32_t texWidth {1}, texHeight {1}, texDepth {1};
+    textures[0].getDimensions(texWidth, texHeight, texDepth);
+    hlgl::TextureArrayPool materials(hlgl::TextureArrayPool::CreateParams{
+      .width = texWidth,
+      .height = texHeight,
+      .mipCount = textures[0].getMipCount(),
+      .format = textures[0].getFormat(),
+      .layersPerArray = 4,
+      .sampler = hlgl::Texture::CreateParams::Sampler{.filtering = hlgl::FilterMode::Linear, .maxLod = (float)textures[0].getMipCount()},
+      .debugName = "materials"
+    });
+    hlgl::TextureRegion materialRegions[3] {};
+    for (size_t i {0}; i < 3; ++i)
+      materialRegions[i] = materials.insert(textures[i]);
+    textures.clear();
 
     struct ShaderData {
       glm::mat4 proj;
@@ -148,6 +183,7 @@ int main(int, char**) {
       glm::vec4 lightPos{0.0f, -10.0f, 10.0f, 0.0f};
       uint32_t material[3];
       uint32_t selected{1};
+      uint32_t materialArray;
     } shaderData{};
 
     hlgl::Buffer uniforms(hlgl::Buffer::CreateParams{
@@ -167,7 +203,7 @@ int main(int, char**) {
     struct PushConstants {
       hlgl::DeviceAddress shaderData;
       hlgl::DeviceAddress vertices;
-      hlgl::DeviceAddress indices;
+      hlgl::DeviceAddress bounds;
     } pushConstants{};
 
     // Loop until the window is closed.
@@ -189,9 +225,10 @@ int main(int, char**) {
         shaderData.model[0] = glm::translate(glm::mat4(1.0f), glm::vec3(-3.0f, 0.0f, 0.0f));
         shaderData.model[1] = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
         shaderData.model[2] = glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, 0.0f, 0.0f));
-        shaderData.material[0] = tex0.getSamplerIndex();
-        shaderData.material[1] = tex1.getSamplerIndex();
-        shaderData.material[2] = tex2.getSamplerIndex();
+        shaderData.material[0] = materialRegions[0].layer;
+        shaderData.material[1] = materialRegions[1].layer;
+        shaderData.material[2] = materialRegions[2].layer;
+        shaderData.materialArray = materialRegions[0].samplerIndex;
 
         uniforms.updateData(&shaderData, sizeof(ShaderData), 0);
 
@@ -200,11 +237,11 @@ int main(int, char**) {
           hlgl::DepthAttachment{.texture = &depthBuffer, .clear = hlgl::DepthStencilClearVal{1.0f, 0}});
         
         pushConstants.shaderData = uniforms.getAddress();
-        pushConstants.vertices = mesh.getAddress();
-        pushConstants.indices = pushConstants.vertices + vBufSize;
+        pushConstants.vertices = mesh.getAddress() + boundsSize;
+        pushConstants.bounds = mesh.getAddress();
         hlgl::pushConstants(&pushConstants, sizeof(PushConstants));
         
-        hlgl::draw(indexCount, 3);
+        hlgl::drawIndexed(indexCount, &mesh, optimized.indexSize, boundsSize + vBufSize, 3);
         hlgl::endFrame();
       }
     } 
@@ -0,0 +1,535 @@
+#include <hlgl.h>
+#include "thread-pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Block compression for BC1, BC3, BC4, BC5, and BC7 (mode 6 only).
+// Each 4x4 block is independent, so rows of blocks are spread across the thread pool.  Within a block, pixels are kept as
+// fixed-size arrays of 16 floats per channel so the fitting and index selection loops vectorize.
+
+namespace {
+
+  using hlgl::CompressionQuality;
+  using hlgl::ImageFormat;
+
+  constexpr uint32_t blockPixels_c {16};
+
+  // A 4x4 block of pixels, one array per channel.
+  struct Block {
+    float ch[4][blockPixels_c];
+  };
+
+  // Reads the 4x4 block at (bx, by), repeating the last row/column where the block hangs off the edge of the image.
+  void loadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, Block& block) {
+    for (uint32_t y {0}; y < 4; ++y) {
+      const uint8_t* row {rgba + (size_t)std::min(by * 4 + y, height - 1) * width * 4};
+      for (uint32_t x {0}; x < 4; ++x) {
+        const uint8_t* p {row + std::min(bx * 4 + x, width - 1) * 4};
+        for (uint32_t c {0}; c < 4; ++c)
+          block.ch[c][y * 4 + x] = p[c];
+      }
+    }
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Endpoint fitting, shared by every format.
+
+  // Finds two endpoints for the first N channels of 'block' which the pixels lie between.
+  // Pixels with a zero in 'mask' are ignored.  Returns false if there are no pixels to fit.
+  template <int N>
+  bool fitEndpoints(const Block& block, const float (&mask)[blockPixels_c], CompressionQuality quality, float (&lo)[N], float (&hi)[N]) {
+    float count {0.0f};
+    float mean[N] {};
+    for (int c {0}; c < N; ++c) {
+      lo[c] = 255.0f;
+      hi[c] = 0.0f;
+    }
+    for (uint32_t i {0}; i < blockPixels_c; ++i) {
+      if (mask[i] == 0.0f)
+        continue;
+      count += 1.0f;
+      for (int c {0}; c < N; ++c) {
+        mean[c] += block.ch[c][i];
+        lo[c] = std::min(lo[c], block.ch[c][i]);
+        hi[c] = std::max(hi[c], block.ch[c][i]);
+      }
+    }
+    if (count == 0.0f)
+      return false;
+    if (quality == CompressionQuality::Fast)
+      return true;
+
+    for (int c {0}; c < N; ++c)
+      mean[c] /= count;
+
+    float cov[N][N] {};
+    for (uint32_t i {0}; i < blockPixels_c; ++i) {
+      if (mask[i] == 0.0f)
+        continue;
+      for (int a {0}; a < N; ++a)
+        for (int b {a}; b < N; ++b)
+          cov[a][b] += (block.ch[a][i] - mean[a]) * (block.ch[b][i] - mean[b]);
+    }
+    for (int a {0}; a < N; ++a)
+      for (int b {0}; b < a; ++b)
+        cov[a][b] = cov[b][a];
+
+    // Power iteration for the principal axis, starting from the bounding box's diagonal.
+    float axis[N];
+    for (int c {0}; c < N; ++c)
+      axis[c] = hi[c] - lo[c];
+    for (int iter {0}; iter < 8; ++iter) {
+      float next[N] {};
+      for (int a {0}; a < N; ++a)
+        for (int b {0}; b < N; ++b)
+          next[a] += cov[a][b] * axis[b];
+      float len {0.0f};
+      for (int c {0}; c < N; ++c)
+        len = std::max(len, std::abs(next[c]));
+      if (len < 1e-6f)
+        break;
+      for (int c {0}; c < N; ++c)
+        axis[c] = next[c] / len;
+    }
+    float lenSq {0.0f};
+    for (int c {0}; c < N; ++c)
+      lenSq += axis[c] * axis[c];
+    if (lenSq < 1e-12f) {
+      for (int c {0}; c < N; ++c)
+        lo[c] = hi[c] = mean[c];
+      return true;
+    }
+
+    float tMin {1e30f}, tMax {-1e30f};
+    for (uint32_t i {0}; i < blockPixels_c; ++i) {
+      if (mask[i] == 0.0f)
+        continue;
+      float t {0.0f};
+      for (int c {0}; c < N; ++c)
+        t += (block.ch[c][i] - mean[c]) * axis[c];
+      tMin = std::min(tMin, t);
+      tMax = std::max(tMax, t);
+    }
+    for (int c {0}; c < N; ++c) {
+      lo[c] = std::clamp(mean[c] + axis[c] * tMin / lenSq, 0.0f, 255.0f);
+      hi[c] = std::clamp(mean[c] + axis[c] * tMax / lenSq, 0.0f, 255.0f);
+    }
+    return true;
+  }
+
+  // Given each pixel's interpolation weight between two endpoints, solves for the endpoints which minimize the squared error.
+  // Pixels with a negative weight are ignored.  Returns false if the system is degenerate (e.g. every pixel uses the same weight).
+  template <int N>
+  bool refineEndpoints(const Block& block, const float (&weights)[blockPixels_c], float (&lo)[N], float (&hi)[N]) {
+    float aa {0.0f}, bb {0.0f}, ab {0.0f};
+    float ax[N] {}, bx[N] {};
+    for (uint32_t i {0}; i < blockPixels_c; ++i) {
+      const float w {weights[i]};
+      if (w < 0.0f)
+        continue;
+      const float a {1.0f - w};
+      aa += a * a;
+      bb += w * w;
+      ab += a * w;
+      for (int c {0}; c < N; ++c) {
+        ax[c] += a * block.ch[c][i];
+        bx[c] += w * block.ch[c][i];
+      }
+    }
+    const float det {aa * bb - ab * ab};
+    if (std::abs(det) < 1e-6f)
+      return false;
+    for (int c {0}; c < N; ++c) {
+      lo[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+      hi[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+    }
+    return true;
+  }
+
+  // Picks the closest palette entry for each pixel, returning the total squared error.
+  template <int N, int P>
+  float chooseIndices(const Block& block, const float (&palette)[P][N], uint32_t numEntries, const float (&mask)[blockPixels_c], uint8_t (&indices)[blockPixels_c]) {
+    float total {0.0f};
+    for (uint32_t i {0}; i < blockPixels_c; ++i) {
+      float best {1e30f};
+      uint8_t bestIndex {0};
+      for (uint32_t p {0}; p < numEntries; ++p) {
+        float err {0.0f};
+        for (int c {0}; c < N; ++c) {
+          const float d {block.ch[c][i] - palette[p][c]};
+          err += d * d;
+        }
+        if (err < best) {
+          best = err;
+          bestIndex = (uint8_t)p;
+        }
+      }
+      indices[i] = bestIndex;
+      total += best * mask[i];
+    }
+    return total;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // BC1 (also the color half of BC3).
+
+  uint16_t packRgb565(const float (&c)[3]) {
+    const uint32_t r {(uint32_t)std::lround(c[0] * (31.0f / 255.0f))};
+    const uint32_t g {(uint32_t)std::lround(c[1] * (63.0f / 255.0f))};
+    const uint32_t b {(uint32_t)std::lround(c[2] * (31.0f / 255.0f))};
+    return (uint16_t)((r << 11) | (g << 5) | b);
+  }
+
+  void unpackRgb565(uint16_t v, float (&c)[3]) {
+    const uint32_t r {(uint32_t)(v >> 11) & 31u}, g {(uint32_t)(v >> 5) & 63u}, b {v & 31u};
+    c[0] = (float)((r << 3) | (r >> 2));
+    c[1] = (float)((g << 2) | (g >> 4));
+    c[2] = (float)((b << 3) | (b >> 2));
+  }
+
+  struct Bc1Result {
+    uint16_t c0, c1;
+    uint8_t indices[blockPixels_c];
+    float error;
+  };
+
+  // Quantizes a pair of endpoints and picks indices for them.
+  // Four color mode needs c0 > c1, three color mode (where index 3 is transparent black) needs c0 <= c1.
+  Bc1Result evaluateBc1(const Block& block, const float (&lo)[3], const float (&hi)[3], bool threeColor, const float (&mask)[blockPixels_c]) {
+    Bc1Result result {packRgb565(hi), packRgb565(lo), {}, 0.0f};
+    if (threeColor ? (result.c0 > result.c1) : (result.c0 < result.c1))
+      std::swap(result.c0, result.c1);
+
+    float palette[4][3];
+    unpackRgb565(result.c0, palette[0]);
+    unpackRgb565(result.c1, palette[1]);
+    for (int c {0}; c < 3; ++c) {
+      if (threeColor) {
+        palette[2][c] = (palette[0][c] + palette[1][c]) * 0.5f;
+        palette[3][c] = 0.0f;
+      }
+      else {
+        palette[2][c] = (palette[0][c] * 2.0f + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + palette[1][c] * 2.0f) / 3.0f;
+      }
+    }
+    // When c0 == c1 only index 0 is meaningful, whichever mode the decoder picks.
+    const uint32_t numEntries {(result.c0 == result.c1) ? 1u : threeColor ? 3u : 4u};
+    result.error = chooseIndices<3>(block, palette, numEntries, mask, result.indices);
+    for (uint32_t i {0}; i < blockPixels_c; ++i)
+      if (threeColor && mask[i] == 0.0f)
+        result.indices[i] = 3;
+    return result;
+  }
+
+  // 'allowTransparent' is true for BC1RGBA, where pixels with alpha below 128 are encoded as transparent.
+  void encodeBc1(const Block& block, CompressionQuality quality, bool allowTransparent, uint8_t* out) {
+    float mask[blockPixels_c];
+    bool anyTransparent {false};
+    for (uint32_t i {0}; i < blockPixels_c; ++i) {
+      const bool transparent {allowTransparent && block.ch[3][i] < 128.0f};
+      mask[i] = transparent ? 0.0f : 1.0f;
+      anyTransparent |= transparent;
+    }
+
+    Bc1Result best {0, 0, {}, 0.0f};
+    float lo[3], hi[3];
+    if (!fitEndpoints<3>(block, mask, quality, lo, hi)) {
+      // Every pixel is transparent.
+      memset(best.indices, 3, sizeof(best.indices));
+    }
+    else {
+      best = evaluateBc1(block, lo, hi, anyTransparent, mask);
+      if (quality == CompressionQuality::High) {
+        // Fold the indices back into weights along the endpoints (in c0 -> c1 order) and re-solve.
+        static constexpr float fourColorWeights_c[4] {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+        static constexpr float threeColorWeights_c[4] {0.0f, 1.0f, 0.5f, -1.0f};
+        for (int iter {0}; iter < 2 && best.error > 0.0f && best.c0 != best.c1; ++iter) {
+          float weights[blockPixels_c];
+          for (uint32_t i {0}; i < blockPixels_c; ++i)
+            weights[i] = anyTransparent ? threeColorWeights_c[best.indices[i]] : fourColorWeights_c[best.indices[i]];
+          float e0[3], e1[3];
+          if (!refineEndpoints<3>(block, weights, e0, e1))
+            break;
+          const Bc1Result candidate {evaluateBc1(block, e1, e0, anyTransparent, mask)};
+          if (candidate.error >= best.error)
+            break;
+          best = candidate;
+        }
+      }
+    }
+
+    uint32_t bits {0};
+    for (uint32_t i {0}; i < blockPixels_c; ++i)
+      bits |= (uint32_t)best.indices[i] << (i * 2);
+    memcpy(out, &best.c0, 2);
+    memcpy(out + 2, &best.c1, 2);
+    memcpy(out + 4, &bits, 4);
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // BC4 (also the alpha half of BC3, and both halves of BC5).
+
+  struct Bc4Result {
+    uint8_t a0, a1;
+    uint8_t indices[blockPixels_c];
+    float error;
+  };
+
+  // a0 > a1 selects 8 interpolated values, a0 <= a1 selects 6 plus 0 and 255.
+  Bc4Result evaluateBc4(const Block& block, int channel, uint8_t a0, uint8_t a1) {
+    float palette[8][1];
+    palette[0][0] = a0;
+    palette[1][0] = a1;
+    if (a0 > a1) {
+      for (int i {2}; i < 8; ++i)
+        palette[i][0] = (float)(((8 - i) * a0 + (i - 1) * a1) / 7);
+    }
+    else {
+      for (int i {2}; i < 6; ++i)
+        palette[i][0] = (float)(((6 - i) * a0 + (i - 1) * a1) / 5);
+      palette[6][0] = 0.0f;
+      palette[7][0] = 255.0f;
+    }
+    // chooseIndices works on the first N channels, so point a block at the wanted channel.
+    Block single;
+    memcpy(single.ch[0], block.ch[channel], sizeof(single.ch[0]));
+    static constexpr float mask_c[blockPixels_c] {1,1,1,1, 1,1,1,1, 1,1,1,1, 1,1,1,1};
+    Bc4Result result {a0, a1, {}, 0.0f};
+    result.error = chooseIndices<1>(single, palette, 8, mask_c, result.indices);
+    return result;
+  }
+
+  void encodeBc4(const Block& block, int channel, CompressionQuality quality, uint8_t* out) {
+    float lo {255.0f}, hi {0.0f};
+    float innerLo {255.0f}, innerHi {0.0f};
+    for (uint32_t i {0}; i < blockPixels_c; ++i) {
+      const float v {block.ch[channel][i]};
+      lo = std::min(lo, v);
+      hi = std::max(hi, v);
+      if (v > 0.0f && v < 255.0f) {
+        innerLo = std::min(innerLo, v);
+        innerHi = std::max(innerHi, v);
+      }
+    }
+
+    Bc4Result best {evaluateBc4(block, channel, (uint8_t)hi, (uint8_t)lo)};
+    // Blocks which touch 0 or 255 can often do better with the six value mode, which has those values for free.
+    if (quality != CompressionQuality::Fast && best.error > 0.0f && (lo == 0.0f || hi == 255.0f)) {
+      if (innerLo > innerHi)
+        innerLo = innerHi = 0.0f;
+      const Bc4Result candidate {evaluateBc4(block, channel, (uint8_t)innerLo, (uint8_t)innerHi)};
+      if (candidate.error < best.error)
+        best = candidate;
+    }
+
+    uint64_t bits {0};
+    for (uint32_t i {0}; i < blockPixels_c; ++i)
+      bits |= (uint64_t)best.indices[i] << (i * 3);
+    out[0] = best.a0;
+    out[1] = best.a1;
+    for (int i {0}; i < 6; ++i)
+      out[2 + i] = (uint8_t)(bits >> (i * 8));
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // BC7 mode 6: one subset, RGBA endpoints with 7 bits per channel plus a shared p-bit per endpoint, and 4-bit indices.
+  // It handles smooth color and alpha well, which covers most runtime baked content.
+
+  constexpr float bc7Weights4_c[16] {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+  struct Bc7Endpoint {
+    uint8_t value[4]; // 7 bits per channel.
+    uint8_t pbit;
+  };
+
+  Bc7Endpoint quantizeBc7Endpoint(const float (&e)[4]) {
+    Bc7Endpoint best {};
+    float bestErr {1e30f};
+    for (uint8_t p {0}; p < 2; ++p) {
+      Bc7Endpoint candidate {{}, p};
+      float err {0.0f};
+      for (int c {0}; c < 4; ++c) {
+        candidate.value[c] = (uint8_t)std::clamp((int)std::lround((e[c] - p) * 0.5f), 0, 127);
+        const float d {(float)((candidate.value[c] << 1) | p) - e[c]};
+        err += d * d;
+      }
+      if (err < bestErr) {
+        bestErr = err;
+        best = candidate;
+      }
+    }
+    return best;
+  }
+
+  struct Bc7Result {
+    Bc7Endpoint e0, e1;
+    uint8_t indices[blockPixels_c];
+    float error;
+  };
+
+  Bc7Result evaluateBc7(const Block& block, const float (&lo)[4], const float (&hi)[4]) {
+    Bc7Result result {quantizeBc7Endpoint(lo), quantizeBc7Endpoint(hi), {}, 0.0f};
+    float palette[16][4];
+    for (int c {0}; c < 4; ++c) {
+      const int a {(result.e0.value[c] << 1) | result.e0.pbit};
+      const int b {(result.e1.value[c] << 1) | result.e1.pbit};
+      for (int i {0}; i < 16; ++i)
+        palette[i][c] = (float)((a * (64 - (int)bc7Weights4_c[i]) + b * (int)bc7Weights4_c[i] + 32) >> 6);
+    }
+    static constexpr float mask_c[blockPixels_c] {1,1,1,1, 1,1,1,1, 1,1,1,1, 1,1,1,1};
+    result.error = chooseIndices<4>(block, palette, 16, mask_c, result.indices);
+    return result;
+  }
+
+  // Writes bits into a block from least to most significant.
+  struct BitWriter {
+    uint8_t* out;
+    uint32_t pos {0};
+    void write(uint32_t value, uint32_t numBits) {
+      for (uint32_t i {0}; i < numBits; ++i, ++pos)
+        out[pos >> 3] |= (uint8_t)(((value >> i) & 1) << (pos & 7));
+    }
+  };
+
+  void encodeBc7(const Block& block, CompressionQuality quality, uint8_t* out) {
+    static constexpr float mask_c[blockPixels_c] {1,1,1,1, 1,1,1,1, 1,1,1,1, 1,1,1,1};
+    float lo[4], hi[4];
+    fitEndpoints<4>(block, mask_c, quality, lo, hi);
+    Bc7Result best {evaluateBc7(block, lo, hi)};
+
+    if (quality == CompressionQuality::High) {
+      for (int iter {0}; iter < 2 && best.error > 0.0f; ++iter) {
+        float weights[blockPixels_c];
+        for (uint32_t i {0}; i < blockPixels_c; ++i)
+          weights[i] = bc7Weights4_c[best.indices[i]] / 64.0f;
+        if (!refineEndpoints<4>(block, weights, lo, hi))
+          break;
+        const Bc7Result candidate {evaluateBc7(block, lo, hi)};
+        if (candidate.error >= best.error)
+          break;
+        best = candidate;
+      }
+    }
+
+    // The first index's most significant bit isn't stored, so it must be below 8.  Swapping the endpoints flips every index.
+    if (best.indices[0] >= 8) {
+      std::swap(best.e0, best.e1);
+      for (uint8_t& index : best.indices)
+        index = 15 - index;
+    }
+
+    memset(out, 0, 16);
+    BitWriter writer {out};
+    writer.write(1u << 6, 7); // Mode 6.
+    for (int c {0}; c < 4; ++c) {
+      writer.write(best.e0.value[c], 7);
+      writer.write(best.e1.value[c], 7);
+    }
+    writer.write(best.e0.pbit, 1);
+    writer.write(best.e1.pbit, 1);
+    for (uint32_t i {0}; i < blockPixels_c; ++i)
+      writer.write(best.indices[i], (i == 0) ? 3 : 4);
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Level compression.
+
+  enum class BlockEncoding { Unsupported, BC1, BC1A, BC3, BC4, BC5, BC7 };
+
+  BlockEncoding getBlockEncoding(ImageFormat format) {
+    switch (format) {
+      case ImageFormat::BC1RGB: case ImageFormat::BC1RGB_srgb: return BlockEncoding::BC1;
+      case ImageFormat::BC1RGBA: case ImageFormat::BC1RGBA_srgb: return BlockEncoding::BC1A;
+      case ImageFormat::BC3: case ImageFormat::BC3_srgb: return BlockEncoding::BC3;
+      case ImageFormat::BC4u: return BlockEncoding::BC4;
+      case ImageFormat::BC5u: return BlockEncoding::BC5;
+      case ImageFormat::BC7: case ImageFormat::BC7_srgb: return BlockEncoding::BC7;
+      default: return BlockEncoding::Unsupported;
+    }
+  }
+
+  uint32_t getBlockSize(BlockEncoding encoding) {
+    return (encoding == BlockEncoding::BC1 || encoding == BlockEncoding::BC1A || encoding == BlockEncoding::BC4) ? 8 : 16;
+  }
+
+  void encodeBlock(const Block& block, BlockEncoding encoding, CompressionQuality quality, uint8_t* out) {
+    switch (encoding) {
+      case BlockEncoding::BC1: encodeBc1(block, quality, false, out); break;
+      case BlockEncoding::BC1A: encodeBc1(block, quality, true, out); break;
+      case BlockEncoding::BC3: encodeBc4(block, 3, quality, out); encodeBc1(block, quality, false, out + 8); break;
+      case BlockEncoding::BC4: encodeBc4(block, 0, quality, out); break;
+      case BlockEncoding::BC5: encodeBc4(block, 0, quality, out); encodeBc4(block, 1, quality, out + 8); break;
+      case BlockEncoding::BC7: encodeBc7(block, quality, out); break;
+      case BlockEncoding::Unsupported: break;
+    }
+  }
+
+  void compressLevel(const uint8_t* rgba, uint32_t width, uint32_t height, BlockEncoding encoding, CompressionQuality quality, uint8_t* out) {
+    const uint32_t blocksX {(width + 3) / 4};
+    const uint32_t blocksY {(height + 3) / 4};
+    const uint32_t blockSize {getBlockSize(encoding)};
+    // A row of blocks is enough work to be worth a task on its own once the image is a few hundred pixels wide.
+    constexpr size_t minBlocksPerTask_c {256};
+    hlgl::getThreadPool().parallelForRange(blocksY, std::max<size_t>(1, minBlocksPerTask_c / blocksX), [&](size_t begin, size_t end) {
+      Block block;
+      for (uint32_t by {(uint32_t)begin}; by < end; ++by) {
+        for (uint32_t bx {0}; bx < blocksX; ++bx) {
+          loadBlock(rgba, width, height, bx, by, block);
+          encodeBlock(block, encoding, quality, out + ((size_t)by * blocksX + bx) * blockSize);
+        }
+      }
+    });
+  }
+
+} // namespace
+
+hlgl::MipChain hlgl::compressTexture(const MipChain& src, ImageFormat format, CompressionQuality quality) {
+  MipChain result {};
+  const BlockEncoding encoding {getBlockEncoding(format)};
+  if (encoding == BlockEncoding::Unsupported || src.data.empty() || src.offsets.empty())
+    return result;
+
+  result.format = format;
+  result.width = src.width;
+  result.height = src.height;
+  result.mipCount = src.mipCount;
+
+  // Lay out the compressed levels in the same order as the source, then compress each in place.
+  const uint32_t blockSize {getBlockSize(encoding)};
+  uint64_t size {0};
+  for (const Texture::Offset& offset : src.offsets) {
+    result.offsets.push_back(Texture::Offset{.offset = size, .layer = offset.layer, .mipLevel = offset.mipLevel});
+    const uint32_t w {std::max(1u, src.width >> offset.mipLevel)};
+    const uint32_t h {std::max(1u, src.height >> offset.mipLevel)};
+    size += (uint64_t)((w + 3) / 4) * ((h + 3) / 4) * blockSize;
+  }
+  result.data.resize(size);
+
+  for (size_t i {0}; i < src.offsets.size(); ++i) {
+    const uint32_t w {std::max(1u, src.width >> src.offsets[i].mipLevel)};
+    const uint32_t h {std::max(1u, src.height >> src.offsets[i].mipLevel)};
+    if (src.offsets[i].offset + (uint64_t)w * h * 4 > src.data.size())
+      return MipChain{};
+    compressLevel(src.data.data() + src.offsets[i].offset, w, h, encoding, quality, result.data.data() + result.offsets[i].offset);
+  }
+  return result;
+}
+
+hlgl::MipChain hlgl::compressTexture(const uint8_t* rgba, uint32_t width, uint32_t height, ImageFormat format, CompressionQuality quality) {
+  MipChain result {};
+  const BlockEncoding encoding {getBlockEncoding(format)};
+  if (encoding == BlockEncoding::Unsupported || !rgba || width == 0 || height == 0)
+    return result;
+
+  result.format = format;
+  result.width = width;
+  result.height = height;
+  result.mipCount = 1;
+  result.offsets.push_back(Texture::Offset{.offset = 0, .layer = 0, .mipLevel = 0});
+  result.data.resize((size_t)((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(encoding));
+  compressLevel(rgba, width, height, encoding, quality, result.data.data());
+  return result;
+}
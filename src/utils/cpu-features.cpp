@@ -0,0 +1,49 @@
+#include "cpu-features.h"
+
+#include <cstdint>
+
+#if defined(HLGL_SIMD_X86) && !defined(_MSC_VER)
+  #include <cpuid.h>
+#endif
+
+namespace {
+
+  hlgl::CpuFeatures detectCpuFeatures() {
+    hlgl::CpuFeatures features {};
+#ifdef HLGL_SIMD_X86
+    unsigned int regs1[4] {}, regs7[4] {};
+  #ifdef _MSC_VER
+    __cpuid((int*)regs1, 1);
+    __cpuidex((int*)regs7, 7, 0);
+  #else
+    __get_cpuid(1, &regs1[0], &regs1[1], &regs1[2], &regs1[3]);
+    __get_cpuid_count(7, 0, &regs7[0], &regs7[1], &regs7[2], &regs7[3]);
+  #endif
+    const bool osxsave {(regs1[2] & (1u << 27)) != 0};
+    const bool avx {(regs1[2] & (1u << 28)) != 0};
+    if (!osxsave || !avx)
+      return features;
+
+    // The OS has to save the upper halves of the YMM registers, or AVX instructions can't be used even if the CPU has them.
+  #ifdef _MSC_VER
+    const uint64_t xcr0 {_xgetbv(0)};
+  #else
+    uint32_t xcr0Lo, xcr0Hi;
+    __asm__ volatile("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+    const uint64_t xcr0 {((uint64_t)xcr0Hi << 32) | xcr0Lo};
+  #endif
+    if ((xcr0 & 0x6) != 0x6)
+      return features;
+
+    features.avx2 = (regs7[1] & (1u << 5)) != 0;
+    features.f16c = (regs1[2] & (1u << 29)) != 0;
+#endif
+    return features;
+  }
+
+} // namespace
+
+const hlgl::CpuFeatures& hlgl::getCpuFeatures() {
+  static const CpuFeatures features {detectCpuFeatures()};
+  return features;
+}
@@ -0,0 +1,34 @@
+#ifndef HLGL_UTILS_CPU_FEATURES_H
+#define HLGL_UTILS_CPU_FEATURES_H
+
+// Which SIMD instruction sets the CPU-side utilities can be built with.
+// x86 code paths are compiled per function with HLGL_TARGET_*, and only called if 'getCpuFeatures' says the CPU supports them.
+// NEON is part of the aarch64 baseline, so it's always used there.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+  #define HLGL_SIMD_X86
+  #include <immintrin.h>
+  #ifdef _MSC_VER
+    #include <intrin.h>
+    #define HLGL_TARGET_AVX2
+    #define HLGL_TARGET_F16C
+  #else
+    #define HLGL_TARGET_AVX2 __attribute__((target("avx2")))
+    #define HLGL_TARGET_F16C __attribute__((target("avx,f16c")))
+  #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  #define HLGL_SIMD_NEON
+  #include <arm_neon.h>
+#endif
+
+namespace hlgl {
+
+struct CpuFeatures {
+  bool avx2 {false};
+  bool f16c {false};
+};
+
+// Detected the first time it's called.
+const CpuFeatures& getCpuFeatures();
+
+} // namespace hlgl
+#endif // HLGL_UTILS_CPU_FEATURES_H
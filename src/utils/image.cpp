@@ -0,0 +1,505 @@
+#include <hlgl.h>
+#include "cpu-features.h"
+#include "thread-pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Work splitting.
+
+  // Work is split into chunks of at least this many bytes.  Anything smaller than a single chunk runs on the calling thread,
+  // since waking the workers would cost more than it saves.
+  constexpr size_t minChunkBytes_c {256 * 1024};
+
+  template <typename Func>
+  void parallelChunks(size_t count, size_t bytesPerItem, Func&& func) {
+    hlgl::getThreadPool().parallelForRange(count, minChunkBytes_c / std::max<size_t>(1, bytesPerItem), std::forward<Func>(func));
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // sRGB conversion tables.
+
+  // sRGB to 16-bit linear, and 16-bit linear back to sRGB.  The reverse table is large, but it keeps the dark end (where sRGB spends most of its precision) exact.
+  struct SrgbTables {
+    std::array<uint16_t, 256> toLinear {};
+    std::array<float, 256> toLinearF {};
+    std::vector<uint8_t> fromLinear {};
+
+    SrgbTables() {
+      for (uint32_t i {0}; i < 256; ++i) {
+        const float c {i / 255.0f};
+        const float lin {(c <= 0.04045f) ? (c / 12.92f) : std::pow((c + 0.055f) / 1.055f, 2.4f)};
+        toLinearF[i] = lin;
+        toLinear[i] = (uint16_t)std::lround(lin * 65535.0f);
+      }
+      fromLinear.resize(65536);
+      for (uint32_t i {0}; i < 65536; ++i)
+        fromLinear[i] = linearToSrgb(i / 65535.0f);
+    }
+
+    static uint8_t linearToSrgb(float lin) {
+      lin = std::clamp(lin, 0.0f, 1.0f);
+      const float c {(lin <= 0.0031308f) ? (lin * 12.92f) : (1.055f * std::pow(lin, 1.0f / 2.4f) - 0.055f)};
+      return (uint8_t)std::lround(c * 255.0f);
+    }
+    uint8_t fromLinearF(float lin) const {
+      return fromLinear[(uint32_t)std::lround(std::clamp(lin, 0.0f, 1.0f) * 65535.0f)];
+    }
+  };
+
+  const SrgbTables& getSrgbTables() {
+    static const SrgbTables tables {};
+    return tables;
+  }
+
+  // Exact rounded division by 255 of a product of two bytes.
+  inline uint8_t mulDiv255(uint32_t a, uint32_t b) {
+    const uint32_t t {a * b + 128};
+    return (uint8_t)((t + (t >> 8)) >> 8);
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // RGB to RGBA expansion.
+
+  void expandScalar(const uint8_t* src, uint8_t* dst, size_t begin, size_t end, uint8_t alpha) {
+    for (size_t i {begin}; i < end; ++i) {
+      dst[i * 4 + 0] = src[i * 3 + 0];
+      dst[i * 4 + 1] = src[i * 3 + 1];
+      dst[i * 4 + 2] = src[i * 3 + 2];
+      dst[i * 4 + 3] = alpha;
+    }
+  }
+
+#ifdef HLGL_SIMD_X86
+  HLGL_TARGET_AVX2 void expandAvx2(const uint8_t* src, uint8_t* dst, size_t begin, size_t end, uint8_t alpha) {
+    const __m256i shuffle {_mm256_setr_epi8(
+      0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11, -128,
+      0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11, -128)};
+    const __m256i alphaBits {_mm256_set1_epi32((int)((uint32_t)alpha << 24))};
+    size_t i {begin};
+    // Each iteration reads 28 bytes to produce 8 pixels, so stop early enough that the last load doesn't run past the end.
+    for (; i + 10 <= end; i += 8) {
+      const __m128i lo {_mm_loadu_si128((const __m128i*)(src + i * 3))};
+      const __m128i hi {_mm_loadu_si128((const __m128i*)(src + i * 3 + 12))};
+      __m256i v {_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1)};
+      v = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), alphaBits);
+      _mm256_storeu_si256((__m256i*)(dst + i * 4), v);
+    }
+    expandScalar(src, dst, i, end, alpha);
+  }
+#endif
+
+#ifdef HLGL_SIMD_NEON
+  void expandNeon(const uint8_t* src, uint8_t* dst, size_t begin, size_t end, uint8_t alpha) {
+    const uint8x16_t a {vdupq_n_u8(alpha)};
+    size_t i {begin};
+    for (; i + 16 <= end; i += 16) {
+      const uint8x16x3_t rgb {vld3q_u8(src + i * 3)};
+      const uint8x16x4_t rgba {{rgb.val[0], rgb.val[1], rgb.val[2], a}};
+      vst4q_u8(dst + i * 4, rgba);
+    }
+    expandScalar(src, dst, i, end, alpha);
+  }
+#endif
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Premultiplied alpha.
+
+  void premultiplyScalar(uint8_t* rgba, size_t begin, size_t end) {
+    for (size_t i {begin}; i < end; ++i) {
+      uint8_t* p {rgba + i * 4};
+      p[0] = mulDiv255(p[0], p[3]);
+      p[1] = mulDiv255(p[1], p[3]);
+      p[2] = mulDiv255(p[2], p[3]);
+    }
+  }
+
+  void premultiplySrgbScalar(uint8_t* rgba, size_t begin, size_t end) {
+    const SrgbTables& tables {getSrgbTables()};
+    for (size_t i {begin}; i < end; ++i) {
+      uint8_t* p {rgba + i * 4};
+      const uint32_t a {p[3]};
+      for (uint32_t c {0}; c < 3; ++c)
+        p[c] = tables.fromLinear[(tables.toLinear[p[c]] * a + 127) / 255];
+    }
+  }
+
+#ifdef HLGL_SIMD_X86
+  HLGL_TARGET_AVX2 inline __m256i premultiplyAvx2Half(__m256i px) {
+    // Broadcast each pixel's alpha across its four channels, but multiply alpha itself by 255 so it comes out unchanged.
+    const __m256i alphaShuffle {_mm256_setr_epi8(
+      6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+      6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15)};
+    __m256i alpha {_mm256_shuffle_epi8(px, alphaShuffle)};
+    alpha = _mm256_blend_epi16(alpha, _mm256_set1_epi16(255), 0x88);
+    __m256i t {_mm256_add_epi16(_mm256_mullo_epi16(px, alpha), _mm256_set1_epi16(128))};
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+  }
+
+  HLGL_TARGET_AVX2 void premultiplyAvx2(uint8_t* rgba, size_t begin, size_t end) {
+    size_t i {begin};
+    for (; i + 8 <= end; i += 8) {
+      const __m256i v {_mm256_loadu_si256((const __m256i*)(rgba + i * 4))};
+      const __m256i lo {premultiplyAvx2Half(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)))};
+      const __m256i hi {premultiplyAvx2Half(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)))};
+      // packus works within 128-bit lanes, which leaves the middle two pairs of pixels swapped.
+      const __m256i packed {_mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0))};
+      _mm256_storeu_si256((__m256i*)(rgba + i * 4), packed);
+    }
+    premultiplyScalar(rgba, i, end);
+  }
+#endif
+
+#ifdef HLGL_SIMD_NEON
+  inline uint8x8_t mulDiv255Neon(uint8x8_t c, uint8x8_t a) {
+    const uint16x8_t t {vmull_u8(c, a)};
+    return vrshrn_n_u16(vrsraq_n_u16(t, t, 8), 8);
+  }
+
+  void premultiplyNeon(uint8_t* rgba, size_t begin, size_t end) {
+    size_t i {begin};
+    for (; i + 8 <= end; i += 8) {
+      uint8x8x4_t px {vld4_u8(rgba + i * 4)};
+      px.val[0] = mulDiv255Neon(px.val[0], px.val[3]);
+      px.val[1] = mulDiv255Neon(px.val[1], px.val[3]);
+      px.val[2] = mulDiv255Neon(px.val[2], px.val[3]);
+      vst4_u8(rgba + i * 4, px);
+    }
+    premultiplyScalar(rgba, i, end);
+  }
+#endif
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Half float packing.
+
+  uint16_t floatToHalf(float f) {
+    uint32_t x;
+    memcpy(&x, &f, 4);
+    const uint32_t sign {(x >> 16) & 0x8000};
+    const uint32_t absx {x & 0x7FFFFFFF};
+
+    if (absx >= 0x7F800000) // Inf or NaN.
+      return (uint16_t)(sign | ((absx > 0x7F800000) ? 0x7E00 : 0x7C00));
+    if (absx >= 0x477FF000) // Rounds to a value larger than 65504.
+      return (uint16_t)(sign | 0x7C00);
+
+    if (absx < 0x38800000) { // Below the smallest normal half, so it becomes a denormal (or zero).
+      if (absx < 0x33000000)
+        return (uint16_t)sign;
+      const uint32_t shift {126 - (absx >> 23)};
+      const uint32_t mantissa {(absx & 0x7FFFFF) | 0x800000};
+      uint32_t h {mantissa >> shift};
+      const uint32_t rem {mantissa & ((1u << shift) - 1)};
+      const uint32_t halfway {1u << (shift - 1)};
+      if (rem > halfway || (rem == halfway && (h & 1)))
+        ++h;
+      return (uint16_t)(sign | h);
+    }
+
+    // Rebias the exponent from 127 to 15, and round the mantissa to nearest even.  A carry out of the mantissa correctly bumps the exponent.
+    uint32_t h {(absx - 0x38000000) >> 13};
+    const uint32_t rem {absx & 0x1FFF};
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+      ++h;
+    return (uint16_t)(sign | h);
+  }
+
+  void packHalfScalar(const float* src, uint16_t* dst, size_t begin, size_t end) {
+    for (size_t i {begin}; i < end; ++i)
+      dst[i] = floatToHalf(src[i]);
+  }
+
+#ifdef HLGL_SIMD_X86
+  HLGL_TARGET_F16C void packHalfF16c(const float* src, uint16_t* dst, size_t begin, size_t end) {
+    size_t i {begin};
+    for (; i + 8 <= end; i += 8)
+      _mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+    packHalfScalar(src, dst, i, end);
+  }
+#endif
+
+#ifdef HLGL_SIMD_NEON
+  void packHalfNeon(const float* src, uint16_t* dst, size_t begin, size_t end) {
+    size_t i {begin};
+    for (; i + 4 <= end; i += 4)
+      vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+    packHalfScalar(src, dst, i, end);
+  }
+#endif
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Mip downsampling.
+
+  // Every downsampler halves each dimension (rounding down, to a minimum of 1).
+  // On odd-sized levels the last row or column is clamped, matching the GPU's compute downsample.
+  struct Level {
+    const uint8_t* src;
+    uint32_t srcWidth, srcHeight;
+    uint8_t* dst;
+    uint32_t dstWidth, dstHeight;
+  };
+
+  void boxRowsScalar(const Level& l, uint32_t y, uint32_t x) {
+    const uint8_t* row0 {l.src + (size_t)std::min(y * 2, l.srcHeight - 1) * l.srcWidth * 4};
+    const uint8_t* row1 {l.src + (size_t)std::min(y * 2 + 1, l.srcHeight - 1) * l.srcWidth * 4};
+    uint8_t* out {l.dst + (size_t)y * l.dstWidth * 4};
+    for (; x < l.dstWidth; ++x) {
+      const uint32_t x0 {std::min(x * 2, l.srcWidth - 1) * 4};
+      const uint32_t x1 {std::min(x * 2 + 1, l.srcWidth - 1) * 4};
+      for (uint32_t c {0}; c < 4; ++c)
+        out[x * 4 + c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+    }
+  }
+
+  void boxScalar(const Level& l, uint32_t yBegin, uint32_t yEnd) {
+    for (uint32_t y {yBegin}; y < yEnd; ++y)
+      boxRowsScalar(l, y, 0);
+  }
+
+#ifdef HLGL_SIMD_X86
+  HLGL_TARGET_AVX2 void boxAvx2(const Level& l, uint32_t yBegin, uint32_t yEnd) {
+    // The vector loop never needs clamping horizontally as long as the source is at least 2 pixels wide.
+    const uint32_t vecWidth {(l.srcWidth >= 2) ? (l.dstWidth & ~3u) : 0};
+    for (uint32_t y {yBegin}; y < yEnd; ++y) {
+      const uint8_t* row0 {l.src + (size_t)std::min(y * 2, l.srcHeight - 1) * l.srcWidth * 4};
+      const uint8_t* row1 {l.src + (size_t)std::min(y * 2 + 1, l.srcHeight - 1) * l.srcWidth * 4};
+      uint8_t* out {l.dst + (size_t)y * l.dstWidth * 4};
+      for (uint32_t x {0}; x < vecWidth; x += 4) {
+        const __m256i a {_mm256_loadu_si256((const __m256i*)(row0 + x * 8))};
+        const __m256i b {_mm256_loadu_si256((const __m256i*)(row1 + x * 8))};
+        const __m256i v0 {_mm256_add_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(a)), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(b)))};
+        const __m256i v1 {_mm256_add_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(a, 1)), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(b, 1)))};
+        // Each 64 bits of v0/v1 is one pixel's vertical sum, so adding the even and odd 64-bit halves gives the 2x2 sums.
+        __m256i sum {_mm256_add_epi16(_mm256_unpacklo_epi64(v0, v1), _mm256_unpackhi_epi64(v0, v1))};
+        sum = _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(2)), 2);
+        sum = _mm256_permute4x64_epi64(sum, _MM_SHUFFLE(3, 1, 2, 0));
+        const __m256i packed {_mm256_permute4x64_epi64(_mm256_packus_epi16(sum, sum), _MM_SHUFFLE(3, 1, 2, 0))};
+        _mm_storeu_si128((__m128i*)(out + x * 4), _mm256_castsi256_si128(packed));
+      }
+      boxRowsScalar(l, y, vecWidth);
+    }
+  }
+#endif
+
+#ifdef HLGL_SIMD_NEON
+  void boxNeon(const Level& l, uint32_t yBegin, uint32_t yEnd) {
+    const uint32_t vecWidth {(l.srcWidth >= 2) ? (l.dstWidth & ~7u) : 0};
+    for (uint32_t y {yBegin}; y < yEnd; ++y) {
+      const uint8_t* row0 {l.src + (size_t)std::min(y * 2, l.srcHeight - 1) * l.srcWidth * 4};
+      const uint8_t* row1 {l.src + (size_t)std::min(y * 2 + 1, l.srcHeight - 1) * l.srcWidth * 4};
+      uint8_t* out {l.dst + (size_t)y * l.dstWidth * 4};
+      for (uint32_t x {0}; x < vecWidth; x += 8) {
+        const uint8x16x4_t a {vld4q_u8(row0 + x * 8)};
+        const uint8x16x4_t b {vld4q_u8(row1 + x * 8)};
+        uint8x8x4_t result;
+        for (int c {0}; c < 4; ++c)
+          result.val[c] = vrshrn_n_u16(vpadalq_u8(vpaddlq_u8(a.val[c]), b.val[c]), 2);
+        vst4_u8(out + x * 4, result);
+      }
+      boxRowsScalar(l, y, vecWidth);
+    }
+  }
+#endif
+
+  // Box filtering in linear space.  The extra table lookups per sample are what dominates, so there's no vector path.
+  void boxSrgb(const Level& l, uint32_t yBegin, uint32_t yEnd) {
+    const SrgbTables& tables {getSrgbTables()};
+    for (uint32_t y {yBegin}; y < yEnd; ++y) {
+      const uint8_t* row0 {l.src + (size_t)std::min(y * 2, l.srcHeight - 1) * l.srcWidth * 4};
+      const uint8_t* row1 {l.src + (size_t)std::min(y * 2 + 1, l.srcHeight - 1) * l.srcWidth * 4};
+      uint8_t* out {l.dst + (size_t)y * l.dstWidth * 4};
+      for (uint32_t x {0}; x < l.dstWidth; ++x) {
+        const uint32_t x0 {std::min(x * 2, l.srcWidth - 1) * 4};
+        const uint32_t x1 {std::min(x * 2 + 1, l.srcWidth - 1) * 4};
+        for (uint32_t c {0}; c < 3; ++c) {
+          const uint32_t sum {(uint32_t)tables.toLinear[row0[x0 + c]] + tables.toLinear[row0[x1 + c]] +
+                              tables.toLinear[row1[x0 + c]] + tables.toLinear[row1[x1 + c]]};
+          out[x * 4 + c] = tables.fromLinear[(sum + 2) >> 2];
+        }
+        out[x * 4 + 3] = (uint8_t)((row0[x0 + 3] + row0[x1 + 3] + row1[x0 + 3] + row1[x1 + 3] + 2) >> 2);
+      }
+    }
+  }
+
+  // A 6-tap Kaiser-windowed sinc, for halving resolution.  The taps sit at -2.5 to +2.5 source pixels from the destination pixel's center.
+  constexpr int kaiserTaps_c {6};
+
+  const std::array<float, kaiserTaps_c>& getKaiserWeights() {
+    static const std::array<float, kaiserTaps_c> weights {[]() {
+      constexpr double pi {3.14159265358979323846};
+      constexpr double beta {4.0};
+      constexpr double radius {3.0}; // In source pixels.
+      auto besselI0 = [](double x) {
+        double sum {1.0}, term {1.0};
+        for (int k {1}; k < 20; ++k) {
+          term *= (x / (2.0 * k)) * (x / (2.0 * k));
+          sum += term;
+        }
+        return sum;
+      };
+      std::array<float, kaiserTaps_c> w {};
+      double total {0.0};
+      for (int i {0}; i < kaiserTaps_c; ++i) {
+        const double d {i - 2.5};
+        const double t {d * 0.5}; // The sinc's cutoff is the destination's Nyquist frequency, half the source's.
+        const double sinc {(t == 0.0) ? 1.0 : std::sin(pi * t) / (pi * t)};
+        const double r {d / radius};
+        const double window {besselI0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / besselI0(beta)};
+        w[i] = (float)(sinc * window);
+        total += w[i];
+      }
+      for (float& weight : w)
+        weight = (float)(weight / total);
+      return w;
+    }()};
+    return weights;
+  }
+
+  // The Kaiser filter is separable, so it's applied horizontally into a float buffer, then vertically from that into the destination.
+  // Color is filtered in linear space when 'srgb' is true.
+  void kaiserHorizontal(const Level& l, float* tmp, uint32_t yBegin, uint32_t yEnd, bool srgb) {
+    const std::array<float, kaiserTaps_c>& weights {getKaiserWeights()};
+    const SrgbTables& tables {getSrgbTables()};
+    for (uint32_t y {yBegin}; y < yEnd; ++y) {
+      const uint8_t* row {l.src + (size_t)y * l.srcWidth * 4};
+      float* out {tmp + (size_t)y * l.dstWidth * 4};
+      for (uint32_t x {0}; x < l.dstWidth; ++x) {
+        float sum[4] {};
+        for (int t {0}; t < kaiserTaps_c; ++t) {
+          const int sx {std::clamp((int)(x * 2) - 2 + t, 0, (int)l.srcWidth - 1)};
+          const uint8_t* p {row + sx * 4};
+          for (int c {0}; c < 3; ++c)
+            sum[c] += weights[t] * (srgb ? tables.toLinearF[p[c]] : p[c] * (1.0f / 255.0f));
+          sum[3] += weights[t] * (p[3] * (1.0f / 255.0f));
+        }
+        memcpy(out + x * 4, sum, sizeof(sum));
+      }
+    }
+  }
+
+  void kaiserVertical(const Level& l, const float* tmp, uint32_t yBegin, uint32_t yEnd, bool srgb) {
+    const std::array<float, kaiserTaps_c>& weights {getKaiserWeights()};
+    const SrgbTables& tables {getSrgbTables()};
+    for (uint32_t y {yBegin}; y < yEnd; ++y) {
+      uint8_t* out {l.dst + (size_t)y * l.dstWidth * 4};
+      for (uint32_t x {0}; x < l.dstWidth; ++x) {
+        float sum[4] {};
+        for (int t {0}; t < kaiserTaps_c; ++t) {
+          const int sy {std::clamp((int)(y * 2) - 2 + t, 0, (int)l.srcHeight - 1)};
+          const float* p {tmp + ((size_t)sy * l.dstWidth + x) * 4};
+          for (int c {0}; c < 4; ++c)
+            sum[c] += weights[t] * p[c];
+        }
+        for (int c {0}; c < 3; ++c)
+          out[x * 4 + c] = srgb ? tables.fromLinearF(sum[c]) : (uint8_t)std::lround(std::clamp(sum[c], 0.0f, 1.0f) * 255.0f);
+        out[x * 4 + 3] = (uint8_t)std::lround(std::clamp(sum[3], 0.0f, 1.0f) * 255.0f);
+      }
+    }
+  }
+
+} // namespace
+
+void hlgl::expandRGB8ToRGBA8(const uint8_t* src, uint8_t* dst, size_t pixelCount, uint8_t alpha) {
+  parallelChunks(pixelCount, 4, [&](size_t begin, size_t end) {
+#if defined(HLGL_SIMD_X86)
+    if (getCpuFeatures().avx2)
+      return expandAvx2(src, dst, begin, end, alpha);
+#elif defined(HLGL_SIMD_NEON)
+    return expandNeon(src, dst, begin, end, alpha);
+#endif
+    expandScalar(src, dst, begin, end, alpha);
+  });
+}
+
+void hlgl::premultiplyAlpha(uint8_t* rgba, size_t pixelCount, bool srgb) {
+  if (srgb)
+    getSrgbTables(); // Build the tables before the worker threads need them.
+  parallelChunks(pixelCount, 4, [&](size_t begin, size_t end) {
+    if (srgb)
+      return premultiplySrgbScalar(rgba, begin, end);
+#if defined(HLGL_SIMD_X86)
+    if (getCpuFeatures().avx2)
+      return premultiplyAvx2(rgba, begin, end);
+#elif defined(HLGL_SIMD_NEON)
+    return premultiplyNeon(rgba, begin, end);
+#endif
+    premultiplyScalar(rgba, begin, end);
+  });
+}
+
+void hlgl::packHalfFloats(const float* src, uint16_t* dst, size_t count) {
+  parallelChunks(count, 4, [&](size_t begin, size_t end) {
+#if defined(HLGL_SIMD_X86)
+    if (getCpuFeatures().f16c)
+      return packHalfF16c(src, dst, begin, end);
+#elif defined(HLGL_SIMD_NEON)
+    return packHalfNeon(src, dst, begin, end);
+#endif
+    packHalfScalar(src, dst, begin, end);
+  });
+}
+
+hlgl::MipChain hlgl::buildMipChainRGBA8(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t mipCount, bool srgb, MipFilter filter) {
+  MipChain chain {};
+  if (!rgba || width == 0 || height == 0)
+    return chain;
+
+  const uint32_t fullCount {(uint32_t)std::log2(std::max(width, height)) + 1};
+  chain.format = srgb ? ImageFormat::RGBA8i_srgb : ImageFormat::RGBA8i;
+  chain.width = width;
+  chain.height = height;
+  chain.mipCount = (mipCount == 0) ? fullCount : std::min(mipCount, fullCount);
+
+  // Lay out every level up front so each one can be written in place.
+  uint64_t size {0};
+  for (uint32_t i {0}; i < chain.mipCount; ++i) {
+    chain.offsets.push_back(Texture::Offset{.offset = size, .layer = 0, .mipLevel = i});
+    size += (uint64_t)std::max(1u, width >> i) * std::max(1u, height >> i) * 4;
+  }
+  chain.data.resize(size);
+  memcpy(chain.data.data(), rgba, (size_t)width * height * 4);
+
+  if (srgb || filter == MipFilter::Kaiser)
+    getSrgbTables();
+  if (filter == MipFilter::Kaiser)
+    getKaiserWeights();
+
+  // Each level depends on the one before it, so the levels are built in order, with the rows of each one spread across threads.
+  std::vector<float> tmp {};
+  for (uint32_t i {1}; i < chain.mipCount; ++i) {
+    const Level l {
+      .src = chain.data.data() + chain.offsets[i-1].offset,
+      .srcWidth = std::max(1u, width >> (i-1)),
+      .srcHeight = std::max(1u, height >> (i-1)),
+      .dst = chain.data.data() + chain.offsets[i].offset,
+      .dstWidth = std::max(1u, width >> i),
+      .dstHeight = std::max(1u, height >> i) };
+
+    if (filter == MipFilter::Kaiser) {
+      tmp.resize((size_t)l.dstWidth * l.srcHeight * 4);
+      parallelChunks(l.srcHeight, (size_t)l.srcWidth * 4, [&](size_t begin, size_t end) {
+        kaiserHorizontal(l, tmp.data(), (uint32_t)begin, (uint32_t)end, srgb); });
+      parallelChunks(l.dstHeight, (size_t)l.dstWidth * 4 * kaiserTaps_c, [&](size_t begin, size_t end) {
+        kaiserVertical(l, tmp.data(), (uint32_t)begin, (uint32_t)end, srgb); });
+      continue;
+    }
+
+    parallelChunks(l.dstHeight, (size_t)l.srcWidth * 8, [&](size_t begin, size_t end) {
+      if (srgb)
+        return boxSrgb(l, (uint32_t)begin, (uint32_t)end);
+#if defined(HLGL_SIMD_X86)
+      if (getCpuFeatures().avx2)
+        return boxAvx2(l, (uint32_t)begin, (uint32_t)end);
+#elif defined(HLGL_SIMD_NEON)
+      return boxNeon(l, (uint32_t)begin, (uint32_t)end);
+#endif
+      boxScalar(l, (uint32_t)begin, (uint32_t)end);
+    });
+  }
+  return chain;
+}
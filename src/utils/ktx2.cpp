@@ -0,0 +1,48 @@
+#include "ktx2.h"
+
+#include <cstring>
+
+namespace {
+
+  constexpr uint8_t ktx2Identifier_c[12] {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+  constexpr size_t ktx2HeaderSize_c {80};     // Identifier, header fields, and the index, up to where the level index begins.
+  constexpr size_t ktx2LevelIndexEntry_c {24};
+
+  uint32_t readU32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+  uint64_t readU64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+
+} // namespace
+
+bool hlgl::parseKtx2Header(const uint8_t* data, size_t size, Ktx2Header& header) {
+  if (!data || size < ktx2HeaderSize_c || memcmp(data, ktx2Identifier_c, sizeof(ktx2Identifier_c)) != 0)
+    return false;
+
+  header.vkFormat = readU32(data + 12);
+  header.typeSize = readU32(data + 16);
+  header.width = readU32(data + 20);
+  header.height = readU32(data + 24);
+  header.depth = readU32(data + 28);
+  header.layerCount = readU32(data + 32);
+  header.faceCount = readU32(data + 36);
+  header.levelCount = readU32(data + 40);
+  header.supercompression = readU32(data + 44);
+  if (header.faceCount == 0 || header.width == 0)
+    return false;
+
+  // A level count of 0 means the loader is expected to generate the mips, which only the first level is stored for.
+  const uint32_t numLevels {(header.levelCount > 0) ? header.levelCount : 1};
+  if (ktx2HeaderSize_c + (size_t)numLevels * ktx2LevelIndexEntry_c > size)
+    return false;
+
+  header.levels.resize(numLevels);
+  for (uint32_t i {0}; i < numLevels; ++i) {
+    const uint8_t* entry {data + ktx2HeaderSize_c + i * ktx2LevelIndexEntry_c};
+    header.levels[i] = Ktx2Header::Level{
+      .offset = readU64(entry),
+      .length = readU64(entry + 8),
+      .uncompressedLength = readU64(entry + 16) };
+    if (header.levels[i].offset > size || header.levels[i].length > size - header.levels[i].offset)
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,39 @@
+#ifndef HLGL_UTILS_KTX2_H
+#define HLGL_UTILS_KTX2_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hlgl {
+
+// The parts of a KTX2 file's header and level index which are needed to locate individual mip levels within the file.
+// libktx always copies a file's image data onto the heap, so this is used to read levels directly from a mapped file instead.
+struct Ktx2Header {
+  struct Level {
+    uint64_t offset;              // Offset of this level's data from the start of the file, in bytes.
+    uint64_t length;              // Size of this level's data in the file, in bytes.
+    uint64_t uncompressedLength;  // Size of this level's data after supercompression has been undone, in bytes.
+  };
+
+  uint32_t vkFormat {0};
+  uint32_t typeSize {0};
+  uint32_t width {0};
+  uint32_t height {0};
+  uint32_t depth {0};
+  uint32_t layerCount {0};
+  uint32_t faceCount {0};
+  uint32_t levelCount {0};
+  uint32_t supercompression {0};
+  std::vector<Level> levels {};   // Indexed by mip level, 0 being the largest.
+
+  // The number of separate images (layers and faces) stored in each mip level.
+  uint32_t imagesPerLevel() const { return ((layerCount > 0) ? layerCount : 1) * faceCount; }
+};
+
+// Parses the header and level index of KTX2 data held in memory (usually a mapped file).
+// Returns false if the data isn't KTX2, or if any level lies outside of the data.
+bool parseKtx2Header(const uint8_t* data, size_t size, Ktx2Header& header);
+
+} // namespace hlgl
+#endif // HLGL_UTILS_KTX2_H
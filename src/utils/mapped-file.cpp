@@ -0,0 +1,114 @@
+#include "mapped-file.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace {
+
+  constexpr size_t pageSize_c {4096};
+
+} // namespace
+
+hlgl::MappedFile::MappedFile(const char* filename) {
+  if (!filename)
+    return;
+
+#if defined(_WIN32)
+  HANDLE file {CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr)};
+  if (file == INVALID_HANDLE_VALUE)
+    return;
+  LARGE_INTEGER fileSize {};
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+    CloseHandle(file);
+    return;
+  }
+  HANDLE mapping {CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)};
+  if (!mapping) {
+    CloseHandle(file);
+    return;
+  }
+  const void* view {MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)};
+  if (!view) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return;
+  }
+  file_ = file;
+  mapping_ = mapping;
+  data_ = (const uint8_t*)view;
+  size_ = (size_t)fileSize.QuadPart;
+#else
+  int fd {open(filename, O_RDONLY)};
+  if (fd < 0)
+    return;
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    ::close(fd);
+    return;
+  }
+  void* view {mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)};
+  // The mapping keeps its own reference to the file, so the descriptor isn't needed anymore.
+  ::close(fd);
+  if (view == MAP_FAILED)
+    return;
+  data_ = (const uint8_t*)view;
+  size_ = (size_t)st.st_size;
+#endif
+}
+
+hlgl::MappedFile::MappedFile(MappedFile&& other) noexcept {
+  *this = std::move(other);
+}
+
+hlgl::MappedFile& hlgl::MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    close();
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+#if defined(_WIN32)
+    std::swap(file_, other.file_);
+    std::swap(mapping_, other.mapping_);
+#endif
+  }
+  return *this;
+}
+
+hlgl::MappedFile::~MappedFile() {
+  close();
+}
+
+void hlgl::MappedFile::close() {
+#if defined(_WIN32)
+  if (data_) UnmapViewOfFile(data_);
+  if (mapping_) CloseHandle((HANDLE)mapping_);
+  if (file_) CloseHandle((HANDLE)file_);
+  file_ = nullptr;
+  mapping_ = nullptr;
+#else
+  if (data_) munmap((void*)data_, size_);
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+void hlgl::MappedFile::prefetch(size_t offset, size_t size) const {
+  if (!data_ || offset >= size_)
+    return;
+  if (size > size_ - offset)
+    size = size_ - offset;
+  volatile uint8_t sink {0};
+  for (size_t i {0}; i < size; i += pageSize_c)
+    sink = sink + data_[offset + i];
+  if (size > 0)
+    sink = sink + data_[offset + size - 1];
+}
@@ -0,0 +1,43 @@
+#ifndef HLGL_UTILS_MAPPED_FILE_H
+#define HLGL_UTILS_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hlgl {
+
+// A read-only view of an entire file, mapped into the address space of the process.
+// Pages are read from disk by the OS the first time they're touched, so nothing is copied onto the heap.
+class MappedFile {
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+public:
+  MappedFile() noexcept = default;
+  explicit MappedFile(const char* filename);
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+  ~MappedFile();
+
+  bool isValid() const { return (data_ != nullptr); }
+  operator bool() const { return isValid(); }
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Touches every page in the given range so it's read from disk now, rather than when it's first accessed.
+  // Intended to be called from a worker thread ahead of copying the data on the render thread.
+  void prefetch(size_t offset, size_t size) const;
+
+private:
+  void close();
+
+  const uint8_t* data_ {nullptr};
+  size_t size_ {0};
+#if defined(_WIN32)
+  void* file_ {nullptr};
+  void* mapping_ {nullptr};
+#endif
+};
+
+} // namespace hlgl
+#endif // HLGL_UTILS_MAPPED_FILE_H
@@ -0,0 +1,380 @@
+#include <hlgl.h>
+#include "thread-pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+  constexpr uint32_t invalidIndex_c {UINT32_MAX};
+
+  // The number of triangles a cluster must have before overdraw optimization will consider splitting it.
+  constexpr size_t minClusterTriangles_c {8};
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Vertex welding.
+
+  uint32_t hashVertex(const uint8_t* bytes, size_t size) {
+    // Mixes a word at a time, which is plenty for vertex data where neighbouring vertices mostly differ in their first few floats.
+    uint32_t hash {2166136261u};
+    size_t i {0};
+    for (; i + 4 <= size; i += 4) {
+      uint32_t word;
+      std::memcpy(&word, bytes + i, 4);
+      word *= 0x5bd1e995u;
+      word ^= word >> 24;
+      hash = (hash * 0x5bd1e995u) ^ (word * 0x5bd1e995u);
+    }
+    for (; i < size; ++i)
+      hash = (hash ^ bytes[i]) * 16777619u;
+    return hash ^ (hash >> 15);
+  }
+
+  // Maps each vertex to the first vertex with identical bytes, using an open addressing hash table.
+  std::vector<uint32_t> weldVertices(const uint8_t* vertices, size_t vertexCount, size_t vertexSize) {
+    size_t capacity {16};
+    while (capacity < vertexCount * 2)
+      capacity *= 2;
+    std::vector<uint32_t> table(capacity, invalidIndex_c);
+    std::vector<uint32_t> remap(vertexCount);
+    for (size_t v {0}; v < vertexCount; ++v) {
+      const uint8_t* bytes {vertices + v * vertexSize};
+      size_t slot {hashVertex(bytes, vertexSize) & (capacity - 1)};
+      while (true) {
+        const uint32_t existing {table[slot]};
+        if (existing == invalidIndex_c) {
+          table[slot] = (uint32_t)v;
+          remap[v] = (uint32_t)v;
+          break;
+        }
+        if (std::memcmp(vertices + existing * vertexSize, bytes, vertexSize) == 0) {
+          remap[v] = existing;
+          break;
+        }
+        slot = (slot + 1) & (capacity - 1);
+      }
+    }
+    return remap;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Vertex cache optimization.
+
+  // A FIFO cache, where a vertex is cached if fewer than 'size' misses have happened since it was last missed.
+  struct CacheSim {
+    std::vector<uint32_t> missTime;
+    uint32_t time;
+    uint32_t size;
+    CacheSim(size_t vertexCount, uint32_t cacheSize) : missTime(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+    bool access(uint32_t v) {
+      if (time - missTime[v] <= size)
+        return true;
+      missTime[v] = time++;
+      return false;
+    }
+    void reset() { time += size + 1; }
+  };
+
+  // Tipsify, from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander, Nehab, Barczak 2007).
+  // Emits every triangle around one vertex at a time, then moves on to the neighbour which will still be in the cache after its own fan,
+  // falling back to recently used vertices and then to a cursor through the vertices when it runs into a dead end.
+  std::vector<uint32_t> tipsify(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+    const size_t triangleCount {indices.size() / 3};
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (uint32_t v : indices)
+      ++live[v];
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v {0}; v < vertexCount; ++v)
+      adjacencyOffsets[v + 1] = adjacencyOffsets[v] + live[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+      std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+      for (size_t i {0}; i < indices.size(); ++i)
+        adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds {};
+    std::vector<uint32_t> candidates {};
+    std::vector<uint32_t> result {};
+    result.reserve(indices.size());
+    uint32_t time {cacheSize + 1};
+    size_t cursor {0};
+
+    auto skipDeadEnd = [&]() -> uint32_t {
+      while (!deadEnds.empty()) {
+        const uint32_t v {deadEnds.back()};
+        deadEnds.pop_back();
+        if (live[v] > 0)
+          return v;
+      }
+      for (; cursor < vertexCount; ++cursor) {
+        if (live[cursor] > 0)
+          return (uint32_t)cursor;
+      }
+      return invalidIndex_c;
+    };
+
+    uint32_t fan {skipDeadEnd()};
+    while (fan != invalidIndex_c) {
+      candidates.clear();
+      for (uint32_t a {adjacencyOffsets[fan]}; a < adjacencyOffsets[fan + 1]; ++a) {
+        const uint32_t triangle {adjacency[a]};
+        if (emitted[triangle])
+          continue;
+        for (uint32_t k {0}; k < 3; ++k) {
+          const uint32_t v {indices[triangle * 3 + k]};
+          result.push_back(v);
+          deadEnds.push_back(v);
+          candidates.push_back(v);
+          --live[v];
+          if (time - cacheTime[v] > cacheSize)
+            cacheTime[v] = time++;
+        }
+        emitted[triangle] = true;
+      }
+
+      // Prefer the candidate which has been in the cache longest, as long as its whole fan would fit before it's evicted.
+      uint32_t next {invalidIndex_c};
+      int64_t bestPriority {-1};
+      for (uint32_t v : candidates) {
+        if (live[v] == 0)
+          continue;
+        int64_t priority {0};
+        if ((int64_t)(time - cacheTime[v]) + 2 * (int64_t)live[v] <= (int64_t)cacheSize)
+          priority = time - cacheTime[v];
+        if (priority > bestPriority) {
+          bestPriority = priority;
+          next = v;
+        }
+      }
+      fan = (next != invalidIndex_c) ? next : skipDeadEnd();
+    }
+    return result;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Overdraw optimization.
+
+  struct Vec3 {
+    float x, y, z;
+    Vec3 operator+(const Vec3& o) const { return {x + o.x, y + o.y, z + o.z}; }
+    Vec3 operator-(const Vec3& o) const { return {x - o.x, y - o.y, z - o.z}; }
+    Vec3 operator*(float s) const { return {x * s, y * s, z * s}; }
+  };
+  float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+  Vec3 cross(const Vec3& a, const Vec3& b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+
+  // Splits the cache-optimized triangles into clusters which can be drawn in any order without losing much of the cache's benefit.
+  // A cluster ends wherever the cache is cold anyway (a triangle misses all three vertices), and large clusters are split further
+  // wherever starting over from a cold cache costs no more than 'threshold' times the cluster's cache miss ratio.
+  std::vector<size_t> findClusters(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize, float threshold) {
+    const size_t triangleCount {indices.size() / 3};
+    CacheSim cache(vertexCount, cacheSize);
+    auto misses = [&](size_t triangle) {
+      uint32_t count {0};
+      for (size_t k {0}; k < 3; ++k)
+        count += cache.access(indices[triangle * 3 + k]) ? 0 : 1;
+      return count;
+    };
+
+    std::vector<size_t> hard {0};
+    for (size_t t {0}; t < triangleCount; ++t) {
+      if (misses(t) == 3 && t > 0)
+        hard.push_back(t);
+    }
+    hard.push_back(triangleCount);
+
+    std::vector<size_t> clusters {};
+    for (size_t h {0}; h + 1 < hard.size(); ++h) {
+      const size_t begin {hard[h]}, end {hard[h + 1]};
+      cache.reset();
+      uint32_t clusterMisses {0};
+      for (size_t t {begin}; t < end; ++t)
+        clusterMisses += misses(t);
+      const float clusterAcmr {(float)clusterMisses / (float)(end - begin)};
+
+      cache.reset();
+      clusters.push_back(begin);
+      size_t start {begin};
+      uint32_t runningMisses {0};
+      for (size_t t {begin}; t + 1 < end; ++t) {
+        runningMisses += misses(t);
+        const size_t count {t + 1 - start};
+        if (count >= minClusterTriangles_c && (float)runningMisses / (float)count <= clusterAcmr * threshold) {
+          clusters.push_back(t + 1);
+          cache.reset();
+          start = t + 1;
+          runningMisses = 0;
+        }
+      }
+    }
+    return clusters;
+  }
+
+  // Sorts clusters so the ones facing away from the middle of the mesh are drawn first.  Those are the most likely to be in front
+  // of the rest of the mesh from any viewpoint, so drawing them first lets early depth testing reject more of what's behind them.
+  std::vector<uint32_t> sortClusters(const std::vector<uint32_t>& indices, const std::vector<size_t>& clusters, const uint8_t* vertices, size_t vertexSize, size_t positionOffset) {
+    const size_t triangleCount {indices.size() / 3};
+    auto position = [&](uint32_t v) {
+      float p[3];
+      std::memcpy(p, vertices + v * vertexSize + positionOffset, sizeof(p));
+      return Vec3{p[0], p[1], p[2]};
+    };
+
+    struct ClusterInfo {
+      Vec3 centroid {0.0f, 0.0f, 0.0f};
+      Vec3 normal {0.0f, 0.0f, 0.0f};
+      float area {0.0f};
+    };
+    std::vector<ClusterInfo> info(clusters.size());
+    Vec3 meshCentroid {0.0f, 0.0f, 0.0f};
+    float meshArea {0.0f};
+    for (size_t c {0}; c < clusters.size(); ++c) {
+      const size_t end {(c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount};
+      for (size_t t {clusters[c]}; t < end; ++t) {
+        const Vec3 a {position(indices[t * 3])}, b {position(indices[t * 3 + 1])}, d {position(indices[t * 3 + 2])};
+        const Vec3 n {cross(b - a, d - a)};
+        const float area {std::sqrt(dot(n, n))};
+        info[c].centroid = info[c].centroid + (a + b + d) * (area / 3.0f);
+        info[c].normal = info[c].normal + n;
+        info[c].area += area;
+      }
+      meshCentroid = meshCentroid + info[c].centroid;
+      meshArea += info[c].area;
+    }
+    if (meshArea > 0.0f)
+      meshCentroid = meshCentroid * (1.0f / meshArea);
+
+    std::vector<float> sortKey(clusters.size(), 0.0f);
+    for (size_t c {0}; c < clusters.size(); ++c) {
+      if (info[c].area <= 0.0f)
+        continue;
+      const Vec3 centroid {info[c].centroid * (1.0f / info[c].area)};
+      const float normalLength {std::sqrt(dot(info[c].normal, info[c].normal))};
+      if (normalLength > 0.0f)
+        sortKey[c] = dot(centroid - meshCentroid, info[c].normal * (1.0f / normalLength));
+    }
+    std::vector<uint32_t> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32_t> result {};
+    result.reserve(indices.size());
+    for (uint32_t c : order) {
+      const size_t end {(c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount};
+      result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + end * 3);
+    }
+    return result;
+  }
+
+} // namespace
+
+hlgl::VertexCacheStats hlgl::analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+  VertexCacheStats stats {};
+  if (!indices || indexCount < 3 || vertexCount == 0 || cacheSize == 0)
+    return stats;
+  CacheSim cache(vertexCount, cacheSize);
+  std::vector<bool> used(vertexCount, false);
+  size_t usedCount {0};
+  for (size_t i {0}; i < indexCount; ++i) {
+    if (indices[i] >= vertexCount)
+      return VertexCacheStats{};
+    stats.vertexInvocations += cache.access(indices[i]) ? 0 : 1;
+    if (!used[indices[i]]) {
+      used[indices[i]] = true;
+      ++usedCount;
+    }
+  }
+  stats.acmr = (float)stats.vertexInvocations / (float)(indexCount / 3);
+  stats.atvr = (float)stats.vertexInvocations / (float)usedCount;
+  return stats;
+}
+
+hlgl::OptimizedMesh hlgl::optimizeMesh(const OptimizeMeshParams& params) {
+  OptimizedMesh mesh {};
+  if (!params.vertices || params.vertexCount == 0 || params.vertexSize == 0 || params.cacheSize == 0)
+    return mesh;
+  const uint8_t* srcVertices {(const uint8_t*)params.vertices};
+
+  // Non-indexed meshes are treated as if each vertex were indexed once, in order.
+  std::vector<uint32_t> indices {};
+  if (params.indices) {
+    indices.assign(params.indices, params.indices + (params.indexCount - params.indexCount % 3));
+    for (uint32_t index : indices) {
+      if (index >= params.vertexCount)
+        return mesh;
+    }
+  }
+  else {
+    indices.resize(params.vertexCount - params.vertexCount % 3);
+    std::iota(indices.begin(), indices.end(), 0u);
+  }
+  if (indices.empty())
+    return mesh;
+  mesh.before = analyzeVertexCache(indices.data(), indices.size(), params.vertexCount, params.cacheSize);
+
+  if (params.weld) {
+    const std::vector<uint32_t> remap {weldVertices(srcVertices, params.vertexCount, params.vertexSize)};
+    for (uint32_t& index : indices)
+      index = remap[index];
+  }
+
+  indices = tipsify(indices, params.vertexCount, params.cacheSize);
+
+  const bool hasPositions {params.positionOffset + 3 * sizeof(float) <= params.vertexSize};
+  if (params.overdrawThreshold > 0.0f && hasPositions) {
+    const std::vector<size_t> clusters {findClusters(indices, params.vertexCount, params.cacheSize, std::max(params.overdrawThreshold, 1.0f))};
+    if (clusters.size() > 1)
+      indices = sortClusters(indices, clusters, srcVertices, params.vertexSize, params.positionOffset);
+  }
+
+  // Renumber vertices in the order they're first used, dropping any which aren't (including those merged by welding).
+  std::vector<uint32_t> order(params.vertexCount, invalidIndex_c);
+  mesh.vertices.reserve(params.vertexCount * params.vertexSize);
+  for (uint32_t& index : indices) {
+    if (order[index] == invalidIndex_c) {
+      order[index] = (uint32_t)mesh.vertexCount++;
+      mesh.vertices.insert(mesh.vertices.end(), srcVertices + index * params.vertexSize, srcVertices + (index + 1) * params.vertexSize);
+    }
+    index = order[index];
+  }
+  mesh.vertices.shrink_to_fit();
+
+  mesh.indexSize = (mesh.vertexCount <= 65536) ? 2 : 4;
+  mesh.packedIndices.resize(indices.size() * mesh.indexSize);
+  if (mesh.indexSize == 2) {
+    uint16_t* dst {(uint16_t*)mesh.packedIndices.data()};
+    for (size_t i {0}; i < indices.size(); ++i)
+      dst[i] = (uint16_t)indices[i];
+  }
+  else {
+    std::memcpy(mesh.packedIndices.data(), indices.data(), indices.size() * sizeof(uint32_t));
+  }
+
+  mesh.after = analyzeVertexCache(indices.data(), indices.size(), mesh.vertexCount, params.cacheSize);
+  mesh.indices = std::move(indices);
+  return mesh;
+}
+
+std::vector<uint32_t> hlgl::optimizeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+  if (!indices || cacheSize == 0)
+    return {};
+  std::vector<uint32_t> triangles(indices, indices + (indexCount - indexCount % 3));
+  for (uint32_t index : triangles) {
+    if (index >= vertexCount)
+      return {};
+  }
+  return tipsify(triangles, vertexCount, cacheSize);
+}
+
+std::vector<hlgl::OptimizedMesh> hlgl::optimizeMesh(const std::vector<OptimizeMeshParams>& params) {
+  std::vector<OptimizedMesh> results(params.size());
+  getThreadPool().parallelFor((uint32_t)params.size(), [&](uint32_t i) {
+    results[i] = optimizeMesh(params[i]);
+  });
+  return results;
+}
@@ -0,0 +1,319 @@
+#include <hlgl.h>
+#include "cpu-features.h"
+#include "thread-pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+  // Vertices are gathered from their interleaved layout into blocks of separate arrays, so every encoder works on packed floats.
+  constexpr size_t blockSize_c {256};
+
+  // Large meshes are split across worker threads in ranges of at least this many vertices.
+  constexpr size_t minRangeVertices_c {16384};
+
+  struct Block {
+    float px[blockSize_c], py[blockSize_c], pz[blockSize_c];
+    float nx[blockSize_c], ny[blockSize_c], nz[blockSize_c];
+    float tx[blockSize_c], ty[blockSize_c], tz[blockSize_c], tw[blockSize_c];
+    float u[blockSize_c], v[blockSize_c];
+    uint16_t qpx[blockSize_c], qpy[blockSize_c], qpz[blockSize_c];
+    uint16_t qnx[blockSize_c], qny[blockSize_c];
+    uint16_t qtx[blockSize_c], qty[blockSize_c];
+    uint16_t qu[blockSize_c], qv[blockSize_c];
+  };
+
+  inline float readFloat(const uint8_t* bytes) {
+    float f;
+    std::memcpy(&f, bytes, sizeof(float));
+    return f;
+  }
+
+  void gather(const uint8_t* src, size_t stride, size_t offset, size_t count, std::initializer_list<float*> dsts) {
+    size_t c {0};
+    for (float* dst : dsts) {
+      for (size_t i {0}; i < count; ++i)
+        dst[i] = readFloat(src + i * stride + offset + c * sizeof(float));
+      ++c;
+    }
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Scalar encoders.
+
+  // Maps [min, min + 1/scale] to [0, 65535].
+  void unorm16Scalar(const float* src, uint16_t* dst, size_t begin, size_t end, float min, float scale) {
+    for (size_t i {begin}; i < end; ++i)
+      dst[i] = (uint16_t)std::lround(std::clamp((src[i] - min) * scale, 0.0f, 1.0f) * 65535.0f);
+  }
+
+  inline uint16_t snorm16(float f) {
+    return (uint16_t)(int16_t)std::lround(std::clamp(f, -1.0f, 1.0f) * 32767.0f);
+  }
+
+  // Octahedral encoding projects the unit sphere onto an octahedron, then unfolds the lower half over the corners of the upper half.
+  // Two values are enough to store a direction with far more even precision than storing x and y and reconstructing z.
+  void octahedralScalar(const float* x, const float* y, const float* z, uint16_t* outX, uint16_t* outY, size_t begin, size_t end) {
+    for (size_t i {begin}; i < end; ++i) {
+      const float l1 {std::max(std::abs(x[i]) + std::abs(y[i]) + std::abs(z[i]), 1e-20f)};
+      float ox {x[i] / l1}, oy {y[i] / l1};
+      if (z[i] < 0.0f) {
+        const float wx {(1.0f - std::abs(oy)) * std::copysign(1.0f, ox)};
+        const float wy {(1.0f - std::abs(ox)) * std::copysign(1.0f, oy)};
+        ox = wx;
+        oy = wy;
+      }
+      outX[i] = snorm16(ox);
+      outY[i] = snorm16(oy);
+    }
+  }
+
+#ifdef HLGL_SIMD_X86
+  HLGL_TARGET_AVX2 inline __m128i toUint16Avx2(__m256 scaled) {
+    const __m256i ints {_mm256_cvtps_epi32(scaled)};
+    return _mm_packus_epi32(_mm256_castsi256_si128(ints), _mm256_extracti128_si256(ints, 1));
+  }
+
+  HLGL_TARGET_AVX2 inline __m128i toSnorm16Avx2(__m256 f) {
+    f = _mm256_min_ps(_mm256_max_ps(f, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f));
+    const __m256i ints {_mm256_cvtps_epi32(_mm256_mul_ps(f, _mm256_set1_ps(32767.0f)))};
+    return _mm_packs_epi32(_mm256_castsi256_si128(ints), _mm256_extracti128_si256(ints, 1));
+  }
+
+  HLGL_TARGET_AVX2 void unorm16Avx2(const float* src, uint16_t* dst, size_t begin, size_t end, float min, float scale) {
+    const __m256 vMin {_mm256_set1_ps(min)}, vScale {_mm256_set1_ps(scale)};
+    const __m256 zero {_mm256_setzero_ps()}, one {_mm256_set1_ps(1.0f)}, max {_mm256_set1_ps(65535.0f)};
+    size_t i {begin};
+    for (; i + 8 <= end; i += 8) {
+      __m256 f {_mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(src + i), vMin), vScale)};
+      f = _mm256_min_ps(_mm256_max_ps(f, zero), one);
+      _mm_storeu_si128((__m128i*)(dst + i), toUint16Avx2(_mm256_mul_ps(f, max)));
+    }
+    unorm16Scalar(src, dst, i, end, min, scale);
+  }
+
+  HLGL_TARGET_AVX2 void octahedralAvx2(const float* x, const float* y, const float* z, uint16_t* outX, uint16_t* outY, size_t begin, size_t end) {
+    const __m256 signMask {_mm256_set1_ps(-0.0f)}, one {_mm256_set1_ps(1.0f)}, tiny {_mm256_set1_ps(1e-20f)};
+    size_t i {begin};
+    for (; i + 8 <= end; i += 8) {
+      const __m256 vx {_mm256_loadu_ps(x + i)}, vy {_mm256_loadu_ps(y + i)}, vz {_mm256_loadu_ps(z + i)};
+      const __m256 l1 {_mm256_max_ps(_mm256_add_ps(_mm256_add_ps(_mm256_andnot_ps(signMask, vx), _mm256_andnot_ps(signMask, vy)), _mm256_andnot_ps(signMask, vz)), tiny)};
+      const __m256 ox {_mm256_div_ps(vx, l1)}, oy {_mm256_div_ps(vy, l1)};
+      const __m256 wx {_mm256_mul_ps(_mm256_sub_ps(one, _mm256_andnot_ps(signMask, oy)), _mm256_or_ps(one, _mm256_and_ps(signMask, ox)))};
+      const __m256 wy {_mm256_mul_ps(_mm256_sub_ps(one, _mm256_andnot_ps(signMask, ox)), _mm256_or_ps(one, _mm256_and_ps(signMask, oy)))};
+      const __m256 lower {_mm256_cmp_ps(vz, _mm256_setzero_ps(), _CMP_LT_OQ)};
+      _mm_storeu_si128((__m128i*)(outX + i), toSnorm16Avx2(_mm256_blendv_ps(ox, wx, lower)));
+      _mm_storeu_si128((__m128i*)(outY + i), toSnorm16Avx2(_mm256_blendv_ps(oy, wy, lower)));
+    }
+    octahedralScalar(x, y, z, outX, outY, i, end);
+  }
+#endif
+
+#ifdef HLGL_SIMD_NEON
+  inline uint16x4_t toSnorm16Neon(float32x4_t f) {
+    f = vminq_f32(vmaxq_f32(f, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+    return vreinterpret_u16_s16(vqmovn_s32(vcvtnq_s32_f32(vmulq_n_f32(f, 32767.0f))));
+  }
+
+  void unorm16Neon(const float* src, uint16_t* dst, size_t begin, size_t end, float min, float scale) {
+    const float32x4_t vMin {vdupq_n_f32(min)}, zero {vdupq_n_f32(0.0f)}, one {vdupq_n_f32(1.0f)};
+    size_t i {begin};
+    for (; i + 4 <= end; i += 4) {
+      float32x4_t f {vmulq_n_f32(vsubq_f32(vld1q_f32(src + i), vMin), scale)};
+      f = vminq_f32(vmaxq_f32(f, zero), one);
+      vst1_u16(dst + i, vqmovun_s32(vcvtnq_s32_f32(vmulq_n_f32(f, 65535.0f))));
+    }
+    unorm16Scalar(src, dst, i, end, min, scale);
+  }
+
+  void octahedralNeon(const float* x, const float* y, const float* z, uint16_t* outX, uint16_t* outY, size_t begin, size_t end) {
+    const float32x4_t one {vdupq_n_f32(1.0f)}, tiny {vdupq_n_f32(1e-20f)};
+    const uint32x4_t signMask {vdupq_n_u32(0x80000000u)};
+    size_t i {begin};
+    for (; i + 4 <= end; i += 4) {
+      const float32x4_t vx {vld1q_f32(x + i)}, vy {vld1q_f32(y + i)}, vz {vld1q_f32(z + i)};
+      const float32x4_t l1 {vmaxq_f32(vaddq_f32(vaddq_f32(vabsq_f32(vx), vabsq_f32(vy)), vabsq_f32(vz)), tiny)};
+      const float32x4_t ox {vdivq_f32(vx, l1)}, oy {vdivq_f32(vy, l1)};
+      const float32x4_t signX {vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(one), vandq_u32(vreinterpretq_u32_f32(ox), signMask)))};
+      const float32x4_t signY {vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(one), vandq_u32(vreinterpretq_u32_f32(oy), signMask)))};
+      const float32x4_t wx {vmulq_f32(vsubq_f32(one, vabsq_f32(oy)), signX)};
+      const float32x4_t wy {vmulq_f32(vsubq_f32(one, vabsq_f32(ox)), signY)};
+      const uint32x4_t lower {vcltq_f32(vz, vdupq_n_f32(0.0f))};
+      vst1_u16(outX + i, toSnorm16Neon(vbslq_f32(lower, wx, ox)));
+      vst1_u16(outY + i, toSnorm16Neon(vbslq_f32(lower, wy, oy)));
+    }
+    octahedralScalar(x, y, z, outX, outY, i, end);
+  }
+#endif
+
+  void unorm16(const float* src, uint16_t* dst, size_t count, float min, float extent) {
+    const float scale {(extent > 0.0f) ? (1.0f / extent) : 0.0f};
+#if defined(HLGL_SIMD_X86)
+    if (hlgl::getCpuFeatures().avx2)
+      return unorm16Avx2(src, dst, 0, count, min, scale);
+#elif defined(HLGL_SIMD_NEON)
+    return unorm16Neon(src, dst, 0, count, min, scale);
+#endif
+    unorm16Scalar(src, dst, 0, count, min, scale);
+  }
+
+  void octahedral(const float* x, const float* y, const float* z, uint16_t* outX, uint16_t* outY, size_t count) {
+#if defined(HLGL_SIMD_X86)
+    if (hlgl::getCpuFeatures().avx2)
+      return octahedralAvx2(x, y, z, outX, outY, 0, count);
+#elif defined(HLGL_SIMD_NEON)
+    return octahedralNeon(x, y, z, outX, outY, 0, count);
+#endif
+    octahedralScalar(x, y, z, outX, outY, 0, count);
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Bounds.
+
+  // Whether an attribute is either absent or fits within the vertex.
+  bool fitsInVertex(size_t offset, size_t size, size_t vertexSize) {
+    return offset == hlgl::noAttribute_c || offset + size <= vertexSize;
+  }
+
+  hlgl::QuantizationBounds computeBounds(const hlgl::QuantizeVerticesParams& params) {
+    const uint8_t* src {(const uint8_t*)params.vertices};
+    const bool hasPosition {params.positionOffset != hlgl::noAttribute_c};
+    const bool hasUV {params.uvOffset != hlgl::noAttribute_c};
+
+    // Each range finds its own bounds, which are then combined.
+    struct Range { float min[5]; float max[5]; };
+    const size_t rangeCount {(params.vertexCount + minRangeVertices_c - 1) / minRangeVertices_c};
+    std::vector<Range> ranges(rangeCount);
+    hlgl::getThreadPool().parallelForRange(params.vertexCount, minRangeVertices_c, [&](size_t begin, size_t end) {
+      Range& r {ranges[begin / minRangeVertices_c]};
+      std::fill(std::begin(r.min), std::end(r.min), INFINITY);
+      std::fill(std::begin(r.max), std::end(r.max), -INFINITY);
+      for (size_t i {begin}; i < end; ++i) {
+        const uint8_t* vertex {src + i * params.vertexSize};
+        for (int c {0}; c < 3 && hasPosition; ++c) {
+          const float f {readFloat(vertex + params.positionOffset + c * sizeof(float))};
+          r.min[c] = std::min(r.min[c], f);
+          r.max[c] = std::max(r.max[c], f);
+        }
+        for (int c {0}; c < 2 && hasUV; ++c) {
+          const float f {readFloat(vertex + params.uvOffset + c * sizeof(float))};
+          r.min[3 + c] = std::min(r.min[3 + c], f);
+          r.max[3 + c] = std::max(r.max[3 + c], f);
+        }
+      }
+    });
+
+    float min[5] {INFINITY, INFINITY, INFINITY, INFINITY, INFINITY};
+    float max[5] {-INFINITY, -INFINITY, -INFINITY, -INFINITY, -INFINITY};
+    for (const Range& r : ranges) {
+      for (int c {0}; c < 5; ++c) {
+        min[c] = std::min(min[c], r.min[c]);
+        max[c] = std::max(max[c], r.max[c]);
+      }
+    }
+
+    hlgl::QuantizationBounds bounds {};
+    for (int c {0}; c < 3 && hasPosition; ++c) {
+      bounds.positionMin[c] = min[c];
+      bounds.positionExtent[c] = max[c] - min[c];
+    }
+    for (int c {0}; c < 2 && hasUV; ++c) {
+      bounds.uvMin[c] = min[3 + c];
+      bounds.uvExtent[c] = max[3 + c] - min[3 + c];
+    }
+    return bounds;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Encoding.
+
+  void encodeBlock(const hlgl::QuantizeVerticesParams& params, const hlgl::QuantizationBounds& bounds, Block& b, size_t first, size_t count, hlgl::QuantizedVertex* dst) {
+    const uint8_t* src {(const uint8_t*)params.vertices + first * params.vertexSize};
+    const size_t stride {params.vertexSize};
+    const bool hasPosition {params.positionOffset != hlgl::noAttribute_c};
+    const bool hasNormal {params.normalOffset != hlgl::noAttribute_c};
+    const bool hasTangent {params.tangentOffset != hlgl::noAttribute_c};
+    const bool hasUV {params.uvOffset != hlgl::noAttribute_c};
+
+    if (hasPosition) {
+      gather(src, stride, params.positionOffset, count, {b.px, b.py, b.pz});
+      if (params.positionEncoding == hlgl::PositionEncoding::Half) {
+        hlgl::packHalfFloats(b.px, b.qpx, count);
+        hlgl::packHalfFloats(b.py, b.qpy, count);
+        hlgl::packHalfFloats(b.pz, b.qpz, count);
+      }
+      else {
+        unorm16(b.px, b.qpx, count, bounds.positionMin[0], bounds.positionExtent[0]);
+        unorm16(b.py, b.qpy, count, bounds.positionMin[1], bounds.positionExtent[1]);
+        unorm16(b.pz, b.qpz, count, bounds.positionMin[2], bounds.positionExtent[2]);
+      }
+    }
+    if (hasNormal) {
+      gather(src, stride, params.normalOffset, count, {b.nx, b.ny, b.nz});
+      octahedral(b.nx, b.ny, b.nz, b.qnx, b.qny, count);
+    }
+    if (hasTangent) {
+      gather(src, stride, params.tangentOffset, count, {b.tx, b.ty, b.tz, b.tw});
+      octahedral(b.tx, b.ty, b.tz, b.qtx, b.qty, count);
+    }
+    if (hasUV) {
+      gather(src, stride, params.uvOffset, count, {b.u, b.v});
+      unorm16(b.u, b.qu, count, bounds.uvMin[0], bounds.uvExtent[0]);
+      unorm16(b.v, b.qv, count, bounds.uvMin[1], bounds.uvExtent[1]);
+    }
+
+    for (size_t i {0}; i < count; ++i) {
+      hlgl::QuantizedVertex& q {dst[first + i]};
+      q = {};
+      if (hasPosition) {
+        q.position[0] = b.qpx[i];
+        q.position[1] = b.qpy[i];
+        q.position[2] = b.qpz[i];
+      }
+      if (hasNormal)
+        q.normal = (uint32_t)b.qnx[i] | ((uint32_t)b.qny[i] << 16);
+      if (hasTangent) {
+        // The bitangent sign takes the lowest bit of y, costing it one bit of precision it can easily spare.
+        const uint32_t sign {(b.tw[i] < 0.0f) ? 1u : 0u};
+        q.tangent = (uint32_t)b.qtx[i] | ((uint32_t)((b.qty[i] & ~1u) | sign) << 16);
+      }
+      if (hasUV) {
+        q.uv[0] = b.qu[i];
+        q.uv[1] = b.qv[i];
+      }
+    }
+  }
+
+} // namespace
+
+hlgl::QuantizedMesh hlgl::quantizeVertices(const QuantizeVerticesParams& params) {
+  QuantizedMesh mesh {};
+  if (!params.vertices || params.vertexCount == 0 || params.vertexSize == 0 ||
+      !fitsInVertex(params.positionOffset, sizeof(float) * 3, params.vertexSize) ||
+      !fitsInVertex(params.normalOffset, sizeof(float) * 3, params.vertexSize) ||
+      !fitsInVertex(params.tangentOffset, sizeof(float) * 4, params.vertexSize) ||
+      !fitsInVertex(params.uvOffset, sizeof(float) * 2, params.vertexSize))
+    return mesh;
+
+  mesh.bounds = params.bounds ? *params.bounds : computeBounds(params);
+  mesh.vertices.resize(params.vertexCount);
+
+  getThreadPool().parallelForRange(params.vertexCount, minRangeVertices_c, [&](size_t begin, size_t end) {
+    // Blocks are too big for the stack of a worker thread to hold comfortably.
+    std::unique_ptr<Block> block {std::make_unique<Block>()};
+    for (size_t first {begin}; first < end; first += blockSize_c)
+      encodeBlock(params, mesh.bounds, *block, first, std::min(blockSize_c, end - first), mesh.vertices.data());
+  });
+  return mesh;
+}
+
+std::vector<hlgl::QuantizedMesh> hlgl::quantizeVertices(const std::vector<QuantizeVerticesParams>& params) {
+  std::vector<QuantizedMesh> results(params.size());
+  getThreadPool().parallelFor((uint32_t)params.size(), [&](uint32_t i) {
+    results[i] = quantizeVertices(params[i]);
+  });
+  return results;
+}
@@ -0,0 +1,621 @@
+#include <hlgl.h>
+#include "thread-pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+  constexpr uint32_t invalidIndex_c {UINT32_MAX};
+
+  // Border edges get planes of their own, weighted heavily so open edges keep their shape.
+  constexpr double borderWeight_c {10.0};
+
+  // A collapse is rejected if it turns any remaining triangle further than this (as the cosine of the angle) from where it faced.
+  constexpr double minFlipCos_c {0.25};
+
+  // A level is only kept if it has at most this fraction of the previous level's triangles, otherwise simplification has stalled.
+  constexpr float maxLevelRatio_c {0.9f};
+
+  inline float readFloat(const uint8_t* bytes) {
+    float f;
+    std::memcpy(&f, bytes, sizeof(float));
+    return f;
+  }
+
+  inline uint64_t edgeKey(uint32_t a, uint32_t b) {
+    return ((uint64_t)a << 32) | b;
+  }
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Quadrics.
+
+  // The sum of squared distances to a set of weighted planes, as a symmetric 4x4 matrix.  Divided by the total weight, it's the mean squared distance.
+  struct Quadric {
+    double a00 {0}, a11 {0}, a22 {0}, a01 {0}, a02 {0}, a12 {0};
+    double b0 {0}, b1 {0}, b2 {0};
+    double c {0};
+    double weight {0};
+
+    // The plane is dot(n, p) + d = 0, with n normalized.
+    void addPlane(const double n[3], double d, double w) {
+      a00 += w * n[0] * n[0]; a11 += w * n[1] * n[1]; a22 += w * n[2] * n[2];
+      a01 += w * n[0] * n[1]; a02 += w * n[0] * n[2]; a12 += w * n[1] * n[2];
+      b0 += w * n[0] * d; b1 += w * n[1] * d; b2 += w * n[2] * d;
+      c += w * d * d;
+      weight += w;
+    }
+
+    Quadric& operator+=(const Quadric& q) {
+      a00 += q.a00; a11 += q.a11; a22 += q.a22; a01 += q.a01; a02 += q.a02; a12 += q.a12;
+      b0 += q.b0; b1 += q.b1; b2 += q.b2;
+      c += q.c;
+      weight += q.weight;
+      return *this;
+    }
+
+    double error(const float p[3]) const {
+      const double x {p[0]}, y {p[1]}, z {p[2]};
+      const double r {a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) + 2.0 * (b0 * x + b1 * y + b2 * z) + c};
+      return (weight > 0.0) ? std::abs(r) / weight : 0.0;
+    }
+  };
+
+  void cross(const double a[3], const double b[3], double out[3]) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+  }
+
+  double length(const double v[3]) {
+    return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  }
+
+  // Hoppe's attribute quadric ("New Quadric Metric for Simplifying Meshes with Appearance Attributes", 1999).
+  // Each triangle's attributes are a linear function of position, and this sums the squared difference between a vertex's attributes
+  // and what the original triangles would have interpolated at its position.  Smoothly varying attributes cost nothing to collapse,
+  // while a vertex carrying a sharp change in its attributes is expensive to move.
+  struct AttributeQuadric {
+    float a00 {0}, a11 {0}, a22 {0}, a01 {0}, a02 {0}, a12 {0};
+    float b0 {0}, b1 {0}, b2 {0};
+    float c {0};
+    float weight {0};
+    float gradients[hlgl::maxLodAttributes_c][3] {};
+    float offsets[hlgl::maxLodAttributes_c] {};
+
+    // 'g' and 'd' are the gradient and offset of each attribute over the triangle, so the attribute at 'p' is dot(g, p) + d.
+    void addTriangle(const double g[][3], const double d[], size_t count, double w) {
+      for (size_t k {0}; k < count; ++k) {
+        a00 += (float)(w * g[k][0] * g[k][0]); a11 += (float)(w * g[k][1] * g[k][1]); a22 += (float)(w * g[k][2] * g[k][2]);
+        a01 += (float)(w * g[k][0] * g[k][1]); a02 += (float)(w * g[k][0] * g[k][2]); a12 += (float)(w * g[k][1] * g[k][2]);
+        b0 += (float)(w * g[k][0] * d[k]); b1 += (float)(w * g[k][1] * d[k]); b2 += (float)(w * g[k][2] * d[k]);
+        c += (float)(w * d[k] * d[k]);
+        for (int j {0}; j < 3; ++j)
+          gradients[k][j] += (float)(w * g[k][j]);
+        offsets[k] += (float)(w * d[k]);
+      }
+      weight += (float)w;
+    }
+
+    AttributeQuadric& operator+=(const AttributeQuadric& q) {
+      a00 += q.a00; a11 += q.a11; a22 += q.a22; a01 += q.a01; a02 += q.a02; a12 += q.a12;
+      b0 += q.b0; b1 += q.b1; b2 += q.b2;
+      c += q.c;
+      weight += q.weight;
+      for (size_t k {0}; k < hlgl::maxLodAttributes_c; ++k) {
+        for (int j {0}; j < 3; ++j)
+          gradients[k][j] += q.gradients[k][j];
+        offsets[k] += q.offsets[k];
+      }
+      return *this;
+    }
+
+    double error(const float p[3], const float* attributes, size_t count) const {
+      const double x {p[0]}, y {p[1]}, z {p[2]};
+      double r {(double)a00 * x * x + (double)a11 * y * y + (double)a22 * z * z + 2.0 * ((double)a01 * x * y + (double)a02 * x * z + (double)a12 * y * z) +
+                2.0 * ((double)b0 * x + (double)b1 * y + (double)b2 * z) + c};
+      for (size_t k {0}; k < count; ++k) {
+        const double a {attributes[k]};
+        r += weight * a * a - 2.0 * a * (gradients[k][0] * x + gradients[k][1] * y + gradients[k][2] * z + offsets[k]);
+      }
+      return (weight > 0.0f) ? std::abs(r) / weight : 0.0;
+    }
+  };
+
+  /////////////////////////////////////////////////////////////////////////////////////////////////
+  // Simplification.
+
+  // How a vertex may move, decided by the edges around it.
+  enum class VertexKind : uint8_t {
+    Manifold, // Surrounded by triangles, so it can collapse onto any neighbour.
+    Border,   // On one open edge, so it can only collapse along it.
+    Seam,     // Shares its position with one other vertex, along one seam, so both collapse along it together.
+    Locked,   // Anything more complicated, which never moves.
+  };
+
+  struct Collapse {
+    uint32_t v0, v1;  // v0 moves onto v1.
+    float cost;
+  };
+
+  class Simplifier {
+    public:
+    Simplifier(const hlgl::BuildLodChainParams& params, std::vector<uint32_t> indices)
+    : _params(params), _indices(std::move(indices))
+    {
+      const uint8_t* src {(const uint8_t*)params.vertices};
+      const size_t n {params.vertexCount};
+
+      // Positions are normalized to the mesh's bounds, so errors and weights mean the same thing on any mesh.
+      float lo[3] {INFINITY, INFINITY, INFINITY}, hi[3] {-INFINITY, -INFINITY, -INFINITY};
+      _positions.resize(n * 3);
+      for (size_t v {0}; v < n; ++v) {
+        for (int k {0}; k < 3; ++k) {
+          _positions[v * 3 + k] = readFloat(src + v * params.vertexSize + params.positionOffset + k * sizeof(float));
+          lo[k] = std::min(lo[k], _positions[v * 3 + k]);
+          hi[k] = std::max(hi[k], _positions[v * 3 + k]);
+        }
+      }
+      _scale = std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2], 1e-20f});
+      for (size_t v {0}; v < n; ++v) {
+        for (int k {0}; k < 3; ++k)
+          _positions[v * 3 + k] = (_positions[v * 3 + k] - lo[k]) / _scale;
+      }
+
+      // Attributes are premultiplied by their weights, so their errors can be added straight to the positions' error.
+      _attributeCount = params.attributes.size();
+      _attributes.resize(n * _attributeCount);
+      for (size_t v {0}; v < n; ++v) {
+        for (size_t k {0}; k < _attributeCount; ++k)
+          _attributes[v * _attributeCount + k] = readFloat(src + v * params.vertexSize + params.attributes[k].offset) * params.attributes[k].weight;
+      }
+
+      groupPositions();
+      buildQuadrics();
+
+      _remap.resize(n);
+      _kinds.resize(n);
+      _siblings.resize(n);
+      _groupCounts.resize(n);
+      _locked.resize(n);
+    }
+
+    size_t getTriangleCount() const { return _indices.size() / 3; }
+    const std::vector<uint32_t>& getIndices() const { return _indices; }
+
+    // The largest error of any collapse so far, in the mesh's units.
+    float getError() const { return (float)std::sqrt(_errorSq) * _scale; }
+
+    // Collapses edges, cheapest first, until 'target' triangles remain or nothing more can collapse within 'maxError' (relative to the mesh's size).
+    void simplify(size_t target, float maxError) {
+      const double maxErrorSq {(double)maxError * maxError};
+      while (getTriangleCount() > target) {
+        if (pass(target, maxErrorSq) == 0)
+          break;
+      }
+    }
+
+    private:
+    const hlgl::BuildLodChainParams& _params;
+    std::vector<uint32_t> _indices;
+    std::vector<float> _positions;
+    std::vector<float> _attributes;   // Interleaved, '_attributeCount' per vertex.
+    size_t _attributeCount {0};
+    float _scale {1.0f};
+    double _errorSq {0.0};
+
+    std::vector<uint32_t> _groups;    // Each vertex's position group: the first vertex with exactly the same position.
+    std::vector<Quadric> _quadrics;   // Per position group.
+    std::vector<AttributeQuadric> _attributeQuadrics; // Per vertex, since vertices sharing a position can have different attributes.
+
+    // Rebuilt by every pass.
+    std::vector<uint32_t> _remap;
+    std::vector<VertexKind> _kinds;
+    std::vector<uint32_t> _siblings;  // The other vertex in a group of two.
+    std::vector<uint32_t> _groupCounts;
+    std::vector<uint8_t> _locked;     // Per position group, set once it's been part of a collapse this pass.
+    std::vector<uint64_t> _edges, _groupEdges;
+    std::vector<uint32_t> _adjacencyOffsets, _adjacency;
+
+    const float* pos(uint32_t v) const { return &_positions[v * 3]; }
+    const float* attributes(uint32_t v) const { return _attributes.data() + v * _attributeCount; }
+
+    void groupPositions() {
+      const size_t n {_params.vertexCount};
+      size_t capacity {1};
+      while (capacity < n * 2)
+        capacity <<= 1;
+      std::vector<uint32_t> table(capacity, invalidIndex_c);
+      _groups.resize(n);
+      for (uint32_t v {0}; v < n; ++v) {
+        uint32_t bits[3];
+        std::memcpy(bits, pos(v), sizeof(bits));
+        uint32_t slot {(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u) & (uint32_t)(capacity - 1)};
+        while (table[slot] != invalidIndex_c && std::memcmp(pos(table[slot]), pos(v), sizeof(float) * 3) != 0)
+          slot = (slot + 1) & (uint32_t)(capacity - 1);
+        if (table[slot] == invalidIndex_c)
+          table[slot] = v;
+        _groups[v] = table[slot];
+      }
+    }
+
+    void triangleNormal(uint32_t a, uint32_t b, uint32_t c, const float* pa, double n[3]) const {
+      const float* pb {pos(b)};
+      const float* pc {pos(c)};
+      if (!pa)
+        pa = pos(a);
+      const double e0[3] {(double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2]};
+      const double e1[3] {(double)pc[0] - pa[0], (double)pc[1] - pa[1], (double)pc[2] - pa[2]};
+      cross(e0, e1, n);
+    }
+
+    void buildQuadrics() {
+      _quadrics.assign(_params.vertexCount, Quadric{});
+      if (_attributeCount > 0)
+        _attributeQuadrics.assign(_params.vertexCount, AttributeQuadric{});
+      buildEdges();
+      for (size_t t {0}; t < getTriangleCount(); ++t) {
+        const uint32_t* tri {&_indices[t * 3]};
+        double n[3];
+        triangleNormal(tri[0], tri[1], tri[2], nullptr, n);
+        const double area2 {length(n)};
+        if (area2 <= 0.0)
+          continue;
+        for (int k {0}; k < 3; ++k)
+          n[k] /= area2;
+        const float* p0 {pos(tri[0])};
+        const double d {-(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2])};
+        Quadric q {};
+        q.addPlane(n, d, area2 * 0.5);
+        for (int k {0}; k < 3; ++k)
+          _quadrics[_groups[tri[k]]] += q;
+
+        if (_attributeCount > 0) {
+          // Solve for each attribute's gradient within the plane of the triangle.
+          const float* p1 {pos(tri[1])};
+          const float* p2 {pos(tri[2])};
+          const double e1[3] {(double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2]};
+          const double e2[3] {(double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2]};
+          double c1[3], c2[3];
+          cross(e2, n, c1);
+          cross(n, e1, c2);
+          double g[hlgl::maxLodAttributes_c][3], offsets[hlgl::maxLodAttributes_c];
+          for (size_t k {0}; k < _attributeCount; ++k) {
+            const double a0 {attributes(tri[0])[k]};
+            const double da1 {attributes(tri[1])[k] - a0}, da2 {attributes(tri[2])[k] - a0};
+            for (int j {0}; j < 3; ++j)
+              g[k][j] = (da1 * c1[j] + da2 * c2[j]) / area2;
+            offsets[k] = a0 - (g[k][0] * p0[0] + g[k][1] * p0[1] + g[k][2] * p0[2]);
+          }
+          AttributeQuadric aq {};
+          aq.addTriangle(g, offsets, _attributeCount, area2 * 0.5);
+          for (int k {0}; k < 3; ++k)
+            _attributeQuadrics[tri[k]] += aq;
+        }
+
+        // Open edges add a plane perpendicular to the triangle, which keeps them from being pulled inwards.
+        for (int k {0}; k < 3; ++k) {
+          const uint32_t a {tri[k]}, b {tri[(k + 1) % 3]};
+          if (hasGroupEdge(_groups[b], _groups[a]))
+            continue;
+          const float* pa {pos(a)};
+          const float* pb {pos(b)};
+          const double e[3] {(double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2]};
+          double en[3];
+          cross(e, n, en);
+          const double len {length(en)};
+          if (len <= 0.0)
+            continue;
+          for (int j {0}; j < 3; ++j)
+            en[j] /= len;
+          Quadric border {};
+          border.addPlane(en, -(en[0] * pa[0] + en[1] * pa[1] + en[2] * pa[2]), (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]) * borderWeight_c);
+          _quadrics[_groups[a]] += border;
+          _quadrics[_groups[b]] += border;
+        }
+      }
+    }
+
+    void buildEdges() {
+      _edges.clear();
+      _groupEdges.clear();
+      for (size_t i {0}; i < _indices.size(); i += 3) {
+        for (int k {0}; k < 3; ++k) {
+          const uint32_t a {_indices[i + k]}, b {_indices[i + (k + 1) % 3]};
+          _edges.push_back(edgeKey(a, b));
+          _groupEdges.push_back(edgeKey(_groups[a], _groups[b]));
+        }
+      }
+      std::sort(_edges.begin(), _edges.end());
+      _edges.erase(std::unique(_edges.begin(), _edges.end()), _edges.end());
+      std::sort(_groupEdges.begin(), _groupEdges.end());
+      _groupEdges.erase(std::unique(_groupEdges.begin(), _groupEdges.end()), _groupEdges.end());
+    }
+
+    bool hasEdge(uint32_t a, uint32_t b) const { return std::binary_search(_edges.begin(), _edges.end(), edgeKey(a, b)); }
+    bool hasGroupEdge(uint32_t a, uint32_t b) const { return std::binary_search(_groupEdges.begin(), _groupEdges.end(), edgeKey(a, b)); }
+
+    // An edge with no triangle on the other side at all.
+    bool isBorderEdge(uint32_t a, uint32_t b) const {
+      return (hasEdge(a, b) && !hasGroupEdge(_groups[b], _groups[a])) || (hasEdge(b, a) && !hasGroupEdge(_groups[a], _groups[b]));
+    }
+
+    // An edge with a triangle on the other side, but which uses different vertices.
+    bool isSeamEdge(uint32_t a, uint32_t b) const {
+      return (hasEdge(a, b) && !hasEdge(b, a) && hasGroupEdge(_groups[b], _groups[a])) ||
+             (hasEdge(b, a) && !hasEdge(a, b) && hasGroupEdge(_groups[a], _groups[b]));
+    }
+
+    void classifyVertices() {
+      const size_t n {_params.vertexCount};
+      std::vector<uint8_t> used(n, 0), borderCount(n, 0), seamCount(n, 0);
+      std::fill(_groupCounts.begin(), _groupCounts.end(), 0u);
+      std::fill(_siblings.begin(), _siblings.end(), invalidIndex_c);
+      std::vector<uint32_t> firstInGroup(n, invalidIndex_c);
+      for (uint32_t v : _indices) {
+        if (used[v])
+          continue;
+        used[v] = 1;
+        const uint32_t g {_groups[v]};
+        if (_groupCounts[g]++ == 0) {
+          firstInGroup[g] = v;
+        }
+        else {
+          _siblings[v] = firstInGroup[g];
+          _siblings[firstInGroup[g]] = v;
+        }
+      }
+
+      for (uint64_t edge : _edges) {
+        const uint32_t a {(uint32_t)(edge >> 32)}, b {(uint32_t)edge};
+        if (hasEdge(b, a))
+          continue;
+        std::vector<uint8_t>& counts {hasGroupEdge(_groups[b], _groups[a]) ? seamCount : borderCount};
+        counts[a] = (uint8_t)std::min(counts[a] + 1, 255);
+        counts[b] = (uint8_t)std::min(counts[b] + 1, 255);
+      }
+
+      for (size_t v {0}; v < n; ++v) {
+        const uint32_t groupCount {_groupCounts[_groups[v]]};
+        if (groupCount == 1 && borderCount[v] == 0 && seamCount[v] == 0)
+          _kinds[v] = VertexKind::Manifold;
+        else if (groupCount == 1 && borderCount[v] == 2 && seamCount[v] == 0)
+          _kinds[v] = VertexKind::Border;
+        else if (groupCount == 2 && borderCount[v] == 0 && seamCount[v] == 2)
+          _kinds[v] = VertexKind::Seam;
+        else
+          _kinds[v] = VertexKind::Locked;
+      }
+    }
+
+    void buildAdjacency() {
+      const size_t n {_params.vertexCount};
+      _adjacencyOffsets.assign(n + 1, 0);
+      for (uint32_t v : _indices)
+        ++_adjacencyOffsets[v + 1];
+      for (size_t v {0}; v < n; ++v)
+        _adjacencyOffsets[v + 1] += _adjacencyOffsets[v];
+      _adjacency.resize(_indices.size());
+      std::vector<uint32_t> fill(_adjacencyOffsets.begin(), _adjacencyOffsets.end() - 1);
+      for (size_t i {0}; i < _indices.size(); ++i)
+        _adjacency[fill[_indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    // For a seam vertex, the vertex on the other side of the seam from 'v1', where its sibling would collapse to.
+    uint32_t seamPartner(uint32_t v0, uint32_t v1) const {
+      const uint32_t s0 {_siblings[v0]}, s1 {_siblings[v1]};
+      if (s0 == invalidIndex_c || s1 == invalidIndex_c || !isSeamEdge(s0, s1))
+        return invalidIndex_c;
+      return s1;
+    }
+
+    bool canCollapse(uint32_t v0, uint32_t v1) const {
+      if (_groups[v0] == _groups[v1])
+        return false;
+      switch (_kinds[v0]) {
+        case VertexKind::Manifold: return true;
+        case VertexKind::Border: return isBorderEdge(v0, v1);
+        case VertexKind::Seam: return isSeamEdge(v0, v1) && seamPartner(v0, v1) != invalidIndex_c;
+        default: return false;
+      }
+    }
+
+    // The error of 'v0' taking on the attributes of 'v1', at v1's position.
+    double attributeError(uint32_t v0, uint32_t v1) const {
+      if (_attributeCount == 0)
+        return 0.0;
+      AttributeQuadric q {_attributeQuadrics[v0]};
+      q += _attributeQuadrics[v1];
+      return q.error(pos(v1), attributes(v1), _attributeCount);
+    }
+
+    double collapseCost(uint32_t v0, uint32_t v1) const {
+      Quadric q {_quadrics[_groups[v0]]};
+      q += _quadrics[_groups[v1]];
+      double error {q.error(pos(v1)) + attributeError(v0, v1)};
+      if (_kinds[v0] == VertexKind::Seam)
+        error += attributeError(_siblings[v0], seamPartner(v0, v1));
+      return error;
+    }
+
+    // Checks that moving 'v0' onto 'v1' doesn't flip any of the triangles around it, and counts the triangles it removes.
+    bool checkTriangles(uint32_t v0, uint32_t v1, size_t& removed) const {
+      const uint32_t g1 {_groups[v1]};
+      for (uint32_t a {_adjacencyOffsets[v0]}; a < _adjacencyOffsets[v0 + 1]; ++a) {
+        const uint32_t* tri {&_indices[_adjacency[a] * 3]};
+        uint32_t c[3] {_remap[tri[0]], _remap[tri[1]], _remap[tri[2]]};
+        if (_groups[c[0]] == g1 || _groups[c[1]] == g1 || _groups[c[2]] == g1) {
+          ++removed;
+          continue;
+        }
+        // Rotate so v0 comes first.
+        while (c[0] != v0)
+          std::rotate(c, c + 1, c + 3);
+        double before[3], after[3];
+        triangleNormal(c[0], c[1], c[2], nullptr, before);
+        triangleNormal(c[0], c[1], c[2], pos(v1), after);
+        const double dot {before[0] * after[0] + before[1] * after[1] + before[2] * after[2]};
+        if (dot < minFlipCos_c * length(before) * length(after))
+          return false;
+      }
+      return true;
+    }
+
+    size_t pass(size_t target, double maxErrorSq) {
+      buildEdges();
+      classifyVertices();
+      buildAdjacency();
+
+      // Find the cheapest way to collapse each edge.  Interior edges are seen from both sides, and the duplicates simply fail to lock later.
+      std::vector<Collapse> collapses {};
+      for (size_t i {0}; i < _indices.size(); i += 3) {
+        for (int k {0}; k < 3; ++k) {
+          const uint32_t a {_indices[i + k]}, b {_indices[i + (k + 1) % 3]};
+          if (a > b && hasEdge(b, a))
+            continue;
+          Collapse best {invalidIndex_c, invalidIndex_c, INFINITY};
+          if (canCollapse(a, b))
+            best = Collapse{a, b, (float)collapseCost(a, b)};
+          if (canCollapse(b, a)) {
+            const float cost {(float)collapseCost(b, a)};
+            if (cost < best.cost)
+              best = Collapse{b, a, cost};
+          }
+          if (best.v0 != invalidIndex_c && best.cost <= maxErrorSq)
+            collapses.push_back(best);
+        }
+      }
+      std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+      // Collapse the cheapest edges first.  Each position group takes part in at most one collapse per pass,
+      // which keeps every collapse's costs and flip checks valid without updating them.
+      for (size_t v {0}; v < _remap.size(); ++v)
+        _remap[v] = (uint32_t)v;
+      std::fill(_locked.begin(), _locked.end(), 0);
+      const size_t triangleCount {getTriangleCount()};
+      size_t removed {0}, collapsed {0};
+      for (const Collapse& c : collapses) {
+        if (triangleCount - removed <= target)
+          break;
+        const uint32_t g0 {_groups[c.v0]}, g1 {_groups[c.v1]};
+        if (_locked[g0] || _locked[g1])
+          continue;
+        const bool seam {_kinds[c.v0] == VertexKind::Seam};
+        const uint32_t s0 {seam ? _siblings[c.v0] : invalidIndex_c};
+        const uint32_t s1 {seam ? seamPartner(c.v0, c.v1) : invalidIndex_c};
+        size_t collapseRemoved {0};
+        if (!checkTriangles(c.v0, c.v1, collapseRemoved) || (seam && !checkTriangles(s0, s1, collapseRemoved)))
+          continue;
+        _remap[c.v0] = c.v1;
+        if (seam)
+          _remap[s0] = s1;
+        _quadrics[g1] += _quadrics[g0];
+        if (_attributeCount > 0) {
+          _attributeQuadrics[c.v1] += _attributeQuadrics[c.v0];
+          if (seam)
+            _attributeQuadrics[s1] += _attributeQuadrics[s0];
+        }
+        _locked[g0] = _locked[g1] = 1;
+        _errorSq = std::max(_errorSq, (double)c.cost);
+        removed += collapseRemoved;
+        ++collapsed;
+      }
+
+      // Apply the collapses, dropping the triangles which lost their area.
+      size_t write {0};
+      for (size_t i {0}; i < _indices.size(); i += 3) {
+        const uint32_t a {_remap[_indices[i]]}, b {_remap[_indices[i + 1]]}, c {_remap[_indices[i + 2]]};
+        if (_groups[a] == _groups[b] || _groups[b] == _groups[c] || _groups[c] == _groups[a])
+          continue;
+        _indices[write++] = a;
+        _indices[write++] = b;
+        _indices[write++] = c;
+      }
+      _indices.resize(write);
+      return collapsed;
+    }
+  };
+
+  void packIndices(hlgl::MeshLodChain& chain, size_t vertexCount) {
+    chain.indexSize = (vertexCount <= 65536) ? 2 : 4;
+    chain.packedIndices.resize(chain.indices.size() * chain.indexSize);
+    if (chain.indexSize == 2) {
+      uint16_t* dst {(uint16_t*)chain.packedIndices.data()};
+      for (size_t i {0}; i < chain.indices.size(); ++i)
+        dst[i] = (uint16_t)chain.indices[i];
+    }
+    else {
+      std::memcpy(chain.packedIndices.data(), chain.indices.data(), chain.indices.size() * sizeof(uint32_t));
+    }
+  }
+
+} // namespace
+
+hlgl::MeshLodChain hlgl::buildLodChain(const BuildLodChainParams& params) {
+  MeshLodChain chain {};
+  if (!params.vertices || params.vertexCount == 0 || params.vertexSize == 0 || !params.indices || params.indexCount < 3 || params.maxLods == 0 ||
+      params.positionOffset + sizeof(float) * 3 > params.vertexSize ||
+      params.attributes.size() > maxLodAttributes_c || !(params.reduction > 0.0f && params.reduction < 1.0f))
+    return chain;
+  for (const LodAttribute& attribute : params.attributes) {
+    if (attribute.offset + sizeof(float) > params.vertexSize)
+      return chain;
+  }
+
+  std::vector<uint32_t> indices(params.indices, params.indices + (params.indexCount - params.indexCount % 3));
+  for (uint32_t index : indices) {
+    if (index >= params.vertexCount)
+      return chain;
+  }
+  chain.indices = indices;
+  chain.lods.push_back(MeshLod{.firstIndex = 0, .indexCount = (uint32_t)indices.size(), .error = 0.0f, .padding = 0});
+
+  if (params.maxLods > 1 && indices.size() / 3 > params.minTriangles) {
+    Simplifier simplifier(params, std::move(indices));
+    size_t levelTriangles {simplifier.getTriangleCount()};
+    while (chain.lods.size() < params.maxLods && levelTriangles > params.minTriangles) {
+      const size_t target {std::max((size_t)(levelTriangles * params.reduction), params.minTriangles)};
+      simplifier.simplify(target, params.maxError);
+      if (simplifier.getTriangleCount() > levelTriangles * maxLevelRatio_c)
+        break;
+      levelTriangles = simplifier.getTriangleCount();
+
+      const std::vector<uint32_t>& level {simplifier.getIndices()};
+      const std::vector<uint32_t> optimized {optimizeVertexCache(level.data(), level.size(), params.vertexCount)};
+      chain.lods.push_back(MeshLod{
+        .firstIndex = (uint32_t)chain.indices.size(),
+        .indexCount = (uint32_t)optimized.size(),
+        .error = simplifier.getError(),
+        .padding = 0 });
+      chain.indices.insert(chain.indices.end(), optimized.begin(), optimized.end());
+    }
+  }
+
+  packIndices(chain, params.vertexCount);
+  return chain;
+}
+
+std::vector<hlgl::MeshLodChain> hlgl::buildLodChain(const std::vector<BuildLodChainParams>& params) {
+  std::vector<MeshLodChain> results(params.size());
+  getThreadPool().parallelFor((uint32_t)params.size(), [&](uint32_t i) {
+    results[i] = buildLodChain(params[i]);
+  });
+  return results;
+}
+
+float hlgl::getLodScale(float fovY, float viewportHeight) {
+  return viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+}
+
+uint32_t hlgl::selectLod(const MeshLod* lods, uint32_t lodCount, float depth, float radius, float lodScale, float threshold, float errorScale) {
+  // Errors are projected at the nearest depth the object could have, so a level is never picked for being further away than it is.
+  const float nearest {depth - radius};
+  if (!lods || lodCount <= 1 || lodScale <= 0.0f || nearest <= 0.0f)
+    return 0;
+  const float maxError {threshold * nearest / (lodScale * std::max(errorScale, 1e-20f))};
+  uint32_t lod {0};
+  while (lod + 1 < lodCount && lods[lod + 1].error <= maxError)
+    ++lod;
+  return lod;
+}
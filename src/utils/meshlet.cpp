@@ -0,0 +1,203 @@
+#include <hlgl.h>
+#include "thread-pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+  struct Vec3 {
+    float x, y, z;
+    Vec3 operator+(const Vec3& o) const { return {x + o.x, y + o.y, z + o.z}; }
+    Vec3 operator-(const Vec3& o) const { return {x - o.x, y - o.y, z - o.z}; }
+    Vec3 operator*(float s) const { return {x * s, y * s, z * s}; }
+  };
+  float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+  Vec3 cross(const Vec3& a, const Vec3& b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+  float length(const Vec3& v) { return std::sqrt(dot(v, v)); }
+
+  constexpr uint16_t noLocalIndex_c {0xFFFF};
+
+  // The cone is considered too wide to ever cull once some triangle is within ~84 degrees of perpendicular to its axis.
+  constexpr float minConeDot_c {0.1f};
+
+  Vec3 getPosition(const hlgl::BuildMeshletsParams& params, uint32_t vertex) {
+    const float* p {(const float*)((const uint8_t*)params.positions + vertex * params.positionStride)};
+    return {p[0], p[1], p[2]};
+  }
+
+  void computeBounds(const hlgl::BuildMeshletsParams& params, const hlgl::MeshletMesh& mesh, hlgl::Meshlet& meshlet) {
+    const uint32_t* vertices {mesh.vertices.data() + meshlet.vertexOffset};
+    const uint8_t* triangles {mesh.triangles.data() + meshlet.triangleOffset};
+
+    // The sphere is centered on the vertices' bounding box, which is close to minimal for meshlets of this size.
+    Vec3 lo {getPosition(params, vertices[0])}, hi {lo};
+    for (uint32_t i {1}; i < meshlet.vertexCount; ++i) {
+      const Vec3 p {getPosition(params, vertices[i])};
+      lo = {std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z)};
+      hi = {std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z)};
+    }
+    const Vec3 center {(lo + hi) * 0.5f};
+    float radius {0.0f};
+    for (uint32_t i {0}; i < meshlet.vertexCount; ++i)
+      radius = std::max(radius, length(getPosition(params, vertices[i]) - center));
+    meshlet.center[0] = center.x; meshlet.center[1] = center.y; meshlet.center[2] = center.z;
+    meshlet.radius = radius;
+
+    // The cone's axis is the average of the triangles' normals, and it's as wide as the normal furthest from that.
+    std::vector<Vec3> normals {};
+    normals.reserve(meshlet.triangleCount);
+    Vec3 axis {0.0f, 0.0f, 0.0f};
+    for (uint32_t i {0}; i < meshlet.triangleCount; ++i) {
+      const Vec3 a {getPosition(params, vertices[triangles[i * 3 + 0]])};
+      const Vec3 b {getPosition(params, vertices[triangles[i * 3 + 1]])};
+      const Vec3 c {getPosition(params, vertices[triangles[i * 3 + 2]])};
+      const Vec3 n {cross(b - a, c - a)};
+      const float len {length(n)};
+      if (len <= 0.0f)
+        continue;
+      normals.push_back(n * (1.0f / len));
+      axis = axis + normals.back();
+    }
+    const float axisLength {length(axis)};
+    float minDot {1.0f};
+    if (axisLength > 0.0f) {
+      axis = axis * (1.0f / axisLength);
+      for (const Vec3& n : normals)
+        minDot = std::min(minDot, dot(n, axis));
+    }
+    meshlet.coneAxis[0] = axis.x; meshlet.coneAxis[1] = axis.y; meshlet.coneAxis[2] = axis.z;
+    meshlet.coneCutoff = (axisLength > 0.0f && minDot > minConeDot_c) ? std::sqrt(1.0f - minDot * minDot) : 1.0f;
+  }
+
+} // namespace
+
+hlgl::MeshletMesh hlgl::buildMeshlets(const BuildMeshletsParams& params) {
+  MeshletMesh mesh {};
+  if (!params.indices || !params.positions || params.indexCount < 3 || params.vertexCount == 0 || params.positionStride < 3 * sizeof(float))
+    return mesh;
+  const uint32_t maxVertices {std::clamp(params.maxVertices, 3u, 256u)};
+  const uint32_t maxTriangles {std::clamp(params.maxTriangles, 1u, 512u)};
+  const size_t triangleCount {params.indexCount / 3};
+  for (size_t i {0}; i < triangleCount * 3; ++i) {
+    if (params.indices[i] >= params.vertexCount)
+      return mesh;
+  }
+
+  // The triangles using each vertex, as offsets into one array.
+  std::vector<uint32_t> adjacencyOffsets(params.vertexCount + 1, 0);
+  for (size_t i {0}; i < triangleCount * 3; ++i)
+    ++adjacencyOffsets[params.indices[i] + 1];
+  for (size_t v {0}; v < params.vertexCount; ++v)
+    adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+  std::vector<uint32_t> adjacency(triangleCount * 3);
+  {
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i {0}; i < triangleCount * 3; ++i)
+      adjacency[fill[params.indices[i]]++] = (uint32_t)(i / 3);
+  }
+
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint16_t> localIndex(params.vertexCount, noLocalIndex_c);
+  mesh.meshlets.reserve(triangleCount / maxTriangles + 1);
+  mesh.vertices.reserve(params.indexCount / 2);
+  mesh.triangles.reserve(triangleCount * 3 + triangleCount / maxTriangles * 4);
+
+  Meshlet meshlet {};
+  Vec3 centroidSum {0.0f, 0.0f, 0.0f};
+  size_t seed {0};
+
+  auto newVertexCount = [&](uint32_t triangle) {
+    uint32_t count {0};
+    for (uint32_t k {0}; k < 3; ++k)
+      count += (localIndex[params.indices[triangle * 3 + k]] == noLocalIndex_c) ? 1 : 0;
+    return count;
+  };
+  auto triangleCentroid = [&](uint32_t triangle) {
+    return (getPosition(params, params.indices[triangle * 3]) +
+            getPosition(params, params.indices[triangle * 3 + 1]) +
+            getPosition(params, params.indices[triangle * 3 + 2])) * (1.0f / 3.0f);
+  };
+  auto flush = [&]() {
+    if (meshlet.triangleCount == 0)
+      return;
+    // Keeping each meshlet's triangles 4-byte aligned lets shaders read them as uints.
+    while (mesh.triangles.size() % 4)
+      mesh.triangles.push_back(0);
+    computeBounds(params, mesh, meshlet);
+    for (uint32_t i {0}; i < meshlet.vertexCount; ++i)
+      localIndex[mesh.vertices[meshlet.vertexOffset + i]] = noLocalIndex_c;
+    mesh.meshlets.push_back(meshlet);
+    meshlet = Meshlet{};
+    meshlet.vertexOffset = (uint32_t)mesh.vertices.size();
+    meshlet.triangleOffset = (uint32_t)mesh.triangles.size();
+    centroidSum = {0.0f, 0.0f, 0.0f};
+  };
+  auto add = [&](uint32_t triangle) {
+    for (uint32_t k {0}; k < 3; ++k) {
+      const uint32_t vertex {params.indices[triangle * 3 + k]};
+      if (localIndex[vertex] == noLocalIndex_c) {
+        localIndex[vertex] = (uint16_t)meshlet.vertexCount++;
+        mesh.vertices.push_back(vertex);
+      }
+      mesh.triangles.push_back((uint8_t)localIndex[vertex]);
+    }
+    ++meshlet.triangleCount;
+    emitted[triangle] = true;
+    centroidSum = centroidSum + triangleCentroid(triangle);
+  };
+
+  size_t remaining {triangleCount};
+  while (remaining > 0) {
+    // Of the unused triangles touching the meshlet, take the one which adds the fewest vertices, then the one nearest its centroid.
+    uint32_t best {UINT32_MAX};
+    uint32_t bestNew {UINT32_MAX};
+    float bestDistance {std::numeric_limits<float>::max()};
+    if (meshlet.triangleCount > 0) {
+      const Vec3 centroid {centroidSum * (1.0f / (float)meshlet.triangleCount)};
+      for (uint32_t i {0}; i < meshlet.vertexCount; ++i) {
+        const uint32_t vertex {mesh.vertices[meshlet.vertexOffset + i]};
+        for (uint32_t a {adjacencyOffsets[vertex]}; a < adjacencyOffsets[vertex + 1]; ++a) {
+          const uint32_t triangle {adjacency[a]};
+          if (emitted[triangle])
+            continue;
+          const uint32_t added {newVertexCount(triangle)};
+          if (meshlet.vertexCount + added > maxVertices || added > bestNew)
+            continue;
+          const Vec3 d {triangleCentroid(triangle) - centroid};
+          const float distance {dot(d, d)};
+          if (added < bestNew || distance < bestDistance) {
+            best = triangle;
+            bestNew = added;
+            bestDistance = distance;
+          }
+        }
+      }
+    }
+
+    // With nothing connected left, continue from the first unused triangle, starting a new meshlet if it doesn't fit.
+    if (best == UINT32_MAX) {
+      while (emitted[seed])
+        ++seed;
+      if (meshlet.vertexCount + newVertexCount((uint32_t)seed) > maxVertices)
+        flush();
+      best = (uint32_t)seed;
+    }
+
+    add(best);
+    --remaining;
+    if (meshlet.triangleCount == maxTriangles)
+      flush();
+  }
+  flush();
+  return mesh;
+}
+
+std::vector<hlgl::MeshletMesh> hlgl::buildMeshlets(const std::vector<BuildMeshletsParams>& params) {
+  std::vector<MeshletMesh> results(params.size());
+  getThreadPool().parallelFor((uint32_t)params.size(), [&](uint32_t i) {
+    results[i] = buildMeshlets(params[i]);
+  });
+  return results;
+}
@@ -0,0 +1,91 @@
+#include "thread-pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+hlgl::ThreadPool::ThreadPool(uint32_t numThreads) {
+  if (numThreads == 0)
+    numThreads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+  numThreads = std::max(1u, numThreads);
+
+  threads_.reserve(numThreads);
+  for (uint32_t i {0}; i < numThreads; ++i)
+    threads_.emplace_back([this](){ workerLoop(); });
+}
+
+hlgl::ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+  for (std::thread& thread : threads_)
+    thread.join();
+}
+
+void hlgl::ThreadPool::push(std::function<void()>&& task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  condition_.notify_one();
+}
+
+void hlgl::ThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this](){ return stopping_ || !tasks_.empty(); });
+      // Finish any remaining work before stopping, so nobody is left waiting on a future that'll never be fulfilled.
+      if (tasks_.empty())
+        return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+void hlgl::ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& func) {
+  if (count == 0)
+    return;
+  if (count == 1) {
+    func(0);
+    return;
+  }
+
+  // Every participating thread pulls indices from a shared counter until they run out.
+  struct Shared {
+    std::atomic<uint32_t> next {0};
+    std::atomic<uint32_t> done {0};
+    std::mutex mutex {};
+    std::condition_variable finished {};
+  };
+  auto shared {std::make_shared<Shared>()};
+  auto work = [shared, count, &func]() {
+    uint32_t numDone {0};
+    for (uint32_t i {shared->next++}; i < count; i = shared->next++) {
+      func(i);
+      ++numDone;
+    }
+    if (numDone && (shared->done += numDone) == count) {
+      std::lock_guard<std::mutex> lock(shared->mutex);
+      shared->finished.notify_all();
+    }
+  };
+
+  uint32_t numHelpers {std::min(getNumThreads(), count - 1)};
+  for (uint32_t i {0}; i < numHelpers; ++i)
+    push(work);
+  work();
+
+  // Helpers which start after every index has been claimed will return immediately without touching 'func'.
+  std::unique_lock<std::mutex> lock(shared->mutex);
+  shared->finished.wait(lock, [&](){ return shared->done == count; });
+}
+
+hlgl::ThreadPool& hlgl::getThreadPool() {
+  static ThreadPool pool {};
+  return pool;
+}
@@ -0,0 +1,74 @@
+#ifndef HLGL_UTILS_THREAD_POOL_H
+#define HLGL_UTILS_THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace hlgl {
+
+// A fixed set of worker threads which execute queued tasks in the order they were submitted.
+// Used for background work like reading texture data from disk, which shouldn't stall the render thread.
+class ThreadPool {
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+public:
+  // If 'numThreads' is 0, one thread is created per hardware thread (minus one for the calling thread).
+  explicit ThreadPool(uint32_t numThreads = 0);
+  ~ThreadPool();
+
+  uint32_t getNumThreads() const { return (uint32_t)threads_.size(); }
+
+  // Queues a task to be executed on a worker thread.  The returned future can be used to wait for and retrieve its result.
+  template <typename Func>
+  auto submit(Func&& func) -> std::future<std::invoke_result_t<std::decay_t<Func>>> {
+    using Result = std::invoke_result_t<std::decay_t<Func>>;
+    auto task {std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func))};
+    std::future<Result> future {task->get_future()};
+    push([task](){ (*task)(); });
+    return future;
+  }
+
+  // Calls 'func(i)' for every i in [0, count), spread across the worker threads.
+  // The calling thread participates too, and doesn't return until every call has finished.
+  void parallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+  // Splits [0, count) into ranges of at least 'minRange' items, and calls 'func(begin, end)' for each like 'parallelFor'.
+  // If the work doesn't split into more than one range, it's done on the calling thread without waking any workers.
+  template <typename Func>
+  void parallelForRange(size_t count, size_t minRange, Func&& func) {
+    minRange = std::max<size_t>(1, minRange);
+    const size_t numRanges {(count + minRange - 1) / minRange};
+    if (numRanges <= 1) {
+      func(size_t{0}, count);
+      return;
+    }
+    parallelFor((uint32_t)numRanges, [&](uint32_t i) {
+      func(i * minRange, std::min(count, (i + 1) * minRange));
+    });
+  }
+
+private:
+  void push(std::function<void()>&& task);
+  void workerLoop();
+
+  std::vector<std::thread> threads_ {};
+  std::deque<std::function<void()>> tasks_ {};
+  std::mutex mutex_ {};
+  std::condition_variable condition_ {};
+  bool stopping_ {false};
+};
+
+// The shared thread pool used internally by HLGL.  It's created the first time it's needed.
+ThreadPool& getThreadPool();
+
+} // namespace hlgl
+#endif // HLGL_UTILS_THREAD_POOL_H
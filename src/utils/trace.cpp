@@ -0,0 +1,175 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+  // Events kept per thread.  At 24 bytes each, this is 384KB for every thread which records while a capture is running.
+  constexpr uint64_t eventsPerThread_c {1 << 14};
+
+  // The fields are atomic (and accessed relaxed) because a save can read a slot while its thread overwrites it.
+  struct Event {
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> start;
+    std::atomic<uint64_t> end;
+  };
+
+  // Events as copied out of a thread's buffer when saving.
+  struct EventCopy {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+  };
+
+  // Only the owning thread writes to its buffer, so recording never takes a lock.
+  // 'count' is published with release ordering, so a reader which acquires it sees every event before it.
+  // Since the buffer is a ring, a reader can still race with the slot being overwritten.  Like a seqlock, 'claimed' is raised before
+  // each write, so a reader which checks it after copying knows which of the slots it copied may have been overwritten meanwhile.
+  struct ThreadEvents {
+    uint32_t tid {0};
+    std::unique_ptr<Event[]> events {std::make_unique<Event[]>(eventsPerThread_c)};
+    std::atomic<uint64_t> count {0};
+    std::atomic<uint64_t> claimed {0};  // The count once the event being written (if any) is done.
+    std::atomic<uint32_t> capture {0};  // The capture the events belong to.  Stale events are dropped on the next write.
+  };
+
+  std::atomic<bool> capturing_s {false};
+  std::atomic<uint32_t> capture_s {0};
+  std::atomic<uint64_t> captureStart_s {0};
+
+  // Buffers live until the program exits, so events from threads which have since ended can still be saved.
+  std::mutex threadsMutex_s {};
+  std::vector<std::unique_ptr<ThreadEvents>> threads_s {};
+  thread_local ThreadEvents* threadEvents_s {nullptr};
+
+  uint64_t now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  void record(const char* name, uint64_t start, uint64_t end) {
+    if (!threadEvents_s) {
+      std::scoped_lock lock {threadsMutex_s};
+      threads_s.push_back(std::make_unique<ThreadEvents>());
+      threads_s.back()->tid = (uint32_t)threads_s.size();
+      threadEvents_s = threads_s.back().get();
+    }
+    ThreadEvents& events {*threadEvents_s};
+    const uint32_t capture {capture_s.load(std::memory_order_acquire)};
+    if (events.capture.load(std::memory_order_relaxed) != capture) {
+      events.count.store(0, std::memory_order_relaxed);
+      events.claimed.store(0, std::memory_order_relaxed);
+      events.capture.store(capture, std::memory_order_release);
+    }
+    const uint64_t count {events.count.load(std::memory_order_relaxed)};
+    events.claimed.store(count + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Event& event {events.events[count % eventsPerThread_c]};
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(start, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    events.count.store(count + 1, std::memory_order_release);
+  }
+
+  // Copies the thread's events from 'capture', leaving out any which were overwritten while they were being copied.
+  void copyEvents(const ThreadEvents& thread, uint32_t capture, std::vector<EventCopy>& out) {
+    out.clear();
+    if (thread.capture.load(std::memory_order_acquire) != capture)
+      return;
+    const uint64_t count {thread.count.load(std::memory_order_acquire)};
+    const uint64_t first {(count > eventsPerThread_c) ? count - eventsPerThread_c : 0};
+    out.reserve(count - first);
+    for (uint64_t i {first}; i < count; ++i) {
+      const Event& event {thread.events[i % eventsPerThread_c]};
+      out.push_back(EventCopy{
+        event.name.load(std::memory_order_relaxed),
+        event.start.load(std::memory_order_relaxed),
+        event.end.load(std::memory_order_relaxed)});
+    }
+
+    // Any write which the copy saw is ordered before this fence, so 'claimed' covers it.  Slot 'i' was overwritten once 'i + eventsPerThread_c' was claimed.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (thread.capture.load(std::memory_order_relaxed) != capture) {
+      out.clear();
+      return;
+    }
+    const uint64_t claimed {thread.claimed.load(std::memory_order_relaxed)};
+    if (claimed > first + eventsPerThread_c)
+      out.erase(out.begin(), out.begin() + (ptrdiff_t)std::min<uint64_t>(claimed - first - eventsPerThread_c, out.size()));
+  }
+
+  void writeEscaped(FILE* file, const char* str) {
+    for (; *str; ++str) {
+      if (*str == '"' || *str == '\\')
+        fputc('\\', file);
+      if ((unsigned char)*str >= 0x20)
+        fputc(*str, file);
+    }
+  }
+
+} // namespace
+
+hlgl::TraceScope::TraceScope(const char* name) {
+  if (!capturing_s.load(std::memory_order_relaxed) || !name)
+    return;
+  name_ = name;
+  start_ = now();
+}
+
+hlgl::TraceScope::~TraceScope() {
+  if (!name_ || !capturing_s.load(std::memory_order_relaxed))
+    return;
+  record(name_, start_, now());
+}
+
+void hlgl::beginTraceCapture() {
+  captureStart_s.store(now(), std::memory_order_relaxed);
+  capture_s.fetch_add(1, std::memory_order_acq_rel);
+  capturing_s.store(true, std::memory_order_release);
+}
+
+void hlgl::endTraceCapture() {
+  capturing_s.store(false, std::memory_order_release);
+}
+
+bool hlgl::isTraceCapturing() {
+  return capturing_s.load(std::memory_order_relaxed);
+}
+
+bool hlgl::saveTraceCapture(const char* path) {
+  FILE* file {path ? fopen(path, "wb") : nullptr};
+  if (!file)
+    return false;
+
+  const uint32_t capture {capture_s.load(std::memory_order_acquire)};
+  const uint64_t captureStart {captureStart_s.load(std::memory_order_relaxed)};
+
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+  fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"hlgl\"}}", file);
+  {
+    std::scoped_lock lock {threadsMutex_s};
+    std::vector<EventCopy> events {};
+    for (const std::unique_ptr<ThreadEvents>& thread : threads_s) {
+      copyEvents(*thread, capture, events);
+      for (const EventCopy& event : events) {
+        if (event.start < captureStart)
+          continue;
+        fputs(",\n{\"name\":\"", file);
+        writeEscaped(file, event.name);
+        fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+          thread->tid, (double)(event.start - captureStart) / 1000.0, (double)(event.end - event.start) / 1000.0);
+      }
+    }
+  }
+  fputs("\n]}\n", file);
+
+  const bool success {ferror(file) == 0};
+  fclose(file);
+  return success;
+}
@@ -0,0 +1,12 @@
+#ifndef HLGL_UTILS_TRACE_H
+#define HLGL_UTILS_TRACE_H
+
+#include <hlgl.h>
+
+#define HLGL_TRACE_CONCAT_INNER(a,b) a##b
+#define HLGL_TRACE_CONCAT(a,b) HLGL_TRACE_CONCAT_INNER(a,b)
+
+// Records the rest of the enclosing scope as a trace event, see hlgl::TraceScope.
+#define HLGL_TRACE_SCOPE(name) hlgl::TraceScope HLGL_TRACE_CONCAT(traceScope_,__LINE__) {name}
+
+#endif // HLGL_UTILS_TRACE_H
@@ -0,0 +1,460 @@
+#include "async-compute.h"
+#include "buffer.h"
+#include "context.h"
+#include "frame.h"
+#include "texture.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace {
+
+  // A command buffer which is submitted at the end of the frame.
+  struct Submission {
+    VkCommandBuffer cmd {nullptr};
+    bool compute {false};
+    uint64_t waitValue {0};    // The value of the other queue's timeline to wait on before executing, or 0 for none.
+    uint64_t signalValue {0};  // The value signalled on this queue's timeline once finished.
+  };
+
+  // Graphics commands are split into segments wherever they start waiting on async compute, and each async compute section is a submission of its own.
+  // Submissions are kept in the order they were closed, which always puts a wait after the signal it waits on.
+  struct FrameCommands {
+    std::vector<VkCommandBuffer> graphicsCmds {};  // For segments after the first, which uses the frame's own command buffer.
+    std::vector<VkCommandBuffer> computeCmds {};
+    uint32_t graphicsUsed {0};
+    uint32_t computeUsed {0};
+    std::vector<Submission> submissions {};
+    uint64_t computeValue {0};  // The last value this frame signals on the compute timeline.
+  };
+
+  bool enabled_s {false};
+  uint32_t graphicsFamily_s {VK_QUEUE_FAMILY_IGNORED};
+  uint32_t computeFamily_s {VK_QUEUE_FAMILY_IGNORED};
+  VkQueue graphicsQueue_s {nullptr};
+  VkQueue computeQueue_s {nullptr};
+  VkCommandPool graphicsPool_s {nullptr};
+  VkCommandPool computePool_s {nullptr};
+  VkSemaphore graphicsTimeline_s {nullptr};
+  VkSemaphore computeTimeline_s {nullptr};
+  uint64_t graphicsValue_s {0};
+  uint64_t computeValue_s {0};
+  std::array<FrameCommands, hlgl::numFramesInFlight_c> frames_s {};
+
+  // The graphics segment being recorded.
+  Submission graphics_s {};
+  // The async compute section being recorded, if any.  'sectionReleased_s' is set once resources have been released to it from the
+  // graphics segment, which then has to be closed and submitted ahead of the section.
+  Submission section_s {};
+  bool sectionReleased_s {false};
+
+  VkCommandBuffer beginCmd(VkCommandPool pool, std::vector<VkCommandBuffer>& cmds, uint32_t& used) {
+    using namespace hlgl;
+    if (used == cmds.size()) {
+      VkCommandBufferAllocateInfo ai {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1 };
+      VkCommandBuffer cmd {nullptr};
+      if (!VKCHECK(vkAllocateCommandBuffers(getDevice(), &ai, &cmd)) || !cmd)
+        return nullptr;
+      cmds.push_back(cmd);
+    }
+    else if (!VKCHECK(vkResetCommandBuffer(cmds[used], 0)))
+      return nullptr;
+
+    VkCommandBuffer cmd {cmds[used]};
+    VkCommandBufferBeginInfo bi {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+    if (!VKCHECK(vkBeginCommandBuffer(cmd, &bi)))
+      return nullptr;
+    ++used;
+    return cmd;
+  }
+
+  bool openSection(FrameCommands& commands) {
+    using namespace hlgl;
+    VkCommandBuffer cmd {beginCmd(computePool_s, commands.computeCmds, commands.computeUsed)};
+    if (!cmd)
+      return false;
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, getPipelineLayout(), 0, NUM_DESCRIPTOR_SETS, getDescriptorSets(), 0, nullptr);
+    section_s = Submission{.cmd = cmd, .compute = true, .signalValue = ++computeValue_s};
+    sectionReleased_s = false;
+    return true;
+  }
+
+  // Closes the graphics segment being recorded and starts a new one, which waits for the compute timeline to reach 'waitValue'.
+  bool splitGraphics(hlgl::Frame* frame, FrameCommands& commands, uint64_t waitValue) {
+    using namespace hlgl;
+    VkCommandBuffer cmd {beginCmd(graphicsPool_s, commands.graphicsCmds, commands.graphicsUsed)};
+    if (!cmd) {
+      DEBUG_ERROR("Failed to begin a graphics command buffer for async compute synchronization.");
+      return false;
+    }
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, getPipelineLayout(), 0, NUM_DESCRIPTOR_SETS, getDescriptorSets(), 0, nullptr);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, getPipelineLayout(), 0, NUM_DESCRIPTOR_SETS, getDescriptorSets(), 0, nullptr);
+
+    graphics_s.signalValue = ++graphicsValue_s;
+    commands.submissions.push_back(graphics_s);
+    graphics_s = Submission{.cmd = cmd, .waitValue = waitValue};
+    if (!frame->inAsyncCompute)
+      frame->cmd = cmd;
+    return true;
+  }
+
+  // Records a release barrier, using 'record', on the queue which currently owns a resource, and makes sure the queue acquiring it waits for the release.
+  template <typename RecordFunc>
+  void recordRelease(bool toCompute, uint64_t section, RecordFunc&& record) {
+    using namespace hlgl;
+    // Releases to compute go into the graphics segment, which is closed ahead of the section that acquires them (see 'endAsyncCompute').
+    if (toCompute) {
+      record(graphics_s.cmd);
+      sectionReleased_s = true;
+      return;
+    }
+
+    // Outside of a frame, the release is submitted right away.
+    Frame* frame {getCurrentFrame()};
+    if (!frame) {
+      VkCommandBufferAllocateInfo ai {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = computePool_s,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1 };
+      VkCommandBuffer cmd {nullptr};
+      if (!VKCHECK(vkAllocateCommandBuffers(getDevice(), &ai, &cmd)) || !cmd)
+        return;
+      VkCommandBufferBeginInfo bi {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+      vkBeginCommandBuffer(cmd, &bi);
+      record(cmd);
+      vkEndCommandBuffer(cmd);
+      VkSubmitInfo si {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &cmd };
+      VKCHECK(vkQueueSubmit(computeQueue_s, 1, &si, nullptr));
+      VKCHECK(vkQueueWaitIdle(computeQueue_s));
+      vkFreeCommandBuffers(getDevice(), computePool_s, 1, &cmd);
+      return;
+    }
+
+    // Sections from this frame haven't been ended yet, so the release can go at the end of the section which last used the resource.
+    // Otherwise that section has already been submitted, and the release gets a section of its own.
+    FrameCommands& commands {frames_s[frame->frameIndex]};
+    Submission* owner {nullptr};
+    for (Submission& submission : commands.submissions) {
+      if (submission.compute && submission.signalValue == section)
+        owner = &submission;
+    }
+    if (!owner) {
+      VkCommandBuffer cmd {beginCmd(computePool_s, commands.computeCmds, commands.computeUsed)};
+      if (!cmd)
+        return;
+      commands.submissions.push_back(Submission{.cmd = cmd, .compute = true, .signalValue = ++computeValue_s});
+      commands.computeValue = computeValue_s;
+      owner = &commands.submissions.back();
+    }
+    record(owner->cmd);
+    graphics_s.waitValue = std::max(graphics_s.waitValue, owner->signalValue);
+  }
+
+} // namespace
+
+bool hlgl::initAsyncCompute(uint32_t graphicsFamily, uint32_t computeFamily, VkQueue graphicsQueue, VkQueue computeQueue, VkCommandPool graphicsPool) {
+  graphicsFamily_s = graphicsFamily;
+  computeFamily_s = computeFamily;
+  graphicsQueue_s = graphicsQueue;
+  computeQueue_s = computeQueue;
+  graphicsPool_s = graphicsPool;
+  graphicsValue_s = 0;
+  computeValue_s = 0;
+  enabled_s = false;
+
+  if (computeFamily == graphicsFamily || !computeQueue) {
+    DEBUG_VERBOSE("No separate compute queue family, so async compute will be recorded along with graphics work.");
+    return true;
+  }
+
+  VkCommandPoolCreateInfo pci {
+    .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+    .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+    .queueFamilyIndex = computeFamily };
+  if (!VKCHECK(vkCreateCommandPool(getDevice(), &pci, nullptr, &computePool_s)) || !computePool_s) {
+    DEBUG_ERROR("Failed to create Vulkan compute command pool.");
+    return false;
+  }
+
+  VkSemaphoreTypeCreateInfo tci {
+    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+    .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+    .initialValue = 0 };
+  VkSemaphoreCreateInfo sci {
+    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    .pNext = &tci };
+  if (!VKCHECK(vkCreateSemaphore(getDevice(), &sci, nullptr, &graphicsTimeline_s)) ||
+      !VKCHECK(vkCreateSemaphore(getDevice(), &sci, nullptr, &computeTimeline_s)))
+  {
+    DEBUG_ERROR("Failed to create timeline semaphores for async compute.");
+    return false;
+  }
+
+  if (isValidationEnabled()) {
+    VkDebugUtilsObjectNameInfoEXT info {
+      .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT,
+      .objectType = VK_OBJECT_TYPE_COMMAND_POOL,
+      .objectHandle = (uint64_t)computePool_s,
+      .pObjectName = "cmdPoolCompute" };
+    if (!VKCHECK_WARN(vkSetDebugUtilsObjectNameEXT(getDevice(), &info)))
+      DEBUG_WARNING("Failed to set Vulkan debug name for '%s'.", info.pObjectName);
+
+    info.objectType = VK_OBJECT_TYPE_SEMAPHORE;
+    info.objectHandle = (uint64_t)graphicsTimeline_s;
+    info.pObjectName = "graphicsTimeline";
+    if (!VKCHECK_WARN(vkSetDebugUtilsObjectNameEXT(getDevice(), &info)))
+      DEBUG_WARNING("Failed to set Vulkan debug name for '%s'.", info.pObjectName);
+
+    info.objectHandle = (uint64_t)computeTimeline_s;
+    info.pObjectName = "computeTimeline";
+    if (!VKCHECK_WARN(vkSetDebugUtilsObjectNameEXT(getDevice(), &info)))
+      DEBUG_WARNING("Failed to set Vulkan debug name for '%s'.", info.pObjectName);
+  }
+
+  enabled_s = true;
+  return true;
+}
+
+void hlgl::shutdownAsyncCompute() {
+  for (FrameCommands& commands : frames_s) {
+    if (!commands.graphicsCmds.empty() && graphicsPool_s)
+      vkFreeCommandBuffers(getDevice(), graphicsPool_s, (uint32_t)commands.graphicsCmds.size(), commands.graphicsCmds.data());
+    commands = FrameCommands{};
+  }
+  if (computePool_s) { vkDestroyCommandPool(getDevice(), computePool_s, nullptr); computePool_s = nullptr; }
+  if (graphicsTimeline_s) { vkDestroySemaphore(getDevice(), graphicsTimeline_s, nullptr); graphicsTimeline_s = nullptr; }
+  if (computeTimeline_s) { vkDestroySemaphore(getDevice(), computeTimeline_s, nullptr); computeTimeline_s = nullptr; }
+  graphics_s = {};
+  section_s = {};
+  enabled_s = false;
+}
+
+void hlgl::beginAsyncComputeFrame(Frame* frame) {
+  FrameCommands& commands {frames_s[frame->frameIndex]};
+  if (enabled_s && commands.computeValue > 0) {
+    VkSemaphoreWaitInfo wi {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+      .semaphoreCount = 1,
+      .pSemaphores = &computeTimeline_s,
+      .pValues = &commands.computeValue };
+    VKCHECK(vkWaitSemaphores(getDevice(), &wi, UINT64_MAX));
+  }
+  commands.graphicsUsed = 0;
+  commands.computeUsed = 0;
+  commands.submissions.clear();
+  graphics_s = Submission{.cmd = frame->cmd};
+  section_s = {};
+  sectionReleased_s = false;
+}
+
+bool hlgl::submitFrameCommands(Frame* frame, VkSemaphore acquireSemaphore, VkSemaphore submitSemaphore, VkSemaphore frameTimeline, uint64_t frameValue) {
+  FrameCommands& commands {frames_s[frame->frameIndex]};
+  graphics_s.signalValue = enabled_s ? ++graphicsValue_s : 0;
+  commands.submissions.push_back(graphics_s);
+  graphics_s = {};
+
+  // Nothing was ended until now, since releases may have been added to any section recorded this frame.
+  for (const Submission& submission : commands.submissions)
+    vkEndCommandBuffer(submission.cmd);
+
+  bool firstGraphics {true};
+  for (size_t i {0}; i < commands.submissions.size(); ++i) {
+    const Submission& submission {commands.submissions[i]};
+    const bool last {i + 1 == commands.submissions.size()};
+
+    std::array<VkSemaphore, 2> waits {};
+    std::array<uint64_t, 2> waitValues {};
+    std::array<VkPipelineStageFlags, 2> waitStages {};
+    uint32_t waitCount {0};
+    if (!submission.compute && firstGraphics && acquireSemaphore) {
+      waits[waitCount] = acquireSemaphore;
+      waitStages[waitCount++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    }
+    if (submission.waitValue > 0) {
+      waits[waitCount] = submission.compute ? graphicsTimeline_s : computeTimeline_s;
+      waitValues[waitCount] = submission.waitValue;
+      waitStages[waitCount++] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    }
+
+    std::array<VkSemaphore, 3> signals {};
+    std::array<uint64_t, 3> signalValues {};
+    uint32_t signalCount {0};
+    if (submission.signalValue > 0) {
+      signals[signalCount] = submission.compute ? computeTimeline_s : graphicsTimeline_s;
+      signalValues[signalCount++] = submission.signalValue;
+    }
+    if (last && frameTimeline) {
+      signals[signalCount] = frameTimeline;
+      signalValues[signalCount++] = frameValue;
+    }
+    if (last && submitSemaphore)
+      signals[signalCount++] = submitSemaphore;
+
+    VkTimelineSemaphoreSubmitInfo tsi {
+      .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+      .waitSemaphoreValueCount = waitCount,
+      .pWaitSemaphoreValues = waitValues.data(),
+      .signalSemaphoreValueCount = signalCount,
+      .pSignalSemaphoreValues = signalValues.data() };
+    VkSubmitInfo si {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .pNext = &tsi,
+      .waitSemaphoreCount = waitCount,
+      .pWaitSemaphores = waits.data(),
+      .pWaitDstStageMask = waitStages.data(),
+      .commandBufferCount = 1,
+      .pCommandBuffers = &submission.cmd,
+      .signalSemaphoreCount = signalCount,
+      .pSignalSemaphores = signals.data() };
+    if (!VKCHECK(vkQueueSubmit(submission.compute ? computeQueue_s : graphicsQueue_s, 1, &si, last ? frame->fence : nullptr)))
+      return false;
+    if (!submission.compute)
+      firstGraphics = false;
+  }
+  commands.submissions.clear();
+  return true;
+}
+
+uint64_t hlgl::getAsyncComputeValue() {
+  return enabled_s ? computeValue_s : 0;
+}
+
+bool hlgl::isAsyncComputeComplete(uint64_t value) {
+  if (!enabled_s || value == 0)
+    return true;
+  uint64_t completed {0};
+  return VKCHECK(vkGetSemaphoreCounterValue(getDevice(), computeTimeline_s, &completed)) && completed >= value;
+}
+
+bool hlgl::isAsyncComputeCmd(VkCommandBuffer cmd) {
+  return enabled_s && cmd && cmd == section_s.cmd;
+}
+
+bool hlgl::transferOwnership(TextureImpl* texture, VkCommandBuffer cmd, VkImageLayout dstLayout, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask) {
+  if (!enabled_s)
+    return false;
+  const bool toCompute {isAsyncComputeCmd(cmd)};
+  const uint64_t section {texture->asyncComputeSection};
+  if (toCompute)
+    texture->asyncComputeSection = section_s.signalValue;
+  if (toCompute == texture->asyncComputeOwned)
+    return false;
+  texture->asyncComputeOwned = toCompute;
+
+  // An image with undefined contents doesn't need to be released, the other queue family can just take it.
+  if (texture->layout == VK_IMAGE_LAYOUT_UNDEFINED)
+    return false;
+
+  const uint32_t srcFamily {toCompute ? graphicsFamily_s : computeFamily_s};
+  const uint32_t dstFamily {toCompute ? computeFamily_s : graphicsFamily_s};
+  const VkImageLayout srcLayout {texture->layout};
+  recordRelease(toCompute, section, [&](VkCommandBuffer releaseCmd) {
+    texture->barrier(releaseCmd, dstLayout, VK_ACCESS_NONE, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, srcFamily, dstFamily);
+  });
+  // The acquire has to repeat the release's layout transition.  Its source scope is covered by the semaphore wait.
+  texture->layout = srcLayout;
+  texture->accessMask = VK_ACCESS_NONE;
+  texture->stageMask = dstStageMask;
+  texture->barrier(cmd, dstLayout, dstAccessMask, dstStageMask, srcFamily, dstFamily);
+  return true;
+}
+
+bool hlgl::transferOwnership(BufferImpl* buffer, uint32_t index, VkCommandBuffer cmd, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask) {
+  if (!enabled_s)
+    return false;
+  const bool toCompute {isAsyncComputeCmd(cmd)};
+  const uint64_t section {buffer->asyncComputeSection[index]};
+  if (toCompute)
+    buffer->asyncComputeSection[index] = section_s.signalValue;
+  if (toCompute == buffer->asyncComputeOwned[index])
+    return false;
+  buffer->asyncComputeOwned[index] = toCompute;
+
+  const uint32_t srcFamily {toCompute ? graphicsFamily_s : computeFamily_s};
+  const uint32_t dstFamily {toCompute ? computeFamily_s : graphicsFamily_s};
+  recordRelease(toCompute, section, [&](VkCommandBuffer releaseCmd) {
+    buffer->barrier(releaseCmd, VK_ACCESS_NONE, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, index, srcFamily, dstFamily);
+  });
+  buffer->accessMask[index] = VK_ACCESS_NONE;
+  buffer->stageMask[index] = dstStageMask;
+  buffer->barrier(cmd, dstAccessMask, dstStageMask, index, srcFamily, dstFamily);
+  return true;
+}
+
+bool hlgl::isAsyncComputeAvailable() {
+  return enabled_s;
+}
+
+void hlgl::beginAsyncCompute() {
+  Frame* frame {getCurrentFrame()};
+  if (!frame) {
+    DEBUG_ERROR("Can't call 'beginAsyncCompute' outside of a frame.");
+    return;
+  }
+  if (frame->inAsyncCompute) {
+    DEBUG_ERROR("Can't call 'beginAsyncCompute' inside an async compute section.");
+    return;
+  }
+
+  endDrawing();
+  frame->inAsyncCompute = true;
+  frame->boundPipeline = nullptr;
+  // Without a separate compute queue the section is recorded with the graphics work, which is still correct, just not overlapped.
+  if (enabled_s && openSection(frames_s[frame->frameIndex]))
+    frame->cmd = section_s.cmd;
+}
+
+void hlgl::endAsyncCompute() {
+  Frame* frame {getCurrentFrame()};
+  if (!frame || !frame->inAsyncCompute) {
+    DEBUG_ERROR("Can't call 'endAsyncCompute' without first calling 'beginAsyncCompute'.");
+    return;
+  }
+
+  frame->inAsyncCompute = false;
+  frame->boundPipeline = nullptr;
+  if (!section_s.cmd)
+    return;
+
+  // Anything released to the section has to be submitted before it, so the graphics segment ends here.
+  FrameCommands& commands {frames_s[frame->frameIndex]};
+  if (sectionReleased_s && splitGraphics(frame, commands, 0))
+    section_s.waitValue = graphicsValue_s;
+  commands.submissions.push_back(section_s);
+  commands.computeValue = section_s.signalValue;
+  section_s = {};
+  frame->cmd = graphics_s.cmd;
+}
+
+void hlgl::waitAsyncCompute() {
+  Frame* frame {getCurrentFrame()};
+  if (!frame) {
+    DEBUG_ERROR("Can't call 'waitAsyncCompute' outside of a frame.");
+    return;
+  }
+  if (frame->inAsyncCompute) {
+    DEBUG_ERROR("Can't call 'waitAsyncCompute' inside an async compute section.");
+    return;
+  }
+  if (!enabled_s || graphics_s.waitValue >= computeValue_s)
+    return;
+
+  endDrawing();
+  // If a new segment can't be started, the current one waits instead, which is correct but overlaps less.
+  if (!splitGraphics(frame, frames_s[frame->frameIndex], computeValue_s))
+    graphics_s.waitValue = computeValue_s;
+  frame->boundPipeline = nullptr;
+}
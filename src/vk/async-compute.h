@@ -0,0 +1,39 @@
+#ifndef HLGL_VK_ASYNC_COMPUTE_H
+#define HLGL_VK_ASYNC_COMPUTE_H
+
+#include <hlgl.h>
+#include "vulkan-headers.h"
+
+namespace hlgl {
+
+// Async compute needs a compute queue family separate from the graphics family.  Without one, async compute sections are recorded
+// inline with the graphics commands, and none of the ownership tracking below does anything.
+bool initAsyncCompute(uint32_t graphicsFamily, uint32_t computeFamily, VkQueue graphicsQueue, VkQueue computeQueue, VkCommandPool graphicsPool);
+void shutdownAsyncCompute();
+
+// Waits until the compute work of the frame which last used this frame index has finished, so its command buffers can be reused.
+// Must be called at the beginning of a frame, after the frame's fence has been waited on and before the deletion queue is flushed.
+void beginAsyncComputeFrame(Frame* frame);
+// Ends every command buffer recorded this frame, and submits them in order to the graphics and compute queues.
+// The first graphics submission waits on 'acquireSemaphore', and the last signals 'submitSemaphore', the frame's fence, and the timeline
+// semaphore 'frameTimeline' with 'frameValue'.  Either binary semaphore may be null.
+bool submitFrameCommands(Frame* frame, VkSemaphore acquireSemaphore, VkSemaphore submitSemaphore, VkSemaphore frameTimeline, uint64_t frameValue);
+
+// The value the compute timeline reaches once every async compute section recorded so far has finished, or 0 if async compute is disabled.
+uint64_t getAsyncComputeValue();
+// Returns true if the compute timeline has reached 'value', without waiting.
+bool isAsyncComputeComplete(uint64_t value);
+
+// Returns true if 'cmd' is the command buffer of the async compute section being recorded.
+bool isAsyncComputeCmd(VkCommandBuffer cmd);
+
+// Resources are owned by one queue family at a time.  When a resource owned by the other family is barriered on 'cmd', these record
+// the release on the owning queue's commands and the acquire (including the transition to the requested state) on 'cmd', using the
+// barriers' 'srcQfi' and 'dstQfi' parameters.  Returns true if the transfer took the place of the barrier.
+// Releases from async compute are recorded lazily, into the section which last used the resource, so the graphics commands
+// which acquire it have to wait on that section (see 'waitAsyncCompute').
+bool transferOwnership(TextureImpl* texture, VkCommandBuffer cmd, VkImageLayout dstLayout, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+bool transferOwnership(BufferImpl* buffer, uint32_t index, VkCommandBuffer cmd, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+
+} // namespace hlgl
+#endif // HLGL_VK_ASYNC_COMPUTE_H
@@ -1,6 +1,8 @@
 #include "buffer.h"
+#include "async-compute.h"
 #include "context.h"
 #include "frame.h"
+#include "../utils/trace.h"
 #include <chrono>
 
 hlgl::Buffer::Buffer(Buffer::CreateParams params)
@@ -9,6 +11,7 @@ hlgl::Buffer::Buffer(Buffer::CreateParams params)
 
 hlgl::BufferImpl::BufferImpl(Buffer::CreateParams&& params)
 {
+  HLGL_TRACE_SCOPE("Create buffer");
   auto timeStart = std::chrono::high_resolution_clock::now();
 
   size = params.size;
@@ -25,8 +28,6 @@ hlgl::BufferImpl::BufferImpl(Buffer::CreateParams&& params)
     actualSize = size + (remainder ? (multiple - remainder) : 0);
   }
 
-  VkBufferUsageFlags usage{0};
-
   if (params.usage & BufferUsage::TransferSrc)
     usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 
@@ -153,7 +154,9 @@ void hlgl::BufferImpl::barrier(VkCommandBuffer cmd,
                            uint32_t frame,
                            uint32_t srcQfi, uint32_t dstQfi)
 {
-  if (accessMask[frame] == dstAccessMask && stageMask[frame] == dstStageMask)
+  if (srcQfi == VK_QUEUE_FAMILY_IGNORED && dstQfi == VK_QUEUE_FAMILY_IGNORED && transferOwnership(this, frame, cmd, dstAccessMask, dstStageMask))
+    return;
+  if (srcQfi == dstQfi && accessMask[frame] == dstAccessMask && stageMask[frame] == dstStageMask)
     return;
   VkBufferMemoryBarrier bfrBarrier{
     .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
@@ -164,7 +167,8 @@ void hlgl::BufferImpl::barrier(VkCommandBuffer cmd,
     .buffer = buffer[frame],
     .offset = 0,
     .size = size};
-  vkCmdPipelineBarrier(cmd, stageMask[frame], dstStageMask, 0,
+  // A buffer which has never been barriered has no stages to wait on.
+  vkCmdPipelineBarrier(cmd, stageMask[frame] ? stageMask[frame] : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask, 0,
                        0, nullptr, 1, &bfrBarrier, 0, nullptr);
 
   accessMask[frame] = dstAccessMask;
@@ -218,11 +222,10 @@ void hlgl::Buffer::updateData(void* data, size_t size, DeviceSize offset) {
     vkCmdUpdateBuffer(frame->cmd, _pimpl->buffer[frame->frameIndex], offset, size, data);
   }
   else {
-    Buffer stagingBuffer(Buffer::CreateParams{
-      .usage = BufferUsage::TransferSrc | BufferUsage::HostVisible,
-      .data = {{.ptr = data, .size = size}},
-      .debugName = "stagingBuffer" });
-    VkBufferCopy info{.srcOffset = 0, .dstOffset = offset, .size = size};
-    vkCmdCopyBuffer(frame->cmd, stagingBuffer._pimpl->buffer[0], _pimpl->buffer[frame->frameIndex], 1, &info);
+    StagingAlloc staging {allocStaging(size)};
+    if (!staging.ptr) return;
+    memcpy(staging.ptr, data, size);
+    VkBufferCopy info{.srcOffset = staging.offset, .dstOffset = offset, .size = size};
+    vkCmdCopyBuffer(frame->cmd, staging.buffer->buffer[0], _pimpl->buffer[frame->frameIndex], 1, &info);
   }
 }
@@ -15,9 +15,12 @@ struct BufferImpl {
   std::array<VkDeviceAddress, 2> deviceAddress{0};
   std::array<VkAccessFlags, 2> accessMask{0};
   std::array<VkPipelineStageFlags, 2> stageMask{0};
+  std::array<bool, 2> asyncComputeOwned{false};     // Owned by the async compute queue family rather than graphics, see 'transferOwnership'.
+  std::array<uint64_t, 2> asyncComputeSection{0};   // The async compute section which last used each buffer.
 
   VkDeviceSize size{0};
   VkDeviceSize actualSize{0};
+  VkBufferUsageFlags usage{0};
   VkDeviceSize syncOffset{0};
   uint32_t indexSize{4};
   bool hostVisible{false};
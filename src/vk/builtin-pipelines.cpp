@@ -0,0 +1,271 @@
+#include "builtin-pipelines.h"
+#include "context.h"
+#include "frame.h"
+#include "pipeline.h"
+
+#include <array>
+#include <optional>
+
+namespace {
+
+  constexpr const char* downsampleSrc_c = R"(
+    [vk::binding(0,2)]
+    RWTexture2D<float4> storageImages[];
+
+    [shader("compute")]
+    [numthreads(8,8,1)]
+    void main(uniform uint src, uniform uint dst, uniform uint2 srcSize, uniform uint2 dstSize, uint3 id : SV_DispatchThreadID) {
+      if (id.x >= dstSize.x || id.y >= dstSize.y)
+        return;
+      // Odd-sized sources clamp to their last row/column rather than reading out of bounds.
+      uint2 a = min(id.xy * 2, srcSize - 1);
+      uint2 b = min(id.xy * 2 + 1, srcSize - 1);
+      float4 sum = storageImages[src][a] + storageImages[src][uint2(b.x, a.y)] +
+                   storageImages[src][uint2(a.x, b.y)] + storageImages[src][b];
+      storageImages[dst][id.xy] = sum * 0.25;
+    }
+  )";
+
+  constexpr const char* upscaleSrc_c = R"(
+    [vk::binding(0,2)]
+    RWTexture2D<float4> storageImages[];
+
+    float4 loadClamped(uint src, int2 p, uint2 srcSize) {
+      return storageImages[src][uint2(clamp(p, int2(0), int2(srcSize) - 1))];
+    }
+
+    // 'p' is in source pixels, with pixel centers at half coordinates.
+    float4 bilinear(uint src, float2 p, uint2 srcSize) {
+      p -= 0.5;
+      int2 i = int2(floor(p));
+      float2 f = p - floor(p);
+      float4 top = lerp(loadClamped(src, i, srcSize), loadClamped(src, i + int2(1,0), srcSize), f.x);
+      float4 bottom = lerp(loadClamped(src, i + int2(0,1), srcSize), loadClamped(src, i + int2(1,1), srcSize), f.x);
+      return lerp(top, bottom, f.y);
+    }
+
+    [shader("compute")]
+    [numthreads(8,8,1)]
+    void main(uniform uint src, uniform uint dst, uniform uint2 srcSize, uniform uint2 dstSize, uniform float sharpness, uint3 id : SV_DispatchThreadID) {
+      if (id.x >= dstSize.x || id.y >= dstSize.y)
+        return;
+      float2 p = (float2(id.xy) + 0.5) * float2(srcSize) / float2(dstSize);
+      float4 c = bilinear(src, p, srcSize);
+
+      // Contrast adaptive sharpening: subtract the neighbors one source pixel away, less so where contrast is already high.
+      if (sharpness > 0.0) {
+        float3 n = bilinear(src, p + float2(0,-1), srcSize).rgb;
+        float3 s = bilinear(src, p + float2(0, 1), srcSize).rgb;
+        float3 e = bilinear(src, p + float2( 1,0), srcSize).rgb;
+        float3 w = bilinear(src, p + float2(-1,0), srcSize).rgb;
+        float3 mn = min(c.rgb, min(min(n, s), min(e, w)));
+        float3 mx = max(c.rgb, max(max(n, s), max(e, w)));
+        float3 amp = sqrt(saturate(min(mn, 1.0 - mx) / max(mx, 1e-5)));
+        float3 weight = -amp * lerp(0.125, 0.2, sharpness);
+        c.rgb = saturate((c.rgb + weight * (n + s + e + w)) / (1.0 + 4.0 * weight));
+      }
+      storageImages[dst][id.xy] = c;
+    }
+  )";
+
+  constexpr const char* depthReduceSrc_c = R"(
+    [vk::binding(0,1)]
+    Sampler2D textures[];
+
+    [vk::binding(0,2)]
+    RWTexture2D<float4> storageImages[];
+
+    [shader("compute")]
+    [numthreads(8,8,1)]
+    void main(uniform uint src, uniform uint dst, uniform uint2 dstSize, uniform uint2 srcSize, uniform uint2 srcCapacity, uniform uint reduceMax, uint3 id : SV_DispatchThreadID) {
+      if (id.x >= dstSize.x || id.y >= dstSize.y)
+        return;
+      // Every source texel the destination texel overlaps has to be included, or the pyramid isn't conservative.
+      // That's more than 2x2 texels when a level has an odd size, or when the first level isn't exactly half the size of 'src'.
+      uint2 first = id.xy * srcSize / dstSize;
+      uint2 last = max(((id.xy + 1) * srcSize + dstSize - 1) / dstSize, first + 1) - 1;
+      // 'src' has a min or max reduction sampler, so a linear sample at the corner between four texels returns the least or greatest of them.
+      // Corners are kept inside the region of 'src' in use (which is smaller than the image for screen-sized textures), so the last quad
+      // in each direction overlaps the one before it instead of reaching past the edge.  A single texel is sampled at the clamped edge.
+      float result = 0;
+      bool any = false;
+      for (uint y = first.y; y <= last.y; y += 2) {
+        for (uint x = first.x; x <= last.x; x += 2) {
+          float2 corner = float2(min(uint2(x, y) + 1, srcSize - 1));
+          float value = textures[src].SampleLevel(corner / float2(srcCapacity), 0).r;
+          result = !any ? value : (reduceMax != 0) ? max(result, value) : min(result, value);
+          any = true;
+        }
+      }
+      storageImages[dst][id.xy] = float4(result);
+    }
+  )";
+
+  constexpr const char* cullSrc_c = R"(
+    [vk::binding(0,1)]
+    Sampler2D textures[];
+
+    struct DrawEntry {
+      uint indexCount;
+      uint instanceCount;
+      uint firstIndex;
+      int vertexOffset;
+      uint firstInstance;
+    };
+
+    struct CullInstance {
+      float4 sphere; // xyz = center, w = radius.
+      DrawEntry draw;
+      uint firstLod;
+      uint lodCount;
+      float lodErrorScale;
+    };
+
+    struct MeshLod {
+      uint firstIndex;
+      uint indexCount;
+      float error;
+      uint padding;
+    };
+
+    static const uint occlusion_c = 1;
+    static const uint reverseZ_c = 2;
+
+    // Planes are taken from the rows of the view-projection matrix, so the sphere doesn't have to be transformed into view space.
+    bool insideFrustum(float4x4 viewProj, float4 sphere) {
+      float4 planes[6] = {
+        viewProj[3] + viewProj[0], viewProj[3] - viewProj[0],
+        viewProj[3] + viewProj[1], viewProj[3] - viewProj[1],
+        viewProj[2], viewProj[3] - viewProj[2] };
+      for (uint i = 0; i < 6; ++i) {
+        if (dot(planes[i].xyz, sphere.xyz) + planes[i].w < -sphere.w * length(planes[i].xyz))
+          return false;
+      }
+      return true;
+    }
+
+    // Projects the sphere's bounding box, and compares its nearest depth to the farthest depth in the Hi-Z texels it covers.
+    // The mip is chosen so the box is no wider than one texel, which keeps it to four samples.
+    bool occluded(float4x4 viewProj, float4 sphere, uint hiZ, uint2 hiZSize, uint hiZMips, bool reverseZ) {
+      float3 mn = float3(1e30);
+      float3 mx = float3(-1e30);
+      for (uint i = 0; i < 8; ++i) {
+        float3 corner = sphere.xyz + sphere.w * float3((i & 1) ? 1.0 : -1.0, (i & 2) ? 1.0 : -1.0, (i & 4) ? 1.0 : -1.0);
+        float4 clip = mul(viewProj, float4(corner, 1.0));
+        // Crossing the near plane means the projection isn't bounded, so treat it as visible.
+        if (clip.w <= 0.0)
+          return false;
+        float3 ndc = clip.xyz / clip.w;
+        mn = min(mn, ndc);
+        mx = max(mx, ndc);
+      }
+      float2 uvMin = saturate(mn.xy * 0.5 + 0.5);
+      float2 uvMax = saturate(mx.xy * 0.5 + 0.5);
+      float2 extent = (uvMax - uvMin) * float2(hiZSize);
+      uint mip = min((uint)ceil(log2(max(max(extent.x, extent.y), 1.0))), hiZMips - 1);
+      uint2 mipSize = max(hiZSize >> mip, uint2(1));
+      int2 p0 = int2(min(uint2(uvMin * float2(mipSize)), mipSize - 1));
+      int2 p1 = int2(min(uint2(uvMax * float2(mipSize)), mipSize - 1));
+      float4 d = float4(
+        textures[hiZ].Load(int3(p0, mip)).r, textures[hiZ].Load(int3(p1.x, p0.y, mip)).r,
+        textures[hiZ].Load(int3(p0.x, p1.y, mip)).r, textures[hiZ].Load(int3(p1, mip)).r);
+      if (reverseZ)
+        return mx.z < min(min(d.x, d.y), min(d.z, d.w));
+      return mn.z > max(max(d.x, d.y), max(d.z, d.w));
+    }
+
+    // Picks the coarsest level whose error, projected at the sphere's nearest depth, is within the threshold.  Matches hlgl::selectLod.
+    // The fourth row of the view-projection matrix gives clip space w, which is the view-space depth for a perspective projection.
+    uint selectLod(float4x4 viewProj, CullInstance instance, MeshLod* lods, float lodScale, float lodThreshold) {
+      float nearest = dot(viewProj[3], float4(instance.sphere.xyz, 1.0)) - instance.sphere.w;
+      if (nearest <= 0.0)
+        return 0;
+      float maxError = lodThreshold * nearest / (lodScale * max(instance.lodErrorScale, 1e-20));
+      uint lod = 0;
+      while (lod + 1 < instance.lodCount && lods[instance.firstLod + lod + 1].error <= maxError)
+        ++lod;
+      return lod;
+    }
+
+    [shader("compute")]
+    [numthreads(64,1,1)]
+    void main(uniform float4x4 viewProj, uniform CullInstance* instances, uniform DrawEntry* draws, uniform uint* count, uniform MeshLod* lods,
+              uniform uint instanceCount, uniform uint hiZ, uniform uint2 hiZSize, uniform uint hiZMips, uniform uint flags,
+              uniform float lodScale, uniform float lodThreshold,
+              uint3 id : SV_DispatchThreadID)
+    {
+      if (id.x >= instanceCount)
+        return;
+      CullInstance instance = instances[id.x];
+      if (!insideFrustum(viewProj, instance.sphere))
+        return;
+      if ((flags & occlusion_c) && occluded(viewProj, instance.sphere, hiZ, hiZSize, hiZMips, (flags & reverseZ_c) != 0))
+        return;
+      DrawEntry draw = instance.draw;
+      if (lodScale > 0.0 && instance.lodCount > 1) {
+        MeshLod lod = lods[instance.firstLod + selectLod(viewProj, instance, lods, lodScale, lodThreshold)];
+        draw.firstIndex = lod.firstIndex;
+        draw.indexCount = lod.indexCount;
+      }
+      uint slot;
+      InterlockedAdd(*count, 1, slot);
+      draws[slot] = draw;
+    }
+  )";
+
+  struct BuiltinSource {
+    const char* src;
+    const char* debugName;
+  };
+  constexpr std::array builtinSources_c {
+    BuiltinSource{downsampleSrc_c, "hlgl.downsample"},
+    BuiltinSource{upscaleSrc_c, "hlgl.upscale"},
+    BuiltinSource{depthReduceSrc_c, "hlgl.depth-reduce"},
+    BuiltinSource{cullSrc_c, "hlgl.cull"},
+  };
+
+  std::array<std::optional<hlgl::Pipeline>, builtinSources_c.size()> builtinPipelines_s {};
+
+} // namespace
+
+hlgl::Pipeline* hlgl::getBuiltinPipeline(BuiltinPipeline which) {
+  std::optional<Pipeline>& pipeline {builtinPipelines_s[(size_t)which]};
+  if (!pipeline) {
+    const BuiltinSource& source {builtinSources_c[(size_t)which]};
+    Shader shader(Shader::CreateParams{.src = source.src, .debugName = source.debugName});
+    if (!shader) {
+      DEBUG_ERROR("Failed to compile builtin shader '%s'.", source.debugName);
+      return nullptr;
+    }
+    pipeline.emplace(Pipeline::ComputeParams{
+      .compShader = {.shader = &shader},
+      .debugName = source.debugName });
+  }
+  return pipeline->isValid() ? &*pipeline : nullptr;
+}
+
+void hlgl::shutdownBuiltinPipelines() {
+  for (std::optional<Pipeline>& pipeline : builtinPipelines_s)
+    pipeline.reset();
+}
+
+bool hlgl::dispatchBuiltin(VkCommandBuffer cmd, BuiltinPipeline which,
+  const void* constants, uint32_t constantsSize,
+  uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+  Pipeline* pipeline {getBuiltinPipeline(which)};
+  if (!pipeline)
+    return false;
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->_pimpl->pipeline);
+  vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, getPipelineLayout(), 0, (uint32_t)getDescSetLayouts().size(), getDescriptorSets(), 0, nullptr);
+  if (constants && constantsSize)
+    vkCmdPushConstants(cmd, getPipelineLayout(), VK_SHADER_STAGE_ALL, 0, constantsSize, constants);
+  vkCmdDispatch(cmd, groupCountX, groupCountY, groupCountZ);
+
+  // The user's pipeline is no longer bound, so make sure the next 'bindPipeline' doesn't get skipped.
+  Frame* frame {getCurrentFrame()};
+  if (frame && frame->cmd == cmd)
+    frame->boundPipeline = nullptr;
+  return true;
+}
@@ -0,0 +1,27 @@
+#ifndef HLGL_VK_BUILTIN_PIPELINES_H
+#define HLGL_VK_BUILTIN_PIPELINES_H
+
+#include <hlgl.h>
+#include "vulkan-headers.h"
+
+namespace hlgl {
+
+// Compute pipelines used internally by HLGL.  Each is compiled the first time it's used.
+enum class BuiltinPipeline {
+  Downsample,  // 2x2 box filter from one storage image into another, used to generate mips for formats which can't be blitted.
+  Upscale,     // Bilinear upscale with contrast adaptive sharpening from one storage image into another, used by 'upscale'.
+  DepthReduce, // Min or max reduction of one level of a depth pyramid into the next, used by 'buildDepthPyramid'.
+  Cull,        // Frustum and Hi-Z occlusion culling of bounding spheres, compacting the visible draws into an indirect buffer, used by 'cullDraws'.
+};
+
+Pipeline* getBuiltinPipeline(BuiltinPipeline which);
+void shutdownBuiltinPipelines();
+
+// Records a dispatch of one of the builtin compute pipelines into 'cmd'.
+// The descriptor sets are bound too, so this works with immediate command buffers as well as the current frame's.
+bool dispatchBuiltin(VkCommandBuffer cmd, BuiltinPipeline which,
+  const void* constants, uint32_t constantsSize,
+  uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+
+} // namespace hlgl
+#endif // HLGL_VK_BUILTIN_PIPELINES_H
@@ -1,9 +1,20 @@
 #include "context.h"
+#include "async-compute.h"
 #include "buffer.h"
 #include "texture.h"
 #include "frame.h"
+#include "builtin-pipelines.h"
+#include "depth-pyramid.h"
+#include "dynamic-resolution.h"
+#include "profiler.h"
+#include "query.h"
+#include "readback.h"
+#include "residency.h"
+#include "streaming.h"
+#include "virtual-texture.h"
 
 #include "../utils/array.h"
+#include "../utils/trace.h"
 #include <algorithm>
 #include <chrono>
 #include <map>
@@ -26,14 +37,19 @@ namespace {
   uint32_t displayWidth_s {0}, displayHeight_s {0};
   hlgl::VsyncMode vsync_s {hlgl::VsyncMode::Fifo};
   bool hdr_s {false};
+  bool headless_s {false};
   
   VkInstance instance_s {nullptr};
   VkDebugUtilsMessengerEXT debug_s {nullptr};
   VkSurfaceKHR surface_s {nullptr};
   VkPhysicalDevice physicalDevice_s {nullptr};
   VkPhysicalDeviceProperties physicalDeviceProperties_s {};
+  VkPhysicalDeviceFeatures enabledDeviceFeatures_s {};
   VkDevice device_s {nullptr};
   VmaAllocator allocator_s {nullptr};
+  bool memoryBudgetEnabled_s {false};
+  bool memoryPriorityEnabled_s {false};
+  bool pageableMemoryEnabled_s {false};
 
   uint32_t graphicsQueueFamily_s {UINT32_MAX};
   uint32_t presentQueueFamily_s {UINT32_MAX};
@@ -45,7 +61,6 @@ namespace {
   VkQueue transferQueue_s {nullptr};
 
   VkCommandPool cmdPoolGraphics_s {nullptr};
-  constexpr size_t numFramesInFlight_c {2};
   std::array<VkCommandBuffer, numFramesInFlight_c> frameCmdBuffers_s;
   std::array<VkFence, numFramesInFlight_c> frameFences_s;
   std::array<VkSemaphore, numFramesInFlight_c> acquireSemaphores_s;
@@ -68,9 +83,10 @@ namespace {
 
   VkCommandPool cmdPoolTransfer_s {nullptr};
   VkCommandBuffer cmdTransfer_s {nullptr};
-  std::optional<hlgl::Buffer> stagingBuffer_s {std::nullopt};
-  hlgl::DeviceSize stagingBufferOffset_s {0};
-  uint64_t stagingBufferLastFrameUsed_s {0};
+  // Each frame in flight gets its own staging buffer, so data staged for one frame can't be overwritten while the GPU is still copying it.
+  // A frame's staging offset is only reset once its fence has been waited on.
+  std::array<std::optional<hlgl::Buffer>, numFramesInFlight_c> stagingBuffers_s {};
+  std::array<hlgl::DeviceSize, numFramesInFlight_c> stagingOffsets_s {};
   std::vector<VkSemaphore> transferPendingSemaphores_s {};
 
   VkSwapchainKHR swapchain_s {nullptr};
@@ -83,8 +99,92 @@ namespace {
   std::vector<VkSemaphore> submitSemaphores_s {};
   hlgl::Observable<uint32_t,uint32_t> subjectDisplayResized_s {};  
 
-  constexpr size_t numDelQueues_c {3};
-  std::array<std::vector<hlgl::DelQueueItem>, numDelQueues_c> delQueues_s;
+  // When headless, these stand in for the swapchain images.  There's one per frame in flight, so the next frame can be recorded while the last is rendering.
+  std::array<std::optional<hlgl::Texture>, numFramesInFlight_c> headlessTargets_s {};
+
+  // The last graphics submission of each frame signals this with the frame's 'frameCounter_s', so it counts the frames the GPU has finished.
+  VkSemaphore frameTimeline_s {nullptr};
+
+  // Objects queued for deletion are sorted by type into bins, one for each frame that queued anything, keyed on the value that frame signals on
+  // 'frameTimeline_s' (and the async compute timeline value recorded by then).  A bin is flushed once the GPU has reached both.
+  // Flushed bins are kept as spares without releasing their vectors' capacity, so they only grow (geometrically) the first time a frame queues
+  // that many deletions, and after that queueing a deletion doesn't allocate.
+  struct DelQueueBin {
+    uint64_t frameValue {0};
+    uint64_t computeValue {0};
+    std::vector<hlgl::DelQueueBuffer> buffers;
+    std::vector<hlgl::DelQueueTexture> textures;
+    std::vector<hlgl::DelQueuePipeline> pipelines;
+    std::vector<hlgl::DelQueueDescriptor> descriptors;
+    std::vector<hlgl::DelQueueQueryPool> queryPools;
+  };
+  std::vector<DelQueueBin> delQueues_s;       // Bins waiting on the GPU, oldest first.
+  std::vector<DelQueueBin> spareDelQueues_s;  // Flushed bins, ready for reuse.
+  std::vector<VmaAllocation> delQueueAllocations_s; // Scratch space for freeing memory in bulk.
+
+  DelQueueBin& currentDelQueueBin() {
+    if (delQueues_s.empty() || delQueues_s.back().frameValue != frameCounter_s) {
+      if (spareDelQueues_s.empty())
+        delQueues_s.emplace_back();
+      else {
+        delQueues_s.push_back(std::move(spareDelQueues_s.back()));
+        spareDelQueues_s.pop_back();
+      }
+      delQueues_s.back().frameValue = frameCounter_s;
+    }
+    DelQueueBin& bin {delQueues_s.back()};
+    bin.computeValue = std::max(bin.computeValue, hlgl::getAsyncComputeValue());
+    return bin;
+  }
+
+  void flushDelQueueBin(DelQueueBin& bin) {
+    // Destroy the raw handles first, then hand all of the memory back to VMA in a single call.
+    delQueueAllocations_s.clear();
+    for (const hlgl::DelQueueBuffer& item : bin.buffers) {
+      if (item.allocation && item.buffer) {
+        vkDestroyBuffer(device_s, item.buffer, nullptr);
+        delQueueAllocations_s.push_back(item.allocation);
+      }
+    }
+    for (const hlgl::DelQueueTexture& item : bin.textures) {
+      if (item.view) vkDestroyImageView(device_s, item.view, nullptr);
+      if (item.sampler) vkDestroySampler(device_s, item.sampler, nullptr);
+      if (item.allocation && item.image) {
+        vkDestroyImage(device_s, item.image, nullptr);
+        delQueueAllocations_s.push_back(item.allocation);
+      }
+    }
+    if (!delQueueAllocations_s.empty())
+      vmaFreeMemoryPages(allocator_s, delQueueAllocations_s.size(), delQueueAllocations_s.data());
+
+    for (const hlgl::DelQueuePipeline& item : bin.pipelines) {
+      if (item.pipeline) vkDestroyPipeline(device_s, item.pipeline, nullptr);
+      if (item.layout) vkDestroyPipelineLayout(device_s, item.layout, nullptr);
+    }
+    for (const hlgl::DelQueueDescriptor& item : bin.descriptors) {
+      descFreeIndices_s[item.set].push_back(item.index);
+    }
+    for (const hlgl::DelQueueQueryPool& item : bin.queryPools) {
+      if (item.pool) vkDestroyQueryPool(device_s, item.pool, nullptr);
+    }
+
+    bin.buffers.clear();
+    bin.textures.clear();
+    bin.pipelines.clear();
+    bin.descriptors.clear();
+    bin.queryPools.clear();
+    bin.frameValue = 0;
+    bin.computeValue = 0;
+  }
+
+  // Flushes the oldest 'count' bins and sets them aside for reuse.
+  void retireDelQueueBins(size_t count) {
+    for (size_t i {0}; i < count; ++i) {
+      flushDelQueueBin(delQueues_s[i]);
+      spareDelQueues_s.push_back(std::move(delQueues_s[i]));
+    }
+    delQueues_s.erase(delQueues_s.begin(), delQueues_s.begin() + count);
+  }
 
   bool isLayerSupported(const std::vector<VkLayerProperties>& layerProperties, const std::string_view requestedlayer) {
     for (const VkLayerProperties& layer : layerProperties) {
@@ -153,7 +253,8 @@ namespace {
       if (familyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
         { outGraphics = i; ++curTransferScore; }
       VkBool32 presentSupport {false};
-      vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+      if (surface)
+        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
       if (presentSupport)
         { outPresent = i; ++curTransferScore; }
       if (familyProperties[i].queueFlags & VK_QUEUE_COMPUTE_BIT)
@@ -161,6 +262,10 @@ namespace {
       if ((familyProperties[i].queueFlags & VK_QUEUE_TRANSFER_BIT) && (curTransferScore < minTransferScore))
         { outTransfer = i; minTransferScore = curTransferScore; }
     }
+
+    // Without a surface nothing gets presented, so the graphics queue stands in for the present queue.
+    if (!surface)
+      outPresent = outGraphics;
   }
 
   bool buildSwapchain() {
@@ -243,6 +348,9 @@ namespace {
       }
     }
 
+    // Swapchain images can be read back for screenshots wherever the surface allows it.
+    const bool readable {(caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0};
+
     VkSwapchainKHR newSwapchain;
     VkSwapchainCreateInfoKHR ci {
       .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
@@ -252,7 +360,7 @@ namespace {
       .imageColorSpace = surfaceFormat.colorSpace,
       .imageExtent = swapchainExtent_s,
       .imageArrayLayers = 1,
-      .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+      .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | (readable ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0u),
       .imageSharingMode = sharing,
       .queueFamilyIndexCount = (uint32_t)queueFamilyIndices.size(),
       .pQueueFamilyIndices = queueFamilyIndices.data(),
@@ -324,6 +432,7 @@ namespace {
     for (size_t i {0}; i < images.size(); ++i) {
       char debugName[256]; snprintf(debugName, 256, "swapchainTextures[%zu]", i);
       swapchainImages_s.emplace_back(Texture::CreateParams{
+        .usage = readable ? TextureUsage::TransferSrc : TextureUsage::None,
         .width = swapchainExtent_s.width,
         .height = swapchainExtent_s.height,
         .format = translate(surfaceFormat.format),
@@ -342,6 +451,37 @@ namespace {
     return true;
   }
 
+  // Creates the offscreen targets used in place of swapchain images when headless, at the current display size.
+  bool buildHeadlessTargets() {
+    using namespace hlgl;
+    auto timeStart = std::chrono::high_resolution_clock::now();
+
+    swapchainFormat_s = VK_FORMAT_R8G8B8A8_SRGB;
+    swapchainExtent_s = {std::max(1u, displayWidth_s), std::max(1u, displayHeight_s)};
+    displayWidth_s = swapchainExtent_s.width;
+    displayHeight_s = swapchainExtent_s.height;
+
+    for (size_t i {0}; i < headlessTargets_s.size(); ++i) {
+      char debugName[256]; snprintf(debugName, 256, "headlessTargets[%zu]", i);
+      headlessTargets_s[i].emplace(Texture::CreateParams{
+        .usage = TextureUsage::Framebuffer | TextureUsage::TransferSrc | TextureUsage::TransferDst,
+        .width = swapchainExtent_s.width,
+        .height = swapchainExtent_s.height,
+        .format = translate(swapchainFormat_s),
+        .debugName = debugName });
+      if (!headlessTargets_s[i]->isValid()) {
+        DEBUG_ERROR("Failed to create headless target %zu.", i);
+        return false;
+      }
+    }
+
+    auto timeEnd = std::chrono::high_resolution_clock::now();
+    auto timeElapsed = std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - timeStart);
+    DEBUG_VERBOSE("Created headless targets (%u x %u) (%s) (took %.2fms)",
+      displayWidth_s, displayHeight_s, string_VkFormat(swapchainFormat_s), (double)timeElapsed.count() / 1000.0);
+    return true;
+  }
+
   uint64_t alignedSize(uint64_t value, uint64_t alignment) {
     return (value + alignment - 1) & ~(alignment - 1);
   }
@@ -378,17 +518,22 @@ bool hlgl::initContext(InitContextParams params) {
 
   // Features which are required are also preferred, don't make the user repeat themselves.
   params.preferredFeatures |= params.requiredFeatures;
+  headless_s = params.headless;
 
   // Get the window dimensions.
+  if (headless_s) {
+    displayWidth_s = params.headlessSize.width;
+    displayHeight_s = params.headlessSize.height;
+  }
   #if defined HLGL_WINDOW_LIBRARY_GLFW
-  {
+  else {
     int32_t w {0}, h {0};
     glfwGetWindowSize(params.window, &w, &h);
     displayWidth_s = static_cast<uint32_t>(w);
     displayHeight_s = static_cast<uint32_t>(h);
   }
   #elif defined HLGL_WINDOW_LIBRARY_NATIVE_WIN32
-  {
+  else {
     RECT clientRect {}; 
     GetClientRect(params.window, &clientRect);
     displayWidth_s = static_cast<uint32_t>(std::max<int32_t>(0, clientRect.right - clientRect.left));
@@ -397,7 +542,7 @@ bool hlgl::initContext(InitContextParams params) {
   #endif
 
   vsync_s = params.vsync;
-  hdr_s = params.hdr;
+  hdr_s = params.hdr && !headless_s;
 
   /////////////////////////////////////////////////////////////////////////////
   // Create Instance
@@ -480,9 +625,9 @@ bool hlgl::initContext(InitContextParams params) {
     hlgl::Array<const char*, maxExtensions_c> requiredExtensions;
     hlgl::Array<const char*, maxExtensions_c> optionalExtensions;
 
-    // Start with required platform-specific extensions.
+    // Start with required platform-specific extensions.  Headless contexts have no surface, so they don't need any.
     #if defined HLGL_WINDOW_LIBRARY_GLFW
-    {
+    if (!headless_s) {
       uint32_t glfwExtCount {0};
       const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtCount);
       for (uint32_t i {0}; i < glfwExtCount; ++i) {
@@ -490,12 +635,15 @@ bool hlgl::initContext(InitContextParams params) {
       }
     }
     #elif defined HLGL_WINDOW_LIBRARY_NATIVE_WIN32
+    if (!headless_s) {
       requiredExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
       requiredExtensions.push_back("VK_KHR_win32_surface");
+    }
     #endif
 
     // Color space extension is always optional, since HDR should be toggleable at runtime.
-    optionalExtensions.push_back(VK_EXT_SWAPCHAIN_COLOR_SPACE_EXTENSION_NAME);
+    if (!headless_s)
+      optionalExtensions.push_back(VK_EXT_SWAPCHAIN_COLOR_SPACE_EXTENSION_NAME);
 
     // Validation may or may not be required depending on user preference.
     if ((params.requiredFeatures & Feature::Validation))
@@ -631,7 +779,7 @@ bool hlgl::initContext(InitContextParams params) {
 
   /////////////////////////////////////////////////////////////////////////////
   // Create Surface
-  {
+  if (!headless_s) {
     auto timeStart = std::chrono::high_resolution_clock::now();
     #if defined HLGL_WINDOW_LIBRARY_GLFW
     if (!VKCHECK(glfwCreateWindowSurface(instance_s, params.window, nullptr, &surface_s)) || !surface_s) {
@@ -665,7 +813,8 @@ bool hlgl::initContext(InitContextParams params) {
   std::vector<VkExtensionProperties> extensionProperties;
   std::vector<VkQueueFamilyProperties> queueFamilyProperties;
   {
-    requiredDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    if (!headless_s)
+      requiredDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     
     if (params.requiredFeatures & Feature::MeshShading)
       requiredDeviceExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
@@ -676,6 +825,11 @@ bool hlgl::initContext(InitContextParams params) {
       requiredDeviceExtensions.push_back(VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME);
     else
       optionalDeviceExtensions.push_back(VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME);
+
+    // These let HLGL track how much memory it can use, and tell the driver which allocations matter most.
+    optionalDeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    optionalDeviceExtensions.push_back(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME);
+    optionalDeviceExtensions.push_back(VK_EXT_PAGEABLE_DEVICE_LOCAL_MEMORY_EXTENSION_NAME);
   }
 
   /////////////////////////////////////////////////////////////////////////////
@@ -780,20 +934,21 @@ bool hlgl::initContext(InitContextParams params) {
       if (supportedExtensions.findStr(VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME) != SIZE_MAX)
         properties.supportedFeatures |= Feature::RayTracing;
       
-      // Make sure there's at least one supported surface format.
-      uint32_t surfaceFormatsCount {0};
-      vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface_s, &surfaceFormatsCount, nullptr);
-      if (surfaceFormatsCount == 0) {
-        DEBUG_VERBOSE("  ...no surface formats available, skipping.");
-        continue;
-      }
+      // Make sure there's at least one supported surface format and present mode.
+      if (surface_s) {
+        uint32_t surfaceFormatsCount {0};
+        vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface_s, &surfaceFormatsCount, nullptr);
+        if (surfaceFormatsCount == 0) {
+          DEBUG_VERBOSE("  ...no surface formats available, skipping.");
+          continue;
+        }
 
-      // Make sure there's at least one supported present mode.
-      uint32_t presentModesCount {0};
-      vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface_s, &presentModesCount, nullptr);
-      if (presentModesCount == 0) {
-        DEBUG_VERBOSE("  ...no surface present modes available, skipping.");
-        continue;
+        uint32_t presentModesCount {0};
+        vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface_s, &presentModesCount, nullptr);
+        if (presentModesCount == 0) {
+          DEBUG_VERBOSE("  ...no surface present modes available, skipping.");
+          continue;
+        }
       }
 
       // TODO: Check for feature support.
@@ -892,6 +1047,34 @@ bool hlgl::initContext(InitContextParams params) {
       gpu_s.enabledFeatures |= Feature::RayTracing;
     }
 
+    // Memory extensions are enabled whenever they're available.
+    // Memory priority and pageable memory also have feature bits which need to be checked.
+    if (supportedOptionalExtensions.findStr(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) != SIZE_MAX) {
+      requiredDeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+      memoryBudgetEnabled_s = true;
+    }
+    if (supportedOptionalExtensions.findStr(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME) != SIZE_MAX) {
+      bool pageableSupported {supportedOptionalExtensions.findStr(VK_EXT_PAGEABLE_DEVICE_LOCAL_MEMORY_EXTENSION_NAME) != SIZE_MAX};
+      VkPhysicalDevicePageableDeviceLocalMemoryFeaturesEXT pageableFeatures {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PAGEABLE_DEVICE_LOCAL_MEMORY_FEATURES_EXT };
+      VkPhysicalDeviceMemoryPriorityFeaturesEXT priorityFeatures {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT,
+        .pNext = (pageableSupported) ? &pageableFeatures : nullptr };
+      VkPhysicalDeviceFeatures2 features {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &priorityFeatures };
+      vkGetPhysicalDeviceFeatures2(physicalDevice_s, &features);
+
+      if (priorityFeatures.memoryPriority) {
+        requiredDeviceExtensions.push_back(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME);
+        memoryPriorityEnabled_s = true;
+        if (pageableSupported && pageableFeatures.pageableDeviceLocalMemory) {
+          requiredDeviceExtensions.push_back(VK_EXT_PAGEABLE_DEVICE_LOCAL_MEMORY_EXTENSION_NAME);
+          pageableMemoryEnabled_s = true;
+        }
+      }
+    }
+
     // Assemble queue family indices.
     getQueueFamilyIndices(physicalDevice_s, surface_s,
       graphicsQueueFamily_s, presentQueueFamily_s, computeQueueFamily_s, transferQueueFamily_s, queueFamilyProperties);
@@ -926,6 +1109,20 @@ bool hlgl::initContext(InitContextParams params) {
     if (gpu_s .enabledFeatures & Feature::MeshShading)
       pNext = &msf;
 
+    VkPhysicalDeviceMemoryPriorityFeaturesEXT mpf {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT,
+      .pNext = pNext,
+      .memoryPriority = true };
+    if (memoryPriorityEnabled_s)
+      pNext = &mpf;
+
+    VkPhysicalDevicePageableDeviceLocalMemoryFeaturesEXT pdlmf {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PAGEABLE_DEVICE_LOCAL_MEMORY_FEATURES_EXT,
+      .pNext = pNext,
+      .pageableDeviceLocalMemory = true };
+    if (pageableMemoryEnabled_s)
+      pNext = &pdlmf;
+
     VkPhysicalDeviceVulkan13Features df13 {
       .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
       .pNext = pNext,
@@ -952,6 +1149,8 @@ bool hlgl::initContext(InitContextParams params) {
       .descriptorBindingVariableDescriptorCount = true,
       .runtimeDescriptorArray = true,
       .samplerFilterMinmax = true,
+      .hostQueryReset = true,
+      .timelineSemaphore = true,
       .bufferDeviceAddress = true };
     pNext = &df12;
 
@@ -963,10 +1162,21 @@ bool hlgl::initContext(InitContextParams params) {
       .shaderDrawParameters = true };
     pNext = &df11;
 
+    // Block compressed texture formats are enabled whenever they're available, so transcoded textures can use them.
+    // Likewise for format-less storage image access, which the builtin compute shaders rely on.
+    VkPhysicalDeviceFeatures supportedDf10 {};
+    vkGetPhysicalDeviceFeatures(physicalDevice_s, &supportedDf10);
     VkPhysicalDeviceFeatures df10 {
       .samplerAnisotropy = true,
+      .textureCompressionETC2 = supportedDf10.textureCompressionETC2,
+      .textureCompressionASTC_LDR = supportedDf10.textureCompressionASTC_LDR,
+      .textureCompressionBC = supportedDf10.textureCompressionBC,
+      .occlusionQueryPrecise = supportedDf10.occlusionQueryPrecise,
       .pipelineStatisticsQuery = true,
+      .shaderStorageImageReadWithoutFormat = supportedDf10.shaderStorageImageReadWithoutFormat,
+      .shaderStorageImageWriteWithoutFormat = supportedDf10.shaderStorageImageWriteWithoutFormat,
       .shaderInt16 = true };
+    enabledDeviceFeatures_s = df10;
 
     VkDeviceCreateInfo ci {
       .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
@@ -997,11 +1207,13 @@ bool hlgl::initContext(InitContextParams params) {
       if (!VKCHECK_WARN(vkSetDebugUtilsObjectNameEXT(device_s, &info)))
         DEBUG_WARNING("Failed to set Vulkan debug name for 'instance_s'.");
       
-      info.objectType = VK_OBJECT_TYPE_SURFACE_KHR;
-      info.objectHandle = (uint64_t)surface_s;
-      info.pObjectName = "surface";
-      if (!VKCHECK_WARN(vkSetDebugUtilsObjectNameEXT(device_s, &info)))
-        DEBUG_WARNING("Failed to set Vulkan debug name for 'surface_s'.");
+      if (surface_s) {
+        info.objectType = VK_OBJECT_TYPE_SURFACE_KHR;
+        info.objectHandle = (uint64_t)surface_s;
+        info.pObjectName = "surface";
+        if (!VKCHECK_WARN(vkSetDebugUtilsObjectNameEXT(device_s, &info)))
+          DEBUG_WARNING("Failed to set Vulkan debug name for 'surface_s'.");
+      }
       
       info.objectType = VK_OBJECT_TYPE_PHYSICAL_DEVICE;
       info.objectHandle = (uint64_t)physicalDevice_s;
@@ -1100,11 +1312,17 @@ bool hlgl::initContext(InitContextParams params) {
       .device = device_s,
       .pVulkanFunctions = &volkFunctions,
       .instance = instance_s,
+      .vulkanApiVersion = VK_API_VERSION_1_3,
     };
+    if (memoryBudgetEnabled_s)
+      ci.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    if (memoryPriorityEnabled_s)
+      ci.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_PRIORITY_BIT;
     if (!VKCHECK(vmaCreateAllocator(&ci, &allocator_s)) || !allocator_s) {
       DEBUG_FATAL("Failed to create VMA allocator.");
       return false;
     }
+    initResidency(memoryBudgetEnabled_s, pageableMemoryEnabled_s);
 
     auto timeEnd = std::chrono::high_resolution_clock::now();
     auto timeElapsed = std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - timeStart);
@@ -1256,7 +1474,13 @@ bool hlgl::initContext(InitContextParams params) {
 
   /////////////////////////////////////////////////////////////////////////////
   // Initialize Swapchain
-  if (!buildSwapchain() || !swapchain_s) {
+  if (headless_s) {
+    if (!buildHeadlessTargets()) {
+      DEBUG_FATAL("Failed to create headless targets.");
+      return false;
+    }
+  }
+  else if (!buildSwapchain() || !swapchain_s) {
     DEBUG_FATAL("Failed to create swapchain.");
     return false;
   }
@@ -1313,6 +1537,29 @@ bool hlgl::initContext(InitContextParams params) {
       }
     }
 
+    VkSemaphoreTypeCreateInfo tci {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+      .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+      .initialValue = 0 };
+    VkSemaphoreCreateInfo sci {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+      .pNext = &tci };
+    if (!VKCHECK(vkCreateSemaphore(device_s, &sci, nullptr, &frameTimeline_s)))
+      return false;
+    if (gpu_s.enabledFeatures & Feature::Validation) {
+      VkDebugUtilsObjectNameInfoEXT info {
+        .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT,
+        .objectType = VK_OBJECT_TYPE_SEMAPHORE,
+        .objectHandle = (uint64_t)frameTimeline_s,
+        .pObjectName = "frameTimeline" };
+      if (!VKCHECK_WARN(vkSetDebugUtilsObjectNameEXT(device_s, &info)))
+        DEBUG_WARNING("Failed to set Vulkan debug name for '%s'.", info.pObjectName);
+    }
+
+    initProfiler(queueFamilyProperties[graphicsQueueFamily_s].timestampValidBits);
+    if (!initAsyncCompute(graphicsQueueFamily_s, computeQueueFamily_s, graphicsQueue_s, computeQueue_s, cmdPoolGraphics_s))
+      return false;
+
     auto timeEnd = std::chrono::high_resolution_clock::now();
     auto timeElapsed = std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - timeStart);
     debugPrint(DebugSeverity::Verbose,
@@ -1325,11 +1572,14 @@ bool hlgl::initContext(InitContextParams params) {
   {
     auto timeStart = std::chrono::high_resolution_clock::now();
 
-    stagingBuffer_s.emplace(Buffer::CreateParams{
-      .usage = BufferUsage::TransferSrc | BufferUsage::HostVisible,
-      .size = 1024*1024*100, // Start with a size of 100MB.
-      .debugName = "stagingBuffer"
-    });
+    for (size_t i {0}; i < numFramesInFlight_c; ++i) {
+      stagingBuffers_s[i].emplace(Buffer::CreateParams{
+        .usage = BufferUsage::TransferSrc | BufferUsage::HostVisible,
+        .size = 1024*1024*64, // Start with a size of 64MB per frame.
+        .debugName = "stagingBuffer"
+      });
+      stagingOffsets_s[i] = 0;
+    }
 
     // Allocate a command buffer for the transfer queue.
     VkCommandBufferAllocateInfo ai {
@@ -1438,11 +1688,14 @@ bool hlgl::initContext(InitContextParams params) {
   {
     auto timeStart = std::chrono::high_resolution_clock::now();
     ImGui::CreateContext();
-    #if defined HLGL_WINDOW_LIBRARY_GLFW
-    ImGui_ImplGlfw_InitForVulkan(params.window, true);
-    #elif defined HLGL_WINDOW_LIBRARY_NATIVE_WIN32
-    ImGui_ImplWin32_Init(params.window);
-    #endif
+    // Headless contexts have no window for a platform backend to read input from, so 'imguiNewFrame' fills in the display size itself.
+    if (!headless_s) {
+      #if defined HLGL_WINDOW_LIBRARY_GLFW
+      ImGui_ImplGlfw_InitForVulkan(params.window, true);
+      #elif defined HLGL_WINDOW_LIBRARY_NATIVE_WIN32
+      ImGui_ImplWin32_Init(params.window);
+      #endif
+    }
     ImGui_ImplVulkan_InitInfo ii {
       .Instance = instance_s,
       .PhysicalDevice = physicalDevice_s,
@@ -1478,18 +1731,29 @@ void hlgl::shutdownContext() {
     vkDeviceWaitIdle(device_s);
 
     ImGui_ImplVulkan_Shutdown();
-    #if defined HLGL_WINDOW_LIBRARY_GLFW
-      ImGui_ImplGlfw_Shutdown();
-    #elif defined HLGL_WINDOW_LIBRARY_NATIVE_WIN32
-      ImGui_ImplWin32_Shutdown();
-    #endif
+    if (!headless_s) {
+      #if defined HLGL_WINDOW_LIBRARY_GLFW
+        ImGui_ImplGlfw_Shutdown();
+      #elif defined HLGL_WINDOW_LIBRARY_NATIVE_WIN32
+        ImGui_ImplWin32_Shutdown();
+      #endif
+    }
     ImGui::DestroyContext();
 
     defaultTextureNull_s.reset();
     defaultTextureWhite_s.reset();
     defaultTextureGray_s.reset();
     defaultTextureBlack_s.reset();
-    stagingBuffer_s.reset();   
+    shutdownBuiltinPipelines();
+    shutdownDepthPyramids();
+    for (std::optional<Buffer>& stagingBuffer : stagingBuffers_s) {
+      stagingBuffer.reset();
+    }
+    shutdownQueryPools();
+    shutdownReadbacks();
+    shutdownVirtualTextures();
+    shutdownStreaming();
+    shutdownResidency();
 
     if (pipeLayout_s) vkDestroyPipelineLayout(device_s, pipeLayout_s, nullptr); pipeLayout_s = nullptr;
     if (descPool_s) vkDestroyDescriptorPool(device_s, descPool_s, nullptr); descPool_s = nullptr;
@@ -1497,6 +1761,9 @@ void hlgl::shutdownContext() {
       if (layout) vkDestroyDescriptorSetLayout(device_s, layout, nullptr); layout = nullptr;
     }
     
+    shutdownProfiler();
+    shutdownAsyncCompute();
+    if (frameTimeline_s) { vkDestroySemaphore(device_s, frameTimeline_s, nullptr); frameTimeline_s = nullptr; }
     for (size_t i {0}; i < numFramesInFlight_c; ++i) {
       if (frameFences_s[i]) { vkDestroyFence(device_s, frameFences_s[i], nullptr); frameFences_s[i] = nullptr; }
       if (acquireSemaphores_s[i]) { vkDestroySemaphore(device_s, acquireSemaphores_s[i], nullptr); acquireSemaphores_s[i] = nullptr; }
@@ -1518,10 +1785,16 @@ void hlgl::shutdownContext() {
 
     submitSemaphores_s.clear();
     swapchainImages_s.clear();
+    for (std::optional<Texture>& target : headlessTargets_s)
+      target.reset();
     // The swapchain textures have been added to the deletion queue after we already flushed it, so flush it again here.
     flushAllDelQueues();
+    destroyMemoryPriorityPools();
     if (swapchain_s) { vkDestroySwapchainKHR(device_s, swapchain_s, nullptr); swapchain_s = nullptr; }
     if (allocator_s) { vmaDestroyAllocator(allocator_s); allocator_s = nullptr; }
+    memoryBudgetEnabled_s = false;
+    memoryPriorityEnabled_s = false;
+    pageableMemoryEnabled_s = false;
     vkDestroyDevice(device_s, nullptr); device_s = nullptr;
     physicalDevice_s = nullptr;
   }
@@ -1536,6 +1809,14 @@ const hlgl::GpuProperties& hlgl::getGpuProperties() {
   return gpu_s;
 }
 
+int64_t hlgl::getFrameCounter() {
+  return (int64_t)frameCounter_s;
+}
+
+float hlgl::getGpuFrameTime() {
+  return getProfilerFrameTime();
+}
+
 float hlgl::getDisplayAspectRatio() {
   return static_cast<float>(displayWidth_s) / std::max<float>(1.0f, static_cast<float>(displayHeight_s));
 }
@@ -1559,7 +1840,11 @@ void hlgl::setVsync(VsyncMode mode) {
 }
 
 void hlgl::setHdr(bool val) {
-  hdr_s = val;
+  hdr_s = val && !headless_s;
+}
+
+bool hlgl::isHeadless() {
+  return headless_s;
 }
 
 bool hlgl::isDepthFormatSupported(ImageFormat format) {
@@ -1568,17 +1853,35 @@ bool hlgl::isDepthFormatSupported(ImageFormat format) {
   return (formatProperties.formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
 }
 
+bool hlgl::isTextureFormatSupported(ImageFormat format) {
+  return (getFormatFeatures(translate(format)) & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+}
+
+VkFormatFeatureFlags hlgl::getFormatFeatures(VkFormat format) {
+  VkFormatProperties2 formatProperties {.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2 };
+  vkGetPhysicalDeviceFormatProperties2(physicalDevice_s, format, &formatProperties);
+  return formatProperties.formatProperties.optimalTilingFeatures;
+}
+
 void hlgl::imguiNewFrame() {
   ImGui_ImplVulkan_NewFrame();
+  if (headless_s) {
+    ImGuiIO& io {ImGui::GetIO()};
+    io.DisplaySize = ImVec2((float)displayWidth_s, (float)displayHeight_s);
+    io.DeltaTime = 1.0f / 60.0f;
+  }
+  else {
 #if defined HLGL_WINDOW_LIBRARY_GLFW
-  ImGui_ImplGlfw_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
 #elif defined HLGL_WINDOW_LIBRARY_NATIVE_WIN32
-  ImGui_ImplWin32_NewFrame();
+    ImGui_ImplWin32_NewFrame();
 #endif
+  }
   ImGui::NewFrame();
 }
 
 hlgl::Result hlgl::beginFrame() {
+  HLGL_TRACE_SCOPE("beginFrame");
   if (inFrame_s) {
     DEBUG_ERROR("Can't begin a new frame while an existing frame is active.");
     return Result::SkipFrame;
@@ -1594,12 +1897,28 @@ hlgl::Result hlgl::beginFrame() {
   frame_s.acquireSemaphore = acquireSemaphores_s[frameIndex_s];
 
   // Block until the previous commands sent to this frame are finished.
-  if (!VKCHECK(vkWaitForFences(device_s, 1, &frame_s.fence, true, UINT64_MAX))) {
-    return Result::Shutdown;
+  {
+    HLGL_TRACE_SCOPE("Wait for frame fence");
+    if (!VKCHECK(vkWaitForFences(device_s, 1, &frame_s.fence, true, UINT64_MAX))) {
+      return Result::Shutdown;
+    }
   }
+  // Compute work isn't covered by the fence, so it's waited on separately before anything from this frame is reused or deleted.
+  beginAsyncComputeFrame(&frame_s);
   
+  // Headless targets are resized whenever 'setDisplaySize' has changed the display size.
+  if (headless_s) {
+    if (displayWidth_s == 0 || displayHeight_s == 0)
+      return Result::SkipFrame;
+    if (displayWidth_s != swapchainExtent_s.width || displayHeight_s != swapchainExtent_s.height) {
+      HLGL_TRACE_SCOPE("Rebuild headless targets");
+      if (!buildHeadlessTargets())
+        return Result::Shutdown;
+      subjectDisplayResized_s.execute(swapchainExtent_s.width, swapchainExtent_s.height);
+    }
+  }
   // Resize the swapchain if neccessary.  This may abort the current frame, returning nullptr.
-  {
+  else {
     VkExtent2D checkExtent;
     VkSurfaceCapabilitiesKHR caps;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice_s, surface_s, &caps);
@@ -1624,6 +1943,7 @@ hlgl::Result hlgl::beginFrame() {
 
       // Recreate the swapchain.
       // If this returns false, either a fatal error has occured or the window was running on another thread and has been closed.
+      HLGL_TRACE_SCOPE("Rebuild swapchain");
       if (!buildSwapchain()) {
         return Result::Shutdown;
       }
@@ -1645,8 +1965,13 @@ hlgl::Result hlgl::beginFrame() {
   if (!VKCHECK(vkResetFences(device_s, 1, &frame_s.fence)))
     return Result::Shutdown;
 
-  // Get the next image index.
-  {
+  // Get the next image index.  Headless frames just use the target belonging to this frame in flight.
+  if (headless_s) {
+    frame_s.submitSemaphore = nullptr;
+    frame_s.swapchainImage = &*headlessTargets_s[frameIndex_s];
+  }
+  else {
+    HLGL_TRACE_SCOPE("Acquire swapchain image");
     VkResult result;
     if (!VKCHECK_SWAPCHAIN(result = vkAcquireNextImageKHR(device_s, swapchain_s, UINT64_MAX, acquireSemaphores_s[frameIndex_s], nullptr, &swapchainIndex_s)))
       return Result::Shutdown;
@@ -1654,11 +1979,10 @@ hlgl::Result hlgl::beginFrame() {
       swapchainNeedsRebuild_s = true;
       return Result::SkipFrame;
     }
+    frame_s.submitSemaphore = submitSemaphores_s[swapchainIndex_s];
+    frame_s.swapchainImage = &swapchainImages_s[swapchainIndex_s];
   }
 
-  frame_s.submitSemaphore = submitSemaphores_s[swapchainIndex_s];
-  frame_s.swapchainImage = &swapchainImages_s[swapchainIndex_s];
-
   // Reset this frame's command buffer from its previous usage.
   if (!VKCHECK(vkResetCommandBuffer(frame_s.cmd, 0)))
     return Result::Shutdown;
@@ -1666,6 +1990,9 @@ hlgl::Result hlgl::beginFrame() {
   // Delete any objects that were destroyed on this frame after the command buffer's been reset.
   flushDelQueue();
 
+  // The GPU is done with anything staged the last time this frame index was used.
+  stagingOffsets_s[frameIndex_s] = 0;
+
   // Begin recording commands.
   VkCommandBufferBeginInfo info { .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
   if (!VKCHECK(vkBeginCommandBuffer(frame_s.cmd, &info)))
@@ -1673,6 +2000,7 @@ hlgl::Result hlgl::beginFrame() {
   
   // Submit the transfer queue.
   if (transferPendingSemaphores_s.size() > 0) {
+    HLGL_TRACE_SCOPE("Submit transfers");
     // End the transfer command buffer.
     vkEndCommandBuffer(cmdTransfer_s);
     VkPipelineStageFlags waitStages {VK_PIPELINE_STAGE_TRANSFER_BIT};
@@ -1705,21 +2033,40 @@ hlgl::Result hlgl::beginFrame() {
   frame_s.frameCounter = frameCounter_s;
   frame_s.frameIndex = frameIndex_s;
   frame_s.inDrawingPass = false;
+  frame_s.inAsyncCompute = false;
 
   vkCmdBindDescriptorSets(frame_s.cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeLayout_s, 0, NUM_DESCRIPTOR_SETS, descSets_s.data(), 0, nullptr);
   vkCmdBindDescriptorSets(frame_s.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeLayout_s, 0, NUM_DESCRIPTOR_SETS, descSets_s.data(), 0, nullptr);
 
+  // The last frame to use this frame index has finished, so its timestamps can be read without waiting.
+  beginProfilerFrame(&frame_s);
+
+  // Keep GPU memory usage within budget before any of this frame's work is recorded.
+  HLGL_TRACE_SCOPE("Update resources");
+  updateResidency(&frame_s);
+  updateStreaming(&frame_s);
+  updateVirtualTextures(&frame_s);
+  updateQueryPools(&frame_s);
+  updateReadbacks(&frame_s);
+  updateDynamicResolution(getProfilerFrameTime());
+
   inFrame_s = true;
   return Result::Success;
 }
 
 void hlgl::endFrame() {
+  HLGL_TRACE_SCOPE("endFrame");
   if (!inFrame_s) {
     DEBUG_ERROR("Trying to end a frame before beginning one.");
     return;
   }
   Frame* frame = getCurrentFrame();
 
+  if (frame->inAsyncCompute) {
+    DEBUG_ERROR("Async compute section wasn't ended before 'endFrame'.");
+    endAsyncCompute();
+  }
+
   // If we started a draw pass, end it here.
   endDrawing();
 
@@ -1730,31 +2077,35 @@ void hlgl::endFrame() {
     ImGui_ImplVulkan_RenderDrawData(drawData, frame->cmd, nullptr);
   endDrawing();
 
-  // Transition the swapchain texture to a presentable state.
-  frame->swapchainImage->_pimpl->barrier(frame->cmd,
-    VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-    VK_ACCESS_NONE,
-    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+  // Transition the swapchain texture to a presentable state.  Headless targets are left as they are, ready to be blitted or read back next frame.
+  if (!headless_s) {
+    frame->swapchainImage->_pimpl->barrier(frame->cmd,
+      VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+      VK_ACCESS_NONE,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+  }
+
+  endProfilerFrame(frame);
 
-  // End the command buffer.
-  vkEndCommandBuffer(frame->cmd);
   inFrame_s = false;
 
-  // Submit the command buffer to the graphics queue.
-  VkPipelineStageFlags waitStages {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  VkSubmitInfo si {
-    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-    .waitSemaphoreCount = 1,
-    .pWaitSemaphores = &frame->acquireSemaphore,
-    .pWaitDstStageMask = &waitStages,
-    .commandBufferCount = 1,
-    .pCommandBuffers = &frame->cmd,
-    .signalSemaphoreCount = 1,
-    .pSignalSemaphores = &frame->submitSemaphore };
-  if (!VKCHECK(vkQueueSubmit(graphicsQueue_s, 1, &si, frame->fence)))
-    return;
+  // End the frame's command buffers and submit them to the graphics queue, along with any async compute work.
+  {
+    HLGL_TRACE_SCOPE("Submit frame");
+    // Headless frames have no swapchain image to wait on or hand over to presentation.
+    if (!submitFrameCommands(frame,
+      headless_s ? nullptr : frame->acquireSemaphore,
+      headless_s ? nullptr : frame->submitSemaphore,
+      frameTimeline_s, frameCounter_s))
+    {
+      return;
+    }
+  }
 
   // Present the image to the screen.
+  if (headless_s)
+    return;
+  HLGL_TRACE_SCOPE("Present");
   VkPresentInfoKHR pi {
     .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
     .waitSemaphoreCount = 1,
@@ -1774,14 +2125,17 @@ void hlgl::endFrame() {
 VkDevice hlgl::getDevice() { return device_s; }
 VmaAllocator hlgl::getAllocator() { return allocator_s; }
 const VkPhysicalDeviceProperties& hlgl::getDeviceProperties() { return physicalDeviceProperties_s; }
+const VkPhysicalDeviceFeatures& hlgl::getEnabledDeviceFeatures() { return enabledDeviceFeatures_s; }
 
 hlgl::Frame* hlgl::getCurrentFrame() { return (inFrame_s) ? &frame_s : nullptr; }
 
 VkQueue hlgl::getGraphicsQueue() { return graphicsQueue_s; }
 VkQueue hlgl::getPresentQueue() { return presentQueue_s; }
+VkQueue hlgl::getComputeQueue() { return computeQueue_s; }
 
 const std::array<VkDescriptorSetLayout,3>& hlgl::getDescSetLayouts() { return descLayouts_s; }
 VkDescriptorSet hlgl::getDescriptorSet(uint32_t set) { return descSets_s[set]; }
+const VkDescriptorSet* hlgl::getDescriptorSets() { return descSets_s.data(); }
 
 uint32_t hlgl::allocDescriptorIndex(uint32_t set) {
   if (descFreeIndices_s[set].size() > 0) {
@@ -1819,6 +2173,7 @@ VkCommandBuffer hlgl::beginImmediateCmd() {
 }
 
 void hlgl::submitImmediateCmd(VkCommandBuffer cmd) {
+  HLGL_TRACE_SCOPE("Submit immediate commands");
   vkEndCommandBuffer(cmd);
   VkSubmitInfo si {
     .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
@@ -1829,75 +2184,70 @@ void hlgl::submitImmediateCmd(VkCommandBuffer cmd) {
   vkFreeCommandBuffers(device_s, cmdPoolGraphics_s, 1, &cmd);
 }
 
-void hlgl::queueDeletion(DelQueueItem item) {
-  delQueues_s.back().push_back(item);
-}
+void hlgl::queueDeletion(const DelQueueBuffer& item)     { currentDelQueueBin().buffers.push_back(item); }
+void hlgl::queueDeletion(const DelQueueTexture& item)    { currentDelQueueBin().textures.push_back(item); }
+void hlgl::queueDeletion(const DelQueuePipeline& item)   { currentDelQueueBin().pipelines.push_back(item); }
+void hlgl::queueDeletion(const DelQueueDescriptor& item) { currentDelQueueBin().descriptors.push_back(item); }
+void hlgl::queueDeletion(const DelQueueQueryPool& item)  { currentDelQueueBin().queryPools.push_back(item); }
 
 void hlgl::flushDelQueue() {
-
-  for (auto& varItem : delQueues_s.front()) {
-    if (std::holds_alternative<DelQueueBuffer>(varItem)) {
-      auto item = std::get<DelQueueBuffer>(varItem);
-      if (item.allocation && item.buffer) vmaDestroyBuffer(allocator_s, item.buffer, item.allocation);
-    }
-    else if (std::holds_alternative<DelQueueTexture>(varItem)) {
-      auto item = std::get<DelQueueTexture>(varItem);
-      if (item.view) vkDestroyImageView(device_s, item.view, nullptr);
-      if (item.sampler) vkDestroySampler(device_s, item.sampler, nullptr);
-      if (item.allocation && item.image) vmaDestroyImage(allocator_s, item.image, item.allocation);
-    }
-    else if (std::holds_alternative<DelQueuePipeline>(varItem)) {
-      auto item = std::get<DelQueuePipeline>(varItem);
-      if (item.pipeline) vkDestroyPipeline(device_s, item.pipeline, nullptr);
-      if (item.layout) vkDestroyPipelineLayout(device_s, item.layout, nullptr);
-    }
-    else if (std::holds_alternative<DelQueueDescriptor>(varItem)) {
-      auto item = std::get<DelQueueDescriptor>(varItem);
-      descFreeIndices_s[item.set].push_back(item.index);
-    }
-  }
-  for (size_t i {0}; (i+1) < numDelQueues_c; ++i) {
-    delQueues_s[i] = std::move(delQueues_s[i+1]);
+  // Bins are in the order they were queued into, so they're retired from the front until one the GPU might still be using.
+  uint64_t completedFrame {0};
+  if (!VKCHECK(vkGetSemaphoreCounterValue(device_s, frameTimeline_s, &completedFrame)))
+    return;
+  size_t count {0};
+  while (count < delQueues_s.size() &&
+         delQueues_s[count].frameValue <= completedFrame &&
+         isAsyncComputeComplete(delQueues_s[count].computeValue))
+  {
+    ++count;
   }
-  delQueues_s.back() = {};
+  retireDelQueueBins(count);
 }
 
 void hlgl::flushAllDelQueues() {
-  for (size_t i {0}; i < numDelQueues_c; ++i) {
-    flushDelQueue();
-  }
+  retireDelQueueBins(delQueues_s.size());
 }
 
 void hlgl::observeDisplayResize(Observer<uint32_t,uint32_t>* observer, std::function<void(uint32_t,uint32_t)> callback) {
   subjectDisplayResized_s.attach(observer, callback);
 }
 
-void hlgl::transferToStagingBuffer(const void* srcMem, size_t srcOffset, size_t size) {
-  // We can re-use the same staging buffer for multiple transfers in a single frame, as long as the memory regions don't overlap.
-  if (stagingBufferLastFrameUsed_s != frameCounter_s) {
-    stagingBufferOffset_s = 0;
-    stagingBufferLastFrameUsed_s = frameCounter_s;
-  }
-  else {
-    // Round the offset up to the nearest multiple of 16 bytes.  This alignment is required for some copy operations.
-    stagingBufferOffset_s = (stagingBufferOffset_s + 15) & ~15;
-  }
+hlgl::StagingAlloc hlgl::allocStaging(DeviceSize size) {
+  // Staging space is handed out from the current frame's buffer (or the most recent frame's buffer between frames).
+  // Round the offset up to the nearest multiple of 16 bytes.  This alignment is required for some copy operations.
+  std::optional<Buffer>& stagingBuffer {stagingBuffers_s[frameIndex_s]};
+  DeviceSize& offset {stagingOffsets_s[frameIndex_s]};
+  offset = (offset + 15) & ~DeviceSize{15};
+
   // If we run out of space, destroy the existing staging buffer and create a new, bigger one.
   // the underlying VkBuffer is put into a queue and destroyed on a later frame, so this wont break any active/pending transfers.
-  if (stagingBufferOffset_s + size > stagingBuffer_s->getSize()) {
-    DeviceSize buffSize {stagingBuffer_s->getSize()};
+  if (offset + size > stagingBuffer->getSize()) {
+    DeviceSize buffSize {stagingBuffer->getSize()};
     do { buffSize *= 2; } while (buffSize < size);
-    stagingBuffer_s.reset();
-    stagingBuffer_s.emplace(Buffer::CreateParams{
+    stagingBuffer.reset();
+    stagingBuffer.emplace(Buffer::CreateParams{
       .usage = BufferUsage::TransferSrc | BufferUsage::HostVisible,
-      .size = buffSize });
-    stagingBufferOffset_s = 0;
+      .size = buffSize,
+      .debugName = "stagingBuffer" });
+    offset = 0;
+    if (!stagingBuffer->isValid()) {
+      DEBUG_ERROR("Failed to grow the staging buffer to %llu bytes.", (unsigned long long)buffSize);
+      stagingBuffer.reset();
+      return {};
+    }
   }
-  // Once offsets and sizes are checked, a regular mem-to-buffer transfer copies the data into place.
-  transfer(stagingBuffer_s->_pimpl.get(), stagingBufferOffset_s, srcMem, srcOffset, size, false);
+
+  StagingAlloc result {
+    .buffer = stagingBuffer->_pimpl.get(),
+    .offset = offset,
+    .ptr = (uint8_t*)stagingBuffer->_pimpl->allocInfo[0].pMappedData + offset };
+  offset += size;
+  return result;
 }
 
 void hlgl::transfer(BufferImpl* dstBuffer, DeviceSize dstOffset, const void* srcMem, size_t srcOffset, size_t size, bool useTransferQueue) {
+  HLGL_TRACE_SCOPE("Transfer");
   if (!dstBuffer) {
     DEBUG_ERROR("Invalid dstBuffer for 'transfer'.");
     return;
@@ -1920,13 +2270,15 @@ void hlgl::transfer(BufferImpl* dstBuffer, DeviceSize dstOffset, const void* src
   }
   // If dstBuffer is NOT hostVisible, then we'll have to use the staging buffer as a go-between.
   else {
-    transferToStagingBuffer(srcMem, srcOffset, size);
-    transfer(dstBuffer, dstOffset, stagingBuffer_s->_pimpl.get(), stagingBufferOffset_s, size, useTransferQueue);
-    stagingBufferOffset_s += size;
+    StagingAlloc staging {allocStaging(size)};
+    if (!staging.ptr) return;
+    memcpy(staging.ptr, (uint8_t*)(srcMem) + srcOffset, size);
+    transfer(dstBuffer, dstOffset, staging.buffer, staging.offset, size, useTransferQueue);
   }
 }
 
 void hlgl::transfer(BufferImpl* dstBuffer, DeviceSize dstOffset, BufferImpl* srcBuffer, DeviceSize srcOffset, DeviceSize size, bool useTransferQueue) {
+  HLGL_TRACE_SCOPE("Transfer");
   if (!dstBuffer) {
     DEBUG_ERROR("Invalid dstBuffer for 'transfer'.");
     return;
@@ -1954,13 +2306,16 @@ void hlgl::transfer(BufferImpl* dstBuffer, DeviceSize dstOffset, BufferImpl* src
 }
 
 void hlgl::transfer(TextureImpl* dstTexture, const void* srcMem, size_t srcSize, size_t numRegions, VkBufferImageCopy* regions, bool useTransferQueue) {
+  HLGL_TRACE_SCOPE("Transfer");
   // Images are always created using TILING_OPTIMAL, so we can never memcpy directly into them.  The staging buffer is mandatory.
-  transferToStagingBuffer(srcMem, 0, srcSize);
-  transfer(dstTexture, stagingBuffer_s->_pimpl.get(), stagingBufferOffset_s, numRegions, regions, useTransferQueue);
-  stagingBufferOffset_s += srcSize;
+  StagingAlloc staging {allocStaging(srcSize)};
+  if (!staging.ptr) return;
+  memcpy(staging.ptr, srcMem, srcSize);
+  transfer(dstTexture, staging.buffer, staging.offset, numRegions, regions, useTransferQueue);
 }
 
 void hlgl::transfer(TextureImpl* dstTexture, BufferImpl* srcBuffer, DeviceSize srcOffset, size_t numRegions, VkBufferImageCopy* regions, bool useTransferQueue) {
+  HLGL_TRACE_SCOPE("Transfer");
   if (!dstTexture) {
     DEBUG_ERROR("Invalid dstTexture for 'transfer'.");
     return;
@@ -3,7 +3,6 @@
 
 #include <hlgl.h>
 #include "vulkan-headers.h"
-#include <variant>
 #include "../utils/observer.h"
 
 namespace hlgl {
@@ -15,9 +14,14 @@ constexpr uint32_t NUM_DESCRIPTOR_SETS              {3};
 
 constexpr uint32_t DESCRIPTOR_COUNTS[] {1000, 20000, 1000};
 
+// Per-frame resources are kept in arrays of this size, indexed by 'Frame::frameIndex'.
+constexpr size_t numFramesInFlight_c {2};
+
 VkDevice getDevice();
 VmaAllocator getAllocator();
 const VkPhysicalDeviceProperties& getDeviceProperties();
+VkFormatFeatureFlags getFormatFeatures(VkFormat format);  // Features supported by the format with optimal tiling.
+const VkPhysicalDeviceFeatures& getEnabledDeviceFeatures();
 
 Frame* getCurrentFrame();
 
@@ -28,6 +32,7 @@ VkQueue getTransferQueue();
 
 const std::array<VkDescriptorSetLayout,3>& getDescSetLayouts();
 VkDescriptorSet getDescriptorSet(uint32_t set);
+const VkDescriptorSet* getDescriptorSets();
 uint32_t allocDescriptorIndex(uint32_t set);
 VkPipelineLayout getPipelineLayout();
 
@@ -43,11 +48,16 @@ struct DelQueueBuffer {VkBuffer buffer; VmaAllocation allocation;};
 struct DelQueueTexture {VkImage image; VkImageView view; VkSampler sampler; VmaAllocation allocation;};
 struct DelQueuePipeline {VkPipeline pipeline; VkPipelineLayout layout;};
 struct DelQueueDescriptor {uint32_t set; uint32_t index;};
-using DelQueueItem = std::variant<DelQueueBuffer, DelQueueTexture, DelQueuePipeline, DelQueueDescriptor>;
+struct DelQueueQueryPool {VkQueryPool pool;};
 
 // Push an item to the queue so it can be deleted at a later frame, after it is no longer in use.
-void queueDeletion(DelQueueItem item);
-// Delete all the items which ought to be deleted on the current frame.
+// Items are stored by type in preallocated per-frame bins, so queueing a deletion doesn't normally allocate.
+void queueDeletion(const DelQueueBuffer& item);
+void queueDeletion(const DelQueueTexture& item);
+void queueDeletion(const DelQueuePipeline& item);
+void queueDeletion(const DelQueueDescriptor& item);
+void queueDeletion(const DelQueueQueryPool& item);
+// Delete all the items which were queued on frames that can no longer be in use by the GPU.
 void flushDelQueue();
 // Delete all items that have been queued for deletion, no matter which frame.
 void flushAllDelQueues();
@@ -57,8 +67,15 @@ void observeDisplayResize(Observer<uint32_t,uint32_t>* observer, std::function<v
 
 
 
-// Copies data from memory into the dedicated staging buffer so it can be forwarded onto another destination.
-void transferToStagingBuffer(const void* srcMem, size_t srcOffset, size_t size);
+// A region of the staging buffer which can be written to directly, then copied onto another destination by the GPU.
+struct StagingAlloc {
+  BufferImpl* buffer {nullptr};
+  DeviceSize offset {0};
+  void* ptr {nullptr};
+};
+// Reserves 'size' bytes of staging memory.  The region remains valid until the commands of the current frame (if any) have finished executing.
+// Returns a StagingAlloc with a null 'ptr' if the staging buffer couldn't be grown to fit.
+StagingAlloc allocStaging(DeviceSize size);
 void transfer(BufferImpl* dstBuffer, DeviceSize dstOffset, const void* srcMem, size_t srcOffset, size_t size, bool useTransferQueue);               // Copies data from memory into a buffer.
 void transfer(BufferImpl* dstBuffer, DeviceSize dstOffset, BufferImpl* srcBuffer, DeviceSize srcOffset, DeviceSize size, bool useTransferQueue);    // Copies data from one buffer into another buffer.
 void transfer(TextureImpl* dstTexture, const void* srcMem, size_t srcSize, size_t numRegions, VkBufferImageCopy* regions, bool useTransferQueue);   // Copies data from memory into an image.
@@ -0,0 +1,124 @@
+#include "builtin-pipelines.h"
+#include "buffer.h"
+#include "context.h"
+#include "frame.h"
+#include "texture.h"
+
+#include <algorithm>
+
+namespace {
+
+  constexpr uint32_t cullGroupSize_c {64};
+
+  // Matches the flags in the builtin cull shader.
+  constexpr uint32_t cullOcclusion_c {1};
+  constexpr uint32_t cullReverseZ_c {2};
+
+} // namespace
+
+static_assert(sizeof(hlgl::CullInstance) == 48, "CullInstance must match the layout of the builtin cull shader.");
+static_assert(sizeof(hlgl::MeshLod) == 16, "MeshLod must match the layout of the builtin cull shader.");
+
+void hlgl::cullDraws(CullParams params) {
+  Frame* frame {getCurrentFrame()};
+  if (!frame) {
+    DEBUG_ERROR("Can't call 'cullDraws' outside of a frame.");
+    return;
+  }
+  // The draws are made ready for indirect reads right away, which the compute queue can't wait on.
+  if (frame->inAsyncCompute) {
+    DEBUG_ERROR("Can't call 'cullDraws' inside an async compute section.");
+    return;
+  }
+  if (!params.instances || !params.instances->isValid() || !params.drawBuffer || !params.drawBuffer->isValid() ||
+      !params.countBuffer || !params.countBuffer->isValid() || !params.viewProj)
+  {
+    DEBUG_ERROR("'cullDraws' needs valid instance, draw and count buffers, and a view-projection matrix.");
+    return;
+  }
+
+  BufferImpl* instances {params.instances->_pimpl.get()};
+  BufferImpl* draws {params.drawBuffer->_pimpl.get()};
+  BufferImpl* count {params.countBuffer->_pimpl.get()};
+  const uint32_t instancesIndex {instances->fifSynced ? frame->frameIndex : 0};
+  const uint32_t drawsIndex {draws->fifSynced ? frame->frameIndex : 0};
+  const uint32_t countIndex {count->fifSynced ? frame->frameIndex : 0};
+  const DeviceAddress instancesAddress {instances->deviceAddress[instancesIndex]};
+  const DeviceAddress drawsAddress {draws->deviceAddress[drawsIndex]};
+  const DeviceAddress countAddress {count->deviceAddress[countIndex]};
+  if (!instancesAddress || !drawsAddress || !countAddress) {
+    DEBUG_ERROR("The buffers used by 'cullDraws' need the DeviceAddressable usage.");
+    return;
+  }
+  if (params.instanceCount * sizeof(CullInstance) > instances->size ||
+      params.drawOffset + params.instanceCount * sizeof(DrawIndexedIndirectEntry) > draws->size ||
+      params.countOffset + sizeof(uint32_t) > count->size)
+  {
+    DEBUG_ERROR("The buffers used by 'cullDraws' are too small for %u instances.", params.instanceCount);
+    return;
+  }
+
+  // Level of detail selection is skipped entirely without a buffer of levels to choose from.
+  DeviceAddress lodsAddress {0};
+  BufferImpl* lods {(params.lods && params.lods->isValid()) ? params.lods->_pimpl.get() : nullptr};
+  if (lods && params.lodScale > 0.0f) {
+    lodsAddress = lods->deviceAddress[lods->fifSynced ? frame->frameIndex : 0];
+    if (!lodsAddress) {
+      DEBUG_WARNING("The level of detail buffer given to 'cullDraws' needs the DeviceAddressable usage, level of detail selection is disabled.");
+      lods = nullptr;
+    }
+  }
+  else {
+    lods = nullptr;
+  }
+
+  TextureImpl* hiZ {(params.hiZ && params.hiZ->isValid()) ? params.hiZ->_pimpl.get() : nullptr};
+  if (hiZ && !(hiZ->usage & VK_IMAGE_USAGE_SAMPLED_BIT)) {
+    DEBUG_WARNING("The Hi-Z texture given to 'cullDraws' can't be sampled, occlusion culling is disabled.");
+    hiZ = nullptr;
+  }
+
+  endDrawing();
+
+  count->barrier(frame->cmd, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, countIndex);
+  vkCmdFillBuffer(frame->cmd, count->buffer[countIndex], params.countOffset, sizeof(uint32_t), 0);
+
+  instances->barrier(frame->cmd, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, instancesIndex);
+  if (lods)
+    lods->barrier(frame->cmd, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, lods->fifSynced ? frame->frameIndex : 0);
+  draws->barrier(frame->cmd, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, drawsIndex);
+  count->barrier(frame->cmd, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, countIndex);
+  if (hiZ) {
+    hiZ->barrier(frame->cmd, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    hiZ->lastUsedFrame = (uint64_t)std::max<int64_t>(0, frame->frameCounter);
+  }
+
+  struct {
+    float viewProj[16];
+    DeviceAddress instances, draws, count, lods;
+    uint32_t instanceCount;
+    uint32_t hiZ;
+    uint32_t hiZWidth, hiZHeight;
+    uint32_t hiZMips;
+    uint32_t flags;
+    float lodScale;
+    float lodThreshold;
+  } constants {
+    {},
+    instancesAddress, drawsAddress + params.drawOffset, countAddress + params.countOffset, lodsAddress,
+    params.instanceCount,
+    hiZ ? hiZ->descIndexImageSampler : 0,
+    hiZ ? hiZ->extent.width : 1, hiZ ? hiZ->extent.height : 1,
+    hiZ ? hiZ->mipCount : 1,
+    (hiZ ? cullOcclusion_c : 0) | (params.reverseZ ? cullReverseZ_c : 0),
+    lods ? params.lodScale : 0.0f,
+    params.lodThreshold };
+  static_assert(sizeof(constants) <= 128, "cullDraws' push constants must fit in the guaranteed 128 bytes.");
+  std::copy(params.viewProj, params.viewProj + 16, constants.viewProj);
+
+  if (params.instanceCount)
+    dispatchBuiltin(frame->cmd, BuiltinPipeline::Cull, &constants, sizeof(constants), (params.instanceCount + cullGroupSize_c - 1) / cullGroupSize_c, 1, 1);
+
+  draws->barrier(frame->cmd, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, drawsIndex);
+  count->barrier(frame->cmd, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, countIndex);
+}
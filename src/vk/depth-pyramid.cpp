@@ -0,0 +1,236 @@
+#include "depth-pyramid.h"
+#include "builtin-pipelines.h"
+#include "context.h"
+#include "frame.h"
+#include "texture.h"
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+  // A view of each mip level, each with a combined descriptor using a reduction sampler, and a storage descriptor if the texture is the pyramid.
+  // They're kept until the texture is destroyed, and remade when its image is replaced.
+  struct LevelViews {
+    VkImage image {nullptr};
+    uint32_t mipCount {0};
+    hlgl::FilterMode reduction {hlgl::FilterMode::Max};
+    bool storage {false};
+    std::vector<VkImageView> views {};
+    std::vector<uint32_t> sampled {};
+    std::vector<uint32_t> storages {};
+  };
+
+  std::unordered_map<const hlgl::TextureImpl*, LevelViews> levelViews_s {};
+  std::array<VkSampler, 2> reductionSamplers_s {}; // Min, Max.
+
+  VkExtent3D mipExtent(VkExtent3D extent, uint32_t mip) {
+    return VkExtent3D{std::max(1u, extent.width >> mip), std::max(1u, extent.height >> mip), 1};
+  }
+
+  void release(LevelViews& levels) {
+    using namespace hlgl;
+    for (VkImageView view : levels.views) {
+      if (view)
+        queueDeletion(DelQueueTexture{.image = nullptr, .view = view, .sampler = nullptr, .allocation = nullptr});
+    }
+    for (uint32_t index : levels.sampled) {
+      if (index)
+        queueDeletion(DelQueueDescriptor{.set = DESC_TYPE_COMBINED_IMAGE_SAMPLER, .index = index});
+    }
+    for (uint32_t index : levels.storages) {
+      if (index)
+        queueDeletion(DelQueueDescriptor{.set = DESC_TYPE_STORAGE_IMAGE, .index = index});
+    }
+    levels = LevelViews{};
+  }
+
+  VkSampler getReductionSampler(hlgl::FilterMode reduction) {
+    using namespace hlgl;
+    VkSampler& sampler {reductionSamplers_s[(reduction == FilterMode::Min) ? 0 : 1]};
+    if (!sampler) {
+      VkSamplerReductionModeCreateInfo rci {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO,
+        .reductionMode = translateReduction(reduction) };
+      VkSamplerCreateInfo sci {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = &rci,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .maxLod = 0.0f };
+      if (!VKCHECK(vkCreateSampler(getDevice(), &sci, nullptr, &sampler)) || !sampler) {
+        DEBUG_ERROR("Failed to create depth pyramid reduction sampler.");
+        sampler = nullptr;
+      }
+    }
+    return sampler;
+  }
+
+  // Gets the views of the first 'mipCount' levels of 'texture', making them if they don't exist yet or are out of date.
+  const LevelViews* getLevelViews(hlgl::TextureImpl* texture, uint32_t mipCount, hlgl::FilterMode reduction, bool storage) {
+    using namespace hlgl;
+    LevelViews& levels {levelViews_s[texture]};
+    if (levels.image == texture->image && levels.mipCount == mipCount && levels.reduction == reduction && levels.storage == storage)
+      return &levels;
+    release(levels);
+
+    VkSampler sampler {getReductionSampler(reduction)};
+    if (!sampler)
+      return nullptr;
+
+    // Depth-stencil formats can only be sampled through a view of their depth aspect.
+    VkImageAspectFlags aspect {translateAspect(texture->format)};
+    if (aspect & VK_IMAGE_ASPECT_DEPTH_BIT)
+      aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+    levels.image = texture->image;
+    levels.mipCount = mipCount;
+    levels.reduction = reduction;
+    levels.storage = storage;
+    levels.views.resize(mipCount, nullptr);
+    levels.sampled.resize(mipCount, 0);
+    levels.storages.resize(storage ? mipCount : 0, 0);
+    for (uint32_t mip {0}; mip < mipCount; ++mip) {
+      VkImageViewCreateInfo vci {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = texture->image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = texture->format,
+        .subresourceRange = {.aspectMask = aspect, .baseMipLevel = mip, .levelCount = 1, .baseArrayLayer = texture->layerBase, .layerCount = 1} };
+      if (!VKCHECK(vkCreateImageView(getDevice(), &vci, nullptr, &levels.views[mip])) || !levels.views[mip]) {
+        DEBUG_ERROR("Failed to create depth pyramid view for '%s'.", texture->debugName.c_str());
+        levels.views[mip] = nullptr;
+        release(levels);
+        return nullptr;
+      }
+
+      // Pyramid levels are read while the image is in GENERAL layout, since the next level is being written.
+      levels.sampled[mip] = allocDescriptorIndex(DESC_TYPE_COMBINED_IMAGE_SAMPLER);
+      VkDescriptorImageInfo sampledInfo {
+        .sampler = sampler,
+        .imageView = levels.views[mip],
+        .imageLayout = storage ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL };
+      VkDescriptorImageInfo storageInfo {.imageView = levels.views[mip], .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+      std::array<VkWriteDescriptorSet, 2> writes {
+        VkWriteDescriptorSet{
+          .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+          .dstSet = getDescriptorSet(DESC_TYPE_COMBINED_IMAGE_SAMPLER),
+          .dstArrayElement = levels.sampled[mip],
+          .descriptorCount = 1,
+          .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+          .pImageInfo = &sampledInfo },
+        VkWriteDescriptorSet{
+          .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+          .dstSet = getDescriptorSet(DESC_TYPE_STORAGE_IMAGE),
+          .dstArrayElement = 0,
+          .descriptorCount = 1,
+          .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+          .pImageInfo = &storageInfo } };
+      if (storage) {
+        levels.storages[mip] = allocDescriptorIndex(DESC_TYPE_STORAGE_IMAGE);
+        writes[1].dstArrayElement = levels.storages[mip];
+      }
+      vkUpdateDescriptorSets(getDevice(), storage ? 2 : 1, writes.data(), 0, nullptr);
+    }
+    return &levels;
+  }
+
+} // namespace
+
+void hlgl::releaseDepthPyramidViews(TextureImpl* texture) {
+  auto it {levelViews_s.find(texture)};
+  if (it == levelViews_s.end())
+    return;
+  release(it->second);
+  levelViews_s.erase(it);
+}
+
+void hlgl::shutdownDepthPyramids() {
+  for (auto& [texture, levels] : levelViews_s)
+    release(levels);
+  levelViews_s.clear();
+  for (VkSampler& sampler : reductionSamplers_s) {
+    if (sampler)
+      vkDestroySampler(getDevice(), sampler, nullptr);
+    sampler = nullptr;
+  }
+}
+
+void hlgl::buildDepthPyramid(Texture* depth, Texture* pyramid, FilterMode reduction) {
+  Frame* frame {getCurrentFrame()};
+  if (!frame) {
+    DEBUG_ERROR("Can't call 'buildDepthPyramid' outside of a frame.");
+    return;
+  }
+  if (!depth || !depth->isValid() || !pyramid || !pyramid->isValid()) {
+    DEBUG_ERROR("Invalid texture for 'buildDepthPyramid'.");
+    return;
+  }
+  if (reduction != FilterMode::Min && reduction != FilterMode::Max) {
+    DEBUG_ERROR("'buildDepthPyramid' needs a reduction of either FilterMode::Min or FilterMode::Max.");
+    return;
+  }
+
+  TextureImpl* src {depth->_pimpl.get()};
+  TextureImpl* dst {pyramid->_pimpl.get()};
+  if (!(src->usage & VK_IMAGE_USAGE_SAMPLED_BIT)) {
+    DEBUG_ERROR("Can't build a depth pyramid from '%s', it needs a sampler so it can be read.", src->debugName.c_str());
+    return;
+  }
+  if (!(dst->usage & VK_IMAGE_USAGE_SAMPLED_BIT) || !(dst->usage & VK_IMAGE_USAGE_STORAGE_BIT) || dst->extent.depth > 1) {
+    DEBUG_ERROR("Depth pyramid '%s' must be a 2D texture with the Storage usage and a sampler.", dst->debugName.c_str());
+    return;
+  }
+
+  const LevelViews* srcLevels {getLevelViews(src, 1, reduction, false)};
+  const LevelViews* dstLevels {getLevelViews(dst, dst->mipCount, reduction, true)};
+  if (!srcLevels || !dstLevels)
+    return;
+
+  endDrawing();
+  src->barrier(frame->cmd, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+  dst->barrier(frame->cmd, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+  for (uint32_t mip {0}; mip < dst->mipCount; ++mip) {
+    // Wait for the previous level to be written before reading from it.
+    if (mip > 0) {
+      VkMemoryBarrier barrier {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT };
+      vkCmdPipelineBarrier(frame->cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+    const VkExtent3D srcExtent {(mip == 0) ? src->extent : mipExtent(dst->extent, mip - 1)};
+    const VkExtent3D srcCapacity {(mip == 0) ? src->capacity : mipExtent(dst->capacity, mip - 1)};
+    const VkExtent3D dstExtent {mipExtent(dst->extent, mip)};
+    struct {
+      uint32_t src, dst;
+      uint32_t dstWidth, dstHeight;
+      uint32_t srcWidth, srcHeight;
+      uint32_t srcCapacityWidth, srcCapacityHeight;
+      uint32_t reduceMax;
+    } constants {
+      (mip == 0) ? srcLevels->sampled[0] : dstLevels->sampled[mip - 1],
+      dstLevels->storages[mip],
+      dstExtent.width, dstExtent.height,
+      srcExtent.width, srcExtent.height,
+      srcCapacity.width, srcCapacity.height,
+      (reduction == FilterMode::Min) ? 0u : 1u };
+    if (!dispatchBuiltin(frame->cmd, BuiltinPipeline::DepthReduce, &constants, sizeof(constants),
+        (constants.dstWidth + 7) / 8, (constants.dstHeight + 7) / 8, 1))
+      break;
+  }
+
+  // Async compute sections can only wait on compute stages.
+  dst->barrier(frame->cmd, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+    frame->inAsyncCompute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : (VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+  const uint64_t frameCounter {(uint64_t)std::max<int64_t>(0, frame->frameCounter)};
+  src->lastUsedFrame = frameCounter;
+  dst->lastUsedFrame = frameCounter;
+}
@@ -0,0 +1,15 @@
+#ifndef HLGL_VK_DEPTH_PYRAMID_H
+#define HLGL_VK_DEPTH_PYRAMID_H
+
+#include <hlgl.h>
+#include "vulkan-headers.h"
+
+namespace hlgl {
+
+// Frees the per-level views 'buildDepthPyramid' made for a texture, as the pyramid or its source.  Called when the texture is destroyed.
+void releaseDepthPyramidViews(TextureImpl* texture);
+// Frees every remaining view and the reduction samplers.  The device must be idle.
+void shutdownDepthPyramids();
+
+} // namespace hlgl
+#endif // HLGL_VK_DEPTH_PYRAMID_H
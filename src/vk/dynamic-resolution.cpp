@@ -0,0 +1,106 @@
+#include "dynamic-resolution.h"
+#include "builtin-pipelines.h"
+#include "context.h"
+#include "frame.h"
+#include "texture.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+  hlgl::DynamicResolutionParams params_s {};
+  float scale_s {1.0f};
+  uint32_t renderWidth_s {0}, renderHeight_s {0};
+  hlgl::Observable<uint32_t,uint32_t> subjectRenderResized_s {};
+
+  // Changes smaller than this are ignored, so render-sized textures aren't resized over frame time noise.
+  constexpr float minScaleChange_c {0.02f};
+
+  void calcRenderSize(uint32_t& w, uint32_t& h) {
+    hlgl::getDisplaySize(w, h);
+    w = std::max(1u, (uint32_t)std::lround(w * scale_s));
+    h = std::max(1u, (uint32_t)std::lround(h * scale_s));
+  }
+
+} // namespace
+
+void hlgl::setDynamicResolution(DynamicResolutionParams params) {
+  params.minScale = std::clamp(params.minScale, 0.25f, 1.0f);
+  params.maxScale = std::clamp(params.maxScale, params.minScale, 1.0f);
+  params.increaseRate = std::clamp(params.increaseRate, 0.0f, 1.0f);
+  params.decreaseRate = std::clamp(params.decreaseRate, 0.0f, 1.0f);
+  params_s = params;
+  scale_s = (params_s.enabled) ? std::clamp(scale_s, params_s.minScale, params_s.maxScale) : 1.0f;
+}
+
+float hlgl::getRenderScale() {
+  return scale_s;
+}
+
+void hlgl::getRenderSize(uint32_t& w, uint32_t& h) {
+  calcRenderSize(w, h);
+}
+
+void hlgl::observeRenderResize(Observer<uint32_t,uint32_t>* observer, std::function<void(uint32_t,uint32_t)> callback) {
+  subjectRenderResized_s.attach(observer, callback);
+}
+
+void hlgl::updateDynamicResolution(float gpuFrameTime) {
+  if (params_s.enabled && gpuFrameTime > 0.0f && params_s.targetFrameTime > 0.0f) {
+    // The cost of a frame goes with its pixel count, which goes with the square of the scale.
+    const float ideal {std::clamp(scale_s * std::sqrt(params_s.targetFrameTime / gpuFrameTime), params_s.minScale, params_s.maxScale)};
+    if (std::abs(ideal - scale_s) > minScaleChange_c) {
+      const float rate {(ideal < scale_s) ? params_s.decreaseRate : params_s.increaseRate};
+      scale_s = std::clamp(scale_s + (ideal - scale_s) * rate, params_s.minScale, params_s.maxScale);
+    }
+  }
+
+  uint32_t w {0}, h {0};
+  calcRenderSize(w, h);
+  if (w != renderWidth_s || h != renderHeight_s) {
+    renderWidth_s = w;
+    renderHeight_s = h;
+    subjectRenderResized_s.execute(w, h);
+  }
+}
+
+void hlgl::upscale(Texture* dst, Texture* src, UpscaleFilter filter, float sharpness) {
+  Frame* frame {getCurrentFrame()};
+  if (!frame) {
+    DEBUG_ERROR("Can't call 'upscale' outside of a frame.");
+    return;
+  }
+  if (!dst || !dst->isValid() || !src || !src->isValid()) {
+    DEBUG_ERROR("Invalid texture for 'upscale'.");
+    return;
+  }
+
+  if (filter == UpscaleFilter::Sharpen && !(dst->_pimpl->storageDescriptor && src->_pimpl->storageDescriptor)) {
+    DEBUG_WARNING("Sharpened upscaling needs storage textures, falling back to bilinear.");
+    filter = UpscaleFilter::Bilinear;
+  }
+  if (filter == UpscaleFilter::Bilinear) {
+    blitImage(dst, src, {}, {}, true);
+    return;
+  }
+
+  endDrawing();
+  TextureImpl* srcImpl {src->_pimpl.get()};
+  TextureImpl* dstImpl {dst->_pimpl.get()};
+  srcImpl->barrier(frame->cmd, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+  dstImpl->barrier(frame->cmd, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+  struct {
+    uint32_t src, dst;
+    uint32_t srcWidth, srcHeight;
+    uint32_t dstWidth, dstHeight;
+    float sharpness;
+  } constants {
+    srcImpl->descIndexStorageImage, dstImpl->descIndexStorageImage,
+    srcImpl->extent.width, srcImpl->extent.height,
+    dstImpl->extent.width, dstImpl->extent.height,
+    std::clamp(sharpness, 0.0f, 1.0f) };
+  dispatchBuiltin(frame->cmd, BuiltinPipeline::Upscale, &constants, sizeof(constants),
+    (constants.dstWidth + 7) / 8, (constants.dstHeight + 7) / 8, 1);
+}
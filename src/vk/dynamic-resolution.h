@@ -0,0 +1,18 @@
+#ifndef HLGL_VK_DYNAMIC_RESOLUTION_H
+#define HLGL_VK_DYNAMIC_RESOLUTION_H
+
+#include <hlgl.h>
+#include "vulkan-headers.h"
+#include "../utils/observer.h"
+
+namespace hlgl {
+
+// Register an observer and callback to execute when the render size changes.  Parameters are the new width and height.
+void observeRenderResize(Observer<uint32_t,uint32_t>* observer, std::function<void(uint32_t,uint32_t)> callback);
+
+// Picks the render scale from the GPU time of the most recently finished frame, and resizes render-sized textures if the render size changed.
+// Must be called at the beginning of a frame, after the display has been resized (if it was).
+void updateDynamicResolution(float gpuFrameTime);
+
+} // namespace hlgl
+#endif // HLGL_VK_DYNAMIC_RESOLUTION_H
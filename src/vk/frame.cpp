@@ -10,6 +10,10 @@ void hlgl::blitImage(Texture* dst, Texture* src, BlitRegion dstRegion, BlitRegio
     DEBUG_ERROR("Can't call 'blitImage' outside of a frame.");
     return;
   }
+  if (frame->inAsyncCompute) {
+    DEBUG_ERROR("Can't call 'blitImage' inside an async compute section.");
+    return;
+  }
 
   // If we started a draw pass, end it here.
   endDrawing();
@@ -40,7 +44,7 @@ void hlgl::blitImage(Texture* dst, Texture* src, BlitRegion dstRegion, BlitRegio
     .sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2,
     .srcSubresource = {
       .aspectMask = translateAspect(src->getFormat()),
-      .mipLevel = srcRegion.mipLevel,
+      .mipLevel = src->_pimpl->mipBase + srcRegion.mipLevel,
       .baseArrayLayer = srcRegion.baseLayer,
       .layerCount = srcRegion.layerCount },
       .srcOffsets = {
@@ -54,7 +58,7 @@ void hlgl::blitImage(Texture* dst, Texture* src, BlitRegion dstRegion, BlitRegio
         .z = std::min<int32_t>(src->_pimpl->extent.depth, srcRegion.z + srcRegion.d)} },
       .dstSubresource = {
       .aspectMask = translateAspect(dst->getFormat()),
-      .mipLevel = dstRegion.mipLevel,
+      .mipLevel = dst->_pimpl->mipBase + dstRegion.mipLevel,
       .baseArrayLayer = dstRegion.baseLayer,
       .layerCount = dstRegion.layerCount },
       .dstOffsets = {
@@ -87,6 +91,10 @@ void hlgl::beginDrawing(std::initializer_list<ColorAttachment> colorAttachments,
     DEBUG_ERROR("Can't call 'beginDrawing' outside of a frame.");
     return;
   }
+  if (frame->inAsyncCompute) {
+    DEBUG_ERROR("Can't call 'beginDrawing' inside an async compute section.");
+    return;
+  }
 
   if (colorAttachments.size() <= 0) {
     DEBUG_ERROR("beginDrawing requires at least one color attachment to output to.");
@@ -200,6 +208,10 @@ void hlgl::bindPipeline(Pipeline* pipeline) {
 
   if (frame->boundPipeline == pipeline)
     return;
+  if (frame->inAsyncCompute && !pipeline->isCompute()) {
+    DEBUG_ERROR("Only compute pipelines can be bound inside an async compute section.");
+    return;
+  }
   
   vkCmdBindPipeline(frame->cmd, pipeline->_pimpl->bindPoint, pipeline->_pimpl->pipeline);
   frame->boundPipeline = pipeline;
@@ -378,6 +390,85 @@ void hlgl::drawIndexedIndirectCount(
     maxDraws, stride);
 }
 
+void hlgl::drawMeshTasks(
+  uint32_t groupCountX,
+  uint32_t groupCountY,
+  uint32_t groupCountZ)
+{
+  Frame* frame {getCurrentFrame()};
+  if (!frame) {
+    DEBUG_ERROR("Can't call 'drawMeshTasks' outside of a frame.");
+    return;
+  }
+
+  if (!(getGpuProperties().enabledFeatures & Feature::MeshShading)) {
+    DEBUG_ERROR("Can't call 'drawMeshTasks' without Feature::MeshShading enabled.");
+    return;
+  }
+
+  if (!frame->boundPipeline || !frame->boundPipeline->isGraphics()) {
+    DEBUG_ERROR("A graphics pipeline must be bound before calling 'drawMeshTasks'.");
+    return;
+  }
+
+  vkCmdDrawMeshTasksEXT(frame->cmd, groupCountX, groupCountY, groupCountZ);
+}
+
+void hlgl::drawMeshTasksIndirect(
+  Buffer* drawBuffer,
+  DeviceSize drawOffset,
+  uint32_t drawCount,
+  uint32_t stride)
+{
+  Frame* frame {getCurrentFrame()};
+  if (!frame) {
+    DEBUG_ERROR("Can't call 'drawMeshTasksIndirect' outside of a frame.");
+    return;
+  }
+
+  if (!(getGpuProperties().enabledFeatures & Feature::MeshShading)) {
+    DEBUG_ERROR("Can't call 'drawMeshTasksIndirect' without Feature::MeshShading enabled.");
+    return;
+  }
+
+  if (!frame->boundPipeline || !frame->boundPipeline->isGraphics()) {
+    DEBUG_ERROR("A graphics pipeline must be bound before calling 'drawMeshTasksIndirect'.");
+    return;
+  }
+
+  vkCmdDrawMeshTasksIndirectEXT(frame->cmd, drawBuffer->_pimpl->getBuffer(frame), drawOffset, drawCount, stride);
+}
+
+void hlgl::drawMeshTasksIndirectCount(
+  Buffer* drawBuffer,
+  DeviceSize drawOffset,
+  Buffer* countBuffer,
+  DeviceSize countOffset,
+  uint32_t maxDraws,
+  uint32_t stride)
+{
+  Frame* frame {getCurrentFrame()};
+  if (!frame) {
+    DEBUG_ERROR("Can't call 'drawMeshTasksIndirectCount' outside of a frame.");
+    return;
+  }
+
+  if (!(getGpuProperties().enabledFeatures & Feature::MeshShading)) {
+    DEBUG_ERROR("Can't call 'drawMeshTasksIndirectCount' without Feature::MeshShading enabled.");
+    return;
+  }
+
+  if (!frame->boundPipeline || !frame->boundPipeline->isGraphics()) {
+    DEBUG_ERROR("A graphics pipeline must be bound before calling 'drawMeshTasksIndirectCount'.");
+    return;
+  }
+
+  vkCmdDrawMeshTasksIndirectCountEXT(frame->cmd,
+    drawBuffer->_pimpl->getBuffer(frame), drawOffset,
+    countBuffer->_pimpl->getBuffer(frame), countOffset,
+    maxDraws, stride);
+}
+
 hlgl::Texture* hlgl::getFrameSwapchainImage() {
   Frame* frame {getCurrentFrame()};
   if (!frame) {
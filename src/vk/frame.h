@@ -26,6 +26,7 @@ public:
   int64_t frameCounter {-1};
   uint32_t frameIndex {0};
   bool inDrawingPass {false};
+  bool inAsyncCompute {false};  // Between 'beginAsyncCompute' and 'endAsyncCompute'.  'cmd' is then the async compute command buffer, if there's a separate compute queue.
 };
 
 } // namespace hlgl
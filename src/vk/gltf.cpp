@@ -0,0 +1,548 @@
+#include "vulkan-headers.h"
+#include "../utils/mapped-file.h"
+#include "../utils/thread-pool.h"
+#include "../utils/trace.h"
+#include <hlgl.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+
+#include <fastgltf/core.hpp>
+#include <fastgltf/tools.hpp>
+#include <fastgltf/types.hpp>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_JPEG
+#include <stb_image.h>
+
+namespace {
+
+  // Feeds fastgltf straight from a memory-mapped file.  Only the JSON has to be copied, since simdjson needs padding after it.
+  class MappedFileGetter : public fastgltf::GltfDataGetter {
+  public:
+    explicit MappedFileGetter(const hlgl::MappedFile& file) : file_(file) {}
+
+    void read(void* ptr, std::size_t count) override {
+      count = std::min(count, file_.size() - pos_);
+      std::memcpy(ptr, file_.data() + pos_, count);
+      pos_ += count;
+    }
+
+    fastgltf::span<std::byte> read(std::size_t count, std::size_t padding) override {
+      count = std::min(count, file_.size() - pos_);
+      std::byte* ptr {(std::byte*)file_.data() + pos_};
+      if (padding > 0) {
+        std::vector<std::byte>& copy {copies_.emplace_back(count + padding, std::byte{0})};
+        std::memcpy(copy.data(), ptr, count);
+        ptr = copy.data();
+      }
+      pos_ += count;
+      return fastgltf::span<std::byte>(ptr, count);
+    }
+
+    void reset() override { pos_ = 0; }
+    std::size_t bytesRead() override { return pos_; }
+    std::size_t totalSize() override { return file_.size(); }
+
+  private:
+    const hlgl::MappedFile& file_;
+    std::size_t pos_ {0};
+    std::deque<std::vector<std::byte>> copies_ {};
+  };
+
+  // The bytes of a buffer or image which fastgltf has already loaded (or which live in the mapped file).
+  fastgltf::span<const std::byte> getBytes(const fastgltf::DataSource& data) {
+    return std::visit(fastgltf::visitor{
+      [](const auto&) { return fastgltf::span<const std::byte>(); },
+      [](const fastgltf::sources::Array& array) { return fastgltf::span<const std::byte>(array.bytes.data(), array.bytes.size()); },
+      [](const fastgltf::sources::Vector& vector) { return fastgltf::span<const std::byte>(vector.bytes.data(), vector.bytes.size()); },
+      [](const fastgltf::sources::ByteView& view) { return fastgltf::span<const std::byte>(view.bytes.data(), view.bytes.size()); },
+    }, data);
+  }
+
+  struct PrimitiveData {
+    std::vector<hlgl::GltfVertex> vertices {};
+    std::vector<uint32_t> indices {};     // Every level of detail's indices, finest first.
+    std::vector<hlgl::MeshLod> lods {};   // Relative to 'indices'.
+    uint32_t material {0};
+    float center[3] {};
+    float radius {0.0f};
+  };
+
+  // Area-weighted vertex normals, for primitives which don't provide their own.
+  void computeNormals(PrimitiveData& prim) {
+    for (size_t i {0}; i + 2 < prim.indices.size(); i += 3) {
+      hlgl::GltfVertex& a {prim.vertices[prim.indices[i]]};
+      hlgl::GltfVertex& b {prim.vertices[prim.indices[i + 1]]};
+      hlgl::GltfVertex& c {prim.vertices[prim.indices[i + 2]]};
+      const float e1[3] {b.position[0] - a.position[0], b.position[1] - a.position[1], b.position[2] - a.position[2]};
+      const float e2[3] {c.position[0] - a.position[0], c.position[1] - a.position[1], c.position[2] - a.position[2]};
+      const float n[3] {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+      for (hlgl::GltfVertex* v : {&a, &b, &c}) {
+        v->normal[0] += n[0]; v->normal[1] += n[1]; v->normal[2] += n[2];
+      }
+    }
+    for (hlgl::GltfVertex& v : prim.vertices) {
+      const float length {std::sqrt(v.normal[0] * v.normal[0] + v.normal[1] * v.normal[1] + v.normal[2] * v.normal[2])};
+      if (length > 0.0f) {
+        v.normal[0] /= length; v.normal[1] /= length; v.normal[2] /= length;
+      }
+    }
+  }
+
+  void computeBounds(PrimitiveData& prim) {
+    if (prim.vertices.empty())
+      return;
+    float lo[3] {prim.vertices[0].position[0], prim.vertices[0].position[1], prim.vertices[0].position[2]};
+    float hi[3] {lo[0], lo[1], lo[2]};
+    for (const hlgl::GltfVertex& v : prim.vertices) {
+      for (int k {0}; k < 3; ++k) {
+        lo[k] = std::min(lo[k], v.position[k]);
+        hi[k] = std::max(hi[k], v.position[k]);
+      }
+    }
+    for (int k {0}; k < 3; ++k)
+      prim.center[k] = (lo[k] + hi[k]) * 0.5f;
+    float radiusSq {0.0f};
+    for (const hlgl::GltfVertex& v : prim.vertices) {
+      const float d[3] {v.position[0] - prim.center[0], v.position[1] - prim.center[1], v.position[2] - prim.center[2]};
+      radiusSq = std::max(radiusSq, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+    prim.radius = std::sqrt(radiusSq);
+  }
+
+  bool loadPrimitive(const fastgltf::Asset& asset, const fastgltf::Primitive& primitive, uint32_t defaultMaterial, uint32_t maxLods, PrimitiveData& prim) {
+    const auto position {primitive.findAttribute("POSITION")};
+    if (primitive.type != fastgltf::PrimitiveType::Triangles || position == primitive.attributes.end())
+      return false;
+
+    const fastgltf::Accessor& positions {asset.accessors[position->accessorIndex]};
+    prim.vertices.resize(positions.count, hlgl::GltfVertex{});
+    fastgltf::iterateAccessorWithIndex<fastgltf::math::fvec3>(asset, positions, [&](fastgltf::math::fvec3 p, size_t i) {
+      prim.vertices[i].position[0] = p[0]; prim.vertices[i].position[1] = p[1]; prim.vertices[i].position[2] = p[2];
+    });
+
+    const auto normal {primitive.findAttribute("NORMAL")};
+    if (normal != primitive.attributes.end() && asset.accessors[normal->accessorIndex].count == positions.count) {
+      fastgltf::iterateAccessorWithIndex<fastgltf::math::fvec3>(asset, asset.accessors[normal->accessorIndex], [&](fastgltf::math::fvec3 n, size_t i) {
+        prim.vertices[i].normal[0] = n[0]; prim.vertices[i].normal[1] = n[1]; prim.vertices[i].normal[2] = n[2];
+      });
+    }
+    const auto texcoord {primitive.findAttribute("TEXCOORD_0")};
+    if (texcoord != primitive.attributes.end() && asset.accessors[texcoord->accessorIndex].count == positions.count) {
+      fastgltf::iterateAccessorWithIndex<fastgltf::math::fvec2>(asset, asset.accessors[texcoord->accessorIndex], [&](fastgltf::math::fvec2 uv, size_t i) {
+        prim.vertices[i].u = uv[0]; prim.vertices[i].v = uv[1];
+      });
+    }
+    const auto tangent {primitive.findAttribute("TANGENT")};
+    if (tangent != primitive.attributes.end() && asset.accessors[tangent->accessorIndex].count == positions.count) {
+      fastgltf::iterateAccessorWithIndex<fastgltf::math::fvec4>(asset, asset.accessors[tangent->accessorIndex], [&](fastgltf::math::fvec4 t, size_t i) {
+        for (int k {0}; k < 4; ++k)
+          prim.vertices[i].tangent[k] = t[k];
+      });
+    }
+
+    if (primitive.indicesAccessor) {
+      const fastgltf::Accessor& indices {asset.accessors[*primitive.indicesAccessor]};
+      prim.indices.resize(indices.count);
+      fastgltf::copyFromAccessor<uint32_t>(asset, indices, prim.indices.data());
+    }
+    else {
+      prim.indices.resize(prim.vertices.size());
+      for (size_t i {0}; i < prim.indices.size(); ++i)
+        prim.indices[i] = (uint32_t)i;
+    }
+    prim.indices.resize(prim.indices.size() - prim.indices.size() % 3);
+    for (uint32_t index : prim.indices) {
+      if (index >= prim.vertices.size())
+        return false;
+    }
+
+    if (normal == primitive.attributes.end() || asset.accessors[normal->accessorIndex].count != positions.count)
+      computeNormals(prim);
+    hlgl::OptimizedMesh optimized {hlgl::optimizeMesh(hlgl::OptimizeMeshParams{
+      .vertices = prim.vertices.data(),
+      .vertexCount = prim.vertices.size(),
+      .vertexSize = sizeof(hlgl::GltfVertex),
+      .positionOffset = offsetof(hlgl::GltfVertex, position),
+      .indices = prim.indices.data(),
+      .indexCount = prim.indices.size() })};
+    if (optimized.vertexCount == 0)
+      return false;
+    prim.vertices.resize(optimized.vertexCount);
+    std::memcpy(prim.vertices.data(), optimized.vertices.data(), optimized.vertices.size());
+    prim.indices = std::move(optimized.indices);
+    prim.lods = {hlgl::MeshLod{.firstIndex = 0, .indexCount = (uint32_t)prim.indices.size(), .error = 0.0f, .padding = 0}};
+    if (maxLods > 1) {
+      hlgl::MeshLodChain chain {hlgl::buildLodChain(hlgl::BuildLodChainParams{
+        .vertices = prim.vertices.data(),
+        .vertexCount = prim.vertices.size(),
+        .vertexSize = sizeof(hlgl::GltfVertex),
+        .positionOffset = offsetof(hlgl::GltfVertex, position),
+        .indices = prim.indices.data(),
+        .indexCount = prim.indices.size(),
+        .attributes = {
+          {.offset = offsetof(hlgl::GltfVertex, u), .weight = 1.0f},
+          {.offset = offsetof(hlgl::GltfVertex, v), .weight = 1.0f},
+          {.offset = offsetof(hlgl::GltfVertex, normal) + sizeof(float) * 0, .weight = 0.5f},
+          {.offset = offsetof(hlgl::GltfVertex, normal) + sizeof(float) * 1, .weight = 0.5f},
+          {.offset = offsetof(hlgl::GltfVertex, normal) + sizeof(float) * 2, .weight = 0.5f}},
+        .maxLods = maxLods })};
+      if (!chain.lods.empty()) {
+        prim.indices = std::move(chain.indices);
+        prim.lods = std::move(chain.lods);
+      }
+    }
+    computeBounds(prim);
+    prim.material = primitive.materialIndex ? (uint32_t)*primitive.materialIndex : defaultMaterial;
+    return true;
+  }
+
+  hlgl::WrapMode translate(fastgltf::Wrap wrap) {
+    switch (wrap) {
+      case fastgltf::Wrap::ClampToEdge: return hlgl::WrapMode::ClampToEdge;
+      case fastgltf::Wrap::MirroredRepeat: return hlgl::WrapMode::MirrorRepeat;
+      default: return hlgl::WrapMode::Repeat;
+    }
+  }
+
+  hlgl::Texture::CreateParams::Sampler getSampler(const fastgltf::Asset& asset, const fastgltf::Texture& texture, uint32_t mipCount) {
+    hlgl::Texture::CreateParams::Sampler sampler {.filtering = hlgl::FilterMode::Linear, .maxLod = (float)mipCount, .wrapping = hlgl::WrapMode::Repeat};
+    if (!texture.samplerIndex)
+      return sampler;
+    const fastgltf::Sampler& src {asset.samplers[*texture.samplerIndex]};
+    sampler.wrapU = translate(src.wrapS);
+    sampler.wrapV = translate(src.wrapT);
+    if (src.magFilter == fastgltf::Filter::Nearest)
+      sampler.filterMag = hlgl::FilterMode::Nearest;
+    if (src.minFilter == fastgltf::Filter::Nearest || src.minFilter == fastgltf::Filter::NearestMipMapNearest || src.minFilter == fastgltf::Filter::NearestMipMapLinear)
+      sampler.filterMin = hlgl::FilterMode::Nearest;
+    if (src.minFilter == fastgltf::Filter::NearestMipMapNearest || src.minFilter == fastgltf::Filter::LinearMipMapNearest)
+      sampler.filterMips = hlgl::FilterMode::Nearest;
+    return sampler;
+  }
+
+  // Where an image's encoded bytes are.  Images stored in external files are mapped by the worker which decodes them.
+  struct ImageSource {
+    fastgltf::span<const std::byte> bytes {};
+    std::filesystem::path path {};
+  };
+
+  ImageSource getImageSource(const fastgltf::Asset& asset, const fastgltf::Image& image, const std::filesystem::path& directory) {
+    return std::visit(fastgltf::visitor{
+      [](const auto&) { return ImageSource{}; },
+      [&](const fastgltf::sources::URI& uri) {
+        if (!uri.uri.isLocalPath() || uri.fileByteOffset != 0)
+          return ImageSource{};
+        return ImageSource{.path = directory / uri.uri.fspath()};
+      },
+      [&](const fastgltf::sources::BufferView& view) {
+        const fastgltf::BufferView& bufferView {asset.bufferViews[view.bufferViewIndex]};
+        fastgltf::span<const std::byte> bytes {getBytes(asset.buffers[bufferView.bufferIndex].data)};
+        if (bufferView.byteOffset + bufferView.byteLength > bytes.size())
+          return ImageSource{};
+        return ImageSource{.bytes = bytes.subspan(bufferView.byteOffset, bufferView.byteLength)};
+      },
+      [](const fastgltf::sources::Array& array) { return ImageSource{.bytes = fastgltf::span<const std::byte>(array.bytes.data(), array.bytes.size())}; },
+      [](const fastgltf::sources::Vector& vector) { return ImageSource{.bytes = fastgltf::span<const std::byte>(vector.bytes.data(), vector.bytes.size())}; },
+    }, image.data);
+  }
+
+  bool isKtx2(fastgltf::span<const std::byte> bytes) {
+    constexpr uint8_t magic_c[12] {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    return bytes.size() >= sizeof(magic_c) && std::memcmp(bytes.data(), magic_c, sizeof(magic_c)) == 0;
+  }
+
+  // Decodes a PNG or JPEG on a worker thread, and builds its mip chain there too so the render thread only has to upload it.
+  hlgl::MipChain decodeImage(const ImageSource& source, bool srgb, bool generateMips) {
+    hlgl::MappedFile file {};
+    fastgltf::span<const std::byte> bytes {source.bytes};
+    if (!source.path.empty()) {
+      file = hlgl::MappedFile(source.path.string().c_str());
+      if (!file)
+        return {};
+      bytes = fastgltf::span<const std::byte>((const std::byte*)file.data(), file.size());
+    }
+    int width {0}, height {0}, channels {0};
+    stbi_uc* pixels {stbi_load_from_memory((const stbi_uc*)bytes.data(), (int)bytes.size(), &width, &height, &channels, 4)};
+    if (!pixels)
+      return {};
+    hlgl::MipChain chain {hlgl::buildMipChainRGBA8(pixels, (uint32_t)width, (uint32_t)height, generateMips ? 0 : 1, srgb)};
+    stbi_image_free(pixels);
+    chain.format = srgb ? hlgl::ImageFormat::RGBA8i_srgb : hlgl::ImageFormat::RGBA8i;
+    return chain;
+  }
+
+} // namespace
+
+hlgl::GltfScene hlgl::loadGltf(const LoadGltfParams& params) {
+  HLGL_TRACE_SCOPE("Load glTF");
+  GltfScene scene {};
+  if (!params.filename) {
+    DEBUG_ERROR("A filename is required to load a glTF file.");
+    return scene;
+  }
+  const char* debugName {params.debugName ? params.debugName : params.filename};
+
+  MappedFile file(params.filename);
+  if (!file) {
+    DEBUG_ERROR("Failed to open glTF file '%s'.", params.filename);
+    return scene;
+  }
+
+  const std::filesystem::path directory {std::filesystem::path(params.filename).parent_path()};
+  fastgltf::Parser parser(fastgltf::Extensions::KHR_texture_basisu | fastgltf::Extensions::KHR_mesh_quantization);
+  MappedFileGetter getter(file);
+  fastgltf::Expected<fastgltf::Asset> loaded {parser.loadGltf(getter, directory, fastgltf::Options::LoadExternalBuffers)};
+  if (loaded.error() != fastgltf::Error::None) {
+    DEBUG_ERROR("Failed to parse glTF file '%s': %s", params.filename, std::string(fastgltf::getErrorMessage(loaded.error())).c_str());
+    return scene;
+  }
+  const fastgltf::Asset& asset {loaded.get()};
+
+  // Work out which textures hold color, since those are sRGB.
+  std::vector<bool> srgbTextures(asset.textures.size(), false);
+  auto markSrgb = [&](const auto& info) {
+    if (info && info->textureIndex < srgbTextures.size())
+      srgbTextures[info->textureIndex] = true;
+  };
+  for (const fastgltf::Material& material : asset.materials) {
+    markSrgb(material.pbrData.baseColorTexture);
+    markSrgb(material.emissiveTexture);
+  }
+
+  // Start decoding images straight away, so it overlaps with the meshes being processed.
+  struct PendingTexture {
+    std::future<MipChain> decoded {};
+    std::optional<Texture::LoadKtxParams> ktx {};
+    std::string ktxPath {};
+  };
+  std::vector<PendingTexture> pending(params.loadTextures ? asset.textures.size() : 0);
+  for (size_t i {0}; i < pending.size(); ++i) {
+    const fastgltf::Texture& texture {asset.textures[i]};
+    if (!texture.basisuImageIndex && !texture.imageIndex)
+      continue;
+    const size_t imageIndex {texture.basisuImageIndex ? *texture.basisuImageIndex : *texture.imageIndex};
+    if (imageIndex >= asset.images.size()) {
+      DEBUG_WARNING("Texture %zu of '%s' refers to image %zu, which doesn't exist.", i, debugName, imageIndex);
+      continue;
+    }
+    ImageSource source {getImageSource(asset, asset.images[imageIndex], directory)};
+    if (source.bytes.size() == 0 && source.path.empty()) {
+      DEBUG_WARNING("Image %zu of '%s' has no data that can be loaded.", imageIndex, debugName);
+      continue;
+    }
+    const bool ktx2 {texture.basisuImageIndex.has_value() || isKtx2(source.bytes) || source.path.extension() == ".ktx2"};
+    if (ktx2) {
+      pending[i].ktxPath = source.path.string();
+      pending[i].ktx = Texture::LoadKtxParams{
+        .filename = source.path.empty() ? nullptr : pending[i].ktxPath.c_str(),
+        .dataPtr = source.bytes.data(),
+        .dataSize = source.bytes.size(),
+        .usage = params.textureUsage,
+        .debugName = debugName };
+    }
+    else {
+      const bool srgb {srgbTextures[i]};
+      const bool generateMips {params.generateMips};
+      pending[i].decoded = getThreadPool().submit([source, srgb, generateMips]() { return decodeImage(source, srgb, generateMips); });
+    }
+  }
+
+  // Read each primitive on a worker thread.
+  struct PrimitiveRef { size_t mesh, primitive; };
+  std::vector<PrimitiveRef> refs {};
+  for (size_t m {0}; m < asset.meshes.size(); ++m) {
+    for (size_t p {0}; p < asset.meshes[m].primitives.size(); ++p)
+      refs.push_back({m, p});
+  }
+  const uint32_t defaultMaterial {(uint32_t)asset.materials.size()};
+  std::vector<PrimitiveData> prims(refs.size());
+  std::vector<uint8_t> primLoaded(refs.size(), 0);
+  std::vector<uint32_t> primIndex(refs.size(), 0);
+  {
+    HLGL_TRACE_SCOPE("Process glTF primitives");
+    getThreadPool().parallelFor((uint32_t)refs.size(), [&](uint32_t i) {
+      primLoaded[i] = loadPrimitive(asset, asset.meshes[refs[i].mesh].primitives[refs[i].primitive], defaultMaterial, params.maxLods, prims[i]);
+    });
+  }
+
+  // Lay the primitives out end to end, then pack them into one array of vertices and one of indices.
+  size_t totalVertices {0}, totalIndices {0};
+  bool usesDefaultMaterial {false};
+  scene.meshes.resize(asset.meshes.size());
+  for (size_t m {0}; m < asset.meshes.size(); ++m)
+    scene.meshes[m].name = std::string(std::string_view(asset.meshes[m].name));
+  for (size_t i {0}; i < refs.size(); ++i) {
+    GltfMesh& mesh {scene.meshes[refs[i].mesh]};
+    if (!primLoaded[i]) {
+      DEBUG_WARNING("Skipped primitive %zu of mesh '%s' in '%s', which isn't an indexed or non-indexed triangle list.", refs[i].primitive, mesh.name.c_str(), debugName);
+      continue;
+    }
+    if (mesh.primitiveCount == 0)
+      mesh.firstPrimitive = (uint32_t)scene.primitives.size();
+    primIndex[i] = (uint32_t)scene.primitives.size();
+    ++mesh.primitiveCount;
+    const PrimitiveData& prim {prims[i]};
+    scene.primitives.push_back(GltfPrimitive{
+      .firstIndex = (uint32_t)totalIndices,
+      .indexCount = prim.lods[0].indexCount,
+      .vertexOffset = (uint32_t)totalVertices,
+      .vertexCount = (uint32_t)prim.vertices.size(),
+      .material = prim.material,
+      .center = {prim.center[0], prim.center[1], prim.center[2]},
+      .radius = prim.radius,
+      .firstLod = (uint32_t)scene.lods.size(),
+      .lodCount = (uint32_t)prim.lods.size() });
+    for (MeshLod lod : prim.lods) {
+      lod.firstIndex += (uint32_t)totalIndices;
+      scene.lods.push_back(lod);
+    }
+    usesDefaultMaterial |= (prim.material == defaultMaterial);
+    totalVertices += prim.vertices.size();
+    totalIndices += prim.indices.size();
+  }
+  if (totalVertices == 0 || totalIndices == 0) {
+    DEBUG_ERROR("glTF file '%s' has no triangles.", params.filename);
+    // Images are still being decoded from the asset's buffers and the mapped file, so wait for them before either is destroyed.
+    for (PendingTexture& texture : pending) {
+      if (texture.decoded.valid())
+        texture.decoded.wait();
+    }
+    return {};
+  }
+
+  std::vector<GltfVertex> vertices(totalVertices);
+  std::vector<uint32_t> indices(totalIndices);
+  getThreadPool().parallelFor((uint32_t)refs.size(), [&](uint32_t i) {
+    if (!primLoaded[i])
+      return;
+    const GltfPrimitive& primitive {scene.primitives[primIndex[i]]};
+    std::copy(prims[i].vertices.begin(), prims[i].vertices.end(), vertices.begin() + primitive.vertexOffset);
+    std::copy(prims[i].indices.begin(), prims[i].indices.end(), indices.begin() + primitive.firstIndex);
+  });
+  prims.clear();
+
+  scene.vertexBuffer.emplace(Buffer::CreateParams{
+    .usage = params.bufferUsage | BufferUsage::Vertex | BufferUsage::Storage | BufferUsage::DeviceAddressable,
+    .data = {{.ptr = vertices.data(), .size = vertices.size() * sizeof(GltfVertex)}},
+    .debugName = debugName });
+  scene.indexBuffer.emplace(Buffer::CreateParams{
+    .usage = params.bufferUsage | BufferUsage::Index | BufferUsage::Storage | BufferUsage::DeviceAddressable,
+    .data = {{.ptr = indices.data(), .size = indices.size() * sizeof(uint32_t)}},
+    .debugName = debugName });
+  scene.lodBuffer.emplace(Buffer::CreateParams{
+    .usage = params.bufferUsage | BufferUsage::Storage | BufferUsage::DeviceAddressable,
+    .data = {{.ptr = scene.lods.data(), .size = scene.lods.size() * sizeof(MeshLod)}},
+    .debugName = debugName });
+  vertices = {};
+  indices = {};
+
+  // Upload textures as they finish decoding.  KTX2 textures are loaded as one batch, which spreads them across the worker threads itself.
+  // Materials refer to textures by their sampler index, so failed textures are left out and simply read as 0.
+  std::vector<uint32_t> samplerIndices(pending.size(), 0);
+  {
+    std::vector<Texture::LoadKtxParams> ktxParams {};
+    for (const PendingTexture& texture : pending) {
+      if (texture.ktx)
+        ktxParams.push_back(*texture.ktx);
+    }
+    std::vector<Texture> ktxTextures {Texture::loadKtx(ktxParams)};
+    size_t nextKtx {0};
+    for (size_t i {0}; i < pending.size(); ++i) {
+      std::optional<Texture> texture {};
+      if (pending[i].ktx) {
+        texture.emplace(std::move(ktxTextures[nextKtx++]));
+      }
+      else if (pending[i].decoded.valid()) {
+        MipChain chain {pending[i].decoded.get()};
+        if (!chain.data.empty()) {
+          texture.emplace(Texture::CreateParams{
+            .usage = params.textureUsage,
+            .width = chain.width,
+            .height = chain.height,
+            .mipCount = chain.mipCount,
+            .format = chain.format,
+            .dataPtr = chain.data.data(),
+            .dataSize = chain.data.size(),
+            .offsets = chain.offsets.data(),
+            .numOffsets = (uint32_t)chain.offsets.size(),
+            .debugName = debugName,
+            .sampler = getSampler(asset, asset.textures[i], chain.mipCount) });
+        }
+      }
+      else {
+        continue;
+      }
+      if (!texture || !*texture) {
+        DEBUG_WARNING("Failed to load texture %zu of '%s'.", i, debugName);
+        continue;
+      }
+      samplerIndices[i] = texture->getSamplerIndex();
+      scene.textures.push_back(std::move(*texture));
+    }
+  }
+
+  auto samplerIndex = [&](const auto& info) -> uint32_t {
+    return (info && info->textureIndex < samplerIndices.size()) ? samplerIndices[info->textureIndex] : 0;
+  };
+  scene.materials.reserve(asset.materials.size() + 1);
+  for (const fastgltf::Material& src : asset.materials) {
+    GltfMaterial& material {scene.materials.emplace_back()};
+    for (int k {0}; k < 4; ++k)
+      material.baseColorFactor[k] = src.pbrData.baseColorFactor[k];
+    for (int k {0}; k < 3; ++k)
+      material.emissiveFactor[k] = src.emissiveFactor[k] * src.emissiveStrength;
+    material.alphaCutoff = src.alphaCutoff;
+    material.metallicFactor = src.pbrData.metallicFactor;
+    material.roughnessFactor = src.pbrData.roughnessFactor;
+    material.normalScale = src.normalTexture ? src.normalTexture->scale : 1.0f;
+    material.occlusionStrength = src.occlusionTexture ? src.occlusionTexture->strength : 1.0f;
+    material.baseColorTexture = samplerIndex(src.pbrData.baseColorTexture);
+    material.metallicRoughnessTexture = samplerIndex(src.pbrData.metallicRoughnessTexture);
+    material.normalTexture = samplerIndex(src.normalTexture);
+    material.occlusionTexture = samplerIndex(src.occlusionTexture);
+    material.emissiveTexture = samplerIndex(src.emissiveTexture);
+    material.alphaMode = (src.alphaMode == fastgltf::AlphaMode::Mask) ? GltfAlphaMode::Mask :
+                         (src.alphaMode == fastgltf::AlphaMode::Blend) ? GltfAlphaMode::Blend : GltfAlphaMode::Opaque;
+    material.doubleSided = src.doubleSided ? 1 : 0;
+  }
+  if (usesDefaultMaterial || scene.materials.empty())
+    scene.materials.emplace_back();
+  scene.materialBuffer.emplace(Buffer::CreateParams{
+    .usage = params.bufferUsage | BufferUsage::Storage | BufferUsage::DeviceAddressable,
+    .data = {{.ptr = scene.materials.data(), .size = scene.materials.size() * sizeof(GltfMaterial)}},
+    .debugName = debugName });
+
+  // Flatten the scene's node hierarchy.  Files without any scenes get one instance of each mesh.
+  if (!asset.scenes.empty()) {
+    fastgltf::iterateSceneNodes(asset, asset.defaultScene.value_or(0), fastgltf::math::fmat4x4(1.0f),
+      [&](const fastgltf::Node& node, const fastgltf::math::fmat4x4& matrix) {
+        if (!node.meshIndex || scene.meshes[*node.meshIndex].primitiveCount == 0)
+          return;
+        GltfInstance& instance {scene.instances.emplace_back()};
+        for (size_t c {0}; c < 4; ++c) {
+          for (size_t r {0}; r < 4; ++r)
+            instance.transform[c * 4 + r] = matrix[c][r];
+        }
+        instance.mesh = (uint32_t)*node.meshIndex;
+      });
+  }
+  else {
+    for (uint32_t m {0}; m < scene.meshes.size(); ++m) {
+      if (scene.meshes[m].primitiveCount > 0)
+        scene.instances.push_back(GltfInstance{.transform = {1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1}, .mesh = m});
+    }
+  }
+
+  if (!scene.isValid()) {
+    DEBUG_ERROR("Failed to create buffers for glTF file '%s'.", params.filename);
+    return {};
+  }
+  return scene;
+}
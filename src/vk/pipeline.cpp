@@ -3,6 +3,7 @@
 #include "shader.h"
 
 #include "../utils/array.h"
+#include "../utils/trace.h"
 #include <vector>
 #include <map>
 #include <string>
@@ -17,7 +18,9 @@ hlgl::Pipeline::Pipeline(Pipeline::GraphicsParams params)
 { if (!_pimpl->pipeline) _pimpl.reset(); }
 
 hlgl::PipelineImpl::PipelineImpl(Pipeline::ComputeParams&& params)
+: bindPoint(VK_PIPELINE_BIND_POINT_COMPUTE)
 {
+  HLGL_TRACE_SCOPE("Create compute pipeline");
   // Create the pipeline.
   VkComputePipelineCreateInfo pci {
     .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
@@ -45,7 +48,9 @@ hlgl::PipelineImpl::PipelineImpl(Pipeline::ComputeParams&& params)
 }
 
 hlgl::PipelineImpl::PipelineImpl(Pipeline::GraphicsParams&& params)
+: bindPoint(VK_PIPELINE_BIND_POINT_GRAPHICS)
 {
+  HLGL_TRACE_SCOPE("Create graphics pipeline");
 
   // Assemble shaders and stages.
   Array<ShaderInfo,8> shaders;
@@ -0,0 +1,220 @@
+#include "profiler.h"
+#include "context.h"
+#include "frame.h"
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+namespace {
+
+  // Each scope uses two queries, so this is half the size of each query pool.
+  constexpr uint32_t maxScopes_c {256};
+  // How much each new frame contributes to the averaged times.
+  constexpr float avgWeight_c {0.1f};
+  // Where the profiler window saves CPU trace captures.
+  constexpr const char* traceCapturePath_c {"hlgl-trace.json"};
+
+  struct Scope {
+    std::string name;
+    int32_t parent;
+    uint32_t depth;
+  };
+
+  // Scope 'i' writes its timestamps into queries '2i' and '2i+1' of the pool.
+  struct FrameScopes {
+    VkQueryPool pool {nullptr};
+    std::vector<Scope> scopes {};
+    int64_t frame {-1};
+  };
+
+  std::array<FrameScopes, hlgl::numFramesInFlight_c> frames_s {};
+  FrameScopes* current_s {nullptr};
+  std::vector<int32_t> openScopes_s {};
+  std::vector<uint64_t> timestamps_s {};
+  uint64_t timestampMask_s {0};
+  hlgl::ProfileStats stats_s {};
+
+  int32_t openScope(VkCommandBuffer cmd, const char* name) {
+    if (!current_s || current_s->scopes.size() >= maxScopes_c)
+      return -1;
+    const int32_t scope {(int32_t)current_s->scopes.size()};
+    current_s->scopes.push_back(Scope{
+      .name = name ? name : "?",
+      .parent = openScopes_s.empty() ? -1 : openScopes_s.back(),
+      .depth = (uint32_t)openScopes_s.size() });
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, current_s->pool, (uint32_t)scope * 2);
+    openScopes_s.push_back(scope);
+    return scope;
+  }
+
+  // Closes 'scope', along with any scopes opened inside it which are still open.
+  void closeScope(VkCommandBuffer cmd, int32_t scope) {
+    while (!openScopes_s.empty()) {
+      const int32_t top {openScopes_s.back()};
+      openScopes_s.pop_back();
+      vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, current_s->pool, (uint32_t)top * 2 + 1);
+      if (top == scope)
+        break;
+    }
+  }
+
+  void resolve(const FrameScopes& frame) {
+    const uint32_t numScopes {(uint32_t)frame.scopes.size()};
+    if (numScopes == 0)
+      return;
+    timestamps_s.resize(numScopes * 2);
+    if (vkGetQueryPoolResults(hlgl::getDevice(), frame.pool, 0, numScopes * 2,
+      timestamps_s.size() * sizeof(uint64_t), timestamps_s.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+    {
+      return;
+    }
+
+    // Averages only carry over while the scopes stay the same, otherwise they'd be mixed up between different passes.
+    bool sameScopes {stats_s.nodes.size() == numScopes};
+    for (uint32_t i {0}; sameScopes && i < numScopes; ++i)
+      sameScopes = (stats_s.nodes[i].depth == frame.scopes[i].depth && stats_s.nodes[i].name == frame.scopes[i].name);
+    if (!sameScopes)
+      stats_s.nodes.resize(numScopes);
+
+    const double period {hlgl::getDeviceProperties().limits.timestampPeriod};
+    for (uint32_t i {0}; i < numScopes; ++i) {
+      const uint64_t ticks {(timestamps_s[i * 2 + 1] - timestamps_s[i * 2]) & timestampMask_s};
+      hlgl::ProfileNode& node {stats_s.nodes[i]};
+      node.gpuTime = (float)((double)ticks * period / 1000000.0);
+      if (sameScopes)
+        node.avgGpuTime += (node.gpuTime - node.avgGpuTime) * avgWeight_c;
+      else {
+        node.name = frame.scopes[i].name;
+        node.avgGpuTime = node.gpuTime;
+        node.depth = frame.scopes[i].depth;
+        node.parent = frame.scopes[i].parent;
+      }
+    }
+    stats_s.frame = frame.frame;
+  }
+
+} // namespace
+
+void hlgl::initProfiler(uint32_t timestampValidBits) {
+  if (timestampValidBits == 0 || getDeviceProperties().limits.timestampPeriod <= 0.0f) {
+    DEBUG_WARNING("GPU timestamps aren't supported, so GPU profiling and dynamic resolution are unavailable.");
+    return;
+  }
+  timestampMask_s = (timestampValidBits >= 64) ? UINT64_MAX : ((uint64_t{1} << timestampValidBits) - 1);
+
+  for (FrameScopes& frame : frames_s) {
+    VkQueryPoolCreateInfo qci {
+      .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+      .queryType = VK_QUERY_TYPE_TIMESTAMP,
+      .queryCount = maxScopes_c * 2 };
+    if (!VKCHECK_WARN(vkCreateQueryPool(getDevice(), &qci, nullptr, &frame.pool))) {
+      shutdownProfiler();
+      return;
+    }
+  }
+}
+
+void hlgl::shutdownProfiler() {
+  for (FrameScopes& frame : frames_s) {
+    if (frame.pool)
+      vkDestroyQueryPool(getDevice(), frame.pool, nullptr);
+    frame = FrameScopes{};
+  }
+  current_s = nullptr;
+  openScopes_s.clear();
+  stats_s = ProfileStats{};
+}
+
+void hlgl::beginProfilerFrame(Frame* frame) {
+  FrameScopes& scopes {frames_s[frame->frameIndex]};
+  if (!scopes.pool)
+    return;
+
+  resolve(scopes);
+  scopes.scopes.clear();
+  scopes.frame = frame->frameCounter;
+  vkCmdResetQueryPool(frame->cmd, scopes.pool, 0, maxScopes_c * 2);
+
+  current_s = &scopes;
+  openScopes_s.clear();
+  openScope(frame->cmd, "Frame");
+}
+
+void hlgl::endProfilerFrame(Frame* frame) {
+  if (!current_s)
+    return;
+  if (!openScopes_s.empty())
+    closeScope(frame->cmd, openScopes_s.front());
+  current_s = nullptr;
+}
+
+float hlgl::getProfilerFrameTime() {
+  return stats_s.nodes.empty() ? 0.0f : stats_s.nodes[0].gpuTime;
+}
+
+hlgl::ProfileScope::ProfileScope(const char* name) {
+  // Timestamps are only written on the graphics queue, so scopes inside async compute sections are skipped.
+  Frame* frame {getCurrentFrame()};
+  if (!frame || frame->inAsyncCompute)
+    return;
+  scope_ = openScope(frame->cmd, name);
+  frame_ = frame->frameCounter;
+}
+
+hlgl::ProfileScope::~ProfileScope() {
+  Frame* frame {getCurrentFrame()};
+  // A scope which ends inside an async compute section is left open, and closed at the end of the frame.
+  if (scope_ < 0 || !frame || frame->frameCounter != frame_ || !current_s || frame->inAsyncCompute)
+    return;
+  closeScope(frame->cmd, scope_);
+}
+
+const hlgl::ProfileStats& hlgl::getProfileStats() {
+  return stats_s;
+}
+
+void hlgl::drawProfilerWindow(bool* open) {
+  if (!ImGui::Begin("GPU Profiler", open)) {
+    ImGui::End();
+    return;
+  }
+
+  if (!isTraceCapturing()) {
+    if (ImGui::Button("Start CPU trace"))
+      beginTraceCapture();
+  }
+  else if (ImGui::Button("Stop and save CPU trace")) {
+    endTraceCapture();
+    if (!saveTraceCapture(traceCapturePath_c))
+      DEBUG_WARNING("Failed to save the trace capture to '%s'.", traceCapturePath_c);
+  }
+
+  if (stats_s.nodes.empty())
+    ImGui::TextUnformatted("No GPU timings available.");
+  else if (ImGui::BeginTable("scopes", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingStretchProp)) {
+    ImGui::TableSetupColumn("Scope");
+    ImGui::TableSetupColumn("Time (ms)");
+    ImGui::TableSetupColumn("Frame");
+    ImGui::TableHeadersRow();
+
+    const float frameTime {std::max(stats_s.nodes[0].avgGpuTime, 0.0001f)};
+    const float indent {ImGui::GetStyle().IndentSpacing};
+    for (const ProfileNode& node : stats_s.nodes) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      if (node.depth > 0)
+        ImGui::Indent(indent * node.depth);
+      ImGui::TextUnformatted(node.name.c_str());
+      if (node.depth > 0)
+        ImGui::Unindent(indent * node.depth);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", node.avgGpuTime);
+      ImGui::TableNextColumn();
+      ImGui::ProgressBar(node.avgGpuTime / frameTime, ImVec2(-1.0f, 0.0f));
+    }
+    ImGui::EndTable();
+  }
+  ImGui::End();
+}
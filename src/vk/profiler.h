@@ -0,0 +1,23 @@
+#ifndef HLGL_VK_PROFILER_H
+#define HLGL_VK_PROFILER_H
+
+#include <hlgl.h>
+#include "vulkan-headers.h"
+
+namespace hlgl {
+
+// Creates a timestamp query pool for each frame in flight.  Does nothing if the graphics queue can't write timestamps.
+void initProfiler(uint32_t timestampValidBits);
+void shutdownProfiler();
+
+// Reads back the timestamps written by the frame which last used this frame's query pool, then opens the root scope.
+// Must be called at the beginning of a frame, after the frame's fence has been waited on and its command buffer has begun recording.
+void beginProfilerFrame(Frame* frame);
+// Closes any scopes left open, including the root scope.  Must be called before the frame's command buffer ends.
+void endProfilerFrame(Frame* frame);
+
+// The GPU time of the root scope of the most recently resolved frame, in milliseconds.
+float getProfilerFrameTime();
+
+} // namespace hlgl
+#endif // HLGL_VK_PROFILER_H
@@ -0,0 +1,210 @@
+#include "query.h"
+#include "context.h"
+#include "frame.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+  std::vector<hlgl::QueryPoolImpl*> pools_s {};
+
+  // The statistics gathered by PipelineStatistics queries.  Results are written in bit order, which matches the order of hlgl::PipelineStatistics.
+  constexpr VkQueryPipelineStatisticFlags pipelineStatistics_c {
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT };
+  constexpr uint32_t numPipelineStatistics_c {7};
+  static_assert(sizeof(hlgl::PipelineStatistics) == sizeof(uint64_t) * numPipelineStatistics_c);
+
+} // namespace
+
+hlgl::QueryPool::QueryPool(CreateParams params)
+: _pimpl(std::make_unique<QueryPoolImpl>(std::move(params)))
+{ if (!_pimpl->valid) _pimpl.reset(); }
+
+hlgl::QueryPool::~QueryPool() {}
+
+hlgl::QueryPoolImpl::QueryPoolImpl(QueryPool::CreateParams&& createParams)
+: params(std::move(createParams))
+{
+  const char* name {params.debugName ? params.debugName : "unnamed"};
+  if (params.count == 0) {
+    DEBUG_ERROR("Query pool '%s' needs at least one query.", name);
+    return;
+  }
+
+  VkQueryPoolCreateInfo qci {.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO, .queryCount = params.count};
+  switch (params.type) {
+  case QueryType::Occlusion:
+    qci.queryType = VK_QUERY_TYPE_OCCLUSION;
+    if (getEnabledDeviceFeatures().occlusionQueryPrecise)
+      controlFlags = VK_QUERY_CONTROL_PRECISE_BIT;
+    break;
+  case QueryType::OcclusionBinary:
+    qci.queryType = VK_QUERY_TYPE_OCCLUSION;
+    break;
+  case QueryType::PipelineStatistics:
+    qci.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    qci.pipelineStatistics = pipelineStatistics_c;
+    valuesPerQuery = numPipelineStatistics_c;
+    break;
+  }
+
+  for (uint32_t i {0}; i < pools.size(); ++i) {
+    if (!VKCHECK(vkCreateQueryPool(getDevice(), &qci, nullptr, &pools[i]))) {
+      DEBUG_ERROR("Failed to create query pool '%s'.", name);
+      return;
+    }
+    vkResetQueryPool(getDevice(), pools[i], 0, params.count);
+    states[i].resize(params.count, State::Idle);
+
+    if (params.debugName && isValidationEnabled()) {
+      char debugName[256]; snprintf(debugName, 256, "%s[%u]", params.debugName, i);
+      VkDebugUtilsObjectNameInfoEXT info{.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
+      info.objectType = VK_OBJECT_TYPE_QUERY_POOL;
+      info.objectHandle = (uint64_t)pools[i];
+      info.pObjectName = debugName;
+      if (!VKCHECK(vkSetDebugUtilsObjectNameEXT(getDevice(), &info))) {
+        DEBUG_WARNING("Failed to set Vulkan debug name for %s", debugName);
+      }
+    }
+  }
+  results.resize((size_t)params.count * valuesPerQuery, 0);
+  resultFrames.resize(params.count, -1);
+
+  registerQueryPool(this);
+  valid = true;
+  DEBUG_OBJCREATION("Created query pool '%s' (%u queries)", name, params.count);
+}
+
+hlgl::QueryPoolImpl::~QueryPoolImpl() {
+  if (valid)
+    unregisterQueryPool(this);
+  for (VkQueryPool pool : pools) {
+    if (pool)
+      queueDeletion(DelQueueQueryPool{.pool = pool});
+  }
+}
+
+void hlgl::QueryPoolImpl::readResults(Frame* frame) {
+  const uint32_t fi {frame->frameIndex};
+  std::vector<State>& frameStates {states[fi]};
+
+  // Ended queries are read in contiguous runs, to keep the number of calls down when most of the pool is in use.
+  uint32_t first {0};
+  while (first < params.count) {
+    if (frameStates[first] != State::Ended) {
+      if (frameStates[first] != State::Idle)
+        DEBUG_WARNING("Query %u of pool '%s' was begun but never ended.", first, params.debugName ? params.debugName : "unnamed");
+      ++first;
+      continue;
+    }
+    uint32_t last {first + 1};
+    while (last < params.count && frameStates[last] == State::Ended)
+      ++last;
+
+    const uint32_t count {last - first};
+    const size_t stride {sizeof(uint64_t) * valuesPerQuery};
+    if (vkGetQueryPoolResults(getDevice(), pools[fi], first, count, stride * count,
+      &results[(size_t)first * valuesPerQuery], stride, VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+    {
+      std::fill(resultFrames.begin() + first, resultFrames.begin() + last, poolFrames[fi]);
+    }
+    first = last;
+  }
+
+  // The fence has been waited on, so nothing on the GPU is using this pool anymore and it can be reset from the host.
+  if (std::any_of(frameStates.begin(), frameStates.end(), [](State state) { return state != State::Idle; })) {
+    vkResetQueryPool(getDevice(), pools[fi], 0, params.count);
+    std::fill(frameStates.begin(), frameStates.end(), State::Idle);
+  }
+}
+
+void hlgl::QueryPool::begin(uint32_t index) {
+  if (!_pimpl)
+    return;
+  Frame* frame {getCurrentFrame()};
+  if (!frame) {
+    DEBUG_ERROR("Can't begin a query outside of a frame.");
+    return;
+  }
+  if (index >= _pimpl->params.count) {
+    DEBUG_ERROR("Query index %u is out of range (pool has %u queries).", index, _pimpl->params.count);
+    return;
+  }
+  QueryPoolImpl::State& state {_pimpl->states[frame->frameIndex][index]};
+  if (state != QueryPoolImpl::State::Idle) {
+    DEBUG_ERROR("Query %u has already been used this frame.", index);
+    return;
+  }
+
+  vkCmdBeginQuery(frame->cmd, _pimpl->pools[frame->frameIndex], index, _pimpl->controlFlags);
+  state = frame->inDrawingPass ? QueryPoolImpl::State::BegunInPass : QueryPoolImpl::State::Begun;
+  _pimpl->poolFrames[frame->frameIndex] = frame->frameCounter;
+}
+
+void hlgl::QueryPool::end(uint32_t index) {
+  if (!_pimpl)
+    return;
+  Frame* frame {getCurrentFrame()};
+  if (!frame || index >= _pimpl->params.count)
+    return;
+  QueryPoolImpl::State& state {_pimpl->states[frame->frameIndex][index]};
+  if (state == QueryPoolImpl::State::Idle || state == QueryPoolImpl::State::Ended) {
+    DEBUG_ERROR("Query %u can't be ended before it has begun.", index);
+    return;
+  }
+  if (state == QueryPoolImpl::State::BegunInPass && !frame->inDrawingPass) {
+    DEBUG_ERROR("Query %u was begun inside a drawing pass, so it must end before the pass does.", index);
+    return;
+  }
+
+  vkCmdEndQuery(frame->cmd, _pimpl->pools[frame->frameIndex], index);
+  state = QueryPoolImpl::State::Ended;
+}
+
+bool hlgl::QueryPool::getResult(uint32_t index, uint64_t& samples) const {
+  if (!_pimpl || index >= _pimpl->params.count || _pimpl->params.type == QueryType::PipelineStatistics || _pimpl->resultFrames[index] < 0)
+    return false;
+  samples = _pimpl->results[index];
+  return true;
+}
+
+bool hlgl::QueryPool::getResult(uint32_t index, PipelineStatistics& stats) const {
+  if (!_pimpl || index >= _pimpl->params.count || _pimpl->params.type != QueryType::PipelineStatistics || _pimpl->resultFrames[index] < 0)
+    return false;
+  memcpy(&stats, &_pimpl->results[(size_t)index * numPipelineStatistics_c], sizeof(PipelineStatistics));
+  return true;
+}
+
+int64_t hlgl::QueryPool::getResultFrame(uint32_t index) const {
+  if (!_pimpl || index >= _pimpl->params.count)
+    return -1;
+  return _pimpl->resultFrames[index];
+}
+
+void hlgl::shutdownQueryPools() {
+  pools_s.clear();
+}
+
+void hlgl::registerQueryPool(QueryPoolImpl* pool) {
+  pools_s.push_back(pool);
+}
+
+void hlgl::unregisterQueryPool(QueryPoolImpl* pool) {
+  auto it {std::find(pools_s.begin(), pools_s.end(), pool)};
+  if (it != pools_s.end()) {
+    *it = pools_s.back();
+    pools_s.pop_back();
+  }
+}
+
+void hlgl::updateQueryPools(Frame* frame) {
+  for (QueryPoolImpl* pool : pools_s)
+    pool->readResults(frame);
+}
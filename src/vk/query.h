@@ -0,0 +1,43 @@
+#ifndef HLGL_VK_QUERY_H
+#define HLGL_VK_QUERY_H
+
+#include <hlgl.h>
+#include "vulkan-headers.h"
+
+#include <array>
+#include <vector>
+
+namespace hlgl {
+
+struct QueryPoolImpl {
+  QueryPoolImpl(QueryPool::CreateParams&& params);
+  ~QueryPoolImpl();
+
+  // Where each query is in its use for the frame.  Any query that isn't Idle gets read back (if Ended) and reset when the frame's pool comes around again.
+  enum class State : uint8_t { Idle, Begun, BegunInPass, Ended };
+
+  QueryPool::CreateParams params {};
+  std::array<VkQueryPool, 2> pools {};
+  std::array<std::vector<State>, 2> states {};    // One per query, for each frame in flight.
+  std::vector<uint64_t> results {};               // 'valuesPerQuery' per query.
+  std::vector<int64_t> resultFrames {};
+  std::array<int64_t, 2> poolFrames {-1, -1};     // The frame counter of the frame which last recorded into each pool.
+  uint32_t valuesPerQuery {1};
+  VkQueryControlFlags controlFlags {0};
+  bool valid {false};
+
+  // Reads back the results of queries written by the frame which last used this frame's pool, then resets it.
+  void readResults(Frame* frame);
+};
+
+void shutdownQueryPools();
+
+void registerQueryPool(QueryPoolImpl* pool);
+void unregisterQueryPool(QueryPoolImpl* pool);
+
+// Reads back and resets every query pool's queries for this frame.
+// Must be called at the beginning of a frame, after the frame's fence has been waited on.
+void updateQueryPools(Frame* frame);
+
+} // namespace hlgl
+#endif // HLGL_VK_QUERY_H
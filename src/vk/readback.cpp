@@ -0,0 +1,212 @@
+#include "readback.h"
+#include "buffer.h"
+#include "context.h"
+#include "frame.h"
+#include "texture.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+  // The smallest host buffer allocated for readbacks.  Larger requests get a buffer of their own size.
+  constexpr hlgl::DeviceSize minChunkSize_c {1 << 20};
+
+  struct Chunk {
+    VkBuffer buffer {nullptr};
+    VmaAllocation allocation {nullptr};
+    uint8_t* mapped {nullptr};
+    hlgl::DeviceSize size {0};
+  };
+
+  struct Request {
+    uint32_t chunk;
+    hlgl::DeviceSize offset;
+    hlgl::DeviceSize size;
+    hlgl::ReadbackFunc callback;
+  };
+
+  // Space is handed out linearly from the last chunk.  When it runs out another, larger chunk is added,
+  // and once the frame's readbacks have been resolved only the largest chunk is kept, so a frame settles on a single buffer.
+  struct FrameReadbacks {
+    std::vector<Chunk> chunks {};
+    hlgl::DeviceSize offset {0};
+    std::vector<Request> requests {};
+  };
+
+  std::array<FrameReadbacks, hlgl::numFramesInFlight_c> frames_s {};
+
+  bool addChunk(FrameReadbacks& frame, hlgl::DeviceSize minSize) {
+    using namespace hlgl;
+    DeviceSize size {frame.chunks.empty() ? minChunkSize_c : frame.chunks.back().size * 2};
+    size = std::max(size, minSize);
+
+    VkBufferCreateInfo bci {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .size = size,
+      .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE };
+    VmaAllocationCreateInfo aci {
+      .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+      .usage = VMA_MEMORY_USAGE_AUTO };
+    Chunk chunk {.size = size};
+    VmaAllocationInfo info {};
+    if (!VKCHECK(vmaCreateBuffer(getAllocator(), &bci, &aci, &chunk.buffer, &chunk.allocation, &info)) || !info.pMappedData) {
+      DEBUG_ERROR("Failed to allocate %llu bytes of readback memory.", (unsigned long long)size);
+      if (chunk.buffer)
+        vmaDestroyBuffer(getAllocator(), chunk.buffer, chunk.allocation);
+      return false;
+    }
+    chunk.mapped = (uint8_t*)info.pMappedData;
+    frame.chunks.push_back(chunk);
+    frame.offset = 0;
+    return true;
+  }
+
+  void resolve(FrameReadbacks& frame) {
+    using namespace hlgl;
+    // Callbacks are free to request more readbacks in later frames, so work from a copy of the list.
+    std::vector<Request> requests {std::move(frame.requests)};
+    frame.requests.clear();
+    for (Request& request : requests) {
+      const Chunk& chunk {frame.chunks[request.chunk]};
+      vmaInvalidateAllocation(getAllocator(), chunk.allocation, request.offset, request.size);
+      if (request.callback)
+        request.callback(chunk.mapped + request.offset, (size_t)request.size);
+    }
+
+    if (frame.chunks.size() > 1) {
+      for (size_t i {0}; i + 1 < frame.chunks.size(); ++i)
+        queueDeletion(DelQueueBuffer{.buffer = frame.chunks[i].buffer, .allocation = frame.chunks[i].allocation});
+      frame.chunks.erase(frame.chunks.begin(), frame.chunks.end() - 1);
+    }
+    frame.offset = 0;
+  }
+
+} // namespace
+
+hlgl::ReadbackAlloc hlgl::allocReadback(Frame* frame, DeviceSize size, DeviceSize alignment, ReadbackFunc&& callback) {
+  FrameReadbacks& readbacks {frames_s[frame->frameIndex]};
+  DeviceSize offset {(readbacks.offset + alignment - 1) / alignment * alignment};
+  if (readbacks.chunks.empty() || offset + size > readbacks.chunks.back().size) {
+    if (!addChunk(readbacks, size))
+      return {};
+    offset = 0;
+  }
+
+  readbacks.requests.push_back(Request{
+    .chunk = (uint32_t)readbacks.chunks.size() - 1,
+    .offset = offset,
+    .size = size,
+    .callback = std::move(callback) });
+  readbacks.offset = offset + size;
+  return ReadbackAlloc{.buffer = readbacks.chunks.back().buffer, .offset = offset};
+}
+
+void hlgl::readbackBarrier(VkCommandBuffer cmd) {
+  VkMemoryBarrier barrier {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+    .dstAccessMask = VK_ACCESS_HOST_READ_BIT };
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void hlgl::updateReadbacks(Frame* frame) {
+  resolve(frames_s[frame->frameIndex]);
+}
+
+void hlgl::shutdownReadbacks() {
+  for (FrameReadbacks& frame : frames_s) {
+    resolve(frame);
+    for (const Chunk& chunk : frame.chunks)
+      vmaDestroyBuffer(getAllocator(), chunk.buffer, chunk.allocation);
+    frame = FrameReadbacks{};
+  }
+}
+
+bool hlgl::Buffer::readbackAsync(DeviceSize offset, DeviceSize size, ReadbackFunc callback) {
+  Frame* frame {getCurrentFrame()};
+  if (!frame) {
+    DEBUG_ERROR("Can't call 'Buffer::readbackAsync' outside of a frame.");
+    return false;
+  }
+  if (!_pimpl)
+    return false;
+  if (!(_pimpl->usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT)) {
+    DEBUG_ERROR("Can't read back a buffer without the TransferSrc usage.");
+    return false;
+  }
+  if (offset >= _pimpl->size || (size && offset + size > _pimpl->size)) {
+    DEBUG_ERROR("Readback range is outside of the buffer.");
+    return false;
+  }
+  if (size == 0)
+    size = _pimpl->size - offset;
+
+  // Buffer copies have no alignment requirements, but 16 bytes keeps the data aligned for any type the callback reads it as.
+  ReadbackAlloc readback {allocReadback(frame, size, 16, std::move(callback))};
+  if (!readback.buffer)
+    return false;
+
+  endDrawing();
+  const uint32_t index {_pimpl->fifSynced ? frame->frameIndex : 0};
+  _pimpl->barrier(frame->cmd, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, index);
+  VkBufferCopy region {.srcOffset = offset, .dstOffset = readback.offset, .size = size};
+  vkCmdCopyBuffer(frame->cmd, _pimpl->buffer[index], readback.buffer, 1, &region);
+  readbackBarrier(frame->cmd);
+  return true;
+}
+
+bool hlgl::Texture::readbackAsync(ReadbackFunc callback, uint32_t mipLevel, uint32_t layer) {
+  Frame* frame {getCurrentFrame()};
+  if (!frame) {
+    DEBUG_ERROR("Can't call 'Texture::readbackAsync' outside of a frame.");
+    return false;
+  }
+  if (!_pimpl)
+    return false;
+  TextureImpl* impl {_pimpl.get()};
+  if (!(impl->usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+    DEBUG_ERROR("Can't read back texture '%s' without the TransferSrc usage.", impl->debugName.c_str());
+    return false;
+  }
+  if (mipLevel >= impl->mipCount || layer >= impl->layerCount) {
+    DEBUG_ERROR("Readback of texture '%s' is out of range (mip %u, layer %u).", impl->debugName.c_str(), mipLevel, layer);
+    return false;
+  }
+
+  const ImageFormat format {translate(impl->format)};
+  const bool depth {isFormatDepth(format)};
+  const size_t pixelSize {depth ? 4 : bytesPerPixel(format)};
+  if (pixelSize == 0) {
+    DEBUG_ERROR("Can't read back texture '%s', format '%s' isn't supported.", impl->debugName.c_str(), enumToStr(format));
+    return false;
+  }
+
+  const VkExtent3D extent {
+    std::max(1u, impl->extent.width >> mipLevel),
+    std::max(1u, impl->extent.height >> mipLevel),
+    std::max(1u, impl->extent.depth >> mipLevel) };
+  const DeviceSize size {(DeviceSize)extent.width * extent.height * extent.depth * pixelSize};
+  // Buffer-image copies need the offset to be a multiple of the texel size, and of 4 bytes for depth formats.
+  ReadbackAlloc readback {allocReadback(frame, size, std::lcm((DeviceSize)pixelSize, DeviceSize{4}), std::move(callback))};
+  if (!readback.buffer)
+    return false;
+
+  endDrawing();
+  impl->barrier(frame->cmd, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+  VkBufferImageCopy region {
+    .bufferOffset = readback.offset,
+    .imageSubresource = {
+      .aspectMask = depth ? (VkImageAspectFlags)VK_IMAGE_ASPECT_DEPTH_BIT : translateAspect(impl->format),
+      .mipLevel = impl->mipBase + mipLevel,
+      .baseArrayLayer = impl->layerBase + layer,
+      .layerCount = 1 },
+    .imageExtent = extent };
+  vkCmdCopyImageToBuffer(frame->cmd, impl->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &region);
+  readbackBarrier(frame->cmd);
+  impl->lastUsedFrame = (uint64_t)std::max<int64_t>(0, frame->frameCounter);
+  return true;
+}
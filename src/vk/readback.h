@@ -0,0 +1,28 @@
+#ifndef HLGL_VK_READBACK_H
+#define HLGL_VK_READBACK_H
+
+#include <hlgl.h>
+#include "vulkan-headers.h"
+
+namespace hlgl {
+
+struct ReadbackAlloc {
+  VkBuffer buffer {nullptr};
+  DeviceSize offset {0};
+};
+
+// Reserves 'size' bytes of this frame's host-visible readback memory, to be passed to 'callback' once the frame has finished on the GPU.
+// The region's offset is a multiple of 'alignment', which needn't be a power of two.
+// The caller records a copy into the returned region, followed by 'readbackBarrier'.  Returns a null buffer if the memory couldn't be allocated.
+ReadbackAlloc allocReadback(Frame* frame, DeviceSize size, DeviceSize alignment, ReadbackFunc&& callback);
+// Makes transfer writes into readback memory visible to the host once the frame's fence has been waited on.
+void readbackBarrier(VkCommandBuffer cmd);
+
+// Calls the callbacks of readbacks recorded by the frame which last used this frame's memory.
+// Must be called at the beginning of a frame, after the frame's fence has been waited on.
+void updateReadbacks(Frame* frame);
+// Calls any remaining callbacks and frees the readback memory.  The device must be idle.
+void shutdownReadbacks();
+
+} // namespace hlgl
+#endif // HLGL_VK_READBACK_H
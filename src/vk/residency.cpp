@@ -0,0 +1,209 @@
+#include "residency.h"
+#include "context.h"
+#include "frame.h"
+#include "texture.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+  bool memoryBudgetEnabled_s {false};
+  bool pageableMemoryEnabled_s {false};
+  std::vector<hlgl::TextureImpl*> textures_s {};
+  std::vector<hlgl::TextureImpl*> candidates_s {};
+  uint64_t nextCheckFrame_s {0};
+  bool constrained_s {false};
+
+  // Demotion begins when a device-local heap's usage passes the high water mark (as a fraction of its budget),
+  // and continues until usage is expected to drop below the low water mark.
+  constexpr double highWaterMark_c {0.95};
+  constexpr double lowWaterMark_c {0.85};
+  // Limits how much copying is done in a single frame.
+  constexpr uint32_t maxDemotionsPerFrame_c {8};
+  // A texture must have gone unused for this many frames before it's demoted, so no frame still in flight can be sampling it.
+  constexpr uint64_t minUnusedFrames_c {3};
+  // Memory freed by a demotion isn't released until the deletion queue catches up, so wait this long before checking the budget again.
+  constexpr uint64_t demotionCooldown_c {4};
+  // Textures won't be demoted below this size along their shortest axis.
+  constexpr uint32_t minDemotedSize_c {64};
+
+  // Memory pools for each memory type and priority level, created as needed.
+  std::array<std::array<VmaPool, hlgl::priorityLevels_c>, VK_MAX_MEMORY_TYPES> priorityPools_s {};
+
+} // namespace
+
+void hlgl::initResidency(bool memoryBudgetEnabled, bool pageableMemoryEnabled) {
+  memoryBudgetEnabled_s = memoryBudgetEnabled;
+  pageableMemoryEnabled_s = pageableMemoryEnabled;
+  textures_s.reserve(256);
+  nextCheckFrame_s = 0;
+  constrained_s = false;
+}
+
+void hlgl::shutdownResidency() {
+  textures_s.clear();
+  candidates_s.clear();
+  memoryBudgetEnabled_s = false;
+  pageableMemoryEnabled_s = false;
+  constrained_s = false;
+}
+
+bool hlgl::isPageableMemoryEnabled() { return pageableMemoryEnabled_s; }
+bool hlgl::isResidencyConstrained() { return constrained_s; }
+
+void hlgl::registerResidentTexture(TextureImpl* texture) {
+  textures_s.push_back(texture);
+}
+
+void hlgl::unregisterResidentTexture(TextureImpl* texture) {
+  auto it {std::find(textures_s.begin(), textures_s.end(), texture)};
+  if (it != textures_s.end()) {
+    *it = textures_s.back();
+    textures_s.pop_back();
+  }
+}
+
+void hlgl::updateResidency(Frame* frame) {
+  VmaAllocator allocator {getAllocator()};
+  const uint64_t frameCounter {(uint64_t)frame->frameCounter};
+
+  // Lets VMA know a new frame has started so it can refresh its cached budget numbers.
+  vmaSetCurrentFrameIndex(allocator, (uint32_t)frameCounter);
+
+  const VkPhysicalDeviceMemoryProperties* props {nullptr};
+  vmaGetMemoryProperties(allocator, &props);
+  std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets {};
+  vmaGetHeapBudgets(allocator, budgets.data());
+
+  // Anything which wants to grow (such as streaming textures) should hold off while a device-local heap is above the low water mark.
+  // Otherwise it would just push usage back up to where textures start being demoted again.
+  constrained_s = false;
+  for (uint32_t heap {0}; heap < props->memoryHeapCount; ++heap) {
+    if ((props->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) &&
+        budgets[heap].budget > 0 &&
+        (double)budgets[heap].usage >= (double)budgets[heap].budget * lowWaterMark_c)
+      constrained_s = true;
+  }
+
+  if (frameCounter < nextCheckFrame_s)
+    return;
+
+  uint32_t demotions {0};
+  for (uint32_t heap {0}; heap < props->memoryHeapCount && demotions < maxDemotionsPerFrame_c; ++heap) {
+    if (!(props->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+      continue;
+    const double budget {(double)budgets[heap].budget};
+    if (budget == 0.0 || (double)budgets[heap].usage < budget * highWaterMark_c)
+      continue;
+
+    int64_t bytesToFree {(int64_t)budgets[heap].usage - (int64_t)(budget * lowWaterMark_c)};
+
+    // Gather the evictable textures in this heap which haven't been used recently and still have mips to spare.
+    candidates_s.clear();
+    for (TextureImpl* texture : textures_s) {
+      if (texture->evictable &&
+          texture->mipCount > 1 &&
+          std::min(texture->extent.width, texture->extent.height) > minDemotedSize_c &&
+          texture->lastUsedFrame + minUnusedFrames_c <= frameCounter &&
+          props->memoryTypes[texture->allocInfo.memoryType].heapIndex == heap)
+      {
+        candidates_s.push_back(texture);
+      }
+    }
+
+    // Demote the lowest priority textures first, breaking ties by whichever frees the most memory.
+    // Recent use isn't taken into account, since textures which are only sampled through bindless descriptors are never marked as used.
+    std::sort(candidates_s.begin(), candidates_s.end(), [](const TextureImpl* a, const TextureImpl* b) {
+      if (a->priority != b->priority)
+        return (a->priority < b->priority);
+      return (a->allocInfo.size > b->allocInfo.size);
+    });
+
+    for (TextureImpl* texture : candidates_s) {
+      if (bytesToFree <= 0 || demotions >= maxDemotionsPerFrame_c)
+        break;
+      VkDeviceSize oldSize {texture->allocInfo.size};
+      if (!texture->dropMips(frame->cmd, 1))
+        continue;
+      bytesToFree -= (int64_t)oldSize - (int64_t)texture->allocInfo.size;
+      ++demotions;
+      DEBUG_VERBOSE("Demoted texture '%s' to %ux%u to stay within the GPU memory budget.",
+        texture->debugName.c_str(), texture->extent.width, texture->extent.height);
+    }
+  }
+
+  if (demotions > 0)
+    nextCheckFrame_s = frameCounter + demotionCooldown_c;
+}
+
+void hlgl::applyMemoryPriority(const VkImageCreateInfo& ici, VmaAllocationCreateInfo& aci) {
+  if (aci.priority == 0.5f || (aci.flags & VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT))
+    return;
+
+  VkDeviceImageMemoryRequirements dimr {
+    .sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS,
+    .pCreateInfo = &ici };
+  VkMemoryRequirements2 reqs {.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+  vkGetDeviceImageMemoryRequirements(getDevice(), &dimr, &reqs);
+  if (reqs.memoryRequirements.size >= minDedicatedPrioritySize_c) {
+    aci.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    return;
+  }
+
+  const uint32_t level {(uint32_t)std::lround(aci.priority * (float)(priorityLevels_c - 1))};
+  uint32_t memoryType {0};
+  if (!VKCHECK(vmaFindMemoryTypeIndexForImageInfo(getAllocator(), &ici, &aci, &memoryType)))
+    return;
+  VmaPool& pool {priorityPools_s[memoryType][level]};
+  if (!pool) {
+    VmaPoolCreateInfo pci {
+      .memoryTypeIndex = memoryType,
+      .priority = (float)level / (float)(priorityLevels_c - 1) };
+    if (!VKCHECK(vmaCreatePool(getAllocator(), &pci, &pool))) {
+      pool = nullptr;
+      return;
+    }
+  }
+  aci.pool = pool;
+}
+
+void hlgl::destroyMemoryPriorityPools() {
+  for (std::array<VmaPool, priorityLevels_c>& pools : priorityPools_s) {
+    for (VmaPool& pool : pools) {
+      if (pool) { vmaDestroyPool(getAllocator(), pool); pool = nullptr; }
+    }
+  }
+}
+
+hlgl::MemoryBudget hlgl::getMemoryBudget() {
+  MemoryBudget result {};
+  VmaAllocator allocator {getAllocator()};
+  if (!allocator)
+    return result;
+
+  const VkPhysicalDeviceMemoryProperties* props {nullptr};
+  vmaGetMemoryProperties(allocator, &props);
+  std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets {};
+  vmaGetHeapBudgets(allocator, budgets.data());
+
+  result.heapCount = std::min<uint32_t>(props->memoryHeapCount, (uint32_t)result.heaps.size());
+  for (uint32_t i {0}; i < result.heapCount; ++i) {
+    result.heaps[i] = MemoryBudget::Heap{
+      .size = props->memoryHeaps[i].size,
+      .budget = budgets[i].budget,
+      .usage = budgets[i].usage,
+      .allocated = budgets[i].statistics.blockBytes,
+      .deviceLocal = (props->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0 };
+  }
+
+  for (const TextureImpl* texture : textures_s) {
+    result.textureBytes += texture->allocInfo.size;
+    if (texture->evictable)
+      result.evictableTextureBytes += texture->allocInfo.size;
+  }
+  result.fromDriver = memoryBudgetEnabled_s;
+  return result;
+}
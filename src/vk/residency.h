@@ -0,0 +1,35 @@
+#ifndef HLGL_VK_RESIDENCY_H
+#define HLGL_VK_RESIDENCY_H
+
+#include <hlgl.h>
+#include "vulkan-headers.h"
+
+namespace hlgl {
+
+// Tell the residency manager which memory extensions were enabled when the device was created.
+void initResidency(bool memoryBudgetEnabled, bool pageableMemoryEnabled);
+void shutdownResidency();
+bool isPageableMemoryEnabled();
+// True while device-local memory usage is high enough that nothing should grow its footprint voluntarily.
+bool isResidencyConstrained();
+
+// Memory priority only applies to whole VkDeviceMemory blocks.  Images at least 'minDedicatedPrioritySize_c' bytes get a dedicated
+// allocation with their exact priority.  Smaller ones go into a pool of blocks shared by images of the same memory type and similar
+// priority (rounded to 'priorityLevels_c' steps), so setting priorities on many small textures doesn't use up 'maxMemoryAllocationCount'.
+// Does nothing for the default priority of 0.5 or allocations which are already dedicated.
+constexpr VkDeviceSize minDedicatedPrioritySize_c {16 << 20};
+constexpr uint32_t priorityLevels_c {5};
+void applyMemoryPriority(const VkImageCreateInfo& ici, VmaAllocationCreateInfo& aci);
+// Destroys the pools made by 'applyMemoryPriority'.  Every image allocated from them must have been freed.
+void destroyMemoryPriorityPools();
+
+// Every texture which owns memory is registered so its size and last use can be tracked.
+void registerResidentTexture(TextureImpl* texture);
+void unregisterResidentTexture(TextureImpl* texture);
+
+// Checks the memory heaps against their budgets, demoting evictable textures if a device-local heap is over budget.
+// Must be called at the beginning of a frame, after the frame's fence has been waited on and its command buffer has begun recording.
+void updateResidency(Frame* frame);
+
+} // namespace hlgl
+#endif // HLGL_VK_RESIDENCY_H
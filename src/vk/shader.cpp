@@ -1,13 +1,126 @@
 #include "shader.h"
 #include "context.h"
+#include "../utils/trace.h"
 
 #include <slang/slang.h>
 #include <slang/slang-com-ptr.h>
 
+#include <cctype>
+#include <cstring>
+#include <string>
+
 namespace {
 
   Slang::ComPtr<slang::IGlobalSession> slangGlobalSession_s {nullptr};
 
+  // Decodes 'hlgl::QuantizedVertex'.  Fields are read as 32-bit words so the layout matches the C++ struct without needing 16-bit storage.
+  constexpr const char* vertexModuleSrc_c = R"(
+    public struct QuantizedVertex {
+      public uint positionXY;
+      public uint positionZ;
+      public uint normal;
+      public uint tangent;
+      public uint uv;
+    };
+
+    public struct QuantizationBounds {
+      public float3 positionMin;
+      public float padding0;
+      public float3 positionExtent;
+      public float padding1;
+      public float2 uvMin;
+      public float2 uvExtent;
+    };
+
+    public struct DecodedVertex {
+      public float3 position;
+      public float3 normal;
+      public float4 tangent;  // w is the bitangent sign.
+      public float2 uv;
+    };
+
+    public float2 unpackUnorm16x2(uint packed) {
+      return float2(packed & 0xffff, packed >> 16) / 65535.0;
+    }
+
+    public float2 unpackSnorm16x2(uint packed) {
+      int2 v = int2(int(packed << 16) >> 16, int(packed) >> 16);
+      return max(float2(v) / 32767.0, -1.0);
+    }
+
+    public float3 decodeOctahedral(float2 e) {
+      float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+      float t = saturate(-n.z);
+      n.x += (n.x >= 0.0) ? -t : t;
+      n.y += (n.y >= 0.0) ? -t : t;
+      return normalize(n);
+    }
+
+    // For 'PositionEncoding::Unorm16'.
+    public float3 decodePosition(QuantizedVertex v, QuantizationBounds bounds) {
+      float3 q = float3(unpackUnorm16x2(v.positionXY), float(v.positionZ & 0xffff) / 65535.0);
+      return bounds.positionMin + q * bounds.positionExtent;
+    }
+
+    // For 'PositionEncoding::Half'.
+    public float3 decodePositionHalf(QuantizedVertex v) {
+      return float3(f16tof32(v.positionXY), f16tof32(v.positionXY >> 16), f16tof32(v.positionZ));
+    }
+
+    public float3 decodeNormal(QuantizedVertex v) {
+      return decodeOctahedral(unpackSnorm16x2(v.normal));
+    }
+
+    public float4 decodeTangent(QuantizedVertex v) {
+      float3 t = decodeOctahedral(unpackSnorm16x2(v.tangent & ~0x10000u));
+      return float4(t, ((v.tangent & 0x10000u) != 0) ? -1.0 : 1.0);
+    }
+
+    public float2 decodeUV(QuantizedVertex v, QuantizationBounds bounds) {
+      return bounds.uvMin + unpackUnorm16x2(v.uv) * bounds.uvExtent;
+    }
+
+    // Decodes every attribute, assuming positions are 'PositionEncoding::Unorm16'.
+    public DecodedVertex decodeVertex(QuantizedVertex v, QuantizationBounds bounds) {
+      DecodedVertex d;
+      d.position = decodePosition(v, bounds);
+      d.normal = decodeNormal(v);
+      d.tangent = decodeTangent(v);
+      d.uv = decodeUV(v, bounds);
+      return d;
+    }
+  )";
+
+  // Modules which any shader can import, loaded into a shader's session when its source mentions them.
+  struct BuiltinModule {
+    const char* name;
+    const char* src;
+  };
+  constexpr BuiltinModule builtinModules_c[] {
+    {"hlgl_vertex", vertexModuleSrc_c},
+  };
+
+  bool isIdentifierChar(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+  }
+
+  // Whether 'src' has an 'import' of the module 'name', so builtin modules are only compiled for the shaders which use them.
+  // Mentions of the name elsewhere, or of modules which merely start with it, don't count.
+  bool importsModule(const char* src, const char* name) {
+    constexpr const char* keyword_c {"import"};
+    const size_t keywordLen {strlen(keyword_c)}, nameLen {strlen(name)};
+    for (const char* at {strstr(src, keyword_c)}; at; at = strstr(at + 1, keyword_c)) {
+      if ((at > src && isIdentifierChar(at[-1])) || !isspace((unsigned char)at[keywordLen]))
+        continue;
+      const char* module {at + keywordLen};
+      while (isspace((unsigned char)*module))
+        ++module;
+      if (strncmp(module, name, nameLen) == 0 && !isIdentifierChar(module[nameLen]))
+        return true;
+    }
+    return false;
+  }
+
 } // namespace <anon>
 
 hlgl::Shader::Shader(Shader::CreateParams params)
@@ -16,6 +129,7 @@ hlgl::Shader::Shader(Shader::CreateParams params)
 
 hlgl::ShaderImpl::ShaderImpl(Shader::CreateParams&& params)
 {
+  HLGL_TRACE_SCOPE("Create shader");
   if (!slangGlobalSession_s) {
     SlangGlobalSessionDesc desc {.enableGLSL = true};
     slang::createGlobalSession(&desc, slangGlobalSession_s.writeRef());
@@ -42,6 +156,19 @@ hlgl::ShaderImpl::ShaderImpl(Shader::CreateParams&& params)
     slangGlobalSession_s->createSession(slangSessionDesc, slangSession.writeRef());
 
     Slang::ComPtr<slang::IBlob> diagnostic;
+    for (const BuiltinModule& builtin : builtinModules_c) {
+      if (!importsModule(params.src, builtin.name))
+        continue;
+      std::string path {std::string(builtin.name) + ".slang"};
+      if (!slangSession->loadModuleFromSourceString(builtin.name, path.c_str(), builtin.src, diagnostic.writeRef())) {
+        if (diagnostic)
+          { DEBUG_ERROR("Failed to compile builtin shader module '%s': %s", builtin.name, (const char*)diagnostic->getBufferPointer()); }
+        else
+          { DEBUG_ERROR("Failed to compile builtin shader module '%s'.", builtin.name); }
+        return;
+      }
+    }
+
     Slang::ComPtr<slang::IModule> slangModule { slangSession->loadModuleFromSourceString(params.debugName, nullptr, params.src, diagnostic.writeRef()) };
     if (!slangModule) {
       if (diagnostic)
@@ -0,0 +1,107 @@
+#include "streaming.h"
+#include "buffer.h"
+#include "context.h"
+#include "frame.h"
+#include "residency.h"
+#include "texture.h"
+#include "../utils/thread-pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+  std::vector<hlgl::TextureImpl*> textures_s {};
+
+  // Limits how many mip levels are uploaded (or dropped) in a single frame, to bound the staging memory and copies recorded.
+  constexpr uint32_t maxUpdatesPerFrame_c {4};
+
+  bool isReady(const std::future<void>& future) {
+    return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  // Copies a mip level's data from the mapped file into its place in the image, then moves the view up to include it.
+  bool promote(VkCommandBuffer cmd, hlgl::TextureImpl* texture, uint32_t mip) {
+    using namespace hlgl;
+    const Ktx2Header& header {texture->stream->header};
+    const Ktx2Header::Level& level {header.levels[mip]};
+    const uint32_t numImages {header.imagesPerLevel()};
+
+    StagingAlloc staging {allocStaging(level.length)};
+    uint32_t imageMip {0};
+    if (!staging.ptr || !texture->prepareMip(cmd, mip, imageMip))
+      return false;
+    memcpy(staging.ptr, texture->stream->file->data() + level.offset, level.length);
+
+    // Each layer (or cubemap face) is stored contiguously within the level.
+    const DeviceSize imageSize {level.length / numImages};
+    std::vector<VkBufferImageCopy> regions(numImages);
+    for (uint32_t i {0}; i < numImages; ++i) {
+      regions[i] = VkBufferImageCopy{
+        .bufferOffset = staging.offset + i * imageSize,
+        .imageSubresource = {.aspectMask = translateAspect(texture->format), .mipLevel = imageMip, .baseArrayLayer = texture->layerBase + i, .layerCount = 1},
+        .imageExtent = {.width = std::max(1u, header.width >> mip), .height = std::max(1u, header.height >> mip), .depth = 1} };
+    }
+    vkCmdCopyBufferToImage(cmd, staging.buffer->buffer[0], texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+    return texture->setViewMip(cmd, mip);
+  }
+
+} // namespace
+
+void hlgl::shutdownStreaming() {
+  // Any prefetches still in flight hold their own reference to the mapped file, so they can simply be abandoned.
+  for (TextureImpl* texture : textures_s)
+    texture->stream->pending = {};
+  textures_s.clear();
+}
+
+void hlgl::registerStreamingTexture(TextureImpl* texture) {
+  textures_s.push_back(texture);
+}
+
+void hlgl::unregisterStreamingTexture(TextureImpl* texture) {
+  auto it {std::find(textures_s.begin(), textures_s.end(), texture)};
+  if (it != textures_s.end()) {
+    *it = textures_s.back();
+    textures_s.pop_back();
+  }
+}
+
+void hlgl::updateStreaming(Frame* frame) {
+  const bool constrained {isResidencyConstrained()};
+  uint32_t updates {0};
+
+  for (TextureImpl* texture : textures_s) {
+    TextureStream& stream {*texture->stream};
+
+    // Upload the level which has finished paging in, provided it's still wanted.
+    if (isReady(stream.pending)) {
+      if (updates >= maxUpdatesPerFrame_c)
+        continue;
+      stream.pending.get();
+      if (!constrained && stream.pendingMip + 1 == texture->droppedMips && stream.requestedMip < texture->droppedMips) {
+        if (promote(frame->cmd, texture, stream.pendingMip))
+          ++updates;
+      }
+      continue;
+    }
+    if (stream.pending.valid())
+      continue;
+
+    // Start paging in the next larger mip level, so the copy into the staging buffer doesn't stall on disk reads.
+    // Memory pressure takes precedence over requested detail.
+    if (stream.requestedMip < texture->droppedMips && !constrained) {
+      stream.pendingMip = texture->droppedMips - 1;
+      stream.pending = getThreadPool().submit([file = stream.file, level = stream.header.levels[stream.pendingMip]]() {
+        file->prefetch(level.offset, level.length);
+      });
+    }
+    // Drop the largest mip level once it's no longer wanted.  That only moves the view, unless memory is short and the image has to shrink.
+    else if (stream.requestedMip > texture->droppedMips && updates < maxUpdatesPerFrame_c) {
+      if (constrained ? texture->dropMips(frame->cmd, 1) : texture->setViewMip(frame->cmd, texture->droppedMips + 1))
+        ++updates;
+    }
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef HLGL_VK_STREAMING_H
+#define HLGL_VK_STREAMING_H
+
+#include <hlgl.h>
+#include "vulkan-headers.h"
+#include "../utils/ktx2.h"
+#include "../utils/mapped-file.h"
+
+#include <future>
+#include <memory>
+#include <string>
+
+namespace hlgl {
+
+// State kept by a texture which was loaded from KTX in streaming mode.
+// Only the smallest mip levels are loaded up front.  The file stays mapped, and the rest are paged in on a worker thread as they're requested.
+struct TextureStream {
+  std::string filename {};
+  std::shared_ptr<MappedFile> file {};
+  Ktx2Header header {};
+  uint32_t requestedMip {0};  // The highest-resolution mip level the user wants resident.
+  uint32_t pendingMip {0};    // The mip level currently being paged in, if 'pending' is valid.
+  std::future<void> pending {};
+};
+
+void shutdownStreaming();
+
+void registerStreamingTexture(TextureImpl* texture);
+void unregisterStreamingTexture(TextureImpl* texture);
+
+// Starts paging in the next mip level of any texture which has requested more detail, and uploads any levels which are ready.
+// Textures which have requested less detail than they have drop their largest level.
+// Must be called at the beginning of a frame, after the frame's command buffer has begun recording.
+void updateStreaming(Frame* frame);
+
+} // namespace hlgl
+#endif // HLGL_VK_STREAMING_H
@@ -0,0 +1,427 @@
+#include "texture-atlas.h"
+#include "buffer.h"
+#include "context.h"
+#include "frame.h"
+#include "texture.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+  // Records 'func' into the current frame if there is one, otherwise into a command buffer which is executed immediately.
+  template <typename Func>
+  void recordTransfer(Func&& func) {
+    if (hlgl::Frame* frame {hlgl::getCurrentFrame()}; frame) {
+      hlgl::endDrawing();
+      func(frame->cmd);
+    }
+    else {
+      VkCommandBuffer cmd = hlgl::beginImmediateCmd();
+      func(cmd);
+      hlgl::submitImmediateCmd(cmd);
+    }
+  }
+
+  void beginWrite(VkCommandBuffer cmd, hlgl::TextureImpl* texture) {
+    texture->barrier(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+  }
+
+  void endWrite(VkCommandBuffer cmd, hlgl::TextureImpl* texture) {
+    texture->barrier(cmd, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+  }
+
+  // The number of bytes a 'width' by 'height' image takes up in 'format'.  Compressed formats are all stored in 4x4 blocks.
+  uint64_t imageSize(hlgl::ImageFormat format, uint32_t width, uint32_t height) {
+    using hlgl::ImageFormat;
+    if (!hlgl::isFormatCompressed(format))
+      return (uint64_t)width * height * hlgl::bytesPerPixel(format);
+    uint64_t bytesPerBlock {16};
+    switch (format) {
+    case ImageFormat::BC1RGB: case ImageFormat::BC1RGB_srgb: case ImageFormat::BC1RGBA: case ImageFormat::BC1RGBA_srgb:
+    case ImageFormat::BC4u: case ImageFormat::BC4s:
+    case ImageFormat::ETC2RGB: case ImageFormat::ETC2RGB_srgb:
+    case ImageFormat::EACR11u: case ImageFormat::EACR11s:
+      bytesPerBlock = 8;
+      break;
+    default:
+      break;
+    }
+    return (uint64_t)((width + 3) / 4) * ((height + 3) / 4) * bytesPerBlock;
+  }
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// TextureArrayPool
+
+hlgl::TextureArrayPool::TextureArrayPool(TextureArrayPool::CreateParams params)
+: _pimpl(std::make_unique<TextureArrayPoolImpl>(std::move(params)))
+{ if (!_pimpl->valid) _pimpl.reset(); }
+
+hlgl::TextureArrayPool::~TextureArrayPool() {}
+
+hlgl::TextureArrayPoolImpl::TextureArrayPoolImpl(TextureArrayPool::CreateParams&& createParams)
+: params(std::move(createParams))
+{
+  const char* name {params.debugName ? params.debugName : "?"};
+  if (params.width == 0 || params.height == 0 || params.format == ImageFormat::Undefined) {
+    DEBUG_ERROR("Texture array pool '%s' must have a size and format.", name);
+    return;
+  }
+  const uint32_t maxLayers {getDeviceProperties().limits.maxImageArrayLayers};
+  if (params.layersPerArray == 0 || params.layersPerArray > maxLayers) {
+    DEBUG_ERROR("Texture array pool '%s' has %u layers per array, but the GPU supports 1 to %u.", name, params.layersPerArray, maxLayers);
+    return;
+  }
+  uint32_t largest {std::max(params.width, params.height)};
+  uint32_t maxMips {1};
+  while (largest >>= 1)
+    ++maxMips;
+  params.mipCount = std::clamp(params.mipCount, 1u, maxMips);
+  valid = true;
+}
+
+bool hlgl::TextureArrayPoolImpl::allocLayer(uint32_t& index) {
+  while (nextFree < usedLayers.size() && usedLayers[nextFree])
+    ++nextFree;
+  if (nextFree == usedLayers.size()) {
+    Texture array(Texture::CreateParams{
+      .usage = TextureUsage::TransferDst | TextureUsage::ArrayView,
+      .width = params.width,
+      .height = params.height,
+      .mipCount = params.mipCount,
+      .layerCount = params.layersPerArray,
+      .format = params.format,
+      .debugName = params.debugName,
+      .sampler = params.sampler });
+    if (!array.isValid())
+      return false;
+    arrays.push_back(std::move(array));
+    usedLayers.resize(usedLayers.size() + params.layersPerArray, false);
+  }
+  index = nextFree++;
+  usedLayers[index] = true;
+  ++numUsed;
+  return true;
+}
+
+hlgl::TextureRegion hlgl::TextureArrayPoolImpl::makeRegion(uint32_t index) const {
+  return TextureRegion{
+    .handle = index + 1,
+    .samplerIndex = arrays[index / params.layersPerArray].getSamplerIndex(),
+    .layer = index % params.layersPerArray };
+}
+
+hlgl::TextureRegion hlgl::TextureArrayPool::insert(const void* data, uint64_t dataSize, const Texture::Offset* offsets, uint32_t numOffsets) {
+  if (!_pimpl || !data) return {};
+  const TextureArrayPool::CreateParams& params {_pimpl->params};
+
+  if (dataSize == 0) {
+    if (isFormatCompressed(params.format)) {
+      DEBUG_ERROR("Inserting into texture array pool '%s' requires a data size for compressed formats.", params.debugName ? params.debugName : "?");
+      return {};
+    }
+    dataSize = (uint64_t)params.width * params.height * bytesPerPixel(params.format);
+  }
+
+  // One region per mip level, taken from the offsets if there are any.  Levels the pool doesn't have are skipped.
+  std::vector<VkBufferImageCopy> regions {};
+  if (offsets && numOffsets > 0) {
+    for (uint32_t i {0}; i < numOffsets; ++i) {
+      const uint32_t mip {offsets[i].mipLevel};
+      if (mip >= params.mipCount)
+        continue;
+      regions.push_back(VkBufferImageCopy{
+        .bufferOffset = offsets[i].offset,
+        .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = mip, .layerCount = 1},
+        .imageExtent = {std::max(params.width >> mip, 1u), std::max(params.height >> mip, 1u), 1} });
+    }
+  }
+  else {
+    regions.push_back(VkBufferImageCopy{
+      .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .layerCount = 1},
+      .imageExtent = {params.width, params.height, 1} });
+  }
+  if (regions.empty())
+    return {};
+
+  // Every region must lie within the data, or the copy would read past the end of the staging allocation.
+  for (const VkBufferImageCopy& region : regions) {
+    const uint64_t size {imageSize(params.format, region.imageExtent.width, region.imageExtent.height)};
+    if (region.bufferOffset > dataSize || size > dataSize - region.bufferOffset) {
+      DEBUG_ERROR("Data inserted into texture array pool '%s' is too small for mip level %u (%llu bytes at offset %llu, but only %llu given).",
+        params.debugName ? params.debugName : "?", region.imageSubresource.mipLevel,
+        (unsigned long long)size, (unsigned long long)region.bufferOffset, (unsigned long long)dataSize);
+      return {};
+    }
+  }
+
+  StagingAlloc staging {allocStaging(dataSize)};
+  if (!staging.ptr)
+    return {};
+  uint32_t index {0};
+  if (!_pimpl->allocLayer(index))
+    return {};
+  memcpy(staging.ptr, data, dataSize);
+
+  const uint32_t layer {index % params.layersPerArray};
+  for (VkBufferImageCopy& region : regions) {
+    region.bufferOffset += staging.offset;
+    region.imageSubresource.baseArrayLayer = layer;
+  }
+
+  TextureImpl* dst {_pimpl->arrays[index / params.layersPerArray]._pimpl.get()};
+  recordTransfer([&](VkCommandBuffer cmd) {
+    beginWrite(cmd, dst);
+    vkCmdCopyBufferToImage(cmd, staging.buffer->buffer[0], dst->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+    endWrite(cmd, dst);
+  });
+  return _pimpl->makeRegion(index);
+}
+
+hlgl::TextureRegion hlgl::TextureArrayPool::insert(const Texture& texture) {
+  if (!_pimpl || !texture.isValid()) return {};
+  const TextureArrayPool::CreateParams& params {_pimpl->params};
+  TextureImpl* src {texture._pimpl.get()};
+
+  if (src->extent.width != params.width || src->extent.height != params.height || src->format != translate(params.format)) {
+    DEBUG_ERROR("Texture '%s' doesn't match the size and format of texture array pool '%s'.", src->debugName.c_str(), params.debugName ? params.debugName : "?");
+    return {};
+  }
+  if (!(src->usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+    DEBUG_ERROR("Texture '%s' must have the TransferSrc usage to be copied into a texture array pool.", src->debugName.c_str());
+    return {};
+  }
+
+  uint32_t index {0};
+  if (!_pimpl->allocLayer(index))
+    return {};
+
+  std::vector<VkImageCopy> regions {};
+  for (uint32_t mip {0}; mip < std::min(src->mipCount, params.mipCount); ++mip) {
+    regions.push_back(VkImageCopy{
+      .srcSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = mip, .baseArrayLayer = 0, .layerCount = 1},
+      .dstSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = mip, .baseArrayLayer = index % params.layersPerArray, .layerCount = 1},
+      .extent = {std::max(params.width >> mip, 1u), std::max(params.height >> mip, 1u), 1} });
+  }
+
+  TextureImpl* dst {_pimpl->arrays[index / params.layersPerArray]._pimpl.get()};
+  recordTransfer([&](VkCommandBuffer cmd) {
+    VkImageLayout srcLayout {src->layout};
+    src->barrier(cmd, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    beginWrite(cmd, dst);
+    vkCmdCopyImage(cmd, src->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+    endWrite(cmd, dst);
+    if (srcLayout != VK_IMAGE_LAYOUT_UNDEFINED && srcLayout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+      src->barrier(cmd, srcLayout, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+  });
+  return _pimpl->makeRegion(index);
+}
+
+void hlgl::TextureArrayPool::remove(const TextureRegion& region) {
+  if (!_pimpl || region.handle == 0 || region.handle > _pimpl->usedLayers.size()) return;
+  const uint32_t index {region.handle - 1};
+  if (!_pimpl->usedLayers[index]) return;
+  _pimpl->usedLayers[index] = false;
+  _pimpl->nextFree = std::min(_pimpl->nextFree, index);
+  --_pimpl->numUsed;
+}
+
+uint32_t hlgl::TextureArrayPool::getArrayCount() const {
+  return _pimpl ? (uint32_t)_pimpl->arrays.size() : 0;
+}
+
+uint32_t hlgl::TextureArrayPool::getUsedLayerCount() const {
+  return _pimpl ? _pimpl->numUsed : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// TextureAtlas
+
+hlgl::TextureAtlas::TextureAtlas(TextureAtlas::CreateParams params)
+: _pimpl(std::make_unique<TextureAtlasImpl>(std::move(params)))
+{ if (!_pimpl->valid) _pimpl.reset(); }
+
+hlgl::TextureAtlas::~TextureAtlas() {}
+
+hlgl::TextureAtlasImpl::TextureAtlasImpl(TextureAtlas::CreateParams&& createParams)
+: params(std::move(createParams))
+{
+  const char* name {params.debugName ? params.debugName : "?"};
+  if (params.format == ImageFormat::Undefined || isFormatCompressed(params.format)) {
+    DEBUG_ERROR("Texture atlas '%s' must have an uncompressed format.", name);
+    return;
+  }
+  const uint32_t maxDimension {getDeviceProperties().limits.maxImageDimension2D};
+  if (params.width == 0 || params.height == 0 || params.width > maxDimension || params.height > maxDimension) {
+    DEBUG_ERROR("Texture atlas '%s' has an invalid page size.", name);
+    return;
+  }
+  pixelSize = bytesPerPixel(params.format);
+  valid = true;
+}
+
+bool hlgl::TextureAtlasImpl::place(uint32_t width, uint32_t height, Alloc& alloc) {
+  if (width > params.width || height > params.height)
+    return false;
+
+  auto takeSpan = [&](uint32_t page, uint32_t shelf) {
+    std::vector<std::pair<uint32_t,uint32_t>>& spans {pages[page].shelves[shelf].freeSpans};
+    auto span {std::find_if(spans.begin(), spans.end(), [&](const auto& s) { return s.second >= width; })};
+    alloc = Alloc{.page = page, .shelf = shelf, .x = span->first, .width = width};
+    span->first += width;
+    span->second -= width;
+    if (span->second == 0)
+      spans.erase(span);
+  };
+  auto hasSpan = [&](const Shelf& shelf) {
+    return std::any_of(shelf.freeSpans.begin(), shelf.freeSpans.end(), [&](const auto& s) { return s.second >= width; });
+  };
+
+  for (uint32_t p {0}; p < (uint32_t)pages.size(); ++p) {
+    Page& page {pages[p]};
+
+    // Prefer the shelf which wastes the least height.
+    int32_t best {-1};
+    for (uint32_t s {0}; s < (uint32_t)page.shelves.size(); ++s) {
+      const Shelf& shelf {page.shelves[s]};
+      if (shelf.height >= height && hasSpan(shelf) && (best < 0 || shelf.height < page.shelves[best].height))
+        best = (int32_t)s;
+    }
+
+    // Start a new shelf rather than put a short image on a much taller one, as long as there's room.
+    const bool wasteful {best < 0 || page.shelves[best].height - height > height / 2};
+    if (wasteful && page.top + height <= params.height) {
+      page.shelves.push_back(Shelf{.y = page.top, .height = height, .freeSpans = {{0, params.width}}});
+      page.top += height;
+      takeSpan(p, (uint32_t)page.shelves.size() - 1);
+      return true;
+    }
+    if (best >= 0) {
+      takeSpan(p, (uint32_t)best);
+      return true;
+    }
+  }
+
+  Texture texture(Texture::CreateParams{
+    .usage = TextureUsage::TransferDst,
+    .width = params.width,
+    .height = params.height,
+    .format = params.format,
+    .debugName = params.debugName,
+    .sampler = params.sampler });
+  if (!texture.isValid())
+    return false;
+  pages.push_back(Page{.texture = std::move(texture), .shelves = {Shelf{.y = 0, .height = height, .freeSpans = {{0, params.width}}}}, .top = height});
+  takeSpan((uint32_t)pages.size() - 1, 0);
+  return true;
+}
+
+void hlgl::TextureAtlasImpl::release(const Alloc& alloc) {
+  Page& page {pages[alloc.page]};
+  std::vector<std::pair<uint32_t,uint32_t>>& spans {page.shelves[alloc.shelf].freeSpans};
+
+  // Insert the span in order, then merge it with its neighbors.
+  auto it {std::lower_bound(spans.begin(), spans.end(), std::make_pair(alloc.x, 0u))};
+  it = spans.insert(it, {alloc.x, alloc.width});
+  if (auto next {it + 1}; next != spans.end() && it->first + it->second == next->first) {
+    it->second += next->second;
+    spans.erase(next);
+  }
+  if (it != spans.begin()) {
+    if (auto prev {it - 1}; prev->first + prev->second == it->first) {
+      prev->second += it->second;
+      spans.erase(it);
+    }
+  }
+
+  // Empty shelves at the bottom of the page are removed, so their height can go to shelves of a different size.
+  while (!page.shelves.empty()) {
+    const Shelf& last {page.shelves.back()};
+    if (last.freeSpans.size() != 1 || last.freeSpans[0].second != params.width)
+      break;
+    page.top = last.y;
+    page.shelves.pop_back();
+  }
+}
+
+hlgl::TextureRegion hlgl::TextureAtlas::insert(uint32_t width, uint32_t height, const void* data) {
+  if (!_pimpl || !data || width == 0 || height == 0) return {};
+  const TextureAtlas::CreateParams& params {_pimpl->params};
+  const uint32_t pad {params.padding};
+  const uint32_t paddedWidth {width + pad * 2}, paddedHeight {height + pad * 2};
+  const size_t pixelSize {_pimpl->pixelSize};
+
+  StagingAlloc staging {allocStaging((DeviceSize)paddedWidth * paddedHeight * pixelSize)};
+  if (!staging.ptr)
+    return {};
+
+  TextureAtlasImpl::Alloc alloc {};
+  if (!_pimpl->place(paddedWidth, paddedHeight, alloc)) {
+    DEBUG_ERROR("Failed to fit a %ux%u image into texture atlas '%s'.", width, height, params.debugName ? params.debugName : "?");
+    return {};
+  }
+
+  // Copy the image into the staging buffer with its edge rows and columns repeated into the padding.
+  const uint8_t* src {(const uint8_t*)data};
+  uint8_t* dst {(uint8_t*)staging.ptr};
+  for (uint32_t y {0}; y < paddedHeight; ++y) {
+    const uint8_t* srcRow {src + (size_t)std::clamp<int64_t>((int64_t)y - pad, 0, height - 1) * width * pixelSize};
+    uint8_t* dstRow {dst + (size_t)y * paddedWidth * pixelSize};
+    for (uint32_t x {0}; x < pad; ++x) {
+      memcpy(dstRow + x * pixelSize, srcRow, pixelSize);
+      memcpy(dstRow + (pad + width + x) * pixelSize, srcRow + (width - 1) * pixelSize, pixelSize);
+    }
+    memcpy(dstRow + pad * pixelSize, srcRow, width * pixelSize);
+  }
+
+  uint32_t handle {0};
+  if (_pimpl->freeAllocs.empty()) {
+    _pimpl->allocs.push_back(alloc);
+    handle = (uint32_t)_pimpl->allocs.size();
+  }
+  else {
+    handle = _pimpl->freeAllocs.back() + 1;
+    _pimpl->freeAllocs.pop_back();
+    _pimpl->allocs[handle - 1] = alloc;
+  }
+
+  TextureAtlasImpl::Page& page {_pimpl->pages[alloc.page]};
+  const uint32_t top {page.shelves[alloc.shelf].y};
+  TextureImpl* texture {page.texture._pimpl.get()};
+  VkBufferImageCopy region {
+    .bufferOffset = staging.offset,
+    .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
+    .imageOffset = {(int32_t)alloc.x, (int32_t)top, 0},
+    .imageExtent = {paddedWidth, paddedHeight, 1} };
+  recordTransfer([&](VkCommandBuffer cmd) {
+    beginWrite(cmd, texture);
+    vkCmdCopyBufferToImage(cmd, staging.buffer->buffer[0], texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    endWrite(cmd, texture);
+  });
+
+  return TextureRegion{
+    .handle = handle,
+    .samplerIndex = page.texture.getSamplerIndex(),
+    .layer = 0,
+    .uvOffset = {(float)(alloc.x + pad) / params.width, (float)(top + pad) / params.height},
+    .uvScale = {(float)width / params.width, (float)height / params.height} };
+}
+
+void hlgl::TextureAtlas::remove(const TextureRegion& region) {
+  if (!_pimpl || region.handle == 0 || region.handle > _pimpl->allocs.size()) return;
+  TextureAtlasImpl::Alloc& alloc {_pimpl->allocs[region.handle - 1]};
+  if (alloc.width == 0) return;
+  _pimpl->release(alloc);
+  alloc.width = 0;
+  _pimpl->freeAllocs.push_back(region.handle - 1);
+}
+
+uint32_t hlgl::TextureAtlas::getPageCount() const {
+  return _pimpl ? (uint32_t)_pimpl->pages.size() : 0;
+}
+
+uint32_t hlgl::TextureAtlas::getRegionCount() const {
+  return _pimpl ? (uint32_t)(_pimpl->allocs.size() - _pimpl->freeAllocs.size()) : 0;
+}
@@ -0,0 +1,63 @@
+#ifndef HLGL_VK_TEXTURE_ATLAS_H
+#define HLGL_VK_TEXTURE_ATLAS_H
+
+#include <hlgl.h>
+#include "vulkan-headers.h"
+
+#include <vector>
+
+namespace hlgl {
+
+struct TextureArrayPoolImpl {
+  TextureArrayPoolImpl(TextureArrayPool::CreateParams&& params);
+
+  TextureArrayPool::CreateParams params {};
+  std::vector<Texture> arrays {};
+  std::vector<bool> usedLayers {};    // One per layer of every array, indexed by (array * layersPerArray + layer).
+  uint32_t numUsed {0};
+  uint32_t nextFree {0};              // No layer before this one is free.
+  bool valid {false};
+
+  // Finds a free layer, adding another array texture if there are none.  Returns false if the array couldn't be created.
+  bool allocLayer(uint32_t& index);
+  TextureRegion makeRegion(uint32_t index) const;
+};
+
+struct TextureAtlasImpl {
+  TextureAtlasImpl(TextureAtlas::CreateParams&& params);
+
+  // A row of a page, as tall as the first image placed in it.  Free spans are kept sorted and merged as images are removed.
+  struct Shelf {
+    uint32_t y {0};
+    uint32_t height {0};
+    std::vector<std::pair<uint32_t,uint32_t>> freeSpans {};   // {x, width}
+  };
+
+  struct Page {
+    Texture texture;
+    std::vector<Shelf> shelves {};
+    uint32_t top {0};   // Shelves fill each page from the top down, and this is where the next one starts.
+  };
+
+  // The padded rectangle occupied by an image.  Unused entries have a width of 0, and are listed in 'freeAllocs'.
+  struct Alloc {
+    uint32_t page {0};
+    uint32_t shelf {0};
+    uint32_t x {0};
+    uint32_t width {0};
+  };
+
+  TextureAtlas::CreateParams params {};
+  size_t pixelSize {0};
+  std::vector<Page> pages {};
+  std::vector<Alloc> allocs {};
+  std::vector<uint32_t> freeAllocs {};
+  bool valid {false};
+
+  // Finds room for a padded rectangle, adding a shelf or a page if needed.  Returns false if it's larger than a page, or a page couldn't be created.
+  bool place(uint32_t width, uint32_t height, Alloc& alloc);
+  void release(const Alloc& alloc);
+};
+
+} // namespace hlgl
+#endif // HLGL_VK_TEXTURE_ATLAS_H
@@ -1,67 +1,347 @@
 #include "texture.h"
+#include "async-compute.h"
 #include "buffer.h"
 #include "context.h"
 #include "frame.h"
+#include "builtin-pipelines.h"
+#include "depth-pyramid.h"
+#include "dynamic-resolution.h"
+#include "residency.h"
+#include "streaming.h"
+#include "../utils/ktx2.h"
+#include "../utils/mapped-file.h"
+#include "../utils/thread-pool.h"
+#include "../utils/trace.h"
+#include <algorithm>
 #include <chrono>
 #include <vector>
 
 #include <ktx.h>
 #include <ktxvulkan.h>
 
-hlgl::Texture::Texture(LoadKtxParams params)
-{
-  // Load the ktx textures.
-  ktxTexture* ktxTex {nullptr};
-  ktx_error_code_e err {KTX_SUCCESS};
-  if (params.filename) {
-    err = ktxTexture_CreateFromNamedFile(params.filename, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktxTex);
+namespace {
+
+  // When streaming, every mip level no larger than this along its longest axis is loaded up front.
+  constexpr uint32_t streamedTailSize_c {128};
+
+  VkImageViewType chooseViewType(VkImageCreateFlags flags, VkExtent3D extent, uint32_t layerCount, bool arrayView) {
+    return (flags & VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT) ? ((layerCount > 6) ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_CUBE) :
+           (extent.depth > 1) ? VK_IMAGE_VIEW_TYPE_3D :
+           (layerCount > 1 || arrayView) ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
   }
-  else if (params.dataPtr && params.dataSize) {
-    err = ktxTexture_CreateFromMemory((const uint8_t*)params.dataPtr, params.dataSize, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktxTex);
+
+  VkExtent3D levelExtent(VkExtent3D extent, uint32_t mip) {
+    return VkExtent3D{std::max(1u, extent.width >> mip), std::max(1u, extent.height >> mip), std::max(1u, extent.depth >> mip)};
   }
-  else {
-    DEBUG_ERROR("Either a filename or a pointer-size pair must be provided when creating a texture from KTX.");
-    return;
+
+  uint32_t fullMipCount(VkExtent3D extent) {
+    uint32_t largest {std::max({extent.width, extent.height, extent.depth})};
+    uint32_t count {1};
+    while (largest >>= 1)
+      ++count;
+    return count;
   }
-  if (err || !ktxTex) {
-    DEBUG_ERROR("Failed to open '%s', code: %i",
-      params.debugName ? params.debugName : params.filename ? params.filename : "Unnamed KTX Texture",  err);
-    return;
+
+  // The capacity an image needs to hold 'extent'.  Render-sized textures make room for the whole display,
+  // and bucketed ones are rounded up to a multiple of the bucket size.
+  VkExtent3D capacityExtent(VkExtent3D extent, bool bucketed, bool renderSized) {
+    constexpr uint32_t bucket_c {hlgl::TextureImpl::sizeBucket_c};
+    if (renderSized) {
+      uint32_t w {0}, h {0};
+      hlgl::getDisplaySize(w, h);
+      extent.width = std::max(extent.width, w);
+      extent.height = std::max(extent.height, h);
+    }
+    if (!bucketed)
+      return extent;
+    return VkExtent3D{
+      (extent.width + bucket_c - 1) / bucket_c * bucket_c,
+      (extent.height + bucket_c - 1) / bucket_c * bucket_c,
+      extent.depth };
+  }
+
+  bool canBlitMips(VkFormatFeatureFlags features) {
+    constexpr VkFormatFeatureFlags required_c {
+      VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT};
+    return ((features & required_c) == required_c);
+  }
+
+  // The downsample shader reads and writes each level through an RWTexture2D without a format qualifier.
+  bool canDownsampleMips(VkFormatFeatureFlags features) {
+    const VkPhysicalDeviceFeatures& enabled {hlgl::getEnabledDeviceFeatures()};
+    return (features & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) &&
+           enabled.shaderStorageImageReadWithoutFormat && enabled.shaderStorageImageWriteWithoutFormat;
   }
 
-  bool cubemap {ktxTex->numFaces == 6};
-  uint32_t numLayers {cubemap ? 6 : ktxTex->numLayers};
-  std::vector<Texture::Offset> offsets;
-  for (uint32_t level {0}; level < ktxTex->numLevels; ++level) {
-    for (uint32_t layer {0}; layer < numLayers; ++layer) {
-      uint64_t offset {0};
-      if (cubemap)
-        ktxTexture_GetImageOffset(ktxTex, level, 0, layer, &offset);
-      else
-        ktxTexture_GetImageOffset(ktxTex, level, layer, 0, &offset);
-      offsets.push_back(Offset{.offset = offset, .layer = layer, .mipLevel = level});
+  // The 32-bit format which a 24-bit format's data can be expanded to, or the same format if it isn't 24-bit.
+  hlgl::ImageFormat expandedFormat(hlgl::ImageFormat format) {
+    switch (format) {
+      case hlgl::ImageFormat::RGB8i: return hlgl::ImageFormat::RGBA8i;
+      case hlgl::ImageFormat::RGB8i_srgb: return hlgl::ImageFormat::RGBA8i_srgb;
+      case hlgl::ImageFormat::BGR8i: return hlgl::ImageFormat::BGRA8i;
+      case hlgl::ImageFormat::BGR8i_srgb: return hlgl::ImageFormat::BGRA8i_srgb;
+      default: return format;
     }
   }
-  hlgl::Texture::CreateParams createParams{
-    .usage = (cubemap) ? TextureUsage::Cubemap : TextureUsage::None,
-    .width = ktxTex->baseWidth, .height = ktxTex->baseHeight,
-    .mipCount = ktxTex->numLevels,
-    .layerCount = numLayers,
-    .format = (hlgl::ImageFormat)ktxTexture_GetVkFormat(ktxTex),
-    .dataPtr = ktxTex->pData,
-    .dataSize = ktxTex->dataSize,
-    .offsets = offsets.data(),
-    .numOffsets = (uint32_t)offsets.size(),
-    .debugName = (params.debugName) ? params.debugName : params.filename,
-    .sampler = hlgl::Texture::CreateParams::Sampler{
-      .filtering = hlgl::FilterMode::Linear,
-      .maxLod = (float)ktxTex->numLevels,
-      .wrapping = hlgl::WrapMode::Repeat }
+
+  // Barrier for a range of mip levels, for when different levels of the same image need to be in different states.
+  void mipBarrier(VkCommandBuffer cmd, const hlgl::TextureImpl* texture, uint32_t baseMip, uint32_t numMips,
+    VkImageLayout oldLayout, VkAccessFlags srcAccessMask, VkPipelineStageFlags srcStageMask,
+    VkImageLayout newLayout, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+  {
+    VkImageMemoryBarrier imgBarrier {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = srcAccessMask,
+      .dstAccessMask = dstAccessMask,
+      .oldLayout = oldLayout,
+      .newLayout = newLayout,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = texture->image,
+      .subresourceRange = {
+        .aspectMask = hlgl::translateAspect(texture->format),
+        .baseMipLevel = baseMip,
+        .levelCount = numMips,
+        .baseArrayLayer = texture->layerBase,
+        .layerCount = texture->layerCount }
+    };
+    vkCmdPipelineBarrier(cmd, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &imgBarrier);
+  }
+
+  // The CPU side of loading a KTX texture, which doesn't touch the GPU and so can be done on a worker thread.
+  struct KtxSource {
+    KtxSource() = default;
+    KtxSource(const KtxSource&) = delete;
+    KtxSource& operator=(const KtxSource&) = delete;
+    ~KtxSource() { reset(); }
+
+    void reset() {
+      if (ktx) ktxTexture_Destroy(ktx);
+      ktx = nullptr;
+      file.reset();
+      data = nullptr;
+      size = 0;
+    }
+
+    std::shared_ptr<hlgl::MappedFile> file {};
+    const uint8_t* data {nullptr};
+    size_t size {0};
+    hlgl::Ktx2Header header {};
+    bool direct {false};          // If true, the levels described by 'header' can be copied straight out of 'data'.
+    ktxTexture* ktx {nullptr};    // Otherwise, the texture as loaded (and inflated/transcoded) by libktx.
   };
-  _pimpl = std::make_unique<TextureImpl>(std::move(createParams));
-  if (!_pimpl->image || !_pimpl->view) _pimpl.reset();
 
-  if (ktxTex) ktxTexture_Destroy(ktxTex);
+  // Picks the best format a Basis Universal texture can be transcoded to on this device.
+  // Block compressed formats are preferred in order of quality, falling back to uncompressed RGBA if none are supported.
+  ktx_transcode_fmt_e chooseTranscodeFormat(ktxTexture2* ktx) {
+    using namespace hlgl;
+    const bool alpha {ktxTexture2_GetNumComponents(ktx) == 4};
+    if (isTextureFormatSupported(ImageFormat::BC7))
+      return KTX_TTF_BC7_RGBA;
+    if (isTextureFormatSupported(ImageFormat::ASTC4x4))
+      return KTX_TTF_ASTC_4x4_RGBA;
+    if (isTextureFormatSupported(alpha ? ImageFormat::ETC2RGBA : ImageFormat::ETC2RGB))
+      return alpha ? KTX_TTF_ETC2_RGBA : KTX_TTF_ETC1_RGB;
+    if (isTextureFormatSupported(alpha ? ImageFormat::BC3 : ImageFormat::BC1RGB))
+      return alpha ? KTX_TTF_BC3_RGBA : KTX_TTF_BC1_RGB;
+    return KTX_TTF_RGBA32;
+  }
+
+  // Maps the file and works out how it should be uploaded.
+  // Uncompressed KTX2 files are left in the mapping, anything else is loaded by libktx, which inflates zstd/zlib supercompression
+  // as it loads.  Basis Universal (ETC1S/UASTC) textures are then transcoded to a format the GPU supports.
+  bool prepareKtx(const hlgl::Texture::LoadKtxParams& params, KtxSource& src) {
+    using namespace hlgl;
+    src.data = (const uint8_t*)params.dataPtr;
+    src.size = params.dataSize;
+    if (params.filename) {
+      // Map the file rather than reading it, so uncompressed KTX2 levels can be copied directly into the staging buffer.
+      src.file = std::make_shared<MappedFile>(params.filename);
+      src.data = src.file->data();
+      src.size = src.file->size();
+      if (!src.file->isValid()) {
+        DEBUG_ERROR("Failed to open '%s'.", params.filename);
+        return false;
+      }
+    }
+    else if (!src.data || !src.size) {
+      DEBUG_ERROR("Either a filename or a pointer-size pair must be provided when creating a texture from KTX.");
+      return false;
+    }
+
+    const char* name {params.debugName ? params.debugName : params.filename ? params.filename : "Unnamed KTX Texture"};
+    if (parseKtx2Header(src.data, src.size, src.header) &&
+        src.header.supercompression == 0 &&
+        src.header.vkFormat != VK_FORMAT_UNDEFINED &&
+        !(src.header.faceCount == 6 && src.header.layerCount > 1))
+    {
+      src.direct = true;
+      // Fault in the pages now, rather than when they're copied on the render thread.
+      if (src.file && !params.stream)
+        src.file->prefetch(0, src.file->size());
+      return true;
+    }
+
+    ktx_error_code_e err {ktxTexture_CreateFromMemory(src.data, src.size, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &src.ktx)};
+    if (err || !src.ktx) {
+      DEBUG_ERROR("Failed to open '%s', code: %i", name, err);
+      return false;
+    }
+    if (src.ktx->classId == ktxTexture2_c && ktxTexture2_NeedsTranscoding((ktxTexture2*)src.ktx)) {
+      ktx_transcode_fmt_e format {chooseTranscodeFormat((ktxTexture2*)src.ktx)};
+      err = ktxTexture2_TranscodeBasis((ktxTexture2*)src.ktx, format, 0);
+      if (err) {
+        DEBUG_ERROR("Failed to transcode '%s', code: %i", name, err);
+        return false;
+      }
+    }
+    // libktx has its own copy of the data now.
+    src.file.reset();
+    return true;
+  }
+
+  // Creates a texture from KTX2 data by using the parsed level index directly, so the level data can be copied
+  // straight from the mapped file into the staging buffer without passing through the heap.
+  // If streaming was requested, the file is kept mapped so larger mip levels can be streamed in later.
+  std::unique_ptr<hlgl::TextureImpl> createKtxDirect(const hlgl::Texture::LoadKtxParams& params, KtxSource& src) {
+    using namespace hlgl;
+    Ktx2Header& header {src.header};
+    const uint32_t numLevels {(uint32_t)header.levels.size()};
+    const bool cubemap {header.faceCount == 6};
+    const uint32_t numImages {header.imagesPerLevel()};
+
+    // The whole mip chain is allocated up front, with the view starting at the first level loaded.
+    // 3D textures can't have their mips shifted, so they're always loaded whole.
+    const bool stream {params.stream && src.file && numLevels > 1 && header.depth <= 1};
+    uint32_t firstMip {0};
+    while (stream && firstMip + 1 < numLevels &&
+           std::max(header.width >> firstMip, header.height >> firstMip) > streamedTailSize_c)
+      ++firstMip;
+
+    // Only the span of the file covering the levels being loaded gets copied.
+    uint64_t spanBegin {UINT64_MAX}, spanEnd {0};
+    for (uint32_t level {firstMip}; level < numLevels; ++level) {
+      spanBegin = std::min(spanBegin, header.levels[level].offset);
+      spanEnd = std::max(spanEnd, header.levels[level].offset + header.levels[level].length);
+    }
+    std::vector<Texture::Offset> offsets;
+    offsets.reserve((numLevels - firstMip) * numImages);
+    for (uint32_t level {firstMip}; level < numLevels; ++level) {
+      // Each layer (or cubemap face) is stored contiguously within the level.
+      const uint64_t imageSize {header.levels[level].length / numImages};
+      for (uint32_t i {0}; i < numImages; ++i)
+        offsets.push_back(Texture::Offset{.offset = header.levels[level].offset - spanBegin + i * imageSize, .layer = i, .mipLevel = level - firstMip});
+    }
+
+    auto pimpl {std::make_unique<TextureImpl>(Texture::CreateParams{
+      .usage = (cubemap ? TextureUsage::Cubemap : TextureUsage::None) | params.usage |
+               (stream ? (TextureUsage::TransferSrc | TextureUsage::TransferDst) : TextureUsage::None),
+      .width = header.width, .height = std::max(1u, header.height), .depth = std::max(1u, header.depth),
+      .mipCount = numLevels - firstMip,
+      .mipBase = firstMip,
+      .layerCount = numImages,
+      .format = (ImageFormat)header.vkFormat,
+      .dataPtr = (void*)(src.data + spanBegin),
+      .dataSize = spanEnd - spanBegin,
+      .offsets = offsets.data(),
+      .numOffsets = (uint32_t)offsets.size(),
+      .priority = params.priority,
+      .debugName = (params.debugName) ? params.debugName : params.filename,
+      .sampler = Texture::CreateParams::Sampler{
+        .filtering = FilterMode::Linear,
+        .maxLod = (float)numLevels,
+        .wrapping = WrapMode::Repeat }
+    })};
+    if (!pimpl->image || !pimpl->view)
+      return nullptr;
+
+    if (stream) {
+      pimpl->stream = std::make_unique<TextureStream>();
+      pimpl->stream->filename = params.filename;
+      pimpl->stream->file = std::move(src.file);
+      pimpl->stream->header = std::move(header);
+      pimpl->stream->requestedMip = firstMip;
+      registerStreamingTexture(pimpl.get());
+    }
+    return pimpl;
+  }
+
+  std::unique_ptr<hlgl::TextureImpl> createKtx(const hlgl::Texture::LoadKtxParams& params, KtxSource& src) {
+    using namespace hlgl;
+    if (src.direct)
+      return createKtxDirect(params, src);
+    if (!src.ktx)
+      return nullptr;
+
+    ktxTexture* ktxTex {src.ktx};
+    bool cubemap {ktxTex->numFaces == 6};
+    uint32_t numLayers {cubemap ? 6 : ktxTex->numLayers};
+    std::vector<Texture::Offset> offsets;
+    for (uint32_t level {0}; level < ktxTex->numLevels; ++level) {
+      for (uint32_t layer {0}; layer < numLayers; ++layer) {
+        uint64_t offset {0};
+        if (cubemap)
+          ktxTexture_GetImageOffset(ktxTex, level, 0, layer, &offset);
+        else
+          ktxTexture_GetImageOffset(ktxTex, level, layer, 0, &offset);
+        offsets.push_back(Texture::Offset{.offset = offset, .layer = layer, .mipLevel = level});
+      }
+    }
+    hlgl::Texture::CreateParams createParams{
+      .usage = ((cubemap) ? TextureUsage::Cubemap : TextureUsage::None) | params.usage,
+      .width = ktxTex->baseWidth, .height = ktxTex->baseHeight,
+      .mipCount = ktxTex->numLevels,
+      .layerCount = numLayers,
+      .format = (hlgl::ImageFormat)ktxTexture_GetVkFormat(ktxTex),
+      .dataPtr = ktxTex->pData,
+      .dataSize = ktxTex->dataSize,
+      .offsets = offsets.data(),
+      .numOffsets = (uint32_t)offsets.size(),
+      .priority = params.priority,
+      .debugName = (params.debugName) ? params.debugName : params.filename,
+      .sampler = hlgl::Texture::CreateParams::Sampler{
+        .filtering = hlgl::FilterMode::Linear,
+        .maxLod = (float)ktxTex->numLevels,
+        .wrapping = hlgl::WrapMode::Repeat }
+    };
+    auto pimpl {std::make_unique<TextureImpl>(std::move(createParams))};
+    if (!pimpl->image || !pimpl->view)
+      return nullptr;
+    return pimpl;
+  }
+
+} // namespace
+
+hlgl::Texture::Texture(std::unique_ptr<TextureImpl>&& pimpl) noexcept
+: _pimpl(std::move(pimpl))
+{}
+
+hlgl::Texture::Texture(LoadKtxParams params)
+{
+  KtxSource src {};
+  if (prepareKtx(params, src))
+    _pimpl = createKtx(params, src);
+}
+
+std::vector<hlgl::Texture> hlgl::Texture::loadKtx(const std::vector<LoadKtxParams>& params) {
+  // Reading, inflating, and transcoding happen on worker threads, while this thread uploads each texture as soon as it's ready.
+  std::vector<KtxSource> sources(params.size());
+  std::vector<std::future<bool>> prepared;
+  prepared.reserve(params.size());
+  for (size_t i {0}; i < params.size(); ++i)
+    prepared.push_back(getThreadPool().submit([&params, &sources, i]() { return prepareKtx(params[i], sources[i]); }));
+
+  std::vector<Texture> result;
+  result.reserve(params.size());
+  for (size_t i {0}; i < params.size(); ++i) {
+    std::unique_ptr<TextureImpl> pimpl {};
+    if (prepared[i].get())
+      pimpl = createKtx(params[i], sources[i]);
+    // Release the file (or libktx's copy of it) as soon as it's been uploaded.
+    sources[i].reset();
+    result.push_back(Texture(std::move(pimpl)));
+  }
+  return result;
 }
 
 hlgl::Texture::Texture(Texture::CreateParams params)
@@ -70,18 +350,38 @@ hlgl::Texture::Texture(Texture::CreateParams params)
 
 hlgl::TextureImpl::TextureImpl(Texture::CreateParams&& params)
 {
+  HLGL_TRACE_SCOPE("Create texture");
   auto timeStart = std::chrono::high_resolution_clock::now();
   extent = VkExtent3D{params.width, params.height, params.depth};
+  fullExtent = extent;
   mipBase = params.mipBase;
   mipCount = params.mipCount;
   layerBase = params.layerBase;
   layerCount = params.layerCount;
   format = translate(params.format);
   debugName = params.debugName;
+  priority = std::clamp(params.priority, 0.0f, 1.0f);
+  evictable = (params.usage & TextureUsage::Evictable);
+  arrayView = (params.usage & TextureUsage::ArrayView);
+
+  // An owned image with a view which starts past level 0 (such as a streaming texture) is allocated with the larger levels too.
+  if (mipBase > 0 && !params.extraData) {
+    droppedMips = mipBase;
+    extent = levelExtent(fullExtent, mipBase);
+  }
 
   if (params.usage & TextureUsage::ScreenSize) {
     getDisplaySize(extent.width, extent.height);
     extent.depth = 1;
+    fullExtent = extent;
+    bucketed = (params.usage & TextureUsage::Bucketed);
+  }
+  else if (params.usage & TextureUsage::RenderSize) {
+    getRenderSize(extent.width, extent.height);
+    extent.depth = 1;
+    fullExtent = extent;
+    bucketed = (params.usage & TextureUsage::Bucketed);
+    renderSized = true;
   }
 
   if (extent.width == 0 || extent.height == 0 || extent.depth == 0) {
@@ -90,8 +390,12 @@ hlgl::TextureImpl::TextureImpl(Texture::CreateParams&& params)
   }
 
   if (mipCount == 0) {
-    DEBUG_ERROR("Image must have non-zero mip count.");
-    return;
+    if (!params.generateMips) {
+      DEBUG_ERROR("Image must have non-zero mip count.");
+      return;
+    }
+    mipCount = fullMipCount(capacityExtent(extent, bucketed, renderSized));
+    fullMipChain = true;
   }
 
   if (format == VK_FORMAT_UNDEFINED) {
@@ -99,6 +403,31 @@ hlgl::TextureImpl::TextureImpl(Texture::CreateParams&& params)
     return;
   }
 
+  // 24-bit formats often can't be used with optimal tiling, in which case the data is expanded to the equivalent 32-bit format on the CPU.
+  std::vector<uint8_t> expandedData {};
+  std::vector<Texture::Offset> expandedOffsets {};
+  if (ImageFormat expanded {expandedFormat(params.format)};
+    expanded != params.format && !(getFormatFeatures(format) & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+  {
+    if (params.dataPtr) {
+      if (params.dataSize == 0)
+        params.dataSize = (uint64_t)params.width * params.height * params.depth * params.layerCount * 3;
+      const size_t pixelCount {(size_t)(params.dataSize / 3)};
+      expandedData.resize(pixelCount * 4);
+      expandRGB8ToRGBA8((const uint8_t*)params.dataPtr, expandedData.data(), pixelCount);
+      if (params.offsets && params.numOffsets) {
+        expandedOffsets.assign(params.offsets, params.offsets + params.numOffsets);
+        for (Texture::Offset& offset : expandedOffsets)
+          offset.offset = offset.offset / 3 * 4;
+        params.offsets = expandedOffsets.data();
+      }
+      params.dataPtr = expandedData.data();
+      params.dataSize = expandedData.size();
+    }
+    params.format = expanded;
+    format = translate(expanded);
+  }
+
   // Figure out usage flags.
 
   if (params.usage & TextureUsage::Cubemap) {
@@ -125,6 +454,22 @@ hlgl::TextureImpl::TextureImpl(Texture::CreateParams&& params)
   if (params.usage & TextureUsage::Storage)
     usage |= VK_IMAGE_USAGE_STORAGE_BIT;
 
+  // Mips are generated by blitting where possible, otherwise by a compute shader which writes to each level as a storage image.
+  if (params.generateMips && mipCount > 1) {
+    VkFormatFeatureFlags features {getFormatFeatures(format)};
+    if (canBlitMips(features))
+      usage |= (VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+    else if (canDownsampleMips(features))
+      usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    else
+      DEBUG_WARNING("Mips can't be generated for '%s', format '%s' supports neither blitting nor unformatted storage.",
+        params.debugName ? params.debugName : "?", enumToStr(params.format));
+  }
+
+  // Demoting an evictable texture copies its remaining mip levels into a new, smaller image.
+  if (evictable)
+    usage |= (VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
   if (params.usage & TextureUsage::Framebuffer) {
     if (params.dataPtr) {
       DEBUG_ERROR("Can't create a framebuffer texture with existing data.");
@@ -166,12 +511,21 @@ hlgl::TextureImpl::TextureImpl(Texture::CreateParams&& params)
   if (!create((VkImage)params.extraData))
     return;
 
+  // Track the memory used by textures which own their image.
+  if (allocation)
+    registerResidentTexture(this);
+
   // If the image is screen-sized, listen for when the screen is resized so it can remain so.
   if (params.usage & TextureUsage::ScreenSize) {
     observeDisplayResize(&displayResizeObserver, [this](uint32_t w,uint32_t h){
       resize({w, h, 1});
     });
   }
+  else if (renderSized) {
+    observeRenderResize(&displayResizeObserver, [this](uint32_t w,uint32_t h){
+      resize({w, h, 1});
+    });
+  }
 
   // Copy provided data into the texture.
   if (params.dataPtr) {
@@ -184,8 +538,8 @@ hlgl::TextureImpl::TextureImpl(Texture::CreateParams&& params)
     // If offsets weren't provided, interpret the entire provided data block as a single contiguous image with no mip levels.
     if (!params.offsets || !params.numOffsets) {
       VkBufferImageCopy region {
-        .imageSubresource = {.aspectMask = translateAspect(format), .mipLevel = 0, .baseArrayLayer = layerBase, .layerCount = layerCount},
-        .imageExtent = {.width = params.width, .height = params.height, .depth = params.depth}
+        .imageSubresource = {.aspectMask = translateAspect(format), .mipLevel = mipBase, .baseArrayLayer = layerBase, .layerCount = layerCount},
+        .imageExtent = (mipBase > 0) ? extent : VkExtent3D{params.width, params.height, params.depth}
       };
       transfer(this, params.dataPtr, params.dataSize, 1, &region, false);
     }
@@ -197,34 +551,22 @@ hlgl::TextureImpl::TextureImpl(Texture::CreateParams&& params)
         const uint32_t layer = params.offsets[i].layer;
         regions.push_back(VkBufferImageCopy{
           .bufferOffset = params.offsets[i].offset,
-          .imageSubresource = {.aspectMask = translateAspect(format), .mipLevel = mip, .baseArrayLayer = layer, .layerCount = 1},
-          .imageExtent = {.width = extent.width >> mip, .height = extent.height >> mip, .depth = 1}
+          .imageSubresource = {.aspectMask = translateAspect(format), .mipLevel = mipBase + mip, .baseArrayLayer = layer, .layerCount = 1},
+          .imageExtent = levelExtent(extent, mip)
         });
       }
       transfer(this, params.dataPtr, params.dataSize, regions.size(), regions.data(), false);
     }
   }
 
-  // If the texture is flagged as a storage image, allocate and update a descriptor for it.
+  // If the texture is flagged as a storage image, allocate a descriptor for it.
   if (params.usage & TextureUsage::Storage) {
     descIndexStorageImage = allocDescriptorIndex(DESC_TYPE_STORAGE_IMAGE);
-    VkDescriptorImageInfo descInfo {
-      .sampler = nullptr,
-      .imageView = view,
-      .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
-    VkWriteDescriptorSet descWrite {
-      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-      .dstSet = getDescriptorSet(DESC_TYPE_STORAGE_IMAGE),
-      .dstArrayElement = descIndexStorageImage,
-      .descriptorCount = 1,
-      .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-      .pImageInfo = &descInfo };
-    vkUpdateDescriptorSets(getDevice(), 1, &descWrite, 0, nullptr);
+    storageDescriptor = true;
   }
 
   // Create the sampler for this texture.
   // TODO: Hash and cache the sampler parameters so multiple textures can share sampler objects.
-  // TODO: Resizeable textures with mipmaps?
   if (params.sampler) {
     if (params.sampler->wrapU == WrapMode::DontCare)
       params.sampler->wrapU = params.sampler->wrapping;
@@ -280,21 +622,9 @@ hlgl::TextureImpl::TextureImpl(Texture::CreateParams&& params)
       return;
     }
 
-    // With a sampler created, we can assign a descriptor index and update the descriptor set.
+    // With a sampler created, we can assign a descriptor index.
     descIndexImageSampler = allocDescriptorIndex(DESC_TYPE_COMBINED_IMAGE_SAMPLER);
-    VkDescriptorImageInfo descInfo {
-      .sampler = sampler,
-      .imageView = view,
-      .imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL };
-    VkWriteDescriptorSet descWrite {
-      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-      .dstSet = getDescriptorSet(DESC_TYPE_COMBINED_IMAGE_SAMPLER),
-      .dstArrayElement = descIndexImageSampler,
-      .descriptorCount = 1,
-      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-      .pImageInfo = &descInfo };
-    vkUpdateDescriptorSets(getDevice(), 1, &descWrite, 0, nullptr);
-    
+
     if (params.debugName && isValidationEnabled()) {
       char debugNameStr[256]; snprintf(debugNameStr, 256, "%s.sampler", params.debugName);
       VkDebugUtilsObjectNameInfoEXT info { 
@@ -308,10 +638,18 @@ hlgl::TextureImpl::TextureImpl(Texture::CreateParams&& params)
     }
   }
 
-  if (params.sampler) {
-    // Transition the new image into a state appropriate for reading as a sampled texture.
+  // Update the descriptor set(s) now that every descriptor index has been assigned.
+  updateDescriptors();
+
+  // Generate the mips (if requested) and transition the new image into a state appropriate for reading as a sampled texture,
+  // both in the same command buffer.
+  const bool generate {params.generateMips && params.dataPtr && !params.offsets && mipCount > 1};
+  if (params.sampler || generate) {
     VkCommandBuffer cmd = beginImmediateCmd();
-    barrier(cmd, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT);
+    if (generate)
+      generateMips(cmd);
+    if (params.sampler)
+      barrier(cmd, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT);
     submitImmediateCmd(cmd);
   }
 
@@ -334,6 +672,8 @@ bool hlgl::TextureImpl::create(VkImage existingImage) {
     allocation = nullptr;
   }
 
+  capacity = capacityExtent(extent, bucketed, renderSized);
+
   if (existingImage) {
     image = existingImage;
   }
@@ -343,8 +683,9 @@ bool hlgl::TextureImpl::create(VkImage existingImage) {
       .flags = flags,
       .imageType = (extent.depth > 1) ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D,
       .format = format,
-      .extent = extent,
-      .mipLevels = mipCount,
+      // Levels before the view's are allocated too, so the image starts at level 'droppedMips - mipBase' of the full chain.
+      .extent = (mipBase > 0 && !bucketed && !renderSized) ? levelExtent(fullExtent, droppedMips - mipBase) : capacity,
+      .mipLevels = mipBase + mipCount,
       .arrayLayers = layerCount,
       .samples = VK_SAMPLE_COUNT_1_BIT,
       .tiling = VK_IMAGE_TILING_OPTIMAL,
@@ -352,9 +693,12 @@ bool hlgl::TextureImpl::create(VkImage existingImage) {
       .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
       .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
     };
-    VmaAllocationCreateInfo aci{ .usage = VMA_MEMORY_USAGE_AUTO };
+    VmaAllocationCreateInfo aci{ .usage = VMA_MEMORY_USAGE_AUTO, .priority = priority };
     if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
       aci.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    if (isPageableMemoryEnabled())
+      applyMemoryPriority(ici, aci);
+    dedicated = (aci.flags & VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT);
 
     if (!VKCHECK(vmaCreateImage(getAllocator(), &ici, &aci, &image, &allocation, &allocInfo)) || !image) {
       DEBUG_ERROR("Failed to create image.");
@@ -365,8 +709,7 @@ bool hlgl::TextureImpl::create(VkImage existingImage) {
   VkImageViewCreateInfo vci {
     .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
     .image = image,
-    .viewType = (flags & VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT) ? VK_IMAGE_VIEW_TYPE_CUBE :
-                (extent.depth > 1) ? VK_IMAGE_VIEW_TYPE_3D : VK_IMAGE_VIEW_TYPE_2D,
+    .viewType = chooseViewType(flags, extent, layerCount, arrayView),
     .format = format,
     .subresourceRange = {
       .aspectMask = translateAspect(format),
@@ -413,6 +756,10 @@ bool hlgl::TextureImpl::create(VkImage existingImage) {
 
 hlgl::Texture::~Texture() {
   if (!_pimpl) return;
+  unregisterResidentTexture(_pimpl.get());
+  if (_pimpl->stream)
+    unregisterStreamingTexture(_pimpl.get());
+  releaseDepthPyramidViews(_pimpl.get());
   if (_pimpl->image || _pimpl->view || _pimpl->sampler || _pimpl->allocation) {
     queueDeletion(DelQueueTexture{
       .image = _pimpl->image,
@@ -434,10 +781,22 @@ void hlgl::Texture::getDimensions(uint32_t& w, uint32_t& h, uint32_t& d) const {
   d = extent.depth;
 }
 
+void hlgl::Texture::getCapacity(uint32_t& w, uint32_t& h, uint32_t& d) const {
+  if (!_pimpl) return;
+  VkExtent3D capacity = _pimpl->capacity;
+  w = capacity.width;
+  h = capacity.height;
+  d = capacity.depth;
+}
+
 hlgl::ImageFormat hlgl::Texture::getFormat() const {
   return _pimpl ? translate(_pimpl->format) : ImageFormat::Undefined;
 }
 
+uint32_t hlgl::Texture::getMipCount() const {
+  return _pimpl ? _pimpl->mipCount : 0;
+}
+
 uint32_t hlgl::Texture::getSamplerIndex() const {
   return _pimpl ? _pimpl->descIndexImageSampler : 0;
 }
@@ -446,16 +805,394 @@ uint32_t hlgl::Texture::getStorageIndex() const {
   return _pimpl ? _pimpl->descIndexStorageImage : 0;
 }
 
+void hlgl::Texture::markUsed() {
+  if (!_pimpl) return;
+  _pimpl->lastUsedFrame = (uint64_t)std::max<int64_t>(0, getFrameCounter());
+}
+
+void hlgl::Texture::setPriority(float priority) {
+  if (!_pimpl) return;
+  _pimpl->priority = std::clamp(priority, 0.0f, 1.0f);
+  // Dedicated allocations can be re-prioritized on the fly when the driver supports pageable device-local memory.
+  // Pooled ones share their blocks' priority, so for them this only changes the order textures are demoted in.
+  if (_pimpl->dedicated && _pimpl->allocation && isPageableMemoryEnabled())
+    vkSetDeviceMemoryPriorityEXT(getDevice(), _pimpl->allocInfo.deviceMemory, _pimpl->priority);
+}
+
+float hlgl::Texture::getPriority() const {
+  return _pimpl ? _pimpl->priority : 0.0f;
+}
+
+void hlgl::Texture::requestMip(uint32_t mip) {
+  if (!_pimpl || !_pimpl->stream) return;
+  _pimpl->stream->requestedMip = std::min(mip, _pimpl->stream->header.levelCount - 1);
+}
+
+uint32_t hlgl::Texture::getResidentMip() const {
+  return _pimpl ? _pimpl->droppedMips : 0;
+}
+
+void hlgl::TextureImpl::updateDescriptors() {
+  if (sampler) {
+    VkDescriptorImageInfo descInfo {
+      .sampler = sampler,
+      .imageView = view,
+      .imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL };
+    VkWriteDescriptorSet descWrite {
+      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .dstSet = getDescriptorSet(DESC_TYPE_COMBINED_IMAGE_SAMPLER),
+      .dstArrayElement = descIndexImageSampler,
+      .descriptorCount = 1,
+      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      .pImageInfo = &descInfo };
+    vkUpdateDescriptorSets(getDevice(), 1, &descWrite, 0, nullptr);
+  }
+  if (storageDescriptor) {
+    VkDescriptorImageInfo descInfo {
+      .sampler = nullptr,
+      .imageView = view,
+      .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+    VkWriteDescriptorSet descWrite {
+      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .dstSet = getDescriptorSet(DESC_TYPE_STORAGE_IMAGE),
+      .dstArrayElement = descIndexStorageImage,
+      .descriptorCount = 1,
+      .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+      .pImageInfo = &descInfo };
+    vkUpdateDescriptorSets(getDevice(), 1, &descWrite, 0, nullptr);
+  }
+}
+
+bool hlgl::TextureImpl::reallocMips(VkCommandBuffer cmd, uint32_t firstMip, uint32_t viewMip) {
+  const uint32_t totalMips {droppedMips + mipCount};
+  const uint32_t oldFirstMip {droppedMips - mipBase};
+  if (firstMip > viewMip || viewMip >= totalMips || (firstMip == oldFirstMip && viewMip == droppedMips) || !allocation || extent.depth > 1)
+    return false;
+
+  // Get the old image ready to be copied from, then hold onto it until the copy has been recorded.
+  barrier(cmd, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+  VkImage oldImage {image};
+  VkImageView oldView {view};
+  VmaAllocation oldAllocation {allocation};
+  VmaAllocationInfo oldAllocInfo {allocInfo};
+  VkExtent3D oldExtent {extent};
+  uint32_t oldDroppedMips {droppedMips};
+  uint32_t oldMipBase {mipBase};
+  uint32_t oldMipCount {mipCount};
+  VkImageLayout oldLayout {layout};
+  VkAccessFlags oldAccessMask {accessMask};
+  VkPipelineStageFlags oldStageMask {stageMask};
+
+  // The sampler is kept, so hide it from 'create' (which would otherwise queue it for deletion along with the old image).
+  VkSampler oldSampler {sampler};
+  image = nullptr;
+  view = nullptr;
+  sampler = nullptr;
+  allocation = nullptr;
+  extent = levelExtent(VkExtent3D{fullExtent.width, fullExtent.height, 1}, viewMip);
+  droppedMips = viewMip;
+  mipBase = viewMip - firstMip;
+  mipCount = totalMips - viewMip;
+
+  bool success {create(nullptr)};
+  sampler = oldSampler;
+  if (!success) {
+    image = oldImage;
+    view = oldView;
+    allocation = oldAllocation;
+    allocInfo = oldAllocInfo;
+    extent = oldExtent;
+    droppedMips = oldDroppedMips;
+    mipBase = oldMipBase;
+    mipCount = oldMipCount;
+    layout = oldLayout;
+    accessMask = oldAccessMask;
+    stageMask = oldStageMask;
+    return false;
+  }
+
+  // Copy the levels of the view which the old one also had into the new image.
+  barrier(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+  std::vector<VkImageCopy> regions;
+  for (uint32_t mip {std::max(viewMip, oldDroppedMips)}; mip < totalMips; ++mip) {
+    regions.push_back(VkImageCopy{
+      .srcSubresource = {.aspectMask = translateAspect(format), .mipLevel = mip - oldFirstMip, .baseArrayLayer = layerBase, .layerCount = layerCount},
+      .dstSubresource = {.aspectMask = translateAspect(format), .mipLevel = mip - firstMip, .baseArrayLayer = layerBase, .layerCount = layerCount},
+      .extent = levelExtent(VkExtent3D{fullExtent.width, fullExtent.height, 1}, mip) });
+  }
+  vkCmdCopyImage(cmd,
+    oldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+    image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    (uint32_t)regions.size(), regions.data());
+
+  queueDeletion(DelQueueTexture{
+    .image = oldImage,
+    .view = oldView,
+    .sampler = nullptr,
+    .allocation = oldAllocation });
+  return true;
+}
+
+bool hlgl::TextureImpl::dropMips(VkCommandBuffer cmd, uint32_t count) {
+  if (count == 0 || !reallocMips(cmd, droppedMips + count, droppedMips + count))
+    return false;
+  barrier(cmd, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+  updateDescriptors();
+  return true;
+}
+
+bool hlgl::TextureImpl::prepareMip(VkCommandBuffer cmd, uint32_t mip, uint32_t& imageMip) {
+  if (mip >= droppedMips)
+    return false;
+
+  // A texture which was demoted to save memory gets the whole chain back in one go, rather than being reallocated for every level.
+  if (mip < droppedMips - mipBase) {
+    if (!reallocMips(cmd, 0, droppedMips))
+      return false;
+    barrier(cmd, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    updateDescriptors();
+  }
+
+  // The level's old contents (if any) are discarded, but earlier frames may still be sampling it through an older view.
+  imageMip = mip - (droppedMips - mipBase);
+  mipBarrier(cmd, this, imageMip, 1,
+    VK_IMAGE_LAYOUT_UNDEFINED, VK_ACCESS_NONE, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+  return true;
+}
+
+bool hlgl::TextureImpl::setViewMip(VkCommandBuffer cmd, uint32_t mip) {
+  const uint32_t firstMip {droppedMips - mipBase};
+  const uint32_t totalMips {droppedMips + mipCount};
+  if (mip < firstMip || mip >= totalMips || !allocation)
+    return false;
+  if (mip == droppedMips)
+    return true;
+
+  // Added levels join the rest of the view in READ_ONLY_OPTIMAL, which is what streaming textures are kept in.
+  const VkPipelineStageFlags readStages_c {VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT};
+  barrier(cmd, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, readStages_c);
+  if (mip < droppedMips) {
+    mipBarrier(cmd, this, mip - firstMip, droppedMips - mip,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, readStages_c);
+  }
+
+  VkImageViewCreateInfo vci {
+    .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+    .image = image,
+    .viewType = chooseViewType(flags, extent, layerCount, arrayView),
+    .format = format,
+    .subresourceRange = {
+      .aspectMask = translateAspect(format),
+      .baseMipLevel = mip - firstMip,
+      .levelCount = totalMips - mip,
+      .baseArrayLayer = layerBase,
+      .layerCount = layerCount }};
+  VkImageView newView {nullptr};
+  if (!VKCHECK(vkCreateImageView(getDevice(), &vci, nullptr, &newView)) || !newView) {
+    DEBUG_ERROR("Failed to create image view.");
+    return false;
+  }
+  if (!debugName.empty() && isValidationEnabled()) {
+    char debugNameStr[256];
+    snprintf(debugNameStr, 256, "%s.view", debugName.c_str());
+    VkDebugUtilsObjectNameInfoEXT info {
+      .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT,
+      .objectType = VK_OBJECT_TYPE_IMAGE_VIEW,
+      .objectHandle = (uint64_t)newView,
+      .pObjectName = debugNameStr };
+    if (!VKCHECK(vkSetDebugUtilsObjectNameEXT(getDevice(), &info)))
+      DEBUG_WARNING("Failed to set Vulkan debug name for '%s'.", debugNameStr);
+  }
+
+  // Frames still in flight may be using the old view.
+  queueDeletion(DelQueueTexture{.image = nullptr, .view = view, .sampler = nullptr, .allocation = nullptr});
+  view = newView;
+  mipBase = mip - firstMip;
+  mipCount = totalMips - mip;
+  droppedMips = mip;
+  extent = levelExtent(fullExtent, mip);
+  capacity = extent;
+  updateDescriptors();
+  return true;
+}
+
+bool hlgl::TextureImpl::generateMips(VkCommandBuffer cmd) {
+  if (mipCount < 2)
+    return true;
+  const VkImageAspectFlags aspect {translateAspect(format)};
+  const VkPipelineStageFlags readStages_c {VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT};
+  auto mipExtent = [this](uint32_t mip) {
+    return VkExtent3D{std::max(1u, extent.width >> mip), std::max(1u, extent.height >> mip), std::max(1u, extent.depth >> mip)}; };
+
+  // Blit each level from the one before it, transitioning the source level from TRANSFER_DST to TRANSFER_SRC just before it's read.
+  if (canBlitMips(getFormatFeatures(format)) &&
+      (usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) && (usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+  {
+    barrier(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    for (uint32_t mip {1}; mip < mipCount; ++mip) {
+      mipBarrier(cmd, this, mipBase + mip - 1, 1,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+      VkExtent3D src {mipExtent(mip - 1)}, dst {mipExtent(mip)};
+      VkImageBlit2 region {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2,
+        .srcSubresource = {.aspectMask = aspect, .mipLevel = mipBase + mip - 1, .baseArrayLayer = layerBase, .layerCount = layerCount},
+        .srcOffsets = {VkOffset3D{0,0,0}, VkOffset3D{(int32_t)src.width, (int32_t)src.height, (int32_t)src.depth}},
+        .dstSubresource = {.aspectMask = aspect, .mipLevel = mipBase + mip, .baseArrayLayer = layerBase, .layerCount = layerCount},
+        .dstOffsets = {VkOffset3D{0,0,0}, VkOffset3D{(int32_t)dst.width, (int32_t)dst.height, (int32_t)dst.depth}} };
+      VkBlitImageInfo2 info {
+        .sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2,
+        .srcImage = image,
+        .srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .dstImage = image,
+        .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .regionCount = 1,
+        .pRegions = &region,
+        .filter = VK_FILTER_LINEAR };
+      vkCmdBlitImage2(cmd, &info);
+    }
+    // Every level but the last is now TRANSFER_SRC, and the last is still TRANSFER_DST.
+    mipBarrier(cmd, this, mipBase, mipCount - 1,
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, readStages_c);
+    mipBarrier(cmd, this, mipBase + mipCount - 1, 1,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, readStages_c);
+    layout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+    accessMask = VK_ACCESS_SHADER_READ_BIT;
+    stageMask = readStages_c;
+    return true;
+  }
+
+  // Otherwise, downsample with a compute shader through a temporary storage view of each level of each layer.
+  if (!(usage & VK_IMAGE_USAGE_STORAGE_BIT) || !canDownsampleMips(getFormatFeatures(format)) || extent.depth > 1) {
+    DEBUG_ERROR("Can't generate mips for '%s', it can't be blitted or written as a 2D storage image without a format.", debugName.c_str());
+    return false;
+  }
+  std::vector<VkImageView> views(mipCount * layerCount, nullptr);
+  std::vector<uint32_t> indices(mipCount * layerCount, 0);
+  bool success {true};
+  for (uint32_t mip {0}; mip < mipCount && success; ++mip) {
+    for (uint32_t layer {0}; layer < layerCount && success; ++layer) {
+      const uint32_t i {mip * layerCount + layer};
+      VkImageViewCreateInfo vci {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .subresourceRange = {.aspectMask = aspect, .baseMipLevel = mipBase + mip, .levelCount = 1, .baseArrayLayer = layerBase + layer, .layerCount = 1} };
+      if (!VKCHECK(vkCreateImageView(getDevice(), &vci, nullptr, &views[i])) || !views[i]) {
+        DEBUG_ERROR("Failed to create mip generation view for '%s'.", debugName.c_str());
+        success = false;
+        break;
+      }
+      indices[i] = allocDescriptorIndex(DESC_TYPE_STORAGE_IMAGE);
+      VkDescriptorImageInfo descInfo {.imageView = views[i], .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+      VkWriteDescriptorSet descWrite {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = getDescriptorSet(DESC_TYPE_STORAGE_IMAGE),
+        .dstArrayElement = indices[i],
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        .pImageInfo = &descInfo };
+      vkUpdateDescriptorSets(getDevice(), 1, &descWrite, 0, nullptr);
+    }
+  }
+
+  if (success) {
+    barrier(cmd, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    for (uint32_t mip {1}; mip < mipCount && success; ++mip) {
+      // Wait for the previous level to be written before reading from it.
+      if (mip > 1) {
+        mipBarrier(cmd, this, mipBase + mip - 1, 1,
+          VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+          VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+      }
+      VkExtent3D src {mipExtent(mip - 1)}, dst {mipExtent(mip)};
+      for (uint32_t layer {0}; layer < layerCount && success; ++layer) {
+        struct {
+          uint32_t src, dst;
+          uint32_t srcSize[2];
+          uint32_t dstSize[2];
+        } constants {indices[(mip - 1) * layerCount + layer], indices[mip * layerCount + layer], {src.width, src.height}, {dst.width, dst.height}};
+        success = dispatchBuiltin(cmd, BuiltinPipeline::Downsample, &constants, sizeof(constants), (dst.width + 7) / 8, (dst.height + 7) / 8, 1);
+      }
+    }
+    barrier(cmd, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, readStages_c);
+  }
+
+  // The views and their descriptors may still be in use by the GPU, so they're queued for deletion rather than destroyed here.
+  for (size_t i {0}; i < views.size(); ++i) {
+    if (!views[i])
+      continue;
+    queueDeletion(DelQueueTexture{.image = nullptr, .view = views[i], .sampler = nullptr, .allocation = nullptr});
+    queueDeletion(DelQueueDescriptor{.set = DESC_TYPE_STORAGE_IMAGE, .index = indices[i]});
+  }
+  return success;
+}
+
+void hlgl::Texture::generateMips() {
+  if (!_pimpl) return;
+  if (Frame* frame {getCurrentFrame()}; frame) {
+    endDrawing();
+    _pimpl->generateMips(frame->cmd);
+  }
+  else {
+    VkCommandBuffer cmd = beginImmediateCmd();
+    _pimpl->generateMips(cmd);
+    submitImmediateCmd(cmd);
+  }
+}
+
 bool hlgl::TextureImpl::resize(VkExtent3D newExtent) {
+  if (newExtent.width == 0 || newExtent.height == 0 || newExtent.depth == 0)
+    return false;
+
+  // A bucketed or render-sized texture keeps its image unless the new size doesn't fit, or would use less than half of it.
+  if ((bucketed || renderSized) && droppedMips == 0) {
+    const VkExtent3D needed {capacityExtent(newExtent, bucketed, renderSized)};
+    const bool fits {needed.width <= capacity.width && needed.height <= capacity.height && needed.depth <= capacity.depth};
+    const uint64_t neededArea {(uint64_t)needed.width * needed.height};
+    if (fits && neededArea * 2 > (uint64_t)capacity.width * capacity.height) {
+      extent = newExtent;
+      fullExtent = extent;
+      return true;
+    }
+  }
+
   VkExtent3D oldExtent {extent};
   extent.width = newExtent.width;
   extent.height = newExtent.height;
   extent.depth = newExtent.depth;
-  if (!create(nullptr)) {
+  uint32_t oldMipCount {mipCount};
+  if (fullMipChain)
+    mipCount = fullMipCount(capacityExtent(extent, bucketed, renderSized));
+
+  // The sampler is kept, so hide it from 'create' (which would otherwise queue it for deletion along with the old image).
+  VkSampler oldSampler {sampler};
+  sampler = nullptr;
+  bool success {create(nullptr)};
+  sampler = oldSampler;
+  if (!success) {
     extent = oldExtent;
+    mipCount = oldMipCount;
     return false;
   }
-  else return true;
+  fullExtent = extent;
+  droppedMips = 0;
+  updateDescriptors();
+  return true;
+}
+
+bool hlgl::Texture::resize(uint32_t w, uint32_t h) {
+  if (!_pimpl) return false;
+  if (_pimpl->stream || !_pimpl->allocation) {
+    DEBUG_ERROR("Texture '%s' can't be resized.", _pimpl->debugName.c_str());
+    return false;
+  }
+  return _pimpl->resize({w, h, _pimpl->extent.depth});
 }
 
 void hlgl::TextureImpl::barrier(
@@ -465,7 +1202,10 @@ void hlgl::TextureImpl::barrier(
   VkPipelineStageFlags dstStageMask,
   uint32_t srcQfi, uint32_t dstQfi)
 {
-  if (layout == dstLayout && accessMask == dstAccessMask && stageMask == dstStageMask)
+  lastUsedFrame = (uint64_t)std::max<int64_t>(0, getFrameCounter());
+  if (srcQfi == VK_QUEUE_FAMILY_IGNORED && dstQfi == VK_QUEUE_FAMILY_IGNORED && transferOwnership(this, cmd, dstLayout, dstAccessMask, dstStageMask))
+    return;
+  if (srcQfi == dstQfi && layout == dstLayout && accessMask == dstAccessMask && stageMask == dstStageMask)
     return;
 
   VkImageMemoryBarrier imgBarrier {
@@ -3,6 +3,7 @@
 
 #include <hlgl.h>
 #include "vulkan-headers.h"
+#include "streaming.h"
 #include "../utils/observer.h"
 
 namespace hlgl {
@@ -17,7 +18,10 @@ struct TextureImpl {
   VmaAllocation allocation{nullptr};
   VmaAllocationInfo allocInfo{};
   VkExtent3D extent{1,1,1};
-  uint32_t mipBase{0};
+  VkExtent3D fullExtent{1,1,1}; // The extent of the texture before any mip levels were dropped.
+  VkExtent3D capacity{1,1,1};   // The extent of the image at the view's first level.  Only larger than 'extent' for bucketed or render-sized textures.
+  uint32_t droppedMips{0};      // The number of high-resolution mip levels which aren't currently resident.
+  uint32_t mipBase{0};          // The view's first level within the image.  Levels of an owned image before it are only kept for streaming into.
   uint32_t mipCount{1};
   uint32_t layerBase{0};
   uint32_t layerCount{1};
@@ -28,10 +32,24 @@ struct TextureImpl {
   VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
   VkAccessFlags accessMask{VK_ACCESS_NONE};
   VkPipelineStageFlags stageMask{VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+  bool asyncComputeOwned{false};   // Owned by the async compute queue family rather than graphics, see 'transferOwnership'.
+  uint64_t asyncComputeSection{0}; // The async compute section which last used the texture.
 
   uint32_t descIndexImageSampler {0};
   uint32_t descIndexStorageImage {0};
 
+  float priority {0.5f};
+  uint64_t lastUsedFrame {0};
+  bool evictable {false};
+  bool dedicated {false};
+  bool fullMipChain {false};       // The mip count follows the extent, so it changes when the texture is resized.
+  bool bucketed {false};           // Opted in with TextureUsage::Bucketed.  The image is allocated in steps of 'sizeBucket_c' pixels, so resizing only reallocates when the capacity changes.
+  bool renderSized {false};        // Follows the render size, and is allocated large enough for the display so changes in render scale don't reallocate it.
+  bool arrayView {false};          // Viewed as an array even with a single layer.
+  bool storageDescriptor {false};  // Storage usage alone doesn't mean there's a storage descriptor, since it may only be needed for compute mip generation.
+
+  std::unique_ptr<TextureStream> stream {};
+
   Observer<uint32_t,uint32_t> displayResizeObserver {};
 
   void barrier(VkCommandBuffer cmd,
@@ -40,8 +58,33 @@ struct TextureImpl {
     VkPipelineStageFlags dstStageMask,
     uint32_t srcQfi = VK_QUEUE_FAMILY_IGNORED, uint32_t dstQfi = VK_QUEUE_FAMILY_IGNORED);
 
+  // Bucketed textures are allocated in steps of this many pixels, so dragging a window's edge doesn't reallocate them every frame.
+  static constexpr uint32_t sizeBucket_c {256};
+
   bool create(VkImage existingImage);
+  // Changes the texture's size.  Bucketed textures keep their image if the new size fits and doesn't leave most of it unused,
+  // and only the region used for drawing and blitting changes.  Otherwise the image is reallocated, and its contents are lost.
   bool resize(VkExtent3D newExtent);
+
+  // Downsamples mip level 0 into every other level, using blits where the format allows and a compute shader otherwise.
+  // Leaves the image in READ_ONLY_OPTIMAL layout.
+  bool generateMips(VkCommandBuffer cmd);
+
+  // Points this texture's descriptors at its current image view.
+  void updateDescriptors();
+  // Mip levels below are counted from the top of the full chain ('fullExtent'), whatever the image currently holds.
+  // Replaces the image with one which starts at level 'firstMip', with the view starting at 'viewMip'.
+  // Levels from 'viewMip' on which both images have are copied over using 'cmd', and the old image is queued for deletion.
+  // The view's levels are left in TRANSFER_DST_OPTIMAL layout, so any added ones can be filled in before it's used.  Levels before the view are undefined.
+  bool reallocMips(VkCommandBuffer cmd, uint32_t firstMip, uint32_t viewMip);
+  // Replaces the image with a smaller one which doesn't include the 'count' highest-resolution mip levels.
+  bool dropMips(VkCommandBuffer cmd, uint32_t count);
+  // Gets level 'mip' (which must be above the view) ready to be filled in for streaming: the image is reallocated with the full chain if it
+  // doesn't have the level, and the level is transitioned to TRANSFER_DST_OPTIMAL.  'imageMip' is set to the level's index within the image.
+  bool prepareMip(VkCommandBuffer cmd, uint32_t mip, uint32_t& imageMip);
+  // Points the view (and the descriptors) at level 'mip' onwards, without touching the image.
+  // Levels being added to the view must have been filled in after 'prepareMip'.
+  bool setViewMip(VkCommandBuffer cmd, uint32_t mip);
 };
 
 } // namespace hlgl
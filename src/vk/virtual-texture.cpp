@@ -0,0 +1,431 @@
+#include "virtual-texture.h"
+#include "buffer.h"
+#include "context.h"
+#include "frame.h"
+#include "texture.h"
+#include "../utils/thread-pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+  std::vector<hlgl::VirtualTextureImpl*> textures_s {};
+
+  // Limits how many pages can be loading at once per texture, so a sudden jump in the view doesn't flood the thread pool.
+  constexpr size_t maxPendingLoads_c {32};
+
+  const char* shaderSource_c = R"(
+    struct VirtualTexture {
+      uint* pageTable;
+      uint* feedback;
+      uint cacheIndex;
+      uint width;
+      uint height;
+      uint pageSize;
+      uint pageBorder;
+      uint cacheWidth;
+      uint cacheHeight;
+      uint numMips;
+    };
+
+    // The last representable value below 1, so UVs on the far edge stay in the last page.
+    float2 vtClampUv(float2 uv) {
+      return clamp(uv, 0.0, 0.99999994);
+    }
+
+    // The mip level wanted for 'uv', from its screen-space derivatives.
+    float vtMipLevel(VirtualTexture vt, float2 uv) {
+      float2 dx = ddx(uv) * float2(vt.width, vt.height);
+      float2 dy = ddy(uv) * float2(vt.width, vt.height);
+      return clamp(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0.0, float(vt.numMips - 1));
+    }
+
+    // Returns the page table entry for the page covering 'uv' at mip level 'mip', and requests that page through the feedback buffer.
+    uint vtLookup(VirtualTexture vt, float2 uv, uint mip) {
+      uint2 pages = uint2(vt.pageTable[16 + mip], vt.pageTable[32 + mip]);
+      uint2 page = uint2(vtClampUv(uv) * float2(pages));
+      uint index = vt.pageTable[mip] + page.y * pages.x + page.x;
+      vt.feedback[index] = 1;
+      return vt.pageTable[index];
+    }
+
+    // Samples the most detailed resident page covering 'uv', at mip level 'lod' or coarser.
+    float4 vtSampleLevel(VirtualTexture vt, Sampler2D cache, float2 uv, float lod) {
+      uint entry = vtLookup(vt, uv, uint(lod));
+      if ((entry & 0x80000000) == 0)
+        return float4(0.0);
+      uint mip = (entry >> 24) & 0xF;
+      uint2 slot = uint2(entry & 0xFFF, (entry >> 12) & 0xFFF);
+      float2 pages = float2(vt.pageTable[16 + mip], vt.pageTable[32 + mip]);
+      float2 inPage = frac(vtClampUv(uv) * pages);
+      float slotSize = float(vt.pageSize + vt.pageBorder * 2);
+      float2 texel = float2(slot) * slotSize + float(vt.pageBorder) + inPage * float(vt.pageSize);
+      return cache.SampleLevel(texel / float2(vt.cacheWidth, vt.cacheHeight), 0.0);
+    }
+
+    float4 vtSample(VirtualTexture vt, Sampler2D cache, float2 uv) {
+      return vtSampleLevel(vt, cache, uv, vtMipLevel(vt, uv));
+    }
+  )";
+
+  bool isPowerOfTwo(uint32_t v) { return v && !(v & (v - 1)); }
+
+  bool isReady(const std::future<bool>& future) {
+    return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+} // namespace
+
+const char* hlgl::VirtualTexture::getShaderSource() {
+  return shaderSource_c;
+}
+
+hlgl::VirtualTexture::VirtualTexture(VirtualTexture::CreateParams params)
+: _pimpl(std::make_unique<VirtualTextureImpl>(std::move(params)))
+{ if (!_pimpl->valid) _pimpl.reset(); }
+
+hlgl::VirtualTexture::~VirtualTexture() {}
+
+hlgl::VirtualTextureImpl::VirtualTextureImpl(VirtualTexture::CreateParams&& createParams)
+: params(std::move(createParams))
+{
+  auto timeStart = std::chrono::high_resolution_clock::now();
+  const char* name {params.debugName ? params.debugName : "?"};
+
+  if (!params.loader) {
+    DEBUG_ERROR("Virtual texture '%s' must have a page loader.", name);
+    return;
+  }
+  if (!isPowerOfTwo(params.width) || !isPowerOfTwo(params.height) || !isPowerOfTwo(params.pageSize) ||
+      params.width < params.pageSize || params.height < params.pageSize)
+  {
+    DEBUG_ERROR("Virtual texture '%s' must have power of two dimensions and page size, with the page size no larger than either dimension.", name);
+    return;
+  }
+  if (params.format == ImageFormat::Undefined || isFormatCompressed(params.format)) {
+    DEBUG_ERROR("Virtual texture '%s' must have an uncompressed format.", name);
+    return;
+  }
+
+  slotSize = params.pageSize + params.pageBorder * 2;
+  bytesPerPage = slotSize * slotSize * (uint32_t)bytesPerPixel(params.format);
+  const uint32_t maxDimension {getDeviceProperties().limits.maxImageDimension2D};
+  if (params.cachePagesX == 0 || params.cachePagesY == 0 || params.cachePagesX > 4096 || params.cachePagesY > 4096 ||
+      params.cachePagesX * slotSize > maxDimension || params.cachePagesY * slotSize > maxDimension)
+  {
+    DEBUG_ERROR("Virtual texture '%s' has an invalid cache size.", name);
+    return;
+  }
+
+  // Mip levels stop when a page covers the shorter dimension.
+  numEntries = headerSize_c;
+  for (uint32_t mip {0}; mip < maxMips_c; ++mip) {
+    const uint32_t w {params.width >> mip}, h {params.height >> mip};
+    if (w < params.pageSize || h < params.pageSize)
+      break;
+    levels.push_back(Level{.firstEntry = numEntries, .pagesX = w / params.pageSize, .pagesY = h / params.pageSize});
+    numEntries += levels.back().pagesX * levels.back().pagesY;
+  }
+
+  const Level& coarsest {levels.back()};
+  const uint32_t numPinned {coarsest.pagesX * coarsest.pagesY};
+  slots.resize(params.cachePagesX * params.cachePagesY);
+  if (numPinned >= slots.size()) {
+    DEBUG_ERROR("Virtual texture '%s' needs a cache larger than its %u lowest resolution pages.", name, numPinned);
+    return;
+  }
+
+  cache.emplace(Texture::CreateParams{
+    .usage = TextureUsage::TransferDst,
+    .width = params.cachePagesX * slotSize,
+    .height = params.cachePagesY * slotSize,
+    .format = params.format,
+    .debugName = params.debugName,
+    .sampler = Texture::CreateParams::Sampler{.filtering = FilterMode::Linear, .wrapping = WrapMode::ClampToEdge} });
+  if (!cache->isValid())
+    return;
+
+  pageTable.emplace(Buffer::CreateParams{
+    .usage = BufferUsage::DeviceAddressable | BufferUsage::HostVisible | BufferUsage::Storage | BufferUsage::Updateable,
+    .size = numEntries * sizeof(uint32_t),
+    .debugName = params.debugName });
+  if (!pageTable->isValid())
+    return;
+
+  // Feedback is read back by the CPU, so unlike most buffers it wants cached host memory.
+  VkBufferCreateInfo bci {
+    .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+    .size = numEntries * sizeof(uint32_t),
+    .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+    .sharingMode = VK_SHARING_MODE_EXCLUSIVE };
+  VmaAllocationCreateInfo aci {
+    .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+    .usage = VMA_MEMORY_USAGE_AUTO };
+  for (uint32_t i {0}; i < feedback.size(); ++i) {
+    if (!VKCHECK(vmaCreateBuffer(getAllocator(), &bci, &aci, &feedback[i], &feedbackAlloc[i], &feedbackInfo[i])) || !feedbackInfo[i].pMappedData) {
+      DEBUG_ERROR("Failed to create feedback buffer for virtual texture '%s'.", name);
+      return;
+    }
+    memset(feedbackInfo[i].pMappedData, 0, bci.size);
+    vmaFlushAllocation(getAllocator(), feedbackAlloc[i], 0, VK_WHOLE_SIZE);
+    VkBufferDeviceAddressInfo info {.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = feedback[i]};
+    feedbackAddress[i] = vkGetBufferDeviceAddress(getDevice(), &info);
+  }
+
+  table.resize(numEntries, 0);
+  entrySlots.resize(numEntries, -1);
+  entryPending.resize(numEntries, false);
+
+  // Load the coarsest level up front, so every lookup has a resident page to fall back on.
+  std::vector<uint8_t> pinnedData((size_t)numPinned * bytesPerPage);
+  std::vector<uint8_t> loaded(numPinned, 0);
+  getThreadPool().parallelFor(numPinned, [&](uint32_t i) {
+    loaded[i] = params.loader((uint32_t)levels.size() - 1, i % coarsest.pagesX, i / coarsest.pagesX, pinnedData.data() + (size_t)i * bytesPerPage);
+  });
+  std::vector<VkBufferImageCopy> regions(numPinned);
+  for (uint32_t i {0}; i < numPinned; ++i) {
+    if (!loaded[i])
+      DEBUG_WARNING("Failed to load page %u of the lowest resolution mip level of virtual texture '%s'.", i, name);
+    const uint32_t entry {coarsest.firstEntry + i};
+    slots[i] = Slot{.entry = (int32_t)entry, .lastUsed = -1, .pinned = true};
+    entrySlots[entry] = (int32_t)i;
+    regions[i] = VkBufferImageCopy{
+      .bufferOffset = (VkDeviceSize)i * bytesPerPage,
+      .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
+      .imageOffset = {(int32_t)((i % params.cachePagesX) * slotSize), (int32_t)((i / params.cachePagesX) * slotSize), 0},
+      .imageExtent = {slotSize, slotSize, 1} };
+  }
+  transfer(cache->_pimpl.get(), pinnedData.data(), pinnedData.size(), regions.size(), regions.data(), false);
+  rebuildTable();
+
+  registerVirtualTexture(this);
+  valid = true;
+
+  auto timeEnd = std::chrono::high_resolution_clock::now();
+  auto timeElapsed = std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - timeStart);
+  DEBUG_OBJCREATION("Created virtual texture '%s' (%ux%u, %zu mip levels, took %.2fms)",
+    name, params.width, params.height, levels.size(), (double)timeElapsed.count() / 1000.0);
+}
+
+hlgl::VirtualTextureImpl::~VirtualTextureImpl() {
+  unregisterVirtualTexture(this);
+  // Loads still in flight own their data, and will finish harmlessly on their own.
+  for (uint32_t i {0}; i < feedback.size(); ++i) {
+    if (feedback[i] || feedbackAlloc[i])
+      queueDeletion(DelQueueBuffer{.buffer = feedback[i], .allocation = feedbackAlloc[i]});
+  }
+}
+
+void hlgl::VirtualTextureImpl::entryPage(uint32_t entry, uint32_t& mip, uint32_t& pageX, uint32_t& pageY) const {
+  mip = 0;
+  while (mip + 1 < levels.size() && entry >= levels[mip + 1].firstEntry)
+    ++mip;
+  const uint32_t index {entry - levels[mip].firstEntry};
+  pageX = index % levels[mip].pagesX;
+  pageY = index / levels[mip].pagesX;
+}
+
+uint32_t hlgl::VirtualTextureImpl::parentEntry(uint32_t entry) const {
+  uint32_t mip, pageX, pageY;
+  entryPage(entry, mip, pageX, pageY);
+  return entryIndex(mip + 1, pageX / 2, pageY / 2);
+}
+
+void hlgl::VirtualTextureImpl::rebuildTable() {
+  for (uint32_t mip {0}; mip < levels.size(); ++mip) {
+    table[mip] = levels[mip].firstEntry;
+    table[maxMips_c + mip] = levels[mip].pagesX;
+    table[maxMips_c * 2 + mip] = levels[mip].pagesY;
+  }
+  // Coarsest first, so each missing page can copy its parent's entry.
+  for (uint32_t mip {(uint32_t)levels.size()}; mip-- > 0;) {
+    for (uint32_t y {0}; y < levels[mip].pagesY; ++y) {
+      for (uint32_t x {0}; x < levels[mip].pagesX; ++x) {
+        const uint32_t entry {entryIndex(mip, x, y)};
+        const int32_t slot {entrySlots[entry]};
+        if (slot >= 0)
+          table[entry] = entryResident_c | (mip << 24) | ((slot / params.cachePagesX) << 12) | (slot % params.cachePagesX);
+        else if (mip + 1 < levels.size())
+          table[entry] = table[entryIndex(mip + 1, x / 2, y / 2)];
+        else
+          table[entry] = 0;
+      }
+    }
+  }
+  ++tableVersion;
+}
+
+void hlgl::VirtualTextureImpl::readFeedback(Frame* frame) {
+  const uint32_t fi {frame->frameIndex};
+  vmaInvalidateAllocation(getAllocator(), feedbackAlloc[fi], 0, VK_WHOLE_SIZE);
+  uint32_t* flags {(uint32_t*)feedbackInfo[fi].pMappedData};
+
+  std::vector<uint32_t> wanted {};
+  for (uint32_t entry {headerSize_c}; entry < numEntries; ++entry) {
+    if (!flags[entry])
+      continue;
+    flags[entry] = 0;
+    // A page's ancestors are what it falls back on, so they're wanted (and kept warm) too.
+    for (uint32_t e {entry};; e = parentEntry(e)) {
+      if (entrySlots[e] >= 0)
+        slots[entrySlots[e]].lastUsed = frame->frameCounter;
+      else if (!entryPending[e])
+        wanted.push_back(e);
+      if (e >= levels.back().firstEntry)
+        break;
+    }
+  }
+  vmaFlushAllocation(getAllocator(), feedbackAlloc[fi], 0, VK_WHOLE_SIZE);
+
+  // Coarse pages first, since they cover more of the screen and unblock their children.
+  std::sort(wanted.begin(), wanted.end(), std::greater<uint32_t>());
+  wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+
+  for (uint32_t entry : wanted) {
+    if (pending.size() >= maxPendingLoads_c)
+      break;
+    auto load {std::make_shared<PendingLoad>()};
+    load->entry = entry;
+    load->data.resize(bytesPerPage);
+    uint32_t mip, pageX, pageY;
+    entryPage(entry, mip, pageX, pageY);
+    load->loaded = getThreadPool().submit([load, loader = params.loader, mip, pageX, pageY]() {
+      return loader(mip, pageX, pageY, load->data.data());
+    });
+    entryPending[entry] = true;
+    pending.push_back(std::move(load));
+  }
+}
+
+void hlgl::VirtualTextureImpl::upload(Frame* frame) {
+  std::vector<std::shared_ptr<PendingLoad>> ready {};
+  for (auto it {pending.begin()}; it != pending.end() && ready.size() < params.maxUploadsPerFrame;) {
+    if (!isReady((*it)->loaded)) {
+      ++it;
+      continue;
+    }
+    if ((*it)->loaded.get())
+      ready.push_back(*it);
+    else
+      entryPending[(*it)->entry] = false;
+    it = pending.erase(it);
+  }
+
+  std::vector<VkBufferImageCopy> regions {};
+  StagingAlloc staging {};
+  if (!ready.empty())
+    staging = allocStaging((DeviceSize)ready.size() * bytesPerPage);
+
+  for (const std::shared_ptr<PendingLoad>& load : ready) {
+    entryPending[load->entry] = false;
+    if (!staging.ptr)
+      continue;
+
+    // Replace the least recently used page, as long as it wasn't wanted by the latest feedback.
+    int32_t victim {-1};
+    for (int32_t i {0}; i < (int32_t)slots.size(); ++i) {
+      if (slots[i].pinned || slots[i].lastUsed >= frame->frameCounter)
+        continue;
+      if (victim < 0 || slots[i].lastUsed < slots[victim].lastUsed)
+        victim = i;
+      if (slots[i].entry < 0)
+        break;
+    }
+    // Every page is in use, so the cache is too small for what's on screen.  The page will be requested again.
+    if (victim < 0)
+      break;
+
+    Slot& slot {slots[victim]};
+    if (slot.entry >= 0)
+      entrySlots[slot.entry] = -1;
+    slot.entry = (int32_t)load->entry;
+    slot.lastUsed = frame->frameCounter;
+    entrySlots[load->entry] = victim;
+
+    memcpy((uint8_t*)staging.ptr + regions.size() * bytesPerPage, load->data.data(), bytesPerPage);
+    regions.push_back(VkBufferImageCopy{
+      .bufferOffset = staging.offset + regions.size() * bytesPerPage,
+      .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
+      .imageOffset = {(int32_t)((victim % params.cachePagesX) * slotSize), (int32_t)((victim / params.cachePagesX) * slotSize), 0},
+      .imageExtent = {slotSize, slotSize, 1} });
+  }
+
+  if (!regions.empty()) {
+    TextureImpl* texture {cache->_pimpl.get()};
+    texture->barrier(frame->cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    vkCmdCopyBufferToImage(frame->cmd, staging.buffer->buffer[0], texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+    texture->barrier(frame->cmd, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    rebuildTable();
+  }
+
+  // Each frame in flight has its own copy of the page table, which is only rewritten when it's out of date.
+  const uint32_t fi {frame->frameIndex};
+  if (uploadedVersion[fi] == tableVersion)
+    return;
+  BufferImpl* buffer {pageTable->_pimpl.get()};
+  const size_t size {table.size() * sizeof(uint32_t)};
+  if (buffer->hostVisible) {
+    memcpy(buffer->allocInfo[fi].pMappedData, table.data(), size);
+    vmaFlushAllocation(getAllocator(), buffer->allocation[fi], 0, VK_WHOLE_SIZE);
+  }
+  else {
+    StagingAlloc tableStaging {allocStaging(size)};
+    if (!tableStaging.ptr)
+      return;
+    memcpy(tableStaging.ptr, table.data(), size);
+    VkBufferCopy copy {.srcOffset = tableStaging.offset, .dstOffset = 0, .size = size};
+    vkCmdCopyBuffer(frame->cmd, tableStaging.buffer->buffer[0], buffer->buffer[fi], 1, &copy);
+    buffer->barrier(frame->cmd, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, fi);
+  }
+  uploadedVersion[fi] = tableVersion;
+}
+
+hlgl::VirtualTexture::ShaderParams hlgl::VirtualTexture::getShaderParams() const {
+  if (!_pimpl)
+    return {};
+  Frame* frame {getCurrentFrame()};
+  const uint32_t fi {frame ? frame->frameIndex : 0};
+  const VirtualTextureImpl& vt {*_pimpl};
+  return ShaderParams{
+    .pageTable = vt.pageTable->_pimpl->deviceAddress[fi],
+    .feedback = vt.feedbackAddress[fi],
+    .cacheIndex = vt.cache->getSamplerIndex(),
+    .width = vt.params.width,
+    .height = vt.params.height,
+    .pageSize = vt.params.pageSize,
+    .pageBorder = vt.params.pageBorder,
+    .cacheWidth = vt.params.cachePagesX * vt.slotSize,
+    .cacheHeight = vt.params.cachePagesY * vt.slotSize,
+    .numMips = (uint32_t)vt.levels.size() };
+}
+
+uint32_t hlgl::VirtualTexture::getResidentPageCount() const {
+  if (!_pimpl)
+    return 0;
+  return (uint32_t)std::count_if(_pimpl->slots.begin(), _pimpl->slots.end(), [](const VirtualTextureImpl::Slot& slot) { return slot.entry >= 0; });
+}
+
+void hlgl::shutdownVirtualTextures() {
+  textures_s.clear();
+}
+
+void hlgl::registerVirtualTexture(VirtualTextureImpl* texture) {
+  textures_s.push_back(texture);
+}
+
+void hlgl::unregisterVirtualTexture(VirtualTextureImpl* texture) {
+  auto it {std::find(textures_s.begin(), textures_s.end(), texture)};
+  if (it != textures_s.end()) {
+    *it = textures_s.back();
+    textures_s.pop_back();
+  }
+}
+
+void hlgl::updateVirtualTextures(Frame* frame) {
+  for (VirtualTextureImpl* texture : textures_s) {
+    texture->readFeedback(frame);
+    texture->upload(frame);
+  }
+}
@@ -0,0 +1,90 @@
+#ifndef HLGL_VK_VIRTUAL_TEXTURE_H
+#define HLGL_VK_VIRTUAL_TEXTURE_H
+
+#include <hlgl.h>
+#include "context.h"
+#include "vulkan-headers.h"
+
+#include <array>
+#include <future>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace hlgl {
+
+struct VirtualTextureImpl {
+  VirtualTextureImpl(VirtualTexture::CreateParams&& params);
+  ~VirtualTextureImpl();
+
+  // The page table starts with a header giving each mip level's first entry and size in pages, followed by one entry per page.
+  // An entry holds the cache slot and mip level of the most detailed resident page covering it, so missing pages fall back to coarser ones.
+  static constexpr uint32_t maxMips_c {16};
+  static constexpr uint32_t headerSize_c {maxMips_c * 3};
+  static constexpr uint32_t entryResident_c {0x80000000u};
+
+  struct Level {
+    uint32_t firstEntry;
+    uint32_t pagesX;
+    uint32_t pagesY;
+  };
+
+  // A page-sized region of the cache texture.
+  struct Slot {
+    int32_t entry {-1};     // The page table entry whose page is stored here, or -1 if empty.
+    int64_t lastUsed {-1};  // The frame on which feedback last asked for this page.
+    bool pinned {false};    // Pages of the coarsest mip level are never evicted, so there's always something to fall back on.
+  };
+
+  // A page being loaded on a worker thread.  Shared with the task, so the data outlives the texture if it's destroyed mid-load.
+  struct PendingLoad {
+    uint32_t entry {0};
+    std::vector<uint8_t> data {};
+    std::future<bool> loaded {};
+  };
+
+  VirtualTexture::CreateParams params {};
+  uint32_t slotSize {0};      // Page size plus the border on both sides.
+  uint32_t bytesPerPage {0};
+  std::vector<Level> levels {};
+  uint32_t numEntries {0};    // Including the header.
+
+  std::optional<Texture> cache {};
+  std::optional<Buffer> pageTable {};
+  std::array<VkBuffer, numFramesInFlight_c> feedback {};
+  std::array<VmaAllocation, numFramesInFlight_c> feedbackAlloc {};
+  std::array<VmaAllocationInfo, numFramesInFlight_c> feedbackInfo {};
+  std::array<VkDeviceAddress, numFramesInFlight_c> feedbackAddress {};
+
+  std::vector<uint32_t> table {};       // CPU copy of the page table.
+  std::vector<int32_t> entrySlots {};   // The cache slot holding each entry's page, or -1.
+  std::vector<bool> entryPending {};
+  std::vector<Slot> slots {};
+  std::vector<std::shared_ptr<PendingLoad>> pending {};
+  uint64_t tableVersion {0};
+  std::array<uint64_t, numFramesInFlight_c> uploadedVersion {};
+  bool valid {false};
+
+  uint32_t entryIndex(uint32_t mip, uint32_t pageX, uint32_t pageY) const { return levels[mip].firstEntry + pageY * levels[mip].pagesX + pageX; }
+  void entryPage(uint32_t entry, uint32_t& mip, uint32_t& pageX, uint32_t& pageY) const;
+  uint32_t parentEntry(uint32_t entry) const;
+
+  // Rewrites the CPU copy of the page table after pages have been added or evicted.
+  void rebuildTable();
+  // Reads back the feedback written by the frame which last used this frame's buffers, and starts loading any missing pages.
+  void readFeedback(Frame* frame);
+  // Copies loaded pages into the cache, and the page table into this frame's buffer if it's out of date.
+  void upload(Frame* frame);
+};
+
+void shutdownVirtualTextures();
+
+void registerVirtualTexture(VirtualTextureImpl* texture);
+void unregisterVirtualTexture(VirtualTextureImpl* texture);
+
+// Reads feedback, schedules page loads, and uploads finished pages for every virtual texture.
+// Must be called at the beginning of a frame, after the frame's fence has been waited on and its command buffer has begun recording.
+void updateVirtualTextures(Frame* frame);
+
+} // namespace hlgl
+#endif // HLGL_VK_VIRTUAL_TEXTURE_H